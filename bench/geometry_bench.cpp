@@ -0,0 +1,131 @@
+//
+// Created by henryco on 20/07/24.
+//
+// Per frame geometry cost of pose estimation for N views:
+// undistortion of 39 landmarks per view and epipolar lines
+// of 39 landmarks for every ordered pair of views.
+// Compares previous cv::Mat based path with fixed size (glm) one.
+//
+// Usage: xmotion_geometry_bench [frames=2000]
+//
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include <opencv2/calib3d.hpp>
+
+#include "../xmotion/core/utils/geometry.h"
+
+namespace {
+
+    constexpr int MARKS = 39;
+
+    typedef struct View {
+        cv::Mat K;
+        cv::Mat D;
+        xm::util::geom::Camera camera;
+        cv::Point2f points[MARKS];
+    } View;
+
+    cv::Vec3f cv_epi_line(const cv::Mat &F, const cv::Point2f &point) {
+        const cv::Mat pt = (cv::Mat_<double>(3, 1) << point.x, point.y, 1.f);
+        const cv::Mat line = F * pt;
+        cv::Vec3f res = {
+                (float) line.at<double>(0, 0),
+                (float) line.at<double>(1, 0),
+                (float) line.at<double>(2, 0)
+        };
+        const auto norm = (float) std::sqrt(std::pow(res[0], 2) + std::pow(res[1], 2));
+        if (norm != 0)
+            res /= norm;
+        return res;
+    }
+
+    double run_cv(const std::vector<View> &views, const std::vector<cv::Mat> &F, int frames) {
+        const int n = (int) views.size();
+        float sink = 0;
+        const auto t0 = std::chrono::steady_clock::now();
+        for (int f = 0; f < frames; f++) {
+            std::vector<std::vector<cv::Point2f>> undistorted(n);
+            for (int i = 0; i < n; i++) {
+                const auto R = cv::Mat::eye(3, 3, CV_64F);
+                const auto K = views[i].K.clone();
+                const auto D = views[i].D.clone();
+                std::vector<cv::Point2f> in(views[i].points, views[i].points + MARKS);
+                cv::undistortPoints(in, undistorted[i], K, D, R, K);
+            }
+            for (int i = 0; i < n; i++)
+                for (int j = 0; j < n; j++) {
+                    if (i == j)
+                        continue;
+                    for (int k = 0; k < MARKS; k++)
+                        sink += cv_epi_line(F[i * n + j], undistorted[i][k])[2];
+                }
+        }
+        const auto t1 = std::chrono::steady_clock::now();
+        if (sink == 42.f)
+            std::printf(" ");
+        return (double) std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count() / frames;
+    }
+
+    double run_geom(const std::vector<View> &views, const std::vector<xm::util::geom::Mat3> &F, int frames) {
+        const int n = (int) views.size();
+        std::vector<xm::util::geom::Point> undistorted((size_t) n * MARKS);
+        xm::util::geom::Line lines[MARKS];
+        float sink = 0;
+        const auto t0 = std::chrono::steady_clock::now();
+        for (int f = 0; f < frames; f++) {
+            for (int i = 0; i < n; i++) {
+                auto *out = &undistorted[(size_t) i * MARKS];
+                for (int k = 0; k < MARKS; k++)
+                    out[k] = {views[i].points[k].x, views[i].points[k].y};
+                xm::util::geom::undistort(views[i].camera, out, out, MARKS);
+            }
+            for (int i = 0; i < n; i++)
+                for (int j = 0; j < n; j++) {
+                    if (i == j)
+                        continue;
+                    xm::util::geom::epi_lines(F[i * n + j], &undistorted[(size_t) i * MARKS], lines, MARKS);
+                    for (const auto &l: lines)
+                        sink += l.z;
+                }
+        }
+        const auto t1 = std::chrono::steady_clock::now();
+        if (sink == 42.f)
+            std::printf(" ");
+        return (double) std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count() / frames;
+    }
+}
+
+int main(int argc, char **argv) {
+    const int frames = argc > 1 ? std::atoi(argv[1]) : 2000;
+    cv::RNG rng(42);
+
+    std::printf("views | cv::Mat ns/frame | glm ns/frame | speedup\n");
+    for (const int n: {2, 4, 8}) {
+        std::vector<View> views(n);
+        for (auto &view: views) {
+            view.K = (cv::Mat_<double>(3, 3) << 1400, 0, 960, 0, 1400, 540, 0, 0, 1);
+            view.D = (cv::Mat_<double>(1, 5) << -0.12, 0.05, 0.001, -0.001, -0.01);
+            view.camera = xm::util::geom::camera(view.K, view.D);
+            for (auto &point: view.points)
+                point = {rng.uniform(0.f, 1920.f), rng.uniform(0.f, 1080.f)};
+        }
+
+        std::vector<cv::Mat> F_cv;
+        std::vector<xm::util::geom::Mat3> F_glm;
+        for (int k = 0; k < n * n; k++) {
+            cv::Mat F(3, 3, CV_64F);
+            rng.fill(F, cv::RNG::UNIFORM, -1e-3, 1e-3);
+            F_cv.push_back(F);
+            F_glm.push_back(xm::util::geom::mat3(F));
+        }
+
+        const double t_cv = run_cv(views, F_cv, frames);
+        const double t_glm = run_geom(views, F_glm, frames);
+        std::printf("%5d | %16.0f | %12.0f | %6.1fx\n", n, t_cv, t_glm, t_cv / t_glm);
+    }
+    return 0;
+}
@@ -0,0 +1,132 @@
+//
+// Created by henryco on 21/07/24.
+//
+// Sustained raw recording throughput: N cameras at given fps are pushed
+// to the recorder in real time (the same way capture loop does), reports
+// input / output MB/s, compression ratio, CPU cost and dropped frames.
+// Frames are either synthetic (moving gradient with sensor-like noise)
+// or cycled from a clip (decoded up front, so decoding is not measured).
+//
+// Usage: xmotion_raw_record_bench <out> [cameras=4] [fps=60] [seconds=10] [threads=4] [clip]
+//
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <thread>
+#include <vector>
+
+#include <opencv2/imgproc.hpp>
+#include <opencv2/videoio.hpp>
+
+#include <sys/resource.h>
+
+#include "../xmotion/core/sink/raw_recorder.h"
+
+namespace {
+
+    constexpr int WIDTH = 1920;
+    constexpr int HEIGHT = 1080;
+    constexpr int FRAMES = 120;
+
+    std::vector<cv::Mat> synthetic(int n) {
+        std::vector<cv::Mat> frames;
+        frames.reserve(n);
+
+        cv::Mat noise(HEIGHT, WIDTH, CV_8UC3);
+        for (int i = 0; i < n; i++) {
+            cv::Mat frame(HEIGHT, WIDTH, CV_8UC3);
+            for (int y = 0; y < HEIGHT; y++) {
+                auto *row = frame.ptr<uint8_t>(y);
+                for (int x = 0; x < WIDTH; x++) {
+                    row[x * 3 + 0] = (uint8_t) ((x + i * 4) / 8);
+                    row[x * 3 + 1] = (uint8_t) ((y + i * 2) / 5);
+                    row[x * 3 + 2] = (uint8_t) ((x + y) / 12);
+                }
+            }
+            cv::rectangle(frame, cv::Rect(200 + i * 8, 300, 300, 600), cv::Scalar(40, 60, 180), cv::FILLED);
+            cv::randu(noise, 0, 4);
+            frame += noise;
+            frames.push_back(frame);
+        }
+        return frames;
+    }
+
+    std::vector<cv::Mat> clip(const std::string &file, int n) {
+        cv::VideoCapture capture(file);
+        std::vector<cv::Mat> frames;
+        cv::Mat frame;
+        while ((int) frames.size() < n && capture.read(frame)) {
+            cv::Mat resized;
+            cv::resize(frame, resized, cv::Size(WIDTH, HEIGHT));
+            frames.push_back(resized);
+        }
+        return frames;
+    }
+
+    double cpu_seconds() {
+        rusage usage{};
+        getrusage(RUSAGE_SELF, &usage);
+        return (double) usage.ru_utime.tv_sec + (double) usage.ru_utime.tv_usec / 1e6
+               + (double) usage.ru_stime.tv_sec + (double) usage.ru_stime.tv_usec / 1e6;
+    }
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        std::printf("Usage: %s <out> [cameras=4] [fps=60] [seconds=10] [threads=4] [clip]\n", argv[0]);
+        return 1;
+    }
+
+    const std::filesystem::path out = argv[1];
+    const int cameras = argc > 2 ? std::max(1, std::atoi(argv[2])) : 4;
+    const int fps = argc > 3 ? std::max(1, std::atoi(argv[3])) : 60;
+    const int seconds = argc > 4 ? std::max(1, std::atoi(argv[4])) : 10;
+    const int threads = argc > 5 ? std::max(1, std::atoi(argv[5])) : 4;
+
+    const auto frames = argc > 6 ? clip(argv[6], FRAMES) : synthetic(FRAMES);
+    if (frames.empty()) {
+        std::printf("No frames\n");
+        return 1;
+    }
+
+    std::vector<std::string> names;
+    for (int i = 0; i < cameras; i++)
+        names.push_back("cam_" + std::to_string(i));
+
+    xm::sink::RawRecorder recorder(out.string(), names, threads, 4, 600);
+    recorder.open();
+
+    const auto period = std::chrono::nanoseconds(1'000'000'000LL / fps);
+    const int total = fps * seconds;
+    std::vector<cv::Mat> set(cameras);
+
+    const double cpu0 = cpu_seconds();
+    const auto t0 = std::chrono::steady_clock::now();
+    for (int f = 0; f < total; f++) {
+        // cameras are not looking at the very same thing
+        for (int i = 0; i < cameras; i++)
+            set[i] = frames[(f + i * 17) % frames.size()];
+
+        recorder.push(set);
+        std::this_thread::sleep_until(t0 + period * (f + 1));
+    }
+    recorder.close();
+    const double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    const double cpu = cpu_seconds() - cpu0;
+
+    const auto stats = recorder.stats();
+    const double offered = (double) total * cameras;
+    std::printf("%-10s %10s %10s %8s %10s %10s %10s\n",
+                "cameras", "in MB/s", "out MB/s", "ratio", "ms/frame", "cpu cores", "dropped");
+    std::printf("%dx%dx%d@%d %8.1f %10.1f %8.3f %10.2f %10.2f %9.2f%%\n",
+                cameras, WIDTH, HEIGHT, fps,
+                (double) stats.bytes_in / wall / 1e6,
+                (double) stats.bytes_out / wall / 1e6,
+                stats.bytes_in > 0 ? (double) stats.bytes_out / (double) stats.bytes_in : 0.,
+                stats.frames > 0 ? stats.cpu_ms / (double) stats.frames : 0.,
+                cpu / wall,
+                100. * (double) stats.dropped / offered);
+    return 0;
+}
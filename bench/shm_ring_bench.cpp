@@ -0,0 +1,151 @@
+//
+// Created by henryco on 16/07/24.
+//
+// Shared memory pose ring latency benchmark.
+// Single writer, N readers (threads, each with its own read-only mapping),
+// readers are blocking on futex, latency is measured from publish to copy-out.
+//
+// Usage: xmotion_shm_bench [readers=4] [rate_hz=1000] [seconds=5] [devices=4]
+//
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+#include "../xmotion/core/sink/shm_ring.h"
+
+namespace {
+
+    constexpr size_t PACKET_HEADER = 32;
+    constexpr size_t PACKET_DEVICE = 1256;
+    constexpr const char *RING_NAME = "/xmotion_shm_bench";
+
+    typedef struct ReaderStats {
+        std::vector<int64_t> latency;
+        uint64_t lost = 0;
+        uint64_t torn = 0;
+    } ReaderStats;
+
+    int64_t percentile(std::vector<int64_t> &values, double p) {
+        if (values.empty())
+            return 0;
+        const auto idx = (size_t) ((double) (values.size() - 1) * p);
+        std::nth_element(values.begin(), values.begin() + (long) idx, values.end());
+        return values[idx];
+    }
+
+    void reader(const std::atomic<bool> &alive, ReaderStats &stats, size_t capacity) {
+        xm_ring ring{};
+        if (xm_ring_open(RING_NAME, &ring) != 0) {
+            std::fprintf(stderr, "cannot open ring\n");
+            return;
+        }
+
+        std::vector<char> buffer(capacity);
+        uint64_t last = xm_ring_head(&ring);
+
+        while (alive.load(std::memory_order_relaxed)) {
+            if (xm_ring_wait(&ring, last, 100) <= 0)
+                continue;
+
+            // every frame published since the last wake up, not just the newest one
+            const uint64_t head = xm_ring_head(&ring);
+            for (uint64_t n = last + 1; n <= head; n++) {
+                uint32_t size;
+                int64_t published;
+                const int status = xm_ring_read(&ring, n, buffer.data(), (uint32_t) capacity, &size, &published);
+                const int64_t now = xm_ring_now();
+
+                // overwritten by the writer before it was read
+                if (status == -1) {
+                    stats.lost += 1;
+                    continue;
+                }
+
+                if (status != 0) {
+                    stats.torn += 1;
+                    continue;
+                }
+
+                stats.latency.push_back(now - published);
+            }
+
+            last = head;
+        }
+
+        xm_ring_close(&ring);
+    }
+
+}
+
+int main(int argc, char **argv) {
+    const int readers = argc > 1 ? std::atoi(argv[1]) : 4;
+    const int rate = argc > 2 ? std::atoi(argv[2]) : 1000;
+    const int seconds = argc > 3 ? std::atoi(argv[3]) : 5;
+    const int devices = argc > 4 ? std::atoi(argv[4]) : 4;
+
+    if (readers <= 0 || rate <= 0 || seconds <= 0 || devices <= 0) {
+        std::fprintf(stderr, "usage: %s [readers] [rate_hz] [seconds] [devices]\n", argv[0]);
+        return 1;
+    }
+
+    const auto payload = PACKET_HEADER + (size_t) devices * PACKET_DEVICE;
+    xm::sink::ShmRing ring(RING_NAME, 64, (uint32_t) payload);
+    ring.open();
+
+    std::atomic<bool> alive = true;
+    std::vector<ReaderStats> stats(readers);
+    std::vector<std::thread> threads;
+    threads.reserve(readers);
+    for (int i = 0; i < readers; i++)
+        threads.emplace_back(reader, std::cref(alive), std::ref(stats[i]), payload);
+
+    // let readers map the ring
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    std::vector<char> packet(payload, 0);
+    const auto period = std::chrono::nanoseconds(1000000000ll / rate);
+    const auto total = (uint64_t) rate * (uint64_t) seconds;
+    auto next = std::chrono::steady_clock::now();
+
+    std::vector<int64_t> write_cost;
+    write_cost.reserve(total);
+    for (uint64_t i = 0; i < total; i++) {
+        std::this_thread::sleep_until(next);
+        next += period;
+
+        const auto t0 = xm_ring_now();
+        ring.publish(packet.data(), (uint32_t) packet.size());
+        write_cost.push_back(xm_ring_now() - t0);
+    }
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    alive = false;
+    for (auto &t: threads)
+        t.join();
+
+    ring.close();
+
+    std::printf("frames: %llu, payload: %zu bytes, rate: %d Hz, readers: %d\n",
+                (unsigned long long) total, payload, rate, readers);
+    std::printf("writer publish [us]: p50 %.2f, p99 %.2f, max %.2f\n",
+                (double) percentile(write_cost, .5) / 1000.,
+                (double) percentile(write_cost, .99) / 1000.,
+                (double) percentile(write_cost, 1.) / 1000.);
+
+    for (int i = 0; i < readers; i++) {
+        auto &s = stats[i];
+        std::printf("reader %d [us]: frames %zu, lost %llu, torn %llu, p50 %.2f, p99 %.2f, max %.2f\n",
+                    i, s.latency.size(),
+                    (unsigned long long) s.lost,
+                    (unsigned long long) s.torn,
+                    (double) percentile(s.latency, .5) / 1000.,
+                    (double) percentile(s.latency, .99) / 1000.,
+                    (double) percentile(s.latency, 1.) / 1000.);
+    }
+
+    return 0;
+}
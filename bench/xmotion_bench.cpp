@@ -0,0 +1,558 @@
+//
+// Created by henryco on 21/07/24.
+//
+// Hot path benchmark suite, results are written as JSON so runs
+// (ie: before and after dependency upgrade) can be diffed:
+//   micro:  convert_to_squared_blob, ssd::decode_bboxes, VelocityFilter
+//   ocl:    every filter of ocl_filters.cpp, BgSubtract, flip_rotate, copy_ocl,
+//           from_cv_mat upload (480p, 720p, 1080p)
+//   dnn:    interpreter invocation of every model file found (GPU delegate
+//           for float models, XNNPACK for full-integer ones)
+//   stage:  PosePipeline::pass over synthetic or recorded clip
+//
+// Input is either synthetic (moving gradient with green backdrop and sensor-like noise),
+// a video file or a raw recording directory (see RawRecorder), decoded up front.
+// Models are loaded relatively to working directory (same as xmotion), missing ones are skipped.
+//
+// CPU-only OpenCL (ie: PoCL): OPENCV_OPENCL_DEVICE=":CPU:" xmotion_bench ...
+// CPU backend (see ocl_cpu.h, no OpenCL at all): xmotion_bench <out.json> - "" 1000 cpu
+//
+// Usage: xmotion_bench <out.json> [clip|recording|-] [filter] [budget_ms=1000] [backend=opencl]
+//
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <opencv2/core/ocl.hpp>
+#include <opencv2/core/version.hpp>
+#include <opencv2/imgproc.hpp>
+#include <opencv2/videoio.hpp>
+
+#include <nlohmann/json.hpp>
+
+#include "../xmotion/core/ocl/ocl_filters.h"
+#include "../xmotion/core/ocl/ocl_interop.h"
+#include "../xmotion/core/ocl/ocl_cpu.h"
+#include "../xmotion/core/filter/bg_subtract.h"
+#include "../xmotion/core/dnn/net/dnn_common.h"
+#include "../xmotion/core/dnn/net/ssd_anchors.h"
+#include "../xmotion/core/dnn/net/blaze_pose.h"
+#include "../xmotion/core/dnn/net/pose_detector.h"
+#include "../xmotion/core/dnn/pose_pipeline.h"
+#include "../xmotion/core/utils/velocity_filter.h"
+#include "../xmotion/core/camera/raw_reader.h"
+
+namespace {
+
+    using json = nlohmann::json;
+
+    constexpr int WARMUP = 3;
+    constexpr int MIN_ITERATIONS = 10;
+    constexpr int MAX_ITERATIONS = 5000;
+    constexpr int FRAMES = 60;
+
+    /**
+     * Same number of filters pose pipeline uses: 39 landmarks * (x, y, z)
+     */
+    constexpr int VELOCITY_FILTERS = 117;
+
+    const std::vector<std::pair<std::string, cv::Size>> RESOLUTIONS = {
+            {"480p",  {640,  480}},
+            {"720p",  {1280, 720}},
+            {"1080p", {1920, 1080}},
+    };
+
+    class Suite {
+        json results = json::array();
+        std::string filter;
+        double budget_ms;
+
+    public:
+        Suite(std::string filter, double budget_ms) : filter(std::move(filter)), budget_ms(budget_ms) {}
+
+        [[nodiscard]] bool enabled(const std::string &name) const {
+            return filter.empty() || name.find(filter) != std::string::npos;
+        }
+
+        /**
+         * Runs fn (which must block until its work is done) for at least budget_ms
+         * and MIN_ITERATIONS, after WARMUP untimed runs
+         */
+        void run(const std::string &name, const json &params, const std::function<void(int)> &fn) {
+            if (!enabled(name))
+                return;
+
+            std::vector<double> samples;
+            try {
+                for (int i = 0; i < WARMUP; i++)
+                    fn(i);
+
+                double total = 0;
+                for (int i = 0; i < MAX_ITERATIONS && (total < budget_ms || i < MIN_ITERATIONS); i++) {
+                    const auto t0 = std::chrono::steady_clock::now();
+                    fn(i);
+                    const auto ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+                    samples.push_back(ms);
+                    total += ms;
+                }
+            } catch (const std::exception &e) {
+                std::printf("%-32s %-40s error: %s\n", name.c_str(), params.dump().c_str(), e.what());
+                results.push_back({{"name", name}, {"params", params}, {"error", e.what()}});
+                return;
+            }
+
+            std::sort(samples.begin(), samples.end());
+            const auto n = samples.size();
+            double mean = 0;
+            for (const auto s: samples)
+                mean += s;
+            mean /= (double) n;
+            double var = 0;
+            for (const auto s: samples)
+                var += (s - mean) * (s - mean);
+
+            const json ms = {
+                    {"mean",   mean},
+                    {"median", samples[n / 2]},
+                    {"p90",    samples[std::min(n - 1, n * 9 / 10)]},
+                    {"min",    samples.front()},
+                    {"max",    samples.back()},
+                    {"stddev", std::sqrt(var / (double) n)},
+            };
+
+            std::printf("%-32s %-40s %6zu it, median: %9.3f ms, p90: %9.3f ms\n",
+                        name.c_str(), params.dump().c_str(), n, samples[n / 2], (double) ms["p90"]);
+            results.push_back({{"name", name}, {"params", params}, {"iterations", n}, {"ms", ms}});
+        }
+
+        void skip(const std::string &name, const json &params, const std::string &reason) {
+            if (!enabled(name))
+                return;
+            std::printf("%-32s %-40s skipped: %s\n", name.c_str(), params.dump().c_str(), reason.c_str());
+            results.push_back({{"name", name}, {"params", params}, {"skipped", reason}});
+        }
+
+        [[nodiscard]] const json &get() const {
+            return results;
+        }
+    };
+
+    std::vector<cv::Mat> synthetic(int n) {
+        const auto &size = RESOLUTIONS.back().second;
+        std::vector<cv::Mat> frames;
+        frames.reserve(n);
+
+        cv::Mat noise(size, CV_8UC3);
+        for (int i = 0; i < n; i++) {
+            cv::Mat frame(size, CV_8UC3);
+            for (int y = 0; y < size.height; y++) {
+                auto *row = frame.ptr<uint8_t>(y);
+                for (int x = 0; x < size.width; x++) {
+                    row[x * 3 + 0] = (uint8_t) ((x + i * 4) / 8);
+                    row[x * 3 + 1] = (uint8_t) ((y + i * 2) / 5);
+                    row[x * 3 + 2] = (uint8_t) ((x + y) / 12);
+                }
+            }
+            // backdrop for chroma key, "subject" moving in front of it
+            cv::rectangle(frame, cv::Rect(size.width / 4, 0, size.width / 2, size.height), cv::Scalar(40, 200, 40), cv::FILLED);
+            cv::rectangle(frame, cv::Rect(size.width / 3 + i * 4, size.height / 4, size.width / 8, size.height / 2), cv::Scalar(40, 60, 180), cv::FILLED);
+            cv::randu(noise, 0, 4);
+            frame += noise;
+            frames.push_back(frame);
+        }
+        return frames;
+    }
+
+    std::vector<cv::Mat> recorded(const std::string &path, int n) {
+        std::vector<cv::Mat> frames;
+        cv::Mat frame;
+
+        if (xm::RawReader::is_recording(path)) {
+            xm::RawReader reader;
+            reader.open(path);
+            while ((int) frames.size() < n && reader.read(frame))
+                frames.push_back(frame.clone());
+            return frames;
+        }
+
+        cv::VideoCapture capture(path);
+        while ((int) frames.size() < n && capture.read(frame))
+            frames.push_back(frame.clone());
+        return frames;
+    }
+
+    std::vector<cv::Mat> resized(const std::vector<cv::Mat> &frames, const cv::Size &size) {
+        std::vector<cv::Mat> out;
+        out.reserve(frames.size());
+        for (const auto &frame: frames) {
+            cv::Mat r;
+            cv::resize(frame, r, size);
+            out.push_back(r);
+        }
+        return out;
+    }
+
+    void micro(Suite &suite, const std::vector<cv::Mat> &frames) {
+        for (const auto &[label, size]: RESOLUTIONS) {
+            const auto input = resized(frames, size);
+            for (const int blob: {224, 256}) {
+                suite.run("dnn.convert_to_squared_blob", {{"resolution", label}, {"size", blob}, {"mem", "host"}}, [&](int i) {
+                    eox::dnn::convert_to_squared_blob(input[i % input.size()], blob, true);
+                });
+            }
+
+            cv::UMat device;
+            input.front().copyTo(device);
+            suite.run("dnn.convert_to_squared_blob", {{"resolution", label}, {"size", 256}, {"mem", "device"}}, [&](int) {
+                const auto out = eox::dnn::convert_to_squared_blob(device, 256, true);
+                cv::ocl::finish();
+            });
+        }
+
+        // detector's outputs: 2254 anchors (224x224 models), random logits
+        const auto &meta = eox::dnn::box::mappings[eox::dnn::box::ORIGIN];
+        const auto anchors = eox::dnn::ssd::generate_anchors(eox::dnn::ssd::SSDAnchorOptions(
+                5, 0.15, 0.75, meta.i_w, meta.i_h, 0.5, 0.5,
+                {8, 16, 32, 32, 32}, {1.0}, false, 1.0, true));
+
+        std::mt19937 random(42);
+        std::normal_distribution<float> logits(-4.f, 3.f);
+        std::uniform_real_distribution<float> coords(-20.f, 20.f);
+        std::vector<float> scores(anchors.size());
+        std::vector<std::array<float, 12>> bboxes(anchors.size());
+        for (size_t i = 0; i < anchors.size(); i++) {
+            scores[i] = logits(random);
+            for (auto &c: bboxes[i])
+                c = coords(random);
+        }
+
+        for (const bool best: {true, false}) {
+            suite.run("ssd.decode_bboxes", {{"anchors", anchors.size()}, {"best_only", best}}, [&](int) {
+                eox::dnn::ssd::decode_bboxes(0.5f, scores, bboxes, anchors, (float) meta.i_w, best);
+            });
+        }
+
+        std::vector<eox::sig::VelocityFilter> filters;
+        filters.reserve(VELOCITY_FILTERS);
+        for (int i = 0; i < VELOCITY_FILTERS; i++)
+            filters.emplace_back(30, 0.5f, 30);
+
+        std::uniform_real_distribution<float> marks(0.f, 1.f);
+        std::vector<float> values(VELOCITY_FILTERS * FRAMES);
+        for (auto &v: values)
+            v = marks(random);
+
+        // one iteration == one frame of pose pipeline
+        auto timestamp = std::chrono::nanoseconds(0);
+        suite.run("sig.velocity_filter", {{"filters", VELOCITY_FILTERS}}, [&](int i) {
+            timestamp += std::chrono::nanoseconds(33'333'333);
+            const auto offset = (i % FRAMES) * VELOCITY_FILTERS;
+            for (int f = 0; f < VELOCITY_FILTERS; f++)
+                filters[f].filter(timestamp, values[offset + f]);
+        });
+    }
+
+    void ocl(Suite &suite, const std::vector<cv::Mat> &frames) {
+        // cpu backend: host images, ops ignore the queue
+        const bool cpu = xm::ocl::cpu::enabled();
+        const auto queue = cpu ? nullptr : xm::ocl::Kernels::instance().retrieve_queue(0);
+
+        const auto hls_low = xm::ds::Color4u::hls(70, 40, 80);
+        const auto hls_up = xm::ds::Color4u::hls(100, 220, 255);
+        const auto color = xm::ds::Color4u::bgr(255, 255, 255);
+
+        for (const auto &[label, size]: RESOLUTIONS) {
+            const auto input = resized(frames, size);
+            const json p = {{"resolution", label}};
+
+            suite.run("iop.from_cv_mat", p, [&](int i) {
+                xm::ocl::iop::from_cv_mat(input[i % input.size()], queue).waitFor();
+            });
+
+            std::vector<xm::ocl::Image2D> images;
+            std::vector<cv::UMat> umats(input.size());
+            for (size_t i = 0; i < input.size(); i++) {
+                images.push_back(xm::ocl::iop::from_cv_mat(input[i], queue).waitFor().getImage2D());
+                input[i].copyTo(umats[i]);
+            }
+            const auto image = [&](int i) { return xm::ocl::iop::ClImagePromise(images[i % images.size()]); };
+            const auto umat = [&](int i) -> const cv::UMat & { return umats[i % umats.size()]; };
+
+            suite.run("iop.copy_ocl", {{"resolution", label}, {"region", "full"}}, [&](int i) {
+                xm::ocl::iop::copy_ocl(images[i % images.size()], queue).waitFor();
+            });
+            suite.run("iop.copy_ocl", {{"resolution", label}, {"region", "half"}}, [&](int i) {
+                xm::ocl::iop::copy_ocl(images[i % images.size()], queue,
+                                       size.width / 4, size.height / 4, size.width / 2, size.height / 2).waitFor();
+            });
+
+            for (const auto &[fx, fy, rot]: std::vector<std::tuple<bool, bool, bool>>{{true, false, false}, {true, true, true}}) {
+                suite.run("ocl.flip_rotate", {{"resolution", label}, {"flip_x", fx}, {"flip_y", fy}, {"rotate", rot}}, [&](int i) {
+                    xm::ocl::flip_rotate(queue, image(i), fx, fy, rot).waitFor();
+                });
+            }
+
+            for (const int k: {5, 15}) {
+                suite.run("ocl.blur", {{"resolution", label}, {"kernel", k}}, [&](int i) {
+                    xm::ocl::blur(queue, image(i), k).waitFor();
+                });
+            }
+
+            cv::UMat mask, out;
+            const cv::Scalar low(hls_low[0], hls_low[1], hls_low[2]);
+            const cv::Scalar up(hls_up[0], hls_up[1], hls_up[2]);
+            suite.run("ocl.bgr_in_range_hls", p, [&](int i) {
+                xm::ocl::bgr_in_range_hls(low, up, umat(i), mask);
+            });
+
+            xm::ocl::bgr_in_range_hls(low, up, umats.front(), mask);
+            suite.run("ocl.dilate", {{"resolution", label}, {"kernel", 3}, {"iterations", 2}}, [&](int) {
+                xm::ocl::dilate(mask, out, 2, 3);
+            });
+            suite.run("ocl.erode", {{"resolution", label}, {"kernel", 3}, {"iterations", 2}}, [&](int) {
+                xm::ocl::erode(mask, out, 2, 3);
+            });
+            suite.run("ocl.apply_mask_with_color", p, [&](int i) {
+                xm::ocl::apply_mask_with_color(cv::Scalar(255, 255, 255), umat(i), mask, out);
+            });
+
+            // ROI in the middle, same resolution as landmarks model output
+            std::vector<float> logits(256 * 256, 1.f);
+            suite.run("ocl.apply_segmentation", {{"resolution", label}, {"logits", 256}}, [&](int i) {
+                xm::ocl::apply_segmentation(logits.data(), 256, 256, 0.5f,
+                                            (float) size.width / 4.f, (float) size.height / 8.f,
+                                            (float) size.width / 2.f, (float) size.height * 3.f / 4.f,
+                                            umat(i), out);
+            });
+
+            for (const int mask_size: {256, 512}) {
+                const json pc = {{"resolution", label}, {"mask", mask_size}};
+                suite.run("ocl.chroma_key", pc, [&](int i) {
+                    xm::ocl::chroma_key(queue, image(i), hls_low, hls_up, color, false, mask_size, 5, 3, 1).waitFor();
+                });
+                suite.run("ocl.chroma_key_single_pass", pc, [&](int i) {
+                    xm::ocl::chroma_key_single_pass(queue, image(i), hls_low, hls_up, color, false, mask_size, 5).waitFor();
+                });
+                suite.run("ocl.chroma_mask", pc, [&](int i) {
+                    xm::ocl::chroma_mask(queue, image(i), hls_low, hls_up, false, mask_size, 5, 3, 1).waitFor();
+                });
+
+                auto key = xm::ocl::chroma_mask(queue, image(0), hls_low, hls_up, false, mask_size, 5, 3, 1);
+                key.waitFor();
+                suite.run("ocl.chroma_apply", pc, [&](int i) {
+                    xm::ocl::chroma_apply(queue, image(i), key, color).waitFor();
+                });
+                suite.run("ocl.chroma_blob", pc, [&](int i) {
+                    xm::ocl::chroma_blob(queue, image(i), key, color,
+                                         (float) size.width / 4.f, 0.f, (float) size.width / 2.f, (float) size.height,
+                                         256, 256).waitFor();
+                });
+            }
+
+            if (suite.enabled("ocl.packed_to_image") && cpu) {
+                suite.skip("ocl.packed_to_image", p, "not available on cpu backend");
+            } else if (suite.enabled("ocl.packed_to_image")) {
+                auto &kernels = xm::ocl::Kernels::instance();
+                cl_int err;
+                const cl_image_format format = {CL_RGBA, CL_UNORM_INT8};
+                cl_image_desc desc{};
+                desc.image_type = CL_MEM_OBJECT_IMAGE2D;
+                desc.image_width = size.width;
+                desc.image_height = size.height;
+                auto target = clCreateImage(kernels.ocl_context, CL_MEM_WRITE_ONLY, &format, &desc, nullptr, &err);
+                if (err != CL_SUCCESS) {
+                    suite.skip("ocl.packed_to_image", p, "cannot create image object: " + std::to_string(err));
+                } else {
+                    suite.run("ocl.packed_to_image", p, [&](int i) {
+                        auto event = xm::ocl::packed_to_image(queue, images[i % images.size()], target, true);
+                        clFinish(queue);
+                        if (event != nullptr)
+                            clReleaseEvent(event);
+                    });
+                    clReleaseMemObject(target);
+                }
+            }
+
+            if (suite.enabled("filter.bg_subtract")) {
+                xm::filters::bgs::Conf conf;
+                conf.debug_on = false;
+                xm::filters::BgSubtract subtract;
+                subtract.init(conf);
+                subtract.start();
+
+                // background model is temporal, frames are consumed in order
+                for (const int base: {240, 480}) {
+                    subtract.set_resolution(base);
+                    subtract.reset();
+                    suite.run("filter.bg_subtract", {{"resolution", label}, {"base", base}}, [&](int i) {
+                        subtract.filter(image(i), 0).waitFor();
+                    });
+                }
+                subtract.stop();
+            }
+
+            for (auto &i: images)
+                i.release();
+        }
+    }
+
+    std::string backend(const std::string &file) {
+        // full-integer models are never delegated to GPU (see DnnRunner)
+        return file.find("_i8") != std::string::npos ? "xnnpack" : "gpu";
+    }
+
+    void dnn(Suite &suite) {
+        std::mt19937 random(42);
+        std::uniform_real_distribution<float> pixels(0.f, 1.f);
+
+        for (int m = eox::dnn::pose::HEAVY_ORIGIN; m <= eox::dnn::pose::LITE_I8; m++) {
+            const auto type = (eox::dnn::pose::Model) m;
+            const auto file = eox::dnn::BlazePose::model_file(type);
+            const json p = {{"model", std::filesystem::path(file).filename().string()}, {"backend", backend(file)}};
+            if (!suite.enabled("dnn.blaze_pose"))
+                break;
+            if (!std::filesystem::exists(file)) {
+                suite.skip("dnn.blaze_pose", p, "missing model file");
+                continue;
+            }
+
+            eox::dnn::BlazePose pose;
+            pose.set_model_type(type);
+            std::vector<float> input(pose.get_in_w() * pose.get_in_h() * 3);
+            for (auto &v: input)
+                v = pixels(random);
+
+            suite.run("dnn.blaze_pose", p, [&](int) {
+                pose.inference(input.data());
+            });
+        }
+
+        for (int m = eox::dnn::box::ORIGIN; m <= eox::dnn::box::I_8; m++) {
+            const auto type = (eox::dnn::box::Model) m;
+            const auto file = eox::dnn::PoseDetector::model_file(type);
+            const json p = {{"model", std::filesystem::path(file).filename().string()}, {"backend", backend(file)}};
+            if (!suite.enabled("dnn.pose_detector"))
+                break;
+            if (!std::filesystem::exists(file)) {
+                suite.skip("dnn.pose_detector", p, "missing model file");
+                continue;
+            }
+
+            eox::dnn::PoseDetector detector;
+            detector.set_model_type(type);
+            std::vector<float> input(detector.get_in_w() * detector.get_in_h() * 3);
+            for (auto &v: input)
+                v = pixels(random);
+
+            suite.run("dnn.pose_detector", p, [&](int) {
+                detector.inference(input.data());
+            });
+        }
+    }
+
+    void stage(Suite &suite, const std::vector<cv::Mat> &frames, const std::string &source) {
+        if (!suite.enabled("stage.pose_pipeline"))
+            return;
+
+        for (const auto &[label, size]: RESOLUTIONS) {
+            const auto input = resized(frames, size);
+            std::vector<cv::UMat> umats(input.size());
+            for (size_t i = 0; i < input.size(); i++)
+                input[i].copyTo(umats[i]);
+
+            eox::dnn::PosePipeline pipeline;
+            pipeline.init();
+
+            // tracking state carries over, so it is a steady state of the clip (not a cold start)
+            suite.run("stage.pose_pipeline", {{"resolution", label}, {"input", source}}, [&](int i) {
+                cv::UMat segmented;
+                pipeline.pass(umats[i % umats.size()], segmented);
+            });
+        }
+    }
+
+    json device() {
+        if (xm::ocl::cpu::enabled())
+            return {
+                    {"name",  "cpu backend"},
+                    {"type",  "cpu"},
+                    {"units", (int) std::thread::hardware_concurrency()},
+            };
+        const auto &d = cv::ocl::Device::getDefault();
+        return {
+                {"name",     d.name()},
+                {"vendor",   d.vendorName()},
+                {"version",  d.version()},
+                {"driver",   d.driverVersion()},
+                {"type",     d.type() == cv::ocl::Device::TYPE_CPU ? "cpu" : d.type() == cv::ocl::Device::TYPE_GPU ? "gpu" : "other"},
+                {"units",    d.maxComputeUnits()},
+        };
+    }
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        std::printf("Usage: %s <out.json> [clip|recording|-] [filter] [budget_ms=1000] [backend=opencl]\n", argv[0]);
+        return 1;
+    }
+
+    const std::string out = argv[1];
+    const std::string clip = argc > 2 ? argv[2] : "-";
+    const std::string filter = argc > 3 ? argv[3] : "";
+    const double budget = argc > 4 ? std::max(1., std::atof(argv[4])) : 1000.;
+    const std::string backend = argc > 5 ? argv[5] : "opencl";
+
+    try {
+        xm::ocl::cpu::select(backend);
+    } catch (const std::exception &e) {
+        std::printf("%s\n", e.what());
+        return 1;
+    }
+
+    const auto frames = clip == "-" ? synthetic(FRAMES) : recorded(clip, FRAMES);
+    if (frames.empty()) {
+        std::printf("No frames: %s\n", clip.c_str());
+        return 1;
+    }
+
+    const auto source = clip == "-" ? std::string("synthetic") : std::filesystem::path(clip).filename().string();
+    std::printf("device: %s, input: %s (%zu frames)\n",
+                xm::ocl::cpu::enabled() ? "cpu backend" : cv::ocl::Device::getDefault().name().c_str(),
+                source.c_str(), frames.size());
+
+    Suite suite(filter, budget);
+    micro(suite, frames);
+    ocl(suite, frames);
+    dnn(suite);
+    stage(suite, frames, source);
+
+    const json report = {
+            {"version",   1},
+            {"timestamp", (int64_t) std::time(nullptr)},
+            {"opencv",    CV_VERSION},
+            {"device",    device()},
+            {"input",     {{"source", source}, {"frames", frames.size()}}},
+            {"budget_ms", budget},
+            {"results",   suite.get()},
+    };
+
+    std::ofstream file(out);
+    if (!file.is_open()) {
+        std::printf("Cannot write: %s\n", out.c_str());
+        return 1;
+    }
+    file << report.dump(2) << '\n';
+    std::printf("results: %s\n", out.c_str());
+    return 0;
+}
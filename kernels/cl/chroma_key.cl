@@ -46,6 +46,33 @@ inline void downscale(
     }
 }
 
+__constant sampler_t sampler_nearest = CLK_NORMALIZED_COORDS_FALSE | CLK_ADDRESS_CLAMP_TO_EDGE | CLK_FILTER_NEAREST;
+__constant sampler_t sampler_linear  = CLK_NORMALIZED_COORDS_FALSE | CLK_ADDRESS_CLAMP_TO_EDGE | CLK_FILTER_LINEAR;
+
+inline void downscale_image(
+    __read_only image2d_t in_img_bgr, // from, CL_RGBA (BGR in RGB channels)
+    unsigned char *out_pix_bgr,       // to
+
+    const float scale_w,              // [from : to] ie: [2 : 1]
+    const float scale_h,              // [from : to] ie: [2 : 1]
+    const int pix_x,                  // to
+    const int pix_y,                  // to
+
+    const bool linear                 // linear or nearest
+) {
+    // same taps as downscale(): texel centers are at +0.5, so linear filter blends
+    // (x0, x0 + 1) with weight of the fraction and edges are clamped by the sampler
+    const float2 pos = (float2) (pix_x * scale_w, pix_y * scale_h);
+    const float4 pix = linear
+            ? read_imagef(in_img_bgr, sampler_linear, pos + 0.5f)
+            : read_imagef(in_img_bgr, sampler_nearest, pos);
+
+    const uchar4 bgr = convert_uchar4_sat_rte(pix * 255.f);
+    out_pix_bgr[0] = bgr.x;
+    out_pix_bgr[1] = bgr.y;
+    out_pix_bgr[2] = bgr.z;
+}
+
 inline void bgr_to_hls(
     const unsigned char *in_bgr,
     unsigned char *out_hls
@@ -77,6 +104,44 @@ inline void bgr_to_hls(
     out_hls[2] = (unsigned char) ((L < 0.5f ? (c_dif / c_sum) : (c_dif / (2.f - c_sum))) * 255.f);
 }
 
+inline unsigned char hls_threshold(
+    const unsigned char *pix_bgr,
+    const unsigned char lower_h,
+    const unsigned char lower_l,
+    const unsigned char lower_s,
+    const unsigned char upper_h,
+    const unsigned char upper_l,
+    const unsigned char upper_s
+) {
+    unsigned char hls[3];
+    bgr_to_hls(pix_bgr, hls);
+
+    if (lower_h < upper_h) { // Dont wrap
+        if (hls[0] >= lower_h &&
+            hls[1] >= lower_l &&
+            hls[2] >= lower_s &&
+            hls[0] <= upper_h &&
+            hls[1] <= upper_l &&
+            hls[2] <= upper_s) {
+            return 255;
+        } else {
+            return 0;
+        }
+    }
+
+    else { // WRAP !
+        if ((hls[0] >= lower_h || hls[0] <= upper_h) &&
+            hls[1] >= lower_l &&
+            hls[2] >= lower_s &&
+            hls[1] <= upper_l &&
+            hls[2] <= upper_s) {
+            return 255;
+        } else {
+            return 0;
+        }
+    }
+}
+
 inline unsigned char downscale_blur_hls_threshold(
     __global const unsigned char *input,
     __global const float *gaussian_kernel,
@@ -132,34 +197,69 @@ inline unsigned char downscale_blur_hls_threshold(
     }
 
     // ================================== HLS MASK ========================================
+    return hls_threshold(
+            pix_bgr,
+            lower_h, lower_l, lower_s,
+            upper_h, upper_l, upper_s);
+}
 
-    unsigned char hls[3];
-    bgr_to_hls(pix_bgr, hls);
+inline unsigned char downscale_blur_hls_threshold_image(
+    __read_only image2d_t input,
+    __global const float *gaussian_kernel,
+    const int half_kernel_size,
+    const bool blur,
+    const bool linear,
+    const unsigned int mask_w,
+    const unsigned int mask_h,
+    const float scale_w,
+    const float scale_h,
+    const unsigned char lower_h,
+    const unsigned char lower_l,
+    const unsigned char lower_s,
+    const unsigned char upper_h,
+    const unsigned char upper_l,
+    const unsigned char upper_s,
+    const int x,
+    const int y
+) {
+    unsigned char pix_bgr[3] = {0, 0, 0}; // working pixel
 
-    if (lower_h < upper_h) { // Dont wrap
-        if (hls[0] >= lower_h &&
-            hls[1] >= lower_l &&
-            hls[2] >= lower_s &&
-            hls[0] <= upper_h &&
-            hls[1] <= upper_l &&
-            hls[2] <= upper_s) {
-            return 255;
-        } else {
-            return 0;
-        }
-    }
+    if (blur) { // ================================== BLUR ========================================
+        float sum[3] = {0.f, 0.f, 0.f};
+        float weight_sum = 0.f;
 
-    else { // WRAP !
-        if ((hls[0] >= lower_h || hls[0] <= upper_h) &&
-            hls[1] >= lower_l &&
-            hls[2] >= lower_s &&
-            hls[1] <= upper_l &&
-            hls[2] <= upper_s) {
-            return 255;
-        } else {
-            return 0;
+        for (int ky = -half_kernel_size; ky <= half_kernel_size; ky++) {
+            for (int kx = -half_kernel_size; kx <= half_kernel_size; kx++) {
+                const int i_x = x + kx;
+                const int i_y = y + ky;
+
+                if (i_x >= 0 && i_x < mask_w && i_y >= 0 && i_y < mask_h) {
+                    const float weight = gaussian_kernel[half_kernel_size + kx] * gaussian_kernel[half_kernel_size + ky];
+                    unsigned char pixel[3] = {0, 0, 0};
+
+                    downscale_image(input, pixel, scale_w, scale_h, i_x, i_y, linear);
+
+                    sum[0] += ((float) pixel[0]) * weight;
+                    sum[1] += ((float) pixel[1]) * weight;
+                    sum[2] += ((float) pixel[2]) * weight;
+                    weight_sum += weight;
+                }
+            }
         }
+
+        pix_bgr[0] = (unsigned char) (sum[0] / weight_sum);
+        pix_bgr[1] = (unsigned char) (sum[1] / weight_sum);
+        pix_bgr[2] = (unsigned char) (sum[2] / weight_sum);
+
+    } else { // ================================== NON-BLUR ========================================
+        downscale_image(input, pix_bgr, scale_w, scale_h, x, y, linear);
     }
+
+    // ================================== HLS MASK ========================================
+    return hls_threshold(
+            pix_bgr,
+            lower_h, lower_l, lower_s,
+            upper_h, upper_l, upper_s);
 }
 
 inline void upscale_apply(
@@ -228,10 +328,14 @@ __kernel void power_mask(
 ) {
     const int x = get_global_id(0);
     const int y = get_global_id(1);
+    const int z = get_global_id(2); // stacked frame (camera), always 0 for 2D launches
 
     if (x >= mask_w || y >= mask_h)
         return;
 
+    input  += z * input_w * input_h * 3;
+    output += z * mask_w * mask_h;
+
     output[y * mask_w + x] = downscale_blur_hls_threshold(
             input,
             gaussian_kernel,
@@ -246,6 +350,52 @@ __kernel void power_mask(
             x, y);
 }
 
+__kernel void power_mask_image(
+        // IMAGES
+        __read_only image2d_t input, // CL_RGBA, sampled by hardware
+        __global unsigned char *output,
+
+        // BLUR
+        __global const float *gaussian_kernel,
+        const int half_kernel_size,
+        const unsigned char blur,   // aka BOOL
+
+        // SCALING
+        const unsigned char linear, // aka BOOL
+        const unsigned int input_w, // unused, arguments are the same as power_mask ones
+        const unsigned int input_h,
+        const unsigned int mask_w,
+        const unsigned int mask_h,
+        const float scale_w,
+        const float scale_h,
+
+        // HLS MASK
+        const unsigned char lower_h,
+        const unsigned char lower_l,
+        const unsigned char lower_s,
+        const unsigned char upper_h,
+        const unsigned char upper_l,
+        const unsigned char upper_s
+) {
+    const int x = get_global_id(0);
+    const int y = get_global_id(1);
+
+    if (x >= mask_w || y >= mask_h)
+        return;
+
+    output[y * mask_w + x] = downscale_blur_hls_threshold_image(
+            input,
+            gaussian_kernel,
+            half_kernel_size,
+            blur > 0,
+            linear > 0,
+            mask_w, mask_h,
+            scale_w, scale_h,
+            lower_h, lower_l, lower_s,
+            upper_h, upper_l, upper_s,
+            x, y);
+}
+
 __kernel void power_apply(
     // IMAGES
     __global const unsigned char *input,
@@ -269,10 +419,15 @@ __kernel void power_apply(
 ) {
     const int x = get_global_id(0);
     const int y = get_global_id(1);
+    const int z = get_global_id(2);
 
     if (x >= mask_w || y >= mask_h)
         return;
 
+    input  += z * output_w * output_h * 3;
+    output += z * output_w * output_h * 3;
+    mask   += z * mask_w * mask_h;
+
     upscale_apply(
             input, output,
             output_w, output_h,
@@ -323,10 +478,14 @@ __kernel void power_chromakey(
 ) {
     const int x = get_global_id(0);
     const int y = get_global_id(1);
+    const int z = get_global_id(2);
 
     if (x >= mask_w || y >= mask_h)
         return;
 
+    input  += z * input_w * input_h * 3;
+    output += z * input_w * input_h * 3;
+
     const unsigned char mask = downscale_blur_hls_threshold(
             input,
             gaussian_kernel,
@@ -350,4 +509,103 @@ __kernel void power_chromakey(
             mask,
             d_x, d_y,
             x, y);
-}
\ No newline at end of file
+}
+inline float3 masked_pixel(
+    __global const unsigned char *input,
+    __global const unsigned char *mask,
+    const unsigned int input_w,
+    const unsigned int mask_w,
+    const unsigned int mask_h,
+    const float mask_scale_w,
+    const float mask_scale_h,
+    const float3 color,
+    const int x,
+    const int y
+) {
+    const int m_x = min((int) (x / mask_scale_w), (int) (mask_w - 1));
+    const int m_y = min((int) (y / mask_scale_h), (int) (mask_h - 1));
+    if (mask[m_y * mask_w + m_x] > 0)
+        return color;
+    const int idx = (y * input_w + x) * 3;
+    return (float3) ((float) input[idx + 0], (float) input[idx + 1], (float) input[idx + 2]);
+}
+
+__kernel void power_blob(
+    // IMAGES
+    __global const unsigned char *input, // BGR uchar, full frame
+    __global const unsigned char *mask,  // low resolution chroma key mask
+    __global float *output,              // RGB float [0.0 ... 1.0], letterboxed
+
+    // SCALING
+    const unsigned int input_w,
+    const unsigned int input_h,
+    const unsigned int mask_w,
+    const unsigned int mask_h,
+    const unsigned int output_w,
+    const unsigned int output_h,
+
+    // ROI (input space)
+    const float roi_x,
+    const float roi_y,
+    const float roi_w,
+    const float roi_h,
+
+    // LETTERBOX (output space)
+    const float pad_x,
+    const float pad_y,
+    const float scale, // [roi : output] ie: [2 : 1]
+
+    // KEY
+    const unsigned char color_b,
+    const unsigned char color_g,
+    const unsigned char color_r
+) {
+    const int x = get_global_id(0);
+    const int y = get_global_id(1);
+
+    if (x >= output_w || y >= output_h)
+        return;
+
+    const int o_idx = (y * output_w + x) * 3;
+
+    // pixel center in roi space
+    const float r_x = ((x - pad_x) + 0.5f) * scale - 0.5f;
+    const float r_y = ((y - pad_y) + 0.5f) * scale - 0.5f;
+
+    if (r_x < -0.5f || r_y < -0.5f || r_x > roi_w - 0.5f || r_y > roi_h - 0.5f) {
+        // letterbox paddings
+        output[o_idx + 0] = 0.f;
+        output[o_idx + 1] = 0.f;
+        output[o_idx + 2] = 0.f;
+        return;
+    }
+
+    const float i_x = clamp(roi_x + r_x, 0.f, (float) (input_w - 1));
+    const float i_y = clamp(roi_y + r_y, 0.f, (float) (input_h - 1));
+
+    const int x0 = (int) i_x;
+    const int y0 = (int) i_y;
+    const int x1 = min((int) (x0 + 1), (int) (input_w - 1));
+    const int y1 = min((int) (y0 + 1), (int) (input_h - 1));
+    const float dx = i_x - x0;
+    const float dy = i_y - y0;
+
+    const float scale_w = (float) input_w / (float) mask_w;
+    const float scale_h = (float) input_h / (float) mask_h;
+    const float3 color = (float3) ((float) color_b, (float) color_g, (float) color_r);
+
+    // mask is applied per sample, so key edges are resampled as well
+    const float3 p00 = masked_pixel(input, mask, input_w, mask_w, mask_h, scale_w, scale_h, color, x0, y0);
+    const float3 p10 = masked_pixel(input, mask, input_w, mask_w, mask_h, scale_w, scale_h, color, x1, y0);
+    const float3 p01 = masked_pixel(input, mask, input_w, mask_w, mask_h, scale_w, scale_h, color, x0, y1);
+    const float3 p11 = masked_pixel(input, mask, input_w, mask_w, mask_h, scale_w, scale_h, color, x1, y1);
+
+    const float3 p0 = p00 + (p10 - p00) * dx;
+    const float3 p1 = p01 + (p11 - p01) * dx;
+    const float3 bgr = (p0 + (p1 - p0) * dy) / 255.f;
+
+    // BGR -> RGB
+    output[o_idx + 0] = bgr.z;
+    output[o_idx + 1] = bgr.y;
+    output[o_idx + 2] = bgr.x;
+}
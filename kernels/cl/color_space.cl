@@ -136,4 +136,72 @@ __kernel void kernel_simple_mask_apply(
         output_bgr[pix + 1] = front_bgr[pix + 1];
         output_bgr[pix + 2] = front_bgr[pix + 2];
     }
-}
\ No newline at end of file
+}
+__kernel void kernel_image_to_packed(
+    __read_only image2d_t input,   // CL_RGBA, ie: attached image object
+    __global unsigned char *output,
+    const unsigned int width,
+    const unsigned int height
+) {
+    const int x = get_global_id(0);
+    const int y = get_global_id(1);
+
+    if (x >= width || y >= height)
+        return;
+
+    const sampler_t sampler = CLK_NORMALIZED_COORDS_FALSE | CLK_ADDRESS_CLAMP_TO_EDGE | CLK_FILTER_NEAREST;
+    const uchar4 pix = convert_uchar4_sat_rte(read_imagef(input, sampler, (int2) (x, y)) * 255.f);
+    const int idx = (y * width + x) * 3;
+    output[idx + 0] = pix.x;
+    output[idx + 1] = pix.y;
+    output[idx + 2] = pix.z;
+}
+
+__kernel void kernel_segmentation_apply(
+        __global const float *logits,
+        __global const unsigned char *input,
+        __global unsigned char *output,
+        const unsigned int seg_width,
+        const unsigned int seg_height,
+        const unsigned int width,
+        const unsigned int height,
+        const unsigned int channels,
+        const float roi_x,
+        const float roi_y,
+        const float roi_w,
+        const float roi_h,
+        const float threshold_logit
+) {
+    const int x = get_global_id(0);
+    const int y = get_global_id(1);
+
+    if (x >= width || y >= height)
+        return;
+
+    // normalized position within the ROI
+    const float u = ((float) x + 0.5f - roi_x) / roi_w;
+    const float v = ((float) y + 0.5f - roi_y) / roi_h;
+
+    bool keep = false;
+    if (u >= 0.f && u < 1.f && v >= 0.f && v < 1.f) {
+        // bilinear sampling of the logits (pixel centers)
+        const float sx = u * (float) seg_width - 0.5f;
+        const float sy = v * (float) seg_height - 0.5f;
+        const float fx = sx - floor(sx);
+        const float fy = sy - floor(sy);
+        const int x0 = clamp((int) floor(sx), 0, (int) seg_width - 1);
+        const int y0 = clamp((int) floor(sy), 0, (int) seg_height - 1);
+        const int x1 = min(x0 + 1, (int) seg_width - 1);
+        const int y1 = min(y0 + 1, (int) seg_height - 1);
+
+        const float l0 = mix(logits[y0 * seg_width + x0], logits[y0 * seg_width + x1], fx);
+        const float l1 = mix(logits[y1 * seg_width + x0], logits[y1 * seg_width + x1], fx);
+
+        // sigmoid(l) > t  <=>  l > log(t / (1 - t))
+        keep = mix(l0, l1, fy) > threshold_logit;
+    }
+
+    const int idx = (y * width + x) * channels;
+    for (int c = 0; c < channels; c++)
+        output[idx + c] = keep ? input[idx + c] : 0;
+}
@@ -8,10 +8,14 @@ __kernel void gaussian_blur_horizontal(
 ) {
     const int x = get_global_id(0);
     const int y = get_global_id(1);
+    const int z = get_global_id(2); // stacked frame (camera), always 0 for 2D launches
 
     if (x >= width || y >= height)
         return;
 
+    input  += z * width * height * 3;
+    output += z * width * height * 3;
+
     float sum[3] = {0.f, 0.f, 0.f};
     float weight_sum = 0.f;
 
@@ -42,10 +46,14 @@ __kernel void gaussian_blur_vertical(
 ) {
     const int x = get_global_id(0);
     const int y = get_global_id(1);
+    const int z = get_global_id(2);
 
     if (x >= width || y >= height)
         return;
 
+    input  += z * width * height * 3;
+    output += z * width * height * 3;
+
     float sum[3] = {0.f, 0.f, 0.f};
     float weight_sum = 0.f;
 
@@ -75,10 +83,14 @@ __kernel void dilate_horizontal(
 ) {
     const int x = get_global_id(0);
     const int y = get_global_id(1);
+    const int z = get_global_id(2);
 
     if (x >= width || y >= height)
         return;
 
+    input  += z * width * height;
+    output += z * width * height;
+
     unsigned char max_val = 0;
 
     for (int k = -half_kernel_size; k <= half_kernel_size; k++) {
@@ -99,10 +111,14 @@ __kernel void dilate_vertical(
 ) {
     const int x = get_global_id(0);
     const int y = get_global_id(1);
+    const int z = get_global_id(2);
 
     if (x >= width || y >= height)
         return;
 
+    input  += z * width * height;
+    output += z * width * height;
+
     unsigned char max_val = 0;
 
     for (int k = -half_kernel_size; k <= half_kernel_size; k++) {
@@ -123,10 +139,14 @@ __kernel void erode_horizontal(
 ) {
     const int x = get_global_id(0);
     const int y = get_global_id(1);
+    const int z = get_global_id(2);
 
     if (x >= width || y >= height)
         return;
 
+    input  += z * width * height;
+    output += z * width * height;
+
     unsigned char min_val = 255;
 
     for (int k = -half_kernel_size; k <= half_kernel_size; k++) {
@@ -147,10 +167,14 @@ __kernel void erode_vertical(
 ) {
     const int x = get_global_id(0);
     const int y = get_global_id(1);
+    const int z = get_global_id(2);
 
     if (x >= width || y >= height)
         return;
 
+    input  += z * width * height;
+    output += z * width * height;
+
     unsigned char min_val = 255;
 
     for (int k = -half_kernel_size; k <= half_kernel_size; k++) {
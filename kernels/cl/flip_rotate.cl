@@ -10,10 +10,15 @@ __kernel void flip_rotate(
 ) {
     const int x = get_global_id(0);
     const int y = get_global_id(1);
+    const int z = get_global_id(2); // stacked frame (camera), always 0 for 2D launches
 
     if (x >= width || y >= height)
         return;
 
+    // rotated frame has the same size, so layers keep their offsets
+    input  += z * width * height * c_size;
+    output += z * width * height * c_size;
+
     const int f_x = (flip_x > 0) ? (width  - x - 1) : x;
     const int f_y = (flip_y > 0) ? (height - y - 1) : y;
     const int idx_i = (f_y * width + f_x) * c_size;
@@ -32,4 +37,42 @@ __kernel void flip_rotate(
     for (int i = 0; i < c_size; i++) {
         output[idx_o + i] = input[idx_i + i];
     }
-}
\ No newline at end of file
+}
+
+__kernel void flip_rotate_image(
+        __global const unsigned char *input,
+        __global unsigned char *output,
+        __write_only image2d_t output_image, // CL_RGBA or CL_R, same pixels as output
+        const int width,
+        const int height,
+        const int c_size,
+        const int flip_x,
+        const int flip_y,
+        const int rotate
+) {
+    const int x = get_global_id(0);
+    const int y = get_global_id(1);
+
+    if (x >= width || y >= height)
+        return;
+
+    const int f_x = (flip_x > 0) ? (width  - x - 1) : x;
+    const int f_y = (flip_y > 0) ? (height - y - 1) : y;
+    const int idx_i = (f_y * width + f_x) * c_size;
+
+    const int o_x = (rotate > 0) ? (height - y - 1) : x;
+    const int o_y = (rotate > 0) ? x : y;
+    const int idx_o = (o_y * ((rotate > 0) ? height : width) + o_x) * c_size;
+
+    uchar4 pixel = (uchar4) (0, 0, 0, 255);
+    pixel.x = input[idx_i];
+    if (c_size > 1) pixel.y = input[idx_i + 1];
+    if (c_size > 2) pixel.z = input[idx_i + 2];
+    if (c_size > 3) pixel.w = input[idx_i + 3];
+
+    output[idx_o] = pixel.x;
+    if (c_size > 1) output[idx_o + 1] = pixel.y;
+    if (c_size > 2) output[idx_o + 2] = pixel.z;
+    if (c_size > 3) output[idx_o + 3] = pixel.w;
+    write_imagef(output_image, (int2) (o_x, o_y), convert_float4(pixel) / 255.f);
+}
@@ -276,6 +276,32 @@ void downscale(
     }
 }
 
+__constant sampler_t sampler_nearest = CLK_NORMALIZED_COORDS_FALSE | CLK_ADDRESS_CLAMP_TO_EDGE | CLK_FILTER_NEAREST;
+__constant sampler_t sampler_linear  = CLK_NORMALIZED_COORDS_FALSE | CLK_ADDRESS_CLAMP_TO_EDGE | CLK_FILTER_LINEAR;
+
+void downscale_image(
+    __read_only image2d_t in_img,          // from, CL_RGBA or CL_R
+    uchar *out_pix,                        // to
+    const float scale_w,                   // [from : to], ie: [2 : 1]
+    const float scale_h,                   // [from : to], ie: [2 : 1]
+    const int pix_x,                       // to
+    const int pix_y,                       // to
+    const uchar channels_n,                // number of color channels, ie: 1/2/3/4
+    const bool linear                      // linear or nearest interpolation
+) {
+    // texel centers are at +0.5, linear filter blends the same taps as downscale()
+    const float2 pos = (float2) (pix_x * scale_w, pix_y * scale_h);
+    const float4 pix = linear
+            ? read_imagef(in_img, sampler_linear, pos + 0.5f)
+            : read_imagef(in_img, sampler_nearest, pos);
+
+    const uchar4 color = convert_uchar4_sat_rte(pix * 255.f);
+    out_pix[0] = color.x;
+    if (channels_n > 1) out_pix[1] = color.y;
+    if (channels_n > 2) out_pix[2] = color.z;
+    if (channels_n > 3) out_pix[3] = color.w;
+}
+
 void upscale(
     __global const uchar *input_pix,       // Input color pixel [From]
     __global uchar *output,                // Output image [To]
@@ -464,10 +490,31 @@ __kernel void kernel_subsense(
 ) {
     const int x = get_global_id(0);
     const int y = get_global_id(1);
+    const int layer = get_global_id(2); // stacked frame (camera), always 0 for 2D launches
 
     if (x >= width || y >= height)
         return;
 
+    // every stacked frame has its own model and state
+    const int layer_size = width * height;
+#ifndef DISABLED_EXCLUSION_MASK
+    exclusion_mask += layer * layer_size;
+#endif
+#ifndef DISABLED_LBSP
+    bg_model  += layer * layer_size * model_size * channels_n * (1 + lbsp_k_size_bytes(lbsp_kernel));
+#else
+    bg_model  += layer * layer_size * model_size * channels_n;
+#endif
+#ifndef DISABLED_DEBUG
+    utility_1 += layer * layer_size * 5;
+#else
+    utility_1 += layer * layer_size * 4;
+#endif
+    utility_2 += layer * layer_size * 2;
+    noise_map += layer * layer_size;
+    seg_mask  += layer * layer_size;
+    image     += layer * layer_size * channels_n;
+
     const int idx = y * width + x;
 
 #ifndef DISABLED_EXCLUSION_MASK
@@ -646,10 +693,28 @@ __kernel void kernel_prepare_model(
 ) {
     const int x = get_global_id(0);
     const int y = get_global_id(1);
+    const int layer = get_global_id(2);
 
     if (x >= width || y >= height)
         return;
 
+    // every stacked frame has its own model and state
+    const int layer_size = width * height;
+#ifndef DISABLED_LBSP
+    bg_model  += layer * layer_size * model_size * channels_n * (1 + lbsp_k_size_bytes(lbsp_kernel));
+#else
+    bg_model  += layer * layer_size * model_size * channels_n;
+#endif
+#ifndef DISABLED_DEBUG
+    utility_1 += layer * layer_size * 5;
+#else
+    utility_1 += layer * layer_size * 4;
+#endif
+    utility_2 += layer * layer_size * 2;
+    noise_map += layer * layer_size;
+    seg_mask  += layer * layer_size;
+    image     += layer * layer_size * channels_n;
+
 #ifndef DISABLED_LBSP
     const int kernel_size = lbsp_k_size_bytes(lbsp_kernel);
     const int bgm_ch_size = channels_n * (1 + kernel_size);
@@ -714,10 +779,14 @@ __kernel void kernel_downscale(
 ) {
     const int x = get_global_id(0);
     const int y = get_global_id(1);
+    const int layer = get_global_id(2);
 
     if (x >= out_w || y >= out_h)
         return;
 
+    image  += layer * img_w * img_h * channels_n;
+    output += layer * out_w * out_h * channels_n;
+
     uchar color_pixel[4];
     downscale(image, color_pixel, img_w, img_h, scale_w, scale_h, x, y, channels_n, linear > 0);
 
@@ -726,6 +795,34 @@ __kernel void kernel_downscale(
         output[idx + i] = color_pixel[i];
 }
 
+__kernel void kernel_downscale_image(
+
+    __read_only image2d_t image,           // Input  image [From] (larger), sampled by hardware
+    __global       uchar *output,          // Output image [To]   (smaller)
+             const ushort img_w,           // From width  (unused, same arguments as kernel_downscale)
+             const ushort img_h,           // From height (unused, same arguments as kernel_downscale)
+             const ushort out_w,           // To   width
+             const ushort out_h,           // To   height
+             const float scale_w,          // [From : To], ie: [2 : 1]
+             const float scale_h,          // [From : To], ie: [2 : 1]
+             const uchar channels_n,       // Number of color channels, ie: 1/2/3/4
+             const uchar linear            // is linear interpolation used, [0 - false]
+
+) {
+    const int x = get_global_id(0);
+    const int y = get_global_id(1);
+
+    if (x >= out_w || y >= out_h)
+        return;
+
+    uchar color_pixel[4];
+    downscale_image(image, color_pixel, scale_w, scale_h, x, y, channels_n, linear > 0);
+
+    const int idx = (y * out_w + x) * channels_n;
+    for (int i = 0; i < channels_n; i++)
+        output[idx + i] = color_pixel[i];
+}
+
 __kernel void kernel_upscale(
 
     __global const uchar *image,           // Input  image [From] (smaller)
@@ -777,10 +874,15 @@ __kernel void kernel_upscale_apply(
 ) {
     const int x = get_global_id(0);
     const int y = get_global_id(1);
+    const int layer = get_global_id(2);
 
     if (x >= mask_w || y >= mask_h)
         return;
 
+    mask   += layer * mask_w * mask_h;
+    image  += layer * out_w * out_h * channels_n;
+    output += layer * out_w * out_h * channels_n;
+
     const uchar colors[3] = {
         color_b,
         color_g,
@@ -811,10 +913,14 @@ __kernel void kernel_gate_mask(
 ) {
     const int x = get_global_id(0);
     const int y = get_global_id(1);
+    const int layer = get_global_id(2);
 
     if (x >= width || y >= height)
         return;
 
+    input  += layer * width * height * channels_n;
+    output += layer * width * height * channels_n;
+
     gate_mask_operation(input, output, kernel_type, channels_n, threshold, width, height, x, y);
 }
 
@@ -830,10 +936,14 @@ __kernel void kernel_erode(
 ) {
     const int x = get_global_id(0);
     const int y = get_global_id(1);
+    const int layer = get_global_id(2);
 
     if (x >= width || y >= height)
         return;
 
+    input  += layer * width * height * channels_n;
+    output += layer * width * height * channels_n;
+
     morph_operation(input, output, MORPH_TYPE_ERODE, kernel_type, channels_n, width, height, x, y);
 }
 
@@ -849,10 +959,14 @@ __kernel void kernel_dilate(
 ) {
     const int x = get_global_id(0);
     const int y = get_global_id(1);
+    const int layer = get_global_id(2);
 
     if (x >= width || y >= height)
         return;
 
+    input  += layer * width * height * channels_n;
+    output += layer * width * height * channels_n;
+
     morph_operation(input, output, MORPH_TYPE_DILATE, kernel_type, channels_n, width, height, x, y);
 }
 #endif
@@ -879,10 +993,19 @@ __kernel void kernel_debug(
 ) {
     const int x = get_global_id(0);
     const int y = get_global_id(1);
+    const int layer = get_global_id(2);
 
     if (x >= width || y >= height)
         return;
 
+    const int layer_size = width * height;
+    bg_model  += layer * layer_size * model_size * 3 * (1 + lbsp_k_size_bytes(lbsp_kernel));
+    utility_1 += layer * layer_size * 5;
+    utility_2 += layer * layer_size * 2;
+    noise_map += layer * layer_size;
+    seg_mask  += layer * layer_size;
+    output    += layer * layer_size * 3;
+
     const int idx     = y * width + x;
     const int ut1_idx = idx * 5;
     const int ut2_idx = idx * 2;
@@ -5,6 +5,8 @@
 #include "xmotion/core/boot/i_boot.h"
 #include "xmotion/imgui/imgui_boot.h"
 #include "xmotion/fbgtk/file_boot.h"
+#include "xmotion/fbgtk/headless_boot.h"
+#include "xmotion/fbgtk/offline_boot.h"
 
 #define CL_TARGET_OPENCL_VERSION 300
 
@@ -74,6 +76,12 @@ int main(int argc, char **argv) {
     program.add_argument("-g", "--graphic")
             .help("Graphic mode")
             .flag();
+    program.add_argument("-n", "--headless")
+            .help("Headless mode, no gui, results are available only through output sinks")
+            .flag();
+    program.add_argument("-o", "--offline")
+            .help("Offline mode, recorded captures are processed as fast as possible, results are written to output sinks")
+            .flag();
     program.add_argument("-v", "--verbose")
             .help("Increase output verbosity")
             .flag();
@@ -97,6 +105,10 @@ int main(int argc, char **argv) {
 
     if (program.get<bool>("--graphic")) {
         director = std::make_unique<xm::IMGuiBoot>();
+    } else if (program.get<bool>("--headless")) {
+        director = std::make_unique<xm::HeadlessBoot>();
+    } else if (program.get<bool>("--offline")) {
+        director = std::make_unique<xm::OfflineBoot>();
     } else {
         director = std::make_unique<xm::FileBoot>();
     }
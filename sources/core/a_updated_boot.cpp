@@ -4,7 +4,9 @@
 
 #include <opencv2/core/ocl.hpp>
 #include <iostream>
+#include <thread>
 #include "../../xmotion/core/boot/a_updated_boot.h"
+#include "../../xmotion/core/ocl/ocl_cpu.h"
 
 namespace xm {
 
@@ -12,8 +14,11 @@ namespace xm {
         std::cout << "OpenCV version: " << CV_VERSION << '\n';
 
         if (!cv::ocl::useOpenCL()) {
-            std::cerr << "OpenCL is not available..." << '\n';
-            std::exit(1);
+            if (!xm::ocl::cpu::enabled()) {
+                std::cerr << "OpenCL is not available, falling back to CPU" << '\n';
+                xm::ocl::cpu::select("cpu");
+            }
+            std::cout << "Compute backend: CPU, threads: " << std::thread::hardware_concurrency() << std::endl;
         }
 
         else {
@@ -37,7 +42,7 @@ namespace xm {
     }
 
     int UpdatedBoot::boot(int &argc, char **&argv) {
-        cv::ocl::setUseOpenCL(true);
+        cv::ocl::setUseOpenCL(!xm::ocl::cpu::enabled());
 
         print_ocv_ocl_stats();
 
@@ -4,6 +4,8 @@
 
 #include "../../xmotion/core/filter/bg_subtract.h"
 #include "../../xmotion/core/ocl/ocl_filters.h"
+#include "../../xmotion/core/ocl/ocl_cpu.h"
+#include "../../xmotion/core/ocl/cl_tuner.h"
 #include "../../kernels/subsense.h"
 
 #pragma clang diagnostic push
@@ -26,6 +28,7 @@ namespace xm::filters {
         if (kernel_prepare != nullptr) clReleaseKernel(kernel_prepare);
         if (kernel_subsense != nullptr) clReleaseKernel(kernel_subsense);
         if (kernel_downscale != nullptr) clReleaseKernel(kernel_downscale);
+        if (kernel_downscale_image != nullptr) clReleaseKernel(kernel_downscale_image);
         if (kernel_upscale != nullptr) clReleaseKernel(kernel_upscale);
         if (kernel_dilate != nullptr) clReleaseKernel(kernel_dilate);
         if (kernel_erode != nullptr) clReleaseKernel(kernel_erode);
@@ -58,6 +61,13 @@ namespace xm::filters {
         reset();
         release();
 
+        cpu = xm::ocl::cpu::enabled();
+        if (cpu) {
+            // no kernels to build, see bg_subtract_cpu.cpp
+            initialized = true;
+            return;
+        }
+
         device_id = (cl_device_id) cv::ocl::Device::getDefault().ptr();
         ocl_context = (cl_context) cv::ocl::Context::getDefault().ptr();
         ocl_command_queue = xm::ocl::create_queue_device(
@@ -66,7 +76,7 @@ namespace xm::filters {
             true,
             false);
 
-        std::string options = std::string("")
+        build_options = std::string("")
             + (config.norm_l2 ? " -DCOLOR_NORM_l2 " : "")
             + (config.mask_xc ? "" : " -DDISABLED_EXCLUSION_MASK ")
             + (config.lbsp_on ? "" : " -DDISABLED_LBSP ")
@@ -81,13 +91,14 @@ namespace xm::filters {
             ocl_kernel_subsense_data,
             ocl_kernel_subsense_data_size,
             "subsense.cl",
-            options
+            build_options
         );
 
         kernel_apply = xm::ocl::build_kernel(program_subsense, "kernel_upscale_apply");
         kernel_prepare = xm::ocl::build_kernel(program_subsense, "kernel_prepare_model");
         kernel_subsense = xm::ocl::build_kernel(program_subsense, "kernel_subsense");
         kernel_downscale = xm::ocl::build_kernel(program_subsense, "kernel_downscale");
+        kernel_downscale_image = xm::ocl::build_kernel(program_subsense, "kernel_downscale_image");
         kernel_upscale = xm::ocl::build_kernel(program_subsense, "kernel_upscale");
 
         if (config.morph_on) {
@@ -117,6 +128,38 @@ namespace xm::filters {
         if (!ready)
             return frame_in;
 
+        if (cpu)
+            return filter_cpu(frame_in, ex_mask);
+
+        return filter_layers(frame_in, ex_mask, 1, q_idx);
+    }
+
+    xm::ocl::iop::ClImagePromise BgSubtract::filter_stacked(const ocl::iop::ClImagePromise &frame_in, int n_layers, int q_idx) {
+        if (!initialized)
+            throw std::logic_error("Filter is not initialized");
+
+        if (!ready)
+            return frame_in;
+
+        if (cpu)
+            throw std::logic_error("Stacked frames are not supported by CPU compute backend");
+
+        if (n_layers < 1 || frame_in.getImage2D().rows % n_layers != 0)
+            throw std::invalid_argument("Invalid number of stacked frames: " + std::to_string(n_layers));
+
+        return filter_layers(frame_in, {}, n_layers, q_idx);
+    }
+
+    xm::ocl::iop::ClImagePromise BgSubtract::filter_layers(const ocl::iop::ClImagePromise &frame_in,
+                                                           const ocl::iop::ClImagePromise &ex_mask,
+                                                           int n_layers,
+                                                           int q_idx) {
+        if (n_layers != layers) {
+            // other cameras, other models
+            release_model();
+            layers = n_layers;
+        }
+
         auto downscaled = downscale(frame_in, config.BASE_RESOLUTION, q_idx);
 
         if (model_i < config.model_size) {
@@ -134,46 +177,45 @@ namespace xm::filters {
         const auto &in = in_p.getImage2D();
 
         const int n_w = (int) in.cols;
-        const int n_h = (int) in.rows;
+        const int n_h = (int) in.rows / layers;
 
-        size_t l_size[2] = {pref_size, pref_size};
-        size_t g_size[2] = {xm::ocl::optimal_global_size((int) n_w, pref_size),
-                            xm::ocl::optimal_global_size((int) n_h, pref_size)};
+        // buffers of stacked frames are stacked the same way (layer after layer)
+        const int s_h = n_h * layers;
 
         const int lbsp_c_size = config.lbsp_on ? bgs::lbsp_k_size_bytes(config.kernel) : 0;
         if (bg_model.empty()) {
             bg_model = xm::ocl::Image2D::allocate(
-                n_w, n_h, (size_t) config.model_size * (config.color_channels + (config.color_channels * lbsp_c_size)), 1,
+                n_w, s_h, (size_t) config.model_size * (config.color_channels + (config.color_channels * lbsp_c_size)), 1,
                 ocl_context, device_id);
         }
 
         if (utility_1.empty()) {
             utility_1 = xm::ocl::Image2D::allocate(
-                n_w, n_h, config.debug_on ? 5 : 4, sizeof(float),
+                n_w, s_h, config.debug_on ? 5 : 4, sizeof(float),
                 ocl_context, device_id);
         }
 
         if (utility_2.empty()) {
             utility_2 = xm::ocl::Image2D::allocate(
-                n_w, n_h, 2, sizeof(short),
+                n_w, s_h, 2, sizeof(short),
                 ocl_context, device_id);
         }
 
         if (noise_map.empty()) {
             noise_map = xm::ocl::Image2D::allocate(
-                    n_w, n_h, 1, sizeof(float),
+                    n_w, s_h, 1, sizeof(float),
                     ocl_context, device_id);
         }
 
         if (seg_mask.empty()) {
             seg_mask = xm::ocl::Image2D::allocate(
-                    n_w, n_h, 1, 1,
+                    n_w, s_h, 1, 1,
                     ocl_context, device_id);
         }
 
         if (tmp_mask.empty()) {
             tmp_mask = xm::ocl::Image2D::allocate(
-                    n_w, n_h, 1, 1,
+                    n_w, s_h, 1, 1,
                     ocl_context, device_id);
         }
 
@@ -216,13 +258,7 @@ namespace xm::filters {
         idx_1 = xm::ocl::set_kernel_arg(kernel_prepare, idx_1, sizeof(ushort), &_width);
         xm::ocl::set_kernel_arg(kernel_prepare, idx_1, sizeof(ushort), &_height);
 
-        xm::ocl::enqueue_kernel_fast(
-            queue,
-            kernel_prepare,
-            2,
-            g_size,
-            l_size,
-            false);
+        xm::ocl::tuner::enqueue_3d(queue, kernel_prepare, n_w, n_h, layers, pref_size, false, build_options);
     }
 
     xm::ocl::iop::ClImagePromise BgSubtract::downscale(const ocl::iop::ClImagePromise &in_p, int base, int q_idx) {
@@ -232,20 +268,23 @@ namespace xm::filters {
         float scale;
         int n_w, n_h;
 
-        new_size((int) in.cols, (int) in.rows, base, n_w, n_h, scale);
-        const int inter_size = n_w * n_h * config.color_channels * (int) sizeof(char);
-        size_t l_size[2] = {pref_size, pref_size};
-        size_t g_size[2] = {xm::ocl::optimal_global_size((int) n_w, pref_size),
-                            xm::ocl::optimal_global_size((int) n_h, pref_size)};
+        const int rows = (int) in.rows / layers;
+        new_size((int) in.cols, rows, base, n_w, n_h, scale);
+        const int inter_size = n_w * n_h * layers * config.color_channels * (int) sizeof(char);
+
+        // attached image object is sampled by hardware (same arguments, different kernel),
+        // stacked frames are read from the buffer
+        const bool sampled = in.has_image() && layers == 1;
 
         cl_int err;
 
         // ======= BUFFERS ALLOCATION !
-        cl_mem buffer_in = (cl_mem) in.get_handle(ocl::ACCESS::RO);
+        cl_mem buffer_in = sampled ? in.image : (cl_mem) in.get_handle(ocl::ACCESS::RO);
         cl_mem buffer_io_1 = clCreateBuffer(ocl_context, CL_MEM_READ_WRITE, inter_size, NULL, &err);
+        cl_kernel kernel = sampled ? kernel_downscale_image : kernel_downscale;
 
         auto img_w = (ushort) in.cols;
-        auto img_h = (ushort) in.rows;
+        auto img_h = (ushort) rows;
         auto out_w = (ushort) n_w;
         auto out_h = (ushort) n_h;
         auto scale_w = (float) scale;
@@ -254,28 +293,22 @@ namespace xm::filters {
         auto is_linear = (uchar) config.linear ? 255 : 0;
 
         cl_uint idx_0 = 0;
-        idx_0 = xm::ocl::set_kernel_arg(kernel_downscale, idx_0, sizeof(cl_mem), &buffer_in);
-        idx_0 = xm::ocl::set_kernel_arg(kernel_downscale, idx_0, sizeof(cl_mem), &buffer_io_1);
-        idx_0 = xm::ocl::set_kernel_arg(kernel_downscale, idx_0, sizeof(ushort), &img_w);
-        idx_0 = xm::ocl::set_kernel_arg(kernel_downscale, idx_0, sizeof(ushort), &img_h);
-        idx_0 = xm::ocl::set_kernel_arg(kernel_downscale, idx_0, sizeof(ushort), &out_w);
-        idx_0 = xm::ocl::set_kernel_arg(kernel_downscale, idx_0, sizeof(ushort), &out_h);
-        idx_0 = xm::ocl::set_kernel_arg(kernel_downscale, idx_0, sizeof(float), &scale_w);
-        idx_0 = xm::ocl::set_kernel_arg(kernel_downscale, idx_0, sizeof(float), &scale_h);
-        idx_0 = xm::ocl::set_kernel_arg(kernel_downscale, idx_0, sizeof(uchar), &channels_n);
-        xm::ocl::set_kernel_arg(kernel_downscale, idx_0, sizeof(uchar), &is_linear);
-
-        xm::ocl::enqueue_kernel_fast(
-            queue,
-            kernel_downscale,
-            2,
-            g_size,
-            l_size,
-            false);
+        idx_0 = xm::ocl::set_kernel_arg(kernel, idx_0, sizeof(cl_mem), &buffer_in);
+        idx_0 = xm::ocl::set_kernel_arg(kernel, idx_0, sizeof(cl_mem), &buffer_io_1);
+        idx_0 = xm::ocl::set_kernel_arg(kernel, idx_0, sizeof(ushort), &img_w);
+        idx_0 = xm::ocl::set_kernel_arg(kernel, idx_0, sizeof(ushort), &img_h);
+        idx_0 = xm::ocl::set_kernel_arg(kernel, idx_0, sizeof(ushort), &out_w);
+        idx_0 = xm::ocl::set_kernel_arg(kernel, idx_0, sizeof(ushort), &out_h);
+        idx_0 = xm::ocl::set_kernel_arg(kernel, idx_0, sizeof(float), &scale_w);
+        idx_0 = xm::ocl::set_kernel_arg(kernel, idx_0, sizeof(float), &scale_h);
+        idx_0 = xm::ocl::set_kernel_arg(kernel, idx_0, sizeof(uchar), &channels_n);
+        xm::ocl::set_kernel_arg(kernel, idx_0, sizeof(uchar), &is_linear);
+
+        xm::ocl::tuner::enqueue_3d(queue, kernel, n_w, n_h, layers, pref_size, false, build_options);
 
         return xm::ocl::iop::ClImagePromise(
             xm::ocl::Image2D(
-                n_w, n_h, config.color_channels, sizeof(uchar),
+                n_w, n_h * layers, config.color_channels, sizeof(uchar),
                 buffer_io_1, ocl_context, device_id),
                 queue)
                 .withCleanup(in_p);
@@ -292,9 +325,6 @@ namespace xm::filters {
         const auto image = downscaled_p.getImage2D();
         const auto original = original_p.getImage2D();
 
-        size_t l_size[2] = {pref_size, pref_size};
-        size_t g_size[2] = {xm::ocl::optimal_global_size((int) image.cols, pref_size),
-                            xm::ocl::optimal_global_size((int) image.rows, pref_size)};
 
         cl_mem buffer_image = (cl_mem) image.get_handle(ocl::ACCESS::RO);
         cl_mem buffer_noise = (cl_mem) noise_map.handle;
@@ -329,7 +359,7 @@ namespace xm::filters {
         auto _channels_n = (uchar) config.color_channels;
         auto _rng_seed = (uint) time_seed();
         auto _width = (ushort) image.cols;
-        auto _height = (ushort) image.rows;
+        auto _height = (ushort) (image.rows / layers);
 
         cl_uint idx_0 = 0;
 
@@ -380,21 +410,15 @@ namespace xm::filters {
         idx_0 = xm::ocl::set_kernel_arg(kernel_subsense, idx_0, sizeof(ushort), &_width);
         xm::ocl::set_kernel_arg(kernel_subsense, idx_0, sizeof(ushort), &_height);
 
-        xm::ocl::enqueue_kernel_fast(
-            queue,
-            kernel_subsense,
-            2,
-            g_size,
-            l_size,
-            false);
+        xm::ocl::tuner::enqueue_3d(queue, kernel_subsense, _width, _height, layers, pref_size, false, build_options);
 
 
         // ============================================= MORPHOLOGY =============================================
 
         if (config.morph_on) {
-            gate(queue, l_size, g_size);
-            dilate(queue, l_size, g_size);
-            erode(queue, l_size, g_size);
+            gate(queue);
+            dilate(queue);
+            erode(queue);
         }
 
         // ============================================= MASK APPLY ==============================================
@@ -405,11 +429,11 @@ namespace xm::filters {
         cl_mem buffer_original = (cl_mem) original.get_handle(ocl::ACCESS::RO);
 
         auto _mask_w = (ushort) image.cols;
-        auto _mask_h = (ushort) image.rows;
+        auto _mask_h = (ushort) (image.rows / layers);
         auto _out_w = (ushort) img_out.cols;
-        auto _out_h = (ushort) img_out.rows;
-        auto _scale_w = (float) img_out.cols / (float) image.cols;
-        auto _scale_h = (float) img_out.rows / (float) image.rows;
+        auto _out_h = (ushort) (img_out.rows / layers);
+        auto _scale_w = (float) _out_w / (float) _mask_w;
+        auto _scale_h = (float) _out_h / (float) _mask_h;
         auto _d_x = (uchar) std::ceil(_scale_w);
         auto _d_y = (uchar) std::ceil(_scale_h);
         auto _color_b = (uchar) config.color.b;
@@ -434,13 +458,7 @@ namespace xm::filters {
         idx_1 = xm::ocl::set_kernel_arg(kernel_apply, idx_1, sizeof(uchar), &_color_r);
         xm::ocl::set_kernel_arg(kernel_apply, idx_1, sizeof(uchar), &_channels_n);
 
-        xm::ocl::enqueue_kernel_fast(
-            queue,
-            kernel_apply,
-            2,
-            g_size,
-            l_size,
-            false);
+        xm::ocl::tuner::enqueue_3d(queue, kernel_apply, _mask_w, _mask_h, layers, pref_size, false, build_options);
 
         return xm::ocl::iop::ClImagePromise(img_out,queue)
         .withCleanup(downscaled_p)
@@ -449,7 +467,7 @@ namespace xm::filters {
     }
 
 
-    void BgSubtract::gate(cl_command_queue queue, size_t *l_size, size_t *g_size) {
+    void BgSubtract::gate(cl_command_queue queue) {
         if (config.refine_gate <= 0 || !config.morph_on)
             return;
 
@@ -457,7 +475,7 @@ namespace xm::filters {
         auto gate_threshold = (uchar) ((float) gate_kernel_type * 4.f * config.refine_gate_threshold);
         auto gate_c_size = (uchar) 1;
         auto _width = (ushort) seg_mask.cols;
-        auto _height = (ushort) seg_mask.rows;
+        auto _height = (ushort) (seg_mask.rows / layers);
 
         xm::ocl::Image2D im_1 = seg_mask;
         xm::ocl::Image2D im_2 = tmp_mask;
@@ -478,13 +496,7 @@ namespace xm::filters {
             idx_2 = xm::ocl::set_kernel_arg(kernel_gate, idx_2, sizeof(ushort), &_width);
             xm::ocl::set_kernel_arg(kernel_gate, idx_2, sizeof(ushort), &_height);
 
-            xm::ocl::enqueue_kernel_fast(
-                    queue,
-                    kernel_gate,
-                    2,
-                    g_size,
-                    l_size,
-                    false);
+            xm::ocl::tuner::enqueue_3d(queue, kernel_gate, _width, _height, layers, pref_size, false, build_options);
 
             auto tmp = im_1;
             im_1 = std::move(im_2);
@@ -494,14 +506,14 @@ namespace xm::filters {
         seg_mask = std::move(im_1);
     }
 
-    void BgSubtract::erode(cl_command_queue queue, size_t *l_size, size_t *g_size) {
+    void BgSubtract::erode(cl_command_queue queue) {
         if (config.refine_erode <= 0 || !config.morph_on)
             return;
 
         auto erode_kernel_type = (uchar) config.erode_kernel;
         auto erode_c_size = (uchar) 1;
         auto _width = (ushort) seg_mask.cols;
-        auto _height = (ushort) seg_mask.rows;
+        auto _height = (ushort) (seg_mask.rows / layers);
 
         xm::ocl::Image2D im_1 = seg_mask;
         xm::ocl::Image2D im_2 = tmp_mask;
@@ -521,13 +533,7 @@ namespace xm::filters {
             idx_2 = xm::ocl::set_kernel_arg(kernel_erode, idx_2, sizeof(ushort), &_width);
             xm::ocl::set_kernel_arg(kernel_erode, idx_2, sizeof(ushort), &_height);
 
-            xm::ocl::enqueue_kernel_fast(
-                    queue,
-                    kernel_erode,
-                    2,
-                    g_size,
-                    l_size,
-                    false);
+            xm::ocl::tuner::enqueue_3d(queue, kernel_erode, _width, _height, layers, pref_size, false, build_options);
 
             auto tmp = im_1;
             im_1 = std::move(im_2);
@@ -537,14 +543,14 @@ namespace xm::filters {
         seg_mask = std::move(im_1);
     }
 
-    void BgSubtract::dilate(cl_command_queue queue, size_t *l_size, size_t *g_size) {
+    void BgSubtract::dilate(cl_command_queue queue) {
         if (config.refine_dilate <= 0 || !config.morph_on)
             return;
 
         auto dilate_kernel_type = (uchar) config.dilate_kernel;
         auto dilate_c_size = (uchar) 1;
         auto _width = (ushort) seg_mask.cols;
-        auto _height = (ushort) seg_mask.rows;
+        auto _height = (ushort) (seg_mask.rows / layers);
 
         xm::ocl::Image2D im_1 = seg_mask;
         xm::ocl::Image2D im_2 = tmp_mask;
@@ -562,13 +568,7 @@ namespace xm::filters {
             idx_3 = xm::ocl::set_kernel_arg(kernel_dilate, idx_3, sizeof(ushort), &_width);
             xm::ocl::set_kernel_arg(kernel_dilate, idx_3, sizeof(ushort), &_height);
 
-            xm::ocl::enqueue_kernel_fast(
-                    queue,
-                    kernel_dilate,
-                    2,
-                    g_size,
-                    l_size,
-                    false);
+            xm::ocl::tuner::enqueue_3d(queue, kernel_dilate, _width, _height, layers, pref_size, false, build_options);
 
             auto tmp = im_1;
             im_1 = std::move(im_2);
@@ -588,9 +588,6 @@ namespace xm::filters {
                 utility_1.cols, utility_1.rows, (size_t) 3, 1,
                 ocl_context, device_id);
 
-        size_t l_size[2] = {pref_size, pref_size};
-        size_t g_size[2] = {xm::ocl::optimal_global_size((int) out.cols, pref_size),
-                            xm::ocl::optimal_global_size((int) out.rows, pref_size)};
 
         cl_mem buffer_bg_model = (cl_mem) bg_model.handle;
         cl_mem buffer_seg_mask = (cl_mem) seg_mask.handle;
@@ -607,7 +604,7 @@ namespace xm::filters {
         auto _rng_seed = (uint) time_seed();
         auto _ghost_n = (ushort) config.ghost_n;
         auto _width = (ushort) out.cols;
-        auto _height = (ushort) out.rows;
+        auto _height = (ushort) (out.rows / layers);
 
         cl_uint idx_1 = 0;
         idx_1 = xm::ocl::set_kernel_arg(kernel_debug, idx_1, sizeof(cl_mem), &buffer_bg_model);
@@ -627,13 +624,7 @@ namespace xm::filters {
         idx_1 = xm::ocl::set_kernel_arg(kernel_debug, idx_1, sizeof(ushort), &_width);
         xm::ocl::set_kernel_arg(kernel_debug, idx_1, sizeof(ushort), &_height);
 
-        xm::ocl::enqueue_kernel_fast(
-                queue,
-                kernel_debug,
-                2,
-                g_size,
-                l_size,
-                false);
+        xm::ocl::tuner::enqueue_3d(queue, kernel_debug, _width, _height, layers, pref_size, false, build_options);
 
         return xm::ocl::iop::ClImagePromise(out, queue)
         .withCleanup(ref);
@@ -688,8 +679,35 @@ namespace xm::filters {
     }
 
     void BgSubtract::set_debug_mode(int mode) {
+        if (cpu && mode >= 0)
+            log->warn("debug view is not available with CPU compute backend");
         debug_mode = mode;
     }
 
+    void BgSubtract::set_resolution(int base) {
+        if (base == config.BASE_RESOLUTION)
+            return;
+
+        config.BASE_RESOLUTION = base;
+
+        // reallocated with the new size during the next pass
+        release_model();
+    }
+
+    void BgSubtract::release_model() {
+        bg_model.release();
+        utility_1.release();
+        utility_2.release();
+        noise_map.release();
+        seg_mask.release();
+        tmp_mask.release();
+
+        reset();
+    }
+
+    int BgSubtract::resolution() const {
+        return config.BASE_RESOLUTION;
+    }
+
 }
 #pragma clang diagnostic pop
\ No newline at end of file
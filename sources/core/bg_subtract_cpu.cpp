@@ -0,0 +1,483 @@
+//
+// Created by henryco on 21/07/24.
+//
+
+#include "../../xmotion/core/filter/bg_subtract.h"
+#include "../../xmotion/core/ocl/ocl_interop.h"
+#include "../../xmotion/core/ocl/ocl_cpu.h"
+
+#include <algorithm>
+#include <bit>
+#include <climits>
+#include <cmath>
+#include <cstring>
+
+/*
+ * CPU port of kernels/cl/subsense.cl, every function mirrors the kernel of the same name,
+ * pixels are independent within a pass, so rows are processed in parallel bands
+ */
+namespace xm::filters {
+
+    namespace {
+
+        constexpr signed char KER_ARR[32] = {
+                -2, -2,
+                -2,  2,
+                 2, -2,
+                 2,  2,
+
+                -2,  0,
+                 0, -2,
+                 2,  0,
+                 0,  2,
+
+                -1, -1,
+                -1,  1,
+                 1, -1,
+                 1,  1,
+
+                -1,  0,
+                 0, -1,
+                 1,  0,
+                 0,  1
+        };
+
+        constexpr float L2_C3_NORM_DIV = 441.6729559f;
+        constexpr float L2_C2_NORM_DIV = 360.6244584f;
+        constexpr float L2_C1_NORM_DIV = 255.f;
+
+        constexpr int MORPH_TYPE_ERODE = 0;
+        constexpr int MORPH_TYPE_DILATE = 1;
+        constexpr int MORPH_TYPE_GATE = 2;
+
+        inline int kernel_offset(bgs::KernelType kernel_type) {
+            return 32 - ((int) kernel_type * 8);
+        }
+
+        inline float xor_shift_rng(uint32_t state) {
+            state ^= state << 13;
+            state ^= state >> 17;
+            state ^= state << 5;
+            return (float) state / (float) UINT_MAX;
+        }
+
+        inline float noise_3(float x, float y, float z) {
+            const float v = std::sin(x * 112.9898f + y * 179.233f + z * 237.212f) * 43758.5453f;
+            return std::min(v - std::floor(v), 0x1.fffffep-1f); // fract
+        }
+
+        inline int pos_3(int x, int y, int z, int w, int h, int c_sz) {
+            return ((z * h + y) * w + x) * c_sz;
+        }
+
+        // float to integer conversions saturate, as they do on GPUs
+        inline int sat_i32(float v) {
+            return std::isnan(v) ? 0 : (int) std::clamp((double) v, (double) INT_MIN, (double) INT_MAX);
+        }
+
+        inline int sat_u16(float v) {
+            return std::isnan(v) ? 0 : (int) std::clamp(v, 0.f, 65535.f);
+        }
+
+        inline float normalize_l2(float value, int channels_n) {
+            return value / (channels_n == 3 ? L2_C3_NORM_DIV : channels_n == 2 ? L2_C2_NORM_DIV : L2_C1_NORM_DIV);
+        }
+
+        inline int hamming_distance(const uchar *one, const uchar *two, int n) {
+            int d = 0;
+            for (int i = 0; i < n; i++)
+                d += std::popcount((unsigned int) (uchar) (one[i] ^ two[i]));
+            return d;
+        }
+
+        /**
+         * @param out zero initialized, bits are packed across channels
+         */
+        void compute_lbsp(const uchar *input, uchar *out, bgs::KernelType kernel_type, uchar threshold,
+                          int channels_n, int width, int height, int x, int y) {
+            const int offset = kernel_offset(kernel_type);
+            const int idx_mid = (y * width + x) * channels_n;
+
+            int c = 0, b = 0;
+            for (int i = 0; i < channels_n; i++) {
+                const int mid = input[idx_mid + i] + threshold;
+
+                for (int h = offset; h < 31; h += 2) {
+                    const int i_x = x + KER_ARR[h];
+                    const int i_y = y + KER_ARR[h + 1];
+
+                    if (i_x >= 0 && i_y >= 0 && i_x < width && i_y < height
+                        && input[((i_y * width) + i_x) * channels_n + i] > mid)
+                        out[c] |= (uchar) (1 << b);
+
+                    if (++b >= 8) {
+                        c++;
+                        b = 0;
+                    }
+                }
+            }
+        }
+
+        void morph_pass(const uchar *input, uchar *output, int operation, bgs::KernelType kernel_type,
+                        uchar threshold, int width, int height) {
+            const int offset = kernel_offset(kernel_type);
+
+            xm::ocl::cpu::parallel_rows(height, [&](int from, int to) {
+                for (int y = from; y < to; y++) {
+                    for (int x = 0; x < width; x++) {
+                        const int idx = y * width + x;
+
+                        if (operation == MORPH_TYPE_GATE) {
+                            int counter = input[idx] > 0 ? 0 : 1; // Foreground -> 0, Background -> 1
+                            for (int h = offset; h < 31 && counter <= threshold; h += 2) {
+                                const int i_x = x + KER_ARR[h];
+                                const int i_y = y + KER_ARR[h + 1];
+                                if (i_x < 0 || i_x >= width || i_y < 0 || i_y >= height)
+                                    continue;
+                                counter += input[i_y * width + i_x] > 0 ? 0 : 1;
+                            }
+                            output[idx] = counter > threshold ? 0 : 255;
+                            continue;
+                        }
+
+                        uchar value = input[idx];
+                        for (int h = offset; h < 31; h += 2) {
+                            const int i_x = x + KER_ARR[h];
+                            const int i_y = y + KER_ARR[h + 1];
+                            if (i_x < 0 || i_x >= width || i_y < 0 || i_y >= height)
+                                continue;
+                            const uchar v = input[i_y * width + i_x];
+                            value = operation == MORPH_TYPE_DILATE ? std::max(value, v) : std::min(value, v);
+                        }
+                        output[idx] = value;
+                    }
+                }
+            });
+        }
+    }
+
+    xm::ocl::iop::ClImagePromise BgSubtract::filter_cpu(const ocl::iop::ClImagePromise &frame_in,
+                                                        const ocl::iop::ClImagePromise &ex_mask) {
+        const auto original = frame_in.getImage2D();
+        const auto downscaled = downscale_cpu(original, config.BASE_RESOLUTION);
+
+        if (model_i < config.model_size) {
+            prepare_update_model_cpu(downscaled);
+            model_i += 1;
+            return frame_in;
+        }
+
+        return subsense_cpu(downscaled, original, ex_mask.getImage2D());
+    }
+
+    ocl::Image2D BgSubtract::downscale_cpu(const ocl::Image2D &in, int base) {
+        float scale;
+        int n_w, n_h;
+
+        new_size((int) in.cols, (int) in.rows, base, n_w, n_h, scale);
+
+        auto out = xm::ocl::Image2D::allocate_host(n_w, n_h, config.color_channels, sizeof(uchar));
+        auto dst = xm::ocl::iop::to_host_mat(out);
+        xm::ocl::cpu::downscale(xm::ocl::iop::to_host_mat(in), dst, scale, scale, config.linear);
+        return out;
+    }
+
+    void BgSubtract::prepare_update_model_cpu(const ocl::Image2D &in) {
+        const int n_w = (int) in.cols;
+        const int n_h = (int) in.rows;
+
+        const int channels_n = config.color_channels;
+        const int lbsp_c_size = config.lbsp_on ? bgs::lbsp_k_size_bytes(config.kernel) : 0;
+        const int bgm_ch_size = channels_n * (1 + lbsp_c_size);
+        const int lbsp_size_b = channels_n * lbsp_c_size;
+        const int ut1_size = config.debug_on ? 5 : 4;
+
+        if (bg_model.empty())
+            bg_model = xm::ocl::Image2D::allocate_host(n_w, n_h, (size_t) config.model_size * bgm_ch_size, 1);
+        if (utility_1.empty())
+            utility_1 = xm::ocl::Image2D::allocate_host(n_w, n_h, ut1_size, sizeof(float));
+        if (utility_2.empty())
+            utility_2 = xm::ocl::Image2D::allocate_host(n_w, n_h, 2, sizeof(short));
+        if (noise_map.empty())
+            noise_map = xm::ocl::Image2D::allocate_host(n_w, n_h, 1, sizeof(float));
+        if (seg_mask.empty())
+            seg_mask = xm::ocl::Image2D::allocate_host(n_w, n_h, 1, 1);
+        if (tmp_mask.empty())
+            tmp_mask = xm::ocl::Image2D::allocate_host(n_w, n_h, 1, 1);
+
+        const auto image = in.data();
+        const auto noise = reinterpret_cast<float *>(noise_map.data());
+        const auto mask = seg_mask.data();
+        const auto model = bg_model.data();
+        const auto ut1 = reinterpret_cast<float *>(utility_1.data());
+        const auto ut2 = reinterpret_cast<short *>(utility_2.data());
+
+        const auto lbsp_threshold = (uchar) std::min(255.f, config.lbsp_d * 255.f);
+        const auto z = std::clamp((int) (uchar) model_i, 0, config.model_size - 1);
+
+        xm::ocl::cpu::parallel_rows(n_h, [&](int from, int to) {
+            for (int y = from; y < to; y++) {
+                for (int x = 0; x < n_w; x++) {
+                    const int idx = y * n_w + x;
+                    const int ut1_idx = idx * ut1_size;
+                    const int ut2_idx = idx * 2;
+                    const int img_idx = idx * channels_n;
+                    const int bgm_idx = pos_3(x, y, z, n_w, n_h, bgm_ch_size);
+
+                    noise[idx] = noise_3((float) x, (float) y, (float) (uchar) model_i);
+                    mask[idx] = 0;
+
+                    ut1[ut1_idx] = .0f;                         // D_min(x)
+                    ut1[ut1_idx + 1] = 1.f;                     // R(x)
+                    ut1[ut1_idx + 2] = config.v_flicker_dec;    // v(x)
+                    ut1[ut1_idx + 3] = .0f;                     // dt-1(x)
+                    if (config.debug_on)
+                        ut1[ut1_idx + 4] = 0.f;                 // Diff(D_min, dt)
+
+                    ut2[ut2_idx] = (short) config.t_upper;      // T(x)
+                    ut2[ut2_idx + 1] = 0;                       // Gt_acc(x)
+
+                    std::memcpy(model + bgm_idx, image + img_idx, channels_n);
+
+                    if (config.lbsp_on) {
+                        uchar lbsp_img[8] = {};
+                        compute_lbsp(image, lbsp_img, config.kernel, lbsp_threshold, channels_n, n_w, n_h, x, y);
+                        std::memcpy(model + bgm_idx + channels_n, lbsp_img, lbsp_size_b);
+                    }
+                }
+            }
+        });
+    }
+
+    ocl::Image2D BgSubtract::subsense_cpu(const ocl::Image2D &downscaled,
+                                          const ocl::Image2D &original,
+                                          const ocl::Image2D &exclusion) {
+        const int width = (int) downscaled.cols;
+        const int height = (int) downscaled.rows;
+
+        const int channels_n = config.color_channels;
+        const int model_size = (uchar) config.model_size;
+        const int lbsp_c_size = config.lbsp_on ? bgs::lbsp_k_size_bytes(config.kernel) : 0;
+        const int bgm_ch_size = channels_n * (1 + lbsp_c_size);
+        const int lbsp_size_b = channels_n * lbsp_c_size;
+        const int ut1_size = config.debug_on ? 5 : 4;
+
+        const auto lbsp_threshold = (uchar) std::min(255.f, config.lbsp_d * 255.f);
+        const auto n_norm_alpha = config.alpha_norm;
+        const auto n_norm_alpha_inv = 1.f - n_norm_alpha;
+        const auto lbsp_0 = (ushort) denorm_lbsp_threshold(config.lbsp_0);
+        const auto color_0 = (ushort) denorm_color_threshold(config.color_0);
+        const auto t_lower = (int) (ushort) config.t_lower;
+        const auto t_upper = (int) (ushort) config.t_upper;
+        const auto rng_seed = (uint32_t) time_seed();
+
+        const auto image = downscaled.data();
+        const auto noise = reinterpret_cast<const float *>(noise_map.data());
+        const auto mask = seg_mask.data();
+        const auto model = bg_model.data();
+        const auto ut1 = reinterpret_cast<float *>(utility_1.data());
+        const auto ut2 = reinterpret_cast<short *>(utility_2.data());
+        const uchar *ex_mask = config.mask_xc && !exclusion.empty() ? exclusion.data() : nullptr;
+
+        xm::ocl::cpu::parallel_rows(height, [&](int from, int to) {
+            for (int y = from; y < to; y++) {
+                for (int x = 0; x < width; x++) {
+                    const int idx = y * width + x;
+
+                    if (ex_mask != nullptr && ex_mask[idx] > 0) {
+                        mask[idx] = 255;
+                        continue; // this is foreground from exclusion mask
+                    }
+
+                    const int pre_seed = sat_i32(noise[idx] * (float) rng_seed);
+                    const float random_value = xor_shift_rng((uint32_t) pre_seed);
+
+                    const int img_idx = idx * channels_n;
+                    const int ut1_idx = idx * ut1_size;
+                    const int ut2_idx = idx * 2;
+
+                    const float D_m = ut1[ut1_idx];
+                    const float R_x = ut1[ut1_idx + 1];
+                    const float V_x = ut1[ut1_idx + 2];
+
+                    const bool St_1 = mask[idx] > 0;
+                    const short T_x = ut2[ut2_idx];
+
+                    int r_lbsp = 0;
+                    uchar lbsp_img[8] = {};
+                    if (config.lbsp_on) {
+                        r_lbsp = (int) (std::pow(2.f, R_x) + (float) lbsp_0);
+                        compute_lbsp(image, lbsp_img, config.kernel, lbsp_threshold, channels_n, width, height, x, y);
+                    }
+
+                    const int bg_model_start = (int) (random_value * (float) (model_size - 1));
+                    const int r_color = (int) (R_x * (float) color_0);
+
+                    bool is_foreground = true;
+                    float D_MIN_X = 1.f;
+                    int matches = 0;
+
+                    for (int i = bg_model_start, k = model_size; k >= 0; k--) {
+                        const int bgm_idx = pos_3(x, y, i, width, height, bgm_ch_size);
+
+                        int d_lbsp = 0;
+                        float d_l_n = 0.f;
+                        if (config.lbsp_on) {
+                            d_lbsp = hamming_distance(&model[bgm_idx + channels_n], lbsp_img, lbsp_size_b);
+                            d_l_n = (float) d_lbsp / (float) (channels_n * 4 * (int) config.kernel);
+                        }
+
+                        float d_color, d_c_n;
+                        if (config.norm_l2) {
+                            float d = 0;
+                            for (int c = 0; c < channels_n; c++) {
+                                const float diff = (float) image[img_idx + c] - (float) model[bgm_idx + c];
+                                d += diff * diff;
+                            }
+                            d_color = std::sqrt(d);
+                            d_c_n = normalize_l2(d_color, channels_n);
+                        } else {
+                            int d = 0;
+                            for (int c = 0; c < channels_n; c++)
+                                d += std::abs((int) image[img_idx + c] - (int) model[bgm_idx + c]);
+                            d_color = (float) d;
+                            d_c_n = (float) d / (255.f * (float) channels_n);
+                        }
+
+                        const float dtx = config.lbsp_on ? n_norm_alpha * d_c_n + n_norm_alpha_inv * d_l_n : d_c_n;
+                        D_MIN_X = std::min(D_MIN_X, dtx);
+
+                        if (d_color <= (float) r_color && (!config.lbsp_on || d_lbsp <= r_lbsp)) {
+                            if (++matches >= config.n_matches) {
+                                // Background detected
+                                is_foreground = false;
+                                break;
+                            }
+                        }
+
+                        if (++i >= model_size)
+                            i = 0;
+                    }
+
+                    // update out segmentation mask St(x)
+                    mask[idx] = is_foreground ? 255 : 0;
+
+                    // update moving average D_min(x) and dt-1(x)
+                    const float new_D_m = D_m * (1.f - config.alpha_d_min) + D_MIN_X * config.alpha_d_min;
+                    ut1[ut1_idx] = new_D_m;
+                    ut1[ut1_idx + 3] = D_MIN_X;
+
+                    // update v(x)
+                    const float new_V_x = is_foreground != St_1
+                                          ? std::min(config.v_flicker_cap, V_x + config.v_flicker_inc)
+                                          : std::max(config.v_flicker_dec, V_x - config.v_flicker_dec);
+                    ut1[ut1_idx + 2] = new_V_x;
+
+                    // update R(x)
+                    ut1[ut1_idx + 1] = R_x < std::pow(1.f + new_D_m * 2.f, 2.f)
+                                       ? std::min(config.r_cap, R_x + config.r_scale * (new_V_x - config.v_flicker_dec))
+                                       : std::max(1.f, R_x - (config.r_scale / new_V_x));
+
+                    if (!config.adapt_on)
+                        continue;
+
+                    // update T(x)
+                    auto new_T_x = (short) std::clamp(sat_u16(is_foreground
+                                                              ? (float) T_x + config.t_scale_inc * (1.f / (new_V_x * new_D_m))
+                                                              : (float) T_x - config.t_scale_dec * (new_V_x / new_D_m)),
+                                                      t_lower, t_upper);
+                    ut2[ut2_idx] = new_T_x;
+
+                    if (config.ghost_on) {
+                        // dt-1(x) is already updated at this point, same as in the kernel
+                        const float d_diff = std::fabs(ut1[ut1_idx + 3] - D_MIN_X);
+                        const int new_G_c = is_foreground && (d_diff < config.ghost_t)
+                                            ? ut2[ut2_idx + 1] + (ushort) config.ghost_n_inc
+                                            : std::max(0, ut2[ut2_idx + 1] - (ushort) config.ghost_n_dec);
+                        ut2[ut2_idx + 1] = (short) new_G_c;
+
+                        // Ghost detection
+                        if (new_G_c > (ushort) config.ghost_n) {
+                            is_foreground = false;
+                            new_T_x = (short) config.ghost_l;
+                        }
+
+                        if (config.debug_on)
+                            ut1[ut1_idx + 4] = d_diff;
+                    }
+
+                    // update B(x)
+                    if (!is_foreground && random_value <= (1.f / (float) new_T_x)) {
+                        const auto random_frame_n = (int) (xor_shift_rng((uint32_t) pre_seed + 42u) * (float) (model_size - 1));
+                        const int random_frame_idx = pos_3(x, y, random_frame_n, width, height, bgm_ch_size);
+                        std::memcpy(model + random_frame_idx, image + img_idx, channels_n);
+                        if (config.lbsp_on)
+                            std::memcpy(model + random_frame_idx + channels_n, lbsp_img, lbsp_size_b);
+                    }
+                }
+            }
+        });
+
+        // ============================================= MORPHOLOGY =============================================
+
+        if (config.morph_on) {
+            const auto gate_threshold = (uchar) ((float) config.gate_kernel * 4.f * config.refine_gate_threshold);
+            morph_cpu(config.refine_gate, MORPH_TYPE_GATE, config.gate_kernel, gate_threshold);
+            morph_cpu(config.refine_dilate, MORPH_TYPE_DILATE, config.dilate_kernel, 0);
+            morph_cpu(config.refine_erode, MORPH_TYPE_ERODE, config.erode_kernel, 0);
+        }
+
+        // ============================================= MASK APPLY ==============================================
+
+        auto img_out = xm::ocl::Image2D::allocate_like(original);
+
+        const int out_w = (int) img_out.cols;
+        const int out_h = (int) img_out.rows;
+        const int pixel = (int) (original.channels * original.channel_size);
+        const auto scale_w = (float) out_w / (float) width;
+        const auto scale_h = (float) out_h / (float) height;
+        const uchar color[4] = {config.color.b, config.color.g, config.color.r, 0};
+
+        // every output pixel samples the mask pixel whose upscaled block covers it
+        std::vector<int> m_x(out_w);
+        for (int x = 0; x < out_w; x++)
+            m_x[x] = std::min((int) ((float) x / scale_w), width - 1);
+
+        const auto src = original.data();
+        const auto dst = img_out.data();
+        const auto fg_mask = seg_mask.data();
+
+        xm::ocl::cpu::parallel_rows(out_h, [&](int from, int to) {
+            for (int y = from; y < to; y++) {
+                const auto mask_row = fg_mask + std::min((int) ((float) y / scale_h), height - 1) * width;
+                const auto row_in = src + (size_t) y * out_w * pixel;
+                const auto row_out = dst + (size_t) y * out_w * pixel;
+                for (int x = 0; x < out_w; x++) {
+                    if (mask_row[m_x[x]] > 0)
+                        std::memcpy(row_out + x * pixel, row_in + x * pixel, pixel); // foreground
+                    else
+                        std::memcpy(row_out + x * pixel, color, std::min(pixel, 4)); // background
+                }
+            }
+        });
+
+        return img_out;
+    }
+
+    void BgSubtract::morph_cpu(int iterations, int operation, bgs::KernelType kernel, uint8_t threshold) {
+        if (iterations <= 0)
+            return;
+
+        xm::ocl::Image2D im_1 = seg_mask;
+        xm::ocl::Image2D im_2 = tmp_mask;
+
+        for (int i = 0; i < iterations; i++) {
+            morph_pass(im_1.data(), im_2.data(), operation, kernel, threshold, (int) im_1.cols, (int) im_1.rows);
+            std::swap(im_1, im_2);
+        }
+
+        seg_mask = std::move(im_1);
+        tmp_mask = std::move(im_2);
+    }
+
+}
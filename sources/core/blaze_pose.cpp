@@ -4,30 +4,12 @@
 
 #include "../../xmotion/core/dnn/net/blaze_pose.h"
 #include "../../xmotion/core/dnn/net/dnn_cl_utils.h"
+#include "../../xmotion/core/ocl/ocl_cpu.h"
+#include <algorithm>
 #include <filesystem>
 
 namespace eox::dnn {
 
-    const float *lm_3d_1x195(const tflite::Interpreter &interpreter, pose::Model model) {
-        return interpreter.output_tensor(pose::mappings[model].lm_3d)->data.f;
-    }
-
-    const float *lm_world_1x117(const tflite::Interpreter &interpreter, pose::Model model) {
-        return interpreter.output_tensor(pose::mappings[model].world)->data.f;
-    }
-
-    const float *heatmap_1x64x64x39(const tflite::Interpreter &interpreter, pose::Model model) {
-        return interpreter.output_tensor(pose::mappings[model].hm)->data.f;
-    }
-
-    const float *segmentation_1x128x128x1(const tflite::Interpreter &interpreter, pose::Model model) {
-        return interpreter.output_tensor(pose::mappings[model].seg)->data.f;
-    }
-
-    const float *pose_flag_1x1(const tflite::Interpreter &interpreter, pose::Model model) {
-        return interpreter.output_tensor(pose::mappings[model].flag)->data.f;
-    }
-
 //    const std::vector<std::string> BlazePose::outputs = {
 //            "Identity:0",   // 598 | 0: [1, 195]           landmarks 3d
 //            "Identity_4:0", // 600 | 1: [1, 117]           world 3d
@@ -44,13 +26,62 @@ namespace eox::dnn {
         cv::UMat blob = eox::dnn::convert_to_squared_blob(frame, get_in_w(), get_in_h(), true);
 
         with_box = true;
-        init();
-        input_ocl(0, xm::dnn::ocl::getOpenCLBufferFromUMat(frame), get_in_w() * get_in_h() * 3 * 4);
-        const auto result = inference();
+        init_single();
+        if (quantized(0) || xm::ocl::cpu::enabled()) {
+            // integer tensor lives on host, quantized during the copy (or no OpenCL buffer on cpu backend)
+            const auto mat = blob.getMat(cv::ACCESS_READ);
+            input(0, mat.ptr<float>(0), get_in_w() * get_in_h() * 3 * 4);
+        } else {
+            input_ocl(0, xm::dnn::ocl::getOpenCLBufferFromUMat(frame), get_in_w() * get_in_h() * 3 * 4);
+        }
+        auto result = inference();
         with_box = false;
         return result;
     }
 
+    std::vector<PoseOutput> BlazePose::inference(const std::vector<cv::UMat> &frames) {
+        std::vector<PoseOutput> outputs;
+        outputs.reserve(frames.size());
+        if (frames.empty())
+            return outputs;
+
+        init();
+        const int n = (int) frames.size();
+        const int slots = std::max(n, batch_size);
+
+        if (slots > 1 && batching && !batch(0, slots)) {
+            log->warn("Model does not support batch size: {}, falling back to invocation per ROI", slots);
+            batching = false;
+        }
+
+        if (slots == 1 || !batching) {
+            // crops are views of the frame, so their blobs go through the host as well
+            init_single();
+            for (const auto &frame: frames) {
+                input_slot(0, frame);
+                invoke();
+                view_w = frame.cols;
+                view_h = frame.rows;
+                outputs.push_back(decode(0));
+            }
+            return outputs;
+        }
+
+        // letterboxed blobs written directly into consecutive slots of the input tensor,
+        // outputs of the padding slots are ignored, so they are not cleared
+        for (int i = 0; i < n; i++)
+            input_slot(i, frames[i]);
+
+        invoke();
+
+        for (int i = 0; i < n; i++) {
+            view_w = frames[i].cols;
+            view_h = frames[i].rows;
+            outputs.push_back(decode(i));
+        }
+        return outputs;
+    }
+
     PoseOutput BlazePose::inference(const cv::Mat &frame) {
         view_w = frame.cols;
         view_h = frame.rows;
@@ -59,14 +90,38 @@ namespace eox::dnn {
         cv::Mat blob = eox::dnn::convert_to_squared_blob(frame, get_in_w(), get_in_h(), true);
 
         with_box = true;
-        const auto result = inference(blob.ptr<float>(0));
+        auto result = inference(blob.ptr<float>(0));
         with_box = false;
 
         return result;
     }
 
+    PoseOutput BlazePose::inference(cl_command_queue queue, cl_mem blob, int width, int height) {
+        view_w = width;
+        view_h = height;
+
+        with_box = true;
+        init_single();
+        input(0, queue, blob, get_in_w() * get_in_h() * 3 * 4);
+        auto result = inference();
+        with_box = false;
+        return result;
+    }
+
+    PoseOutput BlazePose::inference(const float *blob, int width, int height) {
+        view_w = width;
+        view_h = height;
+
+        with_box = true;
+        init_single();
+        input(0, blob, get_in_w() * get_in_h() * 3 * 4);
+        auto result = inference();
+        with_box = false;
+        return result;
+    }
+
     PoseOutput BlazePose::inference(const float *frame) {
-        init();
+        init_single();
         input(0, frame, get_in_w() * get_in_h() * 3 * 4);
         return inference();
     }
@@ -78,13 +133,21 @@ namespace eox::dnn {
         }
 
         invoke();
-        PoseOutput output;
+        return decode(0);
+    }
 
-        const auto presence = *pose_flag_1x1(*interpreter, model_type);
-        output.score = presence;
+    PoseOutput BlazePose::decode(int index) {
+        PoseOutput result;
 
-        const float *land_marks_3d = lm_3d_1x195(*interpreter, model_type);
-        const float *land_marks_wd = lm_world_1x117(*interpreter, model_type);
+        const auto &mapping = pose::mappings[model_type];
+
+        // [N, 1] pose flag (score)
+        const auto presence = output(mapping.flag)[index];
+        result.score = presence;
+
+        // [N, 195] landmarks 3d, [N, 117] world 3d
+        const float *land_marks_3d = output(mapping.lm_3d) + index * 195;
+        const float *land_marks_wd = output(mapping.world) + index * 117;
 
         // correcting letterbox paddings
         const auto p = eox::dnn::get_letterbox_paddings(view_w, view_h, get_in_w(), get_in_h());
@@ -95,7 +158,7 @@ namespace eox::dnn {
             const int j = i * 3;
             const int k = i * 5;
             // normalized landmarks_3d
-            output.landmarks_norm[i] = {
+            result.landmarks_norm[i] = {
                     .x = (land_marks_3d[k + 0] - p.left) / n_w,
                     .y = (land_marks_3d[k + 1] - p.top) / n_h,
                     .z = land_marks_3d[k + 2] / (float) std::max(get_in_w(), get_in_h()),
@@ -104,7 +167,7 @@ namespace eox::dnn {
             };
 
             // world-space landmarks
-            output.landmarks_3d[i] = {
+            result.landmarks_3d[i] = {
                     .x = land_marks_wd[j + 0],
                     .y = land_marks_wd[j + 1],
                     .z = land_marks_wd[j + 2],
@@ -112,39 +175,56 @@ namespace eox::dnn {
         }
 
         if (SEGMENTATION) {
-            const float *s = segmentation_1x128x128x1(*interpreter, model_type);
-
-            // 256x256 or 128x128
-            const auto size = get_in_w() * get_in_h();
+            // [N, H, W, 1]: 256x256 or 128x128, no resampling here, consumer knows the size
+            const auto dims = interpreter->output_tensor(mapping.seg)->dims;
+            const int s_h = dims->data[1];
+            const int s_w = dims->data[2];
+            const float *s = output(mapping.seg) + (size_t) index * s_w * s_h;
+            result.segmentation = segmentation_pool->acquire(s_w, s_h);
+
+            // raw logits, sigmoid is fused with thresholding by consumer
+            memcpy(result.segmentation.data(), s, (size_t) s_w * s_h * sizeof(float));
+        }
 
-            if (size == 256 * 256) {
+        return result;
+    }
 
-                for (int i = 0; i < size; i++)
-                    output.segmentation[i] = (float) eox::dnn::sigmoid(s[i]);
+    void BlazePose::init_single() {
+        init();
+        batch(0, 1);
+    }
 
-            } else {
+    void BlazePose::input_slot(int index, const cv::UMat &frame) {
+        const size_t size = (size_t) get_in_w() * get_in_h() * 3;
+        const auto blob = eox::dnn::convert_to_squared_blob(frame, get_in_w(), get_in_h(), true);
+        if (quantized(0)) {
+            const auto mat = blob.getMat(cv::ACCESS_READ);
+            input(0, index * size, mat.ptr<float>(0), size);
+            return;
+        }
 
-                auto *buffer = new float[size];
-                for (int i = 0; i < size; i++)
-                    buffer[i] = (float) eox::dnn::sigmoid(s[i]);
+        cv::Mat slot(get_in_h(), get_in_w(), CV_32FC3, interpreter->input_tensor(0)->data.f + index * size);
+        blob.copyTo(slot);
+    }
 
-                cv::Mat temp = cv::Mat(get_in_h(), get_in_w(), CV_32F, buffer);
-                cv::Mat dst;
-                cv::resize(temp, dst, cv::Size(256, 256), 0, 0, cv::INTER_NEAREST);
+    void BlazePose::set_batch_size(int n) {
+        batch_size = std::max(1, n);
+    }
 
-                if (dst.isContinuous()) {
-                    memcpy(output.segmentation, dst.data, 256 * 256 * sizeof(float));
-                }
+    std::string BlazePose::get_model_file() {
+        return model_file(model_type);
+    }
 
-                delete[] buffer;
-            }
-        }
+    std::string BlazePose::model_file(pose::Model type) {
+        return "./../models/blazepose/body/whole/" + pose::models[type];
+    }
 
-        return output;
+    void BlazePose::warm(pose::Model type) {
+        DnnRunner::warm(model_file(type));
     }
 
-    std::string BlazePose::get_model_file() {
-        return "./../models/blazepose/body/whole/" + pose::models[model_type];
+    void BlazePose::prime() {
+        DnnRunner::prime();
     }
 
     bool BlazePose::segmentation() const {
@@ -160,6 +240,8 @@ namespace eox::dnn {
     }
 
     void BlazePose::set_model_type(pose::Model type) {
+        if (type != model_type)
+            batching = true;
         model_type = type;
     }
 
@@ -16,13 +16,17 @@ namespace xm::filters {
     }
 
     xm::ocl::iop::ClImagePromise Blur::filter(const ocl::iop::ClImagePromise &in, int q_idx) {
+        return filter_stacked(in, 1, q_idx);
+    }
+
+    xm::ocl::iop::ClImagePromise Blur::filter_stacked(const ocl::iop::ClImagePromise &in, int layers, int q_idx) {
         if (!ready)
             return in;
 
         if (!initialized)
             throw std::logic_error("Filter is not initialized");
 
-        return xm::ocl::blur(in, kernel_size, q_idx);
+        return xm::ocl::blur(in, kernel_size, q_idx, layers);
     }
 
     void Blur::start() {
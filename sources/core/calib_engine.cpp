@@ -0,0 +1,70 @@
+//
+// Created by henryco on 18/07/24.
+//
+
+#include "../../xmotion/core/algo/calib_engine.h"
+
+namespace xm::calib {
+
+    Engine::~Engine() {
+        wait();
+        solver.shutdown();
+        detectors.shutdown();
+    }
+
+    void Engine::init(uint _columns, uint _rows, bool _sb, int _max_size, size_t threads) {
+        wait();
+
+        columns = _columns;
+        rows = _rows;
+        sb = _sb;
+        max_size = _max_size;
+
+        detectors.start(std::max((size_t) 1, threads));
+        solver.start(1);
+    }
+
+    std::vector<xm::ocv::Squares> Engine::detect(const std::vector<cv::UMat> &views) {
+        if (views.size() == 1)
+            return {xm::ocv::find_squares_fast(views.front(), columns, rows, sb, max_size)};
+
+        std::vector<std::future<xm::ocv::Squares>> futures;
+        futures.reserve(views.size());
+        for (const auto &view: views) {
+            futures.push_back(detectors.execute<xm::ocv::Squares>([this, view]() {
+                return xm::ocv::find_squares_fast(view, columns, rows, sb, max_size);
+            }));
+        }
+
+        std::vector<xm::ocv::Squares> squares;
+        squares.reserve(views.size());
+        for (auto &future: futures)
+            squares.push_back(future.get());
+        return squares;
+    }
+
+    bool Engine::solve(std::function<void()> task) {
+        if (busy())
+            return false;
+
+        solving = solver.execute([task = std::move(task)]() {
+            try {
+                task();
+            } catch (const std::exception &e) {
+                // not enough (or degenerate) samples yet, that's fine
+                log->debug("background solver: {}", e.what());
+            }
+        });
+        return true;
+    }
+
+    bool Engine::busy() const {
+        return solving.valid() && solving.wait_for(std::chrono::seconds(0)) != std::future_status::ready;
+    }
+
+    void Engine::wait() {
+        if (solving.valid())
+            solving.wait();
+    }
+
+} // xm::calib
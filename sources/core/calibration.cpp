@@ -11,15 +11,12 @@
 void xm::Calibration::init(const xm::calib::Initial &params) {
     timer.set_delay(params.delay);
     config = params;
+
+    engine.init(config.columns, config.rows, config.sb, config.detect_size, 1);
 }
 
 bool xm::Calibration::capture_squares(const cv::UMat &frame) {
-    const auto squares = xm::ocv::find_squares(
-            frame,
-            config.columns,
-            config.rows,
-            config.sb
-    );
+    const auto squares = engine.detect({frame}).front();
 
     images.clear();
     images.push_back(xm::ocl::iop::from_cv_umat(squares.result));
@@ -33,6 +30,7 @@ bool xm::Calibration::capture_squares(const cv::UMat &frame) {
 
     const auto callback = [this, &squares]() {
         image_points.push_back(squares.corners);
+        calibrate_live();
     };
 
     if (config.delay <= 0) {
@@ -47,7 +45,37 @@ bool xm::Calibration::capture_squares(const cv::UMat &frame) {
     return results.ready;
 }
 
+void xm::Calibration::calibrate_live() {
+    // at least few views are required for reasonable solution
+    if (image_points.size() < 3)
+        return;
+
+    // dropped if previous solution is still in progress, next sample will trigger it again
+    engine.solve([this, points = image_points]() {
+        xm::calib::Result live{};
+        solve(points, live);
+
+        std::lock_guard<std::mutex> lock(live_mutex);
+        live_rms = live.mre_1;
+        live_samples = (int) points.size();
+    });
+}
+
 void xm::Calibration::calibrate() {
+    // background solver might be still running
+    engine.wait();
+
+    solve(image_points, results);
+
+    active = false;
+    results.ready = true;
+    results.remains_ms = 0;
+    results.remains_cap = 0;
+    results.rms_live = results.mre_1;
+    results.samples_live = (int) image_points.size();
+}
+
+void xm::Calibration::solve(const std::vector<std::vector<cv::Point2f>> &image_points, xm::calib::Result &out) const {
     // Prepare object points (0,0,0), (1,0,0), (2,0,0) ... (8,5,0)
     std::vector<cv::Point3f> obj_p;
     for (int i = 0; i < config.rows - 1; ++i) {
@@ -154,22 +182,18 @@ void xm::Calibration::calibrate() {
             p,
             r);
 
-    active = false;
-    results.K = camera_matrix;
-    results.D = distortion_coefficients;
-    results.width = (float) aw;
-    results.height = (float) ah;
-    results.fov_x = (float) fov_x;
-    results.fov_y = (float) fov_y;
-    results.f = (float) f;
-    results.r = (float) r;
-    results.c_x = (float) p.x;
-    results.c_y = (float) p.y;
-    results.mre_1 = rms;
-    results.mre_2 = mre;
-    results.ready = true;
-    results.remains_ms = 0;
-    results.remains_cap = 0;
+    out.K = camera_matrix;
+    out.D = distortion_coefficients;
+    out.width = (float) aw;
+    out.height = (float) ah;
+    out.fov_x = (float) fov_x;
+    out.fov_y = (float) fov_y;
+    out.f = (float) f;
+    out.r = (float) r;
+    out.c_x = (float) p.x;
+    out.c_y = (float) p.y;
+    out.mre_1 = rms;
+    out.mre_2 = mre;
 }
 
 xm::Calibration &xm::Calibration::proceed(float delta, const std::vector<xm::ocl::Image2D> &_frames) {
@@ -181,6 +205,12 @@ xm::Calibration &xm::Calibration::proceed(float delta, const std::vector<xm::ocl
         return *this;
     }
 
+    {
+        std::lock_guard<std::mutex> lock(live_mutex);
+        results.rms_live = live_rms;
+        results.samples_live = live_samples;
+    }
+
     cv::UMat front;
     xm::ocl::iop::to_cv_umat(_frames.front(), front);
     if (!capture_squares(front)) {
@@ -219,6 +249,12 @@ void xm::Calibration::put_debug_text() {
 
     cv::putText(front, t1, cv::Point(20, 50), font, 1.5, color, 3);
     cv::putText(front, t2, cv::Point(20, 100), font, 1.5, color, 3);
+
+    if (results.samples_live > 0) {
+        const std::string t3 = "rms: " + std::to_string(results.rms_live)
+                               + " (" + std::to_string(results.samples_live) + ")";
+        cv::putText(front, t3, cv::Point(20, 150), font, 1.5, color, 3);
+    }
 }
 
 void xm::Calibration::start() {
@@ -226,6 +262,12 @@ void xm::Calibration::start() {
     results.remains_ms = config.delay;
     results.ready = false;
 
+    engine.wait();
+    live_rms = 0;
+    live_samples = 0;
+    results.rms_live = 0;
+    results.samples_live = 0;
+
     image_points.clear();
     active = true;
     timer.start();
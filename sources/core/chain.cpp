@@ -16,6 +16,9 @@ void xm::ChainCalibration::init(const xm::chain::Initial &params) {
 
     image_points.clear();
     image_points.reserve(total_pairs);
+
+    // left and right views are detected in parallel
+    engine.init(config.columns, config.rows, config.sb, config.detect_size, 2);
 }
 
 xm::ChainCalibration &xm::ChainCalibration::proceed(float delta, const std::vector<xm::ocl::Image2D> &_frames) {
@@ -28,6 +31,12 @@ xm::ChainCalibration &xm::ChainCalibration::proceed(float delta, const std::vect
         return *this;
     }
 
+    {
+        std::lock_guard<std::mutex> lock(live_mutex);
+        results.rms_live = live_pair == current_pair ? live_rms : 0;
+        results.samples_live = live_pair == current_pair ? live_samples : 0;
+    }
+
     if (!capture_squares(_frames)) {
         put_debug_text();
         return *this;
@@ -69,37 +78,17 @@ bool xm::ChainCalibration::capture_squares(const std::vector<xm::ocl::Image2D> &
         }
     }
 
-    cv::UMat frame_left;
+    cv::UMat frame_left, frame_right;
     xm::ocl::iop::to_cv_umat(_frames[left], frame_left);
-
-    const auto squares_l = xm::ocv::find_squares(
-            frame_left,
-            config.columns,
-            config.rows,
-            config.sb
-    );
-
-    images[left] = xm::ocl::iop::from_cv_umat(squares_l.result);
-    if (!squares_l.found) {
-        results.current = current_pair;
-        results.remains_ms = config.delay;
-        results.ready = false;
-        timer.reset();
-        return false;
-    }
-
-    cv::UMat frame_right;
     xm::ocl::iop::to_cv_umat(_frames[right], frame_right);
 
-    const auto squares_r = xm::ocv::find_squares(
-            frame_right,
-            config.columns,
-            config.rows,
-            config.sb
-    );
+    const auto squares = engine.detect({frame_left, frame_right});
+    const auto &squares_l = squares[0];
+    const auto &squares_r = squares[1];
 
+    images[left] = xm::ocl::iop::from_cv_umat(squares_l.result);
     images[right] = xm::ocl::iop::from_cv_umat(squares_r.result);
-    if (!squares_r.found) {
+    if (!squares_l.found || !squares_r.found) {
         results.current = current_pair;
         results.remains_ms = config.delay;
         results.ready = false;
@@ -119,6 +108,8 @@ bool xm::ChainCalibration::capture_squares(const std::vector<xm::ocl::Image2D> &
 
         image_points.back().push_back(l_r_points);
         counter += 1;
+
+        calibrate_live();
     };
 
     if (config.delay <= 0) {
@@ -160,70 +151,94 @@ bool xm::ChainCalibration::capture_squares(const std::vector<xm::ocl::Image2D> &
     return false;
 }
 
-void xm::ChainCalibration::calibrate() {
+void xm::ChainCalibration::calibrate_live() {
+    const auto pair = (int) image_points.size() - 1;
+    if (pair < 0 || image_points[pair].size() < 3)
+        return;
+
+    // dropped if previous solution is still in progress, next sample will trigger it again
+    engine.solve([this, pair, samples = image_points[pair]]() {
+        const auto solution = solve(pair, samples);
+
+        std::lock_guard<std::mutex> lock(live_mutex);
+        live_rms = solution.mre;
+        live_samples = (int) samples.size();
+        live_pair = pair;
+    });
+}
+
+xm::chain::Pair xm::ChainCalibration::solve(int i, const std::vector<std::vector<std::vector<cv::Point2f>>> &samples) const {
 
     // Prepare object points (0,0,0), (1,0,0), (2,0,0) ... (8,5,0)
     std::vector<cv::Point3f> obj_p;
-    for (int i = 0; i < config.rows - 1; ++i) {
-        for (int j = 0; j < config.columns - 1; ++j) {
-            obj_p.emplace_back((float) j * config.size, (float) i * config.size, 0.0f);
+    for (int r = 0; r < config.rows - 1; ++r) {
+        for (int c = 0; c < config.columns - 1; ++c) {
+            obj_p.emplace_back((float) c * config.size, (float) r * config.size, 0.0f);
         }
     }
 
     // Replicate obj_p for each image
     std::vector<std::vector<cv::Point3f>> object_points;
-    object_points.reserve(image_points.back().size());
-    for (int i = 0; i < image_points.back().size(); ++i) {
+    object_points.reserve(samples.size());
+    for (int k = 0; k < samples.size(); ++k) {
         object_points.push_back(obj_p);
     }
 
-    std::vector<xm::chain::Pair> pairs;
-    pairs.reserve(total_pairs);
+    const int j = ((i + 1) >= config.views) ? 0 : (i + 1);
 
-    // cross calibration, for each pair
-    for (int i = 0; i < total_pairs; i++) {
-        const int j = ((i + 1) >= config.views) ? 0 : (i + 1);
+    const auto K1 = config.K[i];
+    const auto K2 = config.K[j];
+    const auto D1 = config.D[i];
+    const auto D2 = config.D[j];
 
-        const auto K1 = config.K[i];
-        const auto K2 = config.K[j];
-        const auto D1 = config.D[i];
-        const auto D2 = config.D[j];
+    cv::Mat Ri, Ti, Ei, Fi, RMSi;
 
-        cv::Mat Ri, Ti, Ei, Fi, RMSi;
+    std::vector<std::vector<cv::Point2f>> corners_l;
+    std::vector<std::vector<cv::Point2f>> corners_r;
 
-        std::vector<std::vector<cv::Point2f>> corners_l;
-        std::vector<std::vector<cv::Point2f>> corners_r;
+    for (const auto &item: samples) {
+        corners_l.push_back(item[0]);
+        corners_r.push_back(item[1]);
+    }
 
-        for (const auto &item: image_points[i]) {
-            corners_l.push_back(item[0]);
-            corners_r.push_back(item[1]);
-        }
+    const auto rms = cv::stereoCalibrate(
+            object_points,
+            corners_l,
+            corners_r,
+            K1,
+            D1,
+            K2,
+            D2,
+            cv::Size(0, 0),
+            Ri, Ti, Ei, Fi, RMSi,
+            cv::CALIB_FIX_INTRINSIC);
+
+    cv::Mat RTi = cv::Mat::eye(4, 4, Ri.type());
+    Ri.copyTo(RTi(cv::Rect(0, 0, 3, 3)));
+    Ti.copyTo(RTi(cv::Rect(3, 0, 1, 3)));
+
+    return {
+        .R = Ri,
+        .T = Ti,
+        .E = Ei,
+        .F = Fi,
+        .RT = RTi,
+        .mre = rms
+    };
+}
+
+void xm::ChainCalibration::calibrate() {
+    // background solver might be still running
+    engine.wait();
 
+    std::vector<xm::chain::Pair> pairs;
+    pairs.reserve(total_pairs);
+
+    // cross calibration, for each pair
+    for (int i = 0; i < total_pairs; i++) {
+        const int j = ((i + 1) >= config.views) ? 0 : (i + 1);
         log->info("stereo calibrate pair: [{},{}]", i, j);
-        const auto rms = cv::stereoCalibrate(
-                object_points,
-                corners_l,
-                corners_r,
-                K1,
-                D1,
-                K2,
-                D2,
-                cv::Size(0, 0),
-                Ri, Ti, Ei, Fi, RMSi,
-                cv::CALIB_FIX_INTRINSIC);
-
-        cv::Mat RTi = cv::Mat::eye(4, 4, Ri.type());
-        Ri.copyTo(RTi(cv::Rect(0, 0, 3, 3)));
-        Ti.copyTo(RTi(cv::Rect(3, 0, 1, 3)));
-
-        pairs.push_back({
-            .R = Ri,
-            .T = Ti,
-            .E = Ei,
-            .F = Fi,
-            .RT = RTi,
-            .mre = rms
-        });
+        pairs.push_back(solve(i, image_points[i]));
     }
 
     active = false;
@@ -268,9 +283,22 @@ void xm::ChainCalibration::put_debug_text() {
 
     cv::putText(front, t1, cv::Point(20, 50), font, 1.5, color, 3);
     cv::putText(front, t2, cv::Point(20, 100), font, 1.5, color, 3);
+
+    if (results.samples_live > 0) {
+        const std::string t3 = "rms: " + std::to_string(results.rms_live)
+                               + " (" + std::to_string(results.samples_live) + ")";
+        cv::putText(front, t3, cv::Point(20, 150), font, 1.5, color, 3);
+    }
 }
 
 void xm::ChainCalibration::start() {
+    engine.wait();
+    live_rms = 0;
+    live_samples = 0;
+    live_pair = -1;
+    results.rms_live = 0;
+    results.samples_live = 0;
+
     results.current = 0;
     results.remains_cap = config.total;
     results.remains_ms = config.delay;
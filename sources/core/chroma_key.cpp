@@ -30,6 +30,7 @@ namespace xm::filters {
         fine_kernel = std::max(3, (conf.fine * 2) + 1);
         mask_iterations = conf.refine;
         bgr_bg_color = conf.color;
+        fused_mode = conf.fused;
 
         log->info("L: {}, {}, {}", hls_key_lower[0], hls_key_lower[1], hls_key_lower[2]);
         log->info("U: {}, {}, {}", hls_key_upper[0], hls_key_upper[1], hls_key_upper[2]);
@@ -38,7 +39,11 @@ namespace xm::filters {
     }
 
     xm::ocl::iop::ClImagePromise ChromaKey::filter(const ocl::iop::ClImagePromise &in, int q_idx) {
-        if (!ready)
+        return filter_stacked(in, 1, q_idx);
+    }
+
+    xm::ocl::iop::ClImagePromise ChromaKey::filter_stacked(const ocl::iop::ClImagePromise &in, int layers, int q_idx) {
+        if (!ready || fused_mode)
             return in;
         if (!initialized)
             throw std::logic_error("Filter is not initialized");
@@ -53,7 +58,8 @@ namespace xm::filters {
                     blur_kernel,
                     fine_kernel,
                     mask_iterations,
-                    q_idx);
+                    q_idx,
+                    layers);
         return xm::ocl::chroma_key_single_pass(
                 in,
                 hls_key_lower,
@@ -62,9 +68,39 @@ namespace xm::filters {
                 linear_interpolation,
                 mask_size,
                 blur_kernel,
+                q_idx,
+                layers);
+    }
+
+    xm::ocl::iop::ClImagePromise ChromaKey::mask(const ocl::iop::ClImagePromise &in, int q_idx) const {
+        if (!initialized)
+            throw std::logic_error("Filter is not initialized");
+        return xm::ocl::chroma_mask(
+                in,
+                hls_key_lower,
+                hls_key_upper,
+                linear_interpolation,
+                mask_size,
+                blur_kernel,
+                fine_kernel,
+                mask_iterations,
                 q_idx);
     }
 
+    xm::ocl::iop::ClImagePromise ChromaKey::apply(const ocl::iop::ClImagePromise &in, const ocl::iop::ClImagePromise &mask, int q_idx) const {
+        return xm::ocl::chroma_apply(in, mask, bgr_bg_color, q_idx);
+    }
+
+    xm::ocl::iop::ClImagePromise ChromaKey::blob(const ocl::iop::ClImagePromise &in, const ocl::iop::ClImagePromise &mask,
+                                                 float roi_x, float roi_y, float roi_w, float roi_h,
+                                                 int width, int height, int q_idx) const {
+        return xm::ocl::chroma_blob(in, mask, bgr_bg_color, roi_x, roi_y, roi_w, roi_h, width, height, q_idx);
+    }
+
+    bool ChromaKey::fused() const {
+        return fused_mode;
+    }
+
     void ChromaKey::start() {
         ready = true;
     }
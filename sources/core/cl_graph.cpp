@@ -0,0 +1,139 @@
+//
+// Created by henryco on 21/07/24.
+//
+
+#include "../../xmotion/core/ocl/cl_graph.h"
+#include "../../xmotion/core/ocl/ocl_filters.h"
+#include "../../xmotion/core/ocl/ocl_cpu.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace xm::ocl {
+
+    namespace {
+
+        /**
+         * Marker of everything enqueued on node's queue so far (node's commands included)
+         */
+        cl_event event_of(cl_command_queue queue, cl_event &done) {
+            if (done != nullptr || queue == nullptr)
+                return done;
+            const cl_int err = clEnqueueMarkerWithWaitList(queue, 0, NULL, &done);
+            if (err != CL_SUCCESS)
+                throw std::runtime_error("Cannot enqueue marker: " + std::to_string(err));
+            // event might be waited for by another queue, it has to be submitted
+            clFlush(queue);
+            return done;
+        }
+    }
+
+    Graph::~Graph() {
+        clear();
+    }
+
+    void Graph::clear() {
+        for (auto &node: nodes) {
+            if (node.done != nullptr)
+                clReleaseEvent(node.done);
+        }
+        nodes.clear();
+    }
+
+    int Graph::source(const iop::ClImagePromise &value) {
+        Node node;
+        node.value = value;
+        node.queue = value.queue();
+        nodes.push_back(std::move(node));
+        return (int) nodes.size() - 1;
+    }
+
+    int Graph::node(int lane, const std::vector<int> &inputs, Op op) {
+        for (const auto id: inputs) {
+            // insertion order is the dispatch order, so graph is acyclic
+            if (id < 0 || id >= (int) nodes.size())
+                throw std::invalid_argument("Invalid graph node input: " + std::to_string(id));
+            nodes[id].consumed = true;
+        }
+
+        Node node;
+        node.lane = lane;
+        node.inputs = inputs;
+        node.op = std::move(op);
+        nodes.push_back(std::move(node));
+        return (int) nodes.size() - 1;
+    }
+
+    cl_command_queue Graph::lane_queue(int lane) const {
+        if (xm::ocl::cpu::enabled())
+            return nullptr;
+        // default queue (index 0) is left for the rest of the pipeline
+        return xm::ocl::Kernels::instance().retrieve_queue(lane + 1);
+    }
+
+    std::vector<iop::ClImagePromise> Graph::run(const std::vector<int> &outputs) {
+        std::vector<iop::ClImagePromise> inputs;
+        std::vector<cl_event> wait_list;
+
+        for (auto &node: nodes) {
+            if (!node.op)
+                continue;
+
+            const auto queue = lane_queue(node.lane);
+
+            inputs.clear();
+            wait_list.clear();
+            for (const auto id: node.inputs) {
+                auto &input = nodes[id];
+                if (queue == nullptr || input.queue == queue) {
+                    inputs.push_back(input.value);
+                    continue;
+                }
+
+                // produced by another queue, this lane waits for it on the device
+                if (input.queue != nullptr && !input.value.resolved())
+                    wait_list.push_back(event_of(input.queue, input.done));
+
+                // bound to lane queue, so operation continues there
+                inputs.push_back(iop::ClImagePromise(input.value.getImage2D(), queue).withCleanup(input.value));
+            }
+
+            if (!wait_list.empty()) {
+                const cl_int err = clEnqueueBarrierWithWaitList(queue, (cl_uint) wait_list.size(), wait_list.data(), NULL);
+                if (err != CL_SUCCESS)
+                    throw std::runtime_error("Cannot enqueue barrier: " + std::to_string(err));
+            }
+
+            node.value = node.op(inputs);
+            node.queue = node.value.queue();
+        }
+
+        // only final nodes are waited for, everything else is ordered before them
+        std::vector<cl_event> finals;
+        for (int id = 0; id < (int) nodes.size(); id++) {
+            auto &node = nodes[id];
+            const bool requested = std::find(outputs.begin(), outputs.end(), id) != outputs.end();
+            if ((node.consumed && !requested) || node.value.resolved())
+                continue;
+            const auto event = event_of(node.queue, node.done);
+            if (event != nullptr && std::find(finals.begin(), finals.end(), event) == finals.end())
+                finals.push_back(event);
+        }
+
+        if (!finals.empty()) {
+            const cl_int err = clWaitForEvents((cl_uint) finals.size(), finals.data());
+            if (err != CL_SUCCESS)
+                throw std::runtime_error("Cannot wait for graph events: " + std::to_string(err));
+        }
+
+        for (auto &node: nodes)
+            node.value.resolve();
+
+        std::vector<iop::ClImagePromise> values;
+        values.reserve(outputs.size());
+        for (const auto id: outputs)
+            values.push_back(nodes.at(id).value);
+        return values;
+    }
+
+}
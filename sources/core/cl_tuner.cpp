@@ -0,0 +1,385 @@
+//
+// Created by henryco on 21/07/24.
+//
+
+#include "../../xmotion/core/ocl/cl_tuner.h"
+#include "../../xmotion/core/ocl/cl_kernel.h"
+
+#include <spdlog/spdlog.h>
+#include <spdlog/sinks/stdout_color_sinks.h>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+namespace xm::ocl::tuner {
+
+    static const auto log =
+            spdlog::stdout_color_mt("cl_tuner");
+
+    namespace {
+        constexpr const char *FILE_NAME = "local_sizes.tsv";
+
+        /**
+         * Launches per candidate, fastest one counts (first launch might include lazy allocations)
+         */
+        constexpr size_t SAMPLES = 3;
+
+        /**
+         * Upper bound of candidate work-group size, larger ones hardly ever win for these kernels
+         */
+        constexpr size_t MAX_GROUP = 256;
+
+        enum class Mode {
+            OFF,
+            AUTO,
+            RETUNE
+        };
+
+        typedef struct Local {
+            size_t x = 0;
+            size_t y = 0;
+        } Local;
+
+        typedef struct Trial {
+            std::vector<Local> candidates;
+            std::vector<double> best;
+            Local fallback;
+            size_t issued = 0;
+            size_t done = 0;
+        } Trial;
+
+        std::mutex mutex;
+        Mode mode = Mode::AUTO;
+        std::string directory;
+        std::map<std::string, Local> winners;
+        std::map<std::string, Trial> trials;
+        std::map<cl_device_id, std::string> devices;
+
+        std::string info_string(cl_device_id device, cl_device_info param) {
+            size_t size = 0;
+            if (clGetDeviceInfo(device, param, 0, nullptr, &size) != CL_SUCCESS || size == 0)
+                return "";
+            std::string value(size, '\0');
+            if (clGetDeviceInfo(device, param, size, value.data(), nullptr) != CL_SUCCESS)
+                return "";
+            value.resize(std::strlen(value.c_str()));
+            return value;
+        }
+
+        std::string kernel_name(cl_kernel kernel) {
+            size_t size = 0;
+            if (clGetKernelInfo(kernel, CL_KERNEL_FUNCTION_NAME, 0, nullptr, &size) != CL_SUCCESS || size == 0)
+                return "";
+            std::string value(size, '\0');
+            if (clGetKernelInfo(kernel, CL_KERNEL_FUNCTION_NAME, size, value.data(), nullptr) != CL_SUCCESS)
+                return "";
+            value.resize(std::strlen(value.c_str()));
+            return value;
+        }
+
+        cl_device_id queue_device(cl_command_queue queue) {
+            cl_device_id device = nullptr;
+            const auto err = clGetCommandQueueInfo(queue, CL_QUEUE_DEVICE, sizeof(device), &device, nullptr);
+            if (err != CL_SUCCESS)
+                throw std::runtime_error("Cannot query command queue device: " + std::to_string(err));
+            return device;
+        }
+
+        bool profiling(cl_command_queue queue) {
+            cl_command_queue_properties properties = 0;
+            clGetCommandQueueInfo(queue, CL_QUEUE_PROPERTIES, sizeof(properties), &properties, nullptr);
+            return (properties & CL_QUEUE_PROFILING_ENABLE) != 0;
+        }
+
+        /**
+         * Requires lock
+         */
+        const std::string &device_token(cl_device_id device) {
+            const auto it = devices.find(device);
+            if (it != devices.end())
+                return it->second;
+            return devices.emplace(device, info_string(device, CL_DEVICE_NAME)
+                                           + " " + info_string(device, CL_DRIVER_VERSION)).first->second;
+        }
+
+        std::string make_key(const std::string &device, const std::string &kernel, const std::string &options,
+                             int width, int height, int depth) {
+            auto key = device + "|" + kernel + "|" + options + "|" + std::to_string(width) + "x" + std::to_string(height);
+            // 2D keys stay the same as before layered launches
+            if (depth > 1)
+                key += "x" + std::to_string(depth);
+            // single line, tab separated file
+            std::replace_if(key.begin(), key.end(), [](char c) { return c == '\t' || c == '\n' || c == '\r'; }, ' ');
+            return key;
+        }
+
+        std::vector<Local> make_candidates(cl_device_id device, cl_kernel kernel, size_t pref_size, int width, int height) {
+            size_t device_max = 0, kernel_max = 0, multiple = 1;
+            size_t items[3] = {0, 0, 0};
+            clGetDeviceInfo(device, CL_DEVICE_MAX_WORK_GROUP_SIZE, sizeof(device_max), &device_max, nullptr);
+            clGetDeviceInfo(device, CL_DEVICE_MAX_WORK_ITEM_SIZES, sizeof(items), items, nullptr);
+            clGetKernelWorkGroupInfo(kernel, device, CL_KERNEL_WORK_GROUP_SIZE, sizeof(kernel_max), &kernel_max, nullptr);
+            clGetKernelWorkGroupInfo(kernel, device, CL_KERNEL_PREFERRED_WORK_GROUP_SIZE_MULTIPLE,
+                                     sizeof(multiple), &multiple, nullptr);
+
+            const size_t max_group = std::min({device_max, kernel_max, MAX_GROUP});
+            multiple = std::max<size_t>(1, multiple);
+
+            std::vector<Local> candidates;
+            for (size_t x = 8; x <= max_group; x *= 2) {
+                for (size_t y = 1; x * y <= max_group; y *= 2) {
+                    const auto n = x * y;
+                    // whole warps / wavefronts only
+                    if (n % multiple != 0)
+                        continue;
+                    if (x > items[0] || y > items[1])
+                        continue;
+                    // group larger than the problem itself
+                    if (x / 2 >= (size_t) width || y / 2 >= (size_t) height)
+                        continue;
+                    candidates.push_back({x, y});
+                }
+            }
+
+            // legacy square is always among candidates, so tuning never makes things worse
+            const bool legacy = pref_size * pref_size <= std::min(device_max, kernel_max);
+            if (legacy && std::none_of(candidates.begin(), candidates.end(), [pref_size](const Local &l) {
+                return l.x == pref_size && l.y == pref_size;
+            }))
+                candidates.push_back({pref_size, pref_size});
+
+            return candidates;
+        }
+
+        /**
+         * Requires lock
+         */
+        void save() {
+            if (directory.empty())
+                return;
+
+            const auto path = std::filesystem::path(directory) / FILE_NAME;
+            const auto temp = std::filesystem::path(directory) / (std::string(FILE_NAME) + ".tmp");
+            {
+                std::ofstream file(temp, std::ios::trunc);
+                if (!file.is_open()) {
+                    log->warn("Cannot write tuned local sizes: {}", temp.string());
+                    return;
+                }
+                for (const auto &[key, local]: winners)
+                    file << key << '\t' << local.x << '\t' << local.y << '\n';
+            }
+
+            std::error_code error;
+            std::filesystem::rename(temp, path, error);
+            if (error)
+                log->warn("Cannot write tuned local sizes: {}, {}", path.string(), error.message());
+        }
+
+        /**
+         * Requires lock
+         */
+        void load() {
+            std::ifstream file(std::filesystem::path(directory) / FILE_NAME);
+            if (!file.is_open())
+                return;
+
+            size_t loaded = 0;
+            std::string line;
+            while (std::getline(file, line)) {
+                std::istringstream stream(line);
+                std::string key;
+                Local local;
+                if (!std::getline(stream, key, '\t') || !(stream >> local.x >> local.y) || local.x == 0 || local.y == 0)
+                    continue;
+                // tuned within this session already
+                if (winners.emplace(key, local).second)
+                    loaded++;
+            }
+            log->info("Tuned local sizes loaded: {}", loaded);
+        }
+
+        cl_int launch(cl_command_queue queue, cl_kernel kernel, const Local &local, int width, int height, int depth,
+                      cl_event *event) {
+            // layers are never split between work-groups
+            const size_t l_size[3] = {local.x, local.y, 1};
+            const size_t g_size[3] = {xm::ocl::optimal_global_size(width, local.x),
+                                      xm::ocl::optimal_global_size(height, local.y),
+                                      (size_t) depth};
+            return clEnqueueNDRangeKernel(queue, kernel, depth > 1 ? 3 : 2, nullptr, g_size, l_size, 0, nullptr, event);
+        }
+
+        /**
+         * Requires lock, picks the fastest candidate once every one of them is measured
+         */
+        void complete(const std::string &key, Trial &trial) {
+            const auto it = std::min_element(trial.best.begin(), trial.best.end());
+            if (it == trial.best.end() || *it == std::numeric_limits<double>::infinity()) {
+                // legacy square from then on
+                log->warn("No usable local size for: {}", key);
+                winners[key] = trial.fallback;
+                trials.erase(key);
+                save();
+                return;
+            }
+
+            const auto &winner = trial.candidates[it - trial.best.begin()];
+            log->info("Tuned local size: {}x{} ({} us), {}", winner.x, winner.y, *it / 1000., key);
+            winners[key] = winner;
+            trials.erase(key);
+            save();
+        }
+    }
+
+    void set_mode(const std::string &value) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (value == "off")
+            mode = Mode::OFF;
+        else if (value == "auto")
+            mode = Mode::AUTO;
+        else if (value == "retune")
+            mode = Mode::RETUNE;
+        else
+            throw std::invalid_argument("Unknown local size tuning mode: " + value + ", expected: auto, retune or off");
+    }
+
+    void set_directory(const std::string &dir) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (dir.empty()) {
+            directory.clear();
+            return;
+        }
+
+        std::error_code error;
+        std::filesystem::create_directories(dir, error);
+        if (error) {
+            log->warn("Cannot create tuning directory: {}, {}", dir, error.message());
+            directory.clear();
+            return;
+        }
+
+        directory = dir;
+        if (mode == Mode::AUTO)
+            load();
+        if (!winners.empty())
+            save();
+    }
+
+    void reset() {
+        std::lock_guard<std::mutex> lock(mutex);
+        winners.clear();
+        trials.clear();
+        save();
+    }
+
+    cl_event enqueue_2d(cl_command_queue queue, cl_kernel kernel, int width, int height, size_t pref_size, bool profile,
+                        const std::string &options) {
+        return enqueue_3d(queue, kernel, width, height, 1, pref_size, profile, options);
+    }
+
+    cl_event enqueue_3d(cl_command_queue queue, cl_kernel kernel, int width, int height, int depth, size_t pref_size,
+                        bool profile, const std::string &options) {
+        if (depth < 1)
+            throw std::invalid_argument("Invalid number of layers: " + std::to_string(depth));
+
+        Local local = {pref_size, pref_size};
+        std::string key;
+        size_t index = 0;
+        bool tuning = false;
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (mode != Mode::OFF) {
+                const auto device = queue_device(queue);
+                key = make_key(device_token(device), kernel_name(kernel), options, width, height, depth);
+
+                const auto winner = winners.find(key);
+                if (winner != winners.end()) {
+                    local = winner->second;
+                } else {
+                    auto &trial = trials[key];
+                    if (trial.candidates.empty()) {
+                        trial.candidates = make_candidates(device, kernel, pref_size, width, height);
+                        trial.best.assign(trial.candidates.size(), std::numeric_limits<double>::infinity());
+                        trial.fallback = local;
+                    }
+
+                    if (trial.candidates.empty()) {
+                        // nothing fits the kernel, not even the legacy square: nothing to measure, ever
+                        log->warn("No local size candidates for: {}", key);
+                        winners[key] = trial.fallback;
+                        trials.erase(key);
+                        save();
+                    } else if (trial.issued < trial.candidates.size() * SAMPLES) {
+                        // round-robin, so samples of every candidate are spread in time
+                        index = trial.issued++ % trial.candidates.size();
+                        local = trial.candidates[index];
+                        tuning = true;
+                    }
+                }
+            }
+        }
+
+        if (!tuning) {
+            cl_event event = nullptr;
+            const auto err = launch(queue, kernel, local, width, height, depth, profile ? &event : nullptr);
+            if (err != CL_SUCCESS)
+                throw std::runtime_error("Cannot enqueue kernel: " + std::to_string(err));
+            return event;
+        }
+
+        // previously enqueued work would be measured otherwise
+        xm::ocl::finish_queue(queue);
+
+        cl_event event = nullptr;
+        const auto t0 = std::chrono::steady_clock::now();
+        auto err = launch(queue, kernel, local, width, height, depth, &event);
+        if (err == CL_SUCCESS)
+            err = clWaitForEvents(1, &event);
+        const auto wall = (double) std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - t0).count();
+
+        double time = std::numeric_limits<double>::infinity();
+        if (err == CL_SUCCESS)
+            time = profiling(queue) ? (double) xm::ocl::measure_exec_time(event) : wall;
+        else
+            log->debug("Local size {}x{} rejected: {}, {}", local.x, local.y, err, key);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            const auto it = trials.find(key);
+            // might be reset in the meantime
+            if (it != trials.end() && index < it->second.best.size()) {
+                auto &trial = it->second;
+                trial.best[index] = std::min(trial.best[index], time);
+                if (++trial.done == trial.candidates.size() * SAMPLES)
+                    complete(key, trial);
+            }
+        }
+
+        if (err != CL_SUCCESS) {
+            // rejected candidate, kernel still has to run once
+            xm::ocl::release_event(event);
+            event = nullptr;
+            const size_t g_size[3] = {xm::ocl::optimal_global_size(width, pref_size),
+                                      xm::ocl::optimal_global_size(height, pref_size),
+                                      (size_t) depth};
+            const size_t l_size[3] = {pref_size, pref_size, 1};
+            return xm::ocl::enqueue_kernel_fast(queue, kernel, depth > 1 ? 3 : 2, g_size, l_size, profile);
+        }
+
+        if (!profile) {
+            xm::ocl::release_event(event);
+            return nullptr;
+        }
+        return event;
+    }
+}
@@ -96,6 +96,102 @@ namespace xm::ocv {
         };
     }
 
+    Squares find_squares_fast(const cv::UMat &image, uint columns, uint rows, bool sb, int max_size, int flag) {
+        const int longest = std::max(image.cols, image.rows);
+        if (max_size <= 0 || longest <= max_size)
+            return find_squares(image, columns, rows, sb, flag);
+
+        cv::Mat gray;
+        cv::cvtColor(image, gray, cv::COLOR_BGR2GRAY);
+
+        const double scale = (double) max_size / (double) longest;
+        cv::Mat small;
+        cv::resize(gray, small, cv::Size(), scale, scale, cv::INTER_AREA);
+
+        const auto size = cv::Size((int) columns - 1, (int) rows - 1);
+
+        std::vector<cv::Point2f> corners;
+        bool found;
+
+        if (!sb) {
+            const int flags = flag
+                              | cv::CALIB_CB_NORMALIZE_IMAGE
+                              | cv::CALIB_CB_FILTER_QUADS
+                              | cv::CALIB_CB_ADAPTIVE_THRESH
+                              | cv::CALIB_CB_ACCURACY
+                              | cv::CALIB_CB_FAST_CHECK
+                              | cv::CALIB_CB_EXHAUSTIVE;
+            found = cv::findChessboardCorners(small, size, corners, flags);
+        } else {
+            const int flags = flag
+                              | cv::CALIB_CB_NORMALIZE_IMAGE
+                              | cv::CALIB_CB_MARKER
+                              | cv::CALIB_CB_EXHAUSTIVE;
+            found = cv::findChessboardCornersSB(small, size, corners, flags);
+        }
+
+        // pattern might be too small to be found on the downscaled image
+        if (!found)
+            return find_squares(image, columns, rows, sb, flag);
+
+        cv::UMat copy = img_copy(image);
+
+        for (auto &corner: corners) {
+            corner.x = (float) (corner.x / scale);
+            corner.y = (float) (corner.y / scale);
+        }
+
+        // bounding box of the pattern, padded with approx one square
+        const cv::Rect2f bounds = cv::boundingRect(corners);
+        const float square = (float) cv::norm(corners[1] - corners[0]);
+        const int pad = (int) std::ceil(std::max(square, 11.f));
+        const cv::Rect roi = cv::Rect(
+                (int) bounds.x - pad,
+                (int) bounds.y - pad,
+                (int) bounds.width + pad * 2,
+                (int) bounds.height + pad * 2) & cv::Rect(0, 0, gray.cols, gray.rows);
+
+        const cv::Mat crop = gray(roi);
+        const cv::Point2f offset((float) roi.x, (float) roi.y);
+
+        std::vector<cv::Point2f> refined;
+        refined.reserve(corners.size());
+        for (const auto &corner: corners)
+            refined.push_back(corner - offset);
+
+        bool sb_refined = false;
+        if (sb) {
+            // SB accuracy mode, but only within the pattern's region
+            std::vector<cv::Point2f> sb_corners;
+            const int flags = flag
+                              | cv::CALIB_CB_NORMALIZE_IMAGE
+                              | cv::CALIB_CB_ACCURACY
+                              | cv::CALIB_CB_MARKER;
+            sb_refined = cv::findChessboardCornersSB(crop, size, sb_corners, flags)
+                         && sb_corners.size() == refined.size();
+            if (sb_refined)
+                refined = std::move(sb_corners);
+        }
+
+        if (!sb_refined) {
+            const auto term = cv::TermCriteria(cv::TermCriteria::EPS | cv::TermCriteria::MAX_ITER, 60, 0.001);
+            const auto window = cv::Size(11, 11);
+            const auto zone = cv::Size(-1, -1);
+            cv::cornerSubPix(crop, refined, window, zone, term);
+        }
+
+        for (auto &corner: refined)
+            corner += offset;
+
+        cv::drawChessboardCorners(copy, size, refined, true);
+        return {
+                .corners = std::move(refined),
+                .original = image,
+                .result = std::move(copy),
+                .found = true
+        };
+    }
+
     cv::Scalar distinct_color(int index, int N) {
         // Ensure the index is within bounds
         if (index < 0 || index >= N)
@@ -0,0 +1,147 @@
+//
+// Created by henryco on 21/07/24.
+//
+
+#include "../../xmotion/core/dnn/net/dnn_cache.h"
+
+#include <spdlog/spdlog.h>
+#include <spdlog/sinks/stdout_color_sinks.h>
+#include <opencv2/core/ocl.hpp>
+#include <filesystem>
+#include <fstream>
+#include <cctype>
+#include <cstdio>
+#include <mutex>
+#include <set>
+
+namespace eox::dnn::cache {
+
+    static const auto log =
+            spdlog::stdout_color_mt("dnn_cache");
+
+    namespace {
+        constexpr uint64_t FNV_OFFSET = 0xcbf29ce484222325ULL;
+        constexpr uint64_t FNV_PRIME = 0x100000001b3ULL;
+
+        std::mutex mutex;
+        std::string cache_dir;
+
+        /**
+         * Delegate keeps raw pointers to the strings, so they are never released
+         */
+        std::set<std::string> interned;
+
+        const char *intern(const std::string &str) {
+            return interned.insert(str).first->c_str();
+        }
+
+        uint64_t fnv(uint64_t hash, const void *data, size_t size) {
+            const auto bytes = static_cast<const unsigned char *>(data);
+            for (size_t i = 0; i < size; i++) {
+                hash ^= bytes[i];
+                hash *= FNV_PRIME;
+            }
+            return hash;
+        }
+
+        template<typename T>
+        uint64_t fnv(uint64_t hash, const T &value) {
+            return fnv(hash, &value, sizeof(T));
+        }
+
+        uint64_t fnv(uint64_t hash, const std::string &str) {
+            return fnv(hash, str.data(), str.size());
+        }
+
+        std::string token(const TfLiteGpuDelegateOptionsV2 &options, const std::string &file) {
+            std::ifstream stream(file, std::ios::binary);
+            if (!stream.is_open())
+                throw std::runtime_error("Failed to open model file: " + file);
+
+            uint64_t hash = FNV_OFFSET;
+            char buffer[64 * 1024];
+            while (stream.read(buffer, sizeof(buffer)) || stream.gcount() > 0)
+                hash = fnv(hash, buffer, stream.gcount());
+
+            hash = fnv(hash, options.is_precision_loss_allowed);
+            hash = fnv(hash, options.inference_preference);
+            hash = fnv(hash, options.inference_priority1);
+            hash = fnv(hash, options.inference_priority2);
+            hash = fnv(hash, options.inference_priority3);
+            hash = fnv(hash, options.max_delegated_partitions);
+
+            // compiled programs are valid only for the same device and driver
+            if (cv::ocl::haveOpenCL()) {
+                const auto &device = cv::ocl::Device::getDefault();
+                hash = fnv(hash, device.name());
+                hash = fnv(hash, device.driverVersion());
+            }
+
+            auto name = std::filesystem::path(file).stem().string();
+            for (auto &c: name)
+                if (!std::isalnum((unsigned char) c))
+                    c = '_';
+
+            char hex[17];
+            snprintf(hex, sizeof(hex), "%016llx", (unsigned long long) hash);
+            return name + "_" + hex;
+        }
+    }
+
+    void set_directory(const std::string &dir) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (dir.empty()) {
+            cache_dir.clear();
+            return;
+        }
+
+        std::error_code error;
+        std::filesystem::create_directories(dir, error);
+        if (error) {
+            log->warn("Cannot create delegate cache directory: {}, {}", dir, error.message());
+            cache_dir.clear();
+            return;
+        }
+
+        cache_dir = dir;
+        log->info("Delegate cache directory: {}", dir);
+    }
+
+    std::string directory() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return cache_dir;
+    }
+
+    bool configure(TfLiteGpuDelegateOptionsV2 &options, const std::string &file) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (cache_dir.empty())
+            return false;
+
+        const auto model_token = token(options, file);
+        options.experimental_flags |= TFLITE_GPU_EXPERIMENTAL_FLAGS_ENABLE_SERIALIZATION;
+        options.serialization_dir = intern(cache_dir);
+        options.model_token = intern(model_token);
+
+        // delegate's own file naming is internal, so there is a marker of our own
+        std::error_code error;
+        return std::filesystem::exists(std::filesystem::path(cache_dir) / (model_token + ".ok"), error);
+    }
+
+    void mark(const TfLiteGpuDelegateOptionsV2 &options) {
+        if (options.serialization_dir == nullptr || options.model_token == nullptr)
+            return;
+
+        std::ofstream marker(std::filesystem::path(options.serialization_dir) / (std::string(options.model_token) + ".ok"));
+        if (!marker.is_open())
+            log->warn("Cannot write delegate cache marker: {}", options.model_token);
+    }
+
+    void report_build(const std::string &file, bool cached, float ms) {
+        log->info("Interpreter built ({}): {}, {} ms", cached ? "warm" : "cold", file, ms);
+    }
+
+    void report_prime(const std::string &file, float ms) {
+        log->info("Interpreter primed: {}, {} ms", file, ms);
+    }
+
+} // eox
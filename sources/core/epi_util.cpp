@@ -67,7 +67,8 @@ namespace xm::util::epi {
                 epipolar_matrix[index] = {
                         .RT = src.epipolar_matrix[index].RT.clone(),
                         .E = src.epipolar_matrix[index].E.clone(),
-                        .F = src.epipolar_matrix[index].F.clone()
+                        .F = src.epipolar_matrix[index].F.clone(),
+                        .fixed = src.epipolar_matrix[index].fixed
                 };
             }
         }
@@ -312,7 +313,8 @@ namespace xm::util::epi {
                 epipolar_matrix[(i * size) + j] = {
                         .RT = RT,
                         .E = E,
-                        .F = F
+                        .F = F,
+                        .fixed = xm::util::geom::epi_fixed(RT, E, F)
                 };
             }
         }
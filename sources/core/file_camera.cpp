@@ -0,0 +1,356 @@
+//
+// Created by henryco on 21/07/24.
+//
+
+#include <opencv2/core/ocl.hpp>
+#include <opencv2/imgproc.hpp>
+
+#include "../../xmotion/core/camera/file_camera.h"
+#include "../../xmotion/core/ocl/ocl_filters.h"
+#include "../../xmotion/core/ocl/ocl_cpu.h"
+#include "../../xmotion/core/ocl/ocl_interop.h"
+
+namespace xm {
+
+    FileCamera::~FileCamera() {
+        FileCamera::release();
+    }
+
+    void FileCamera::release() {
+        for (auto &[id, source]: sources) {
+            {
+                std::lock_guard<std::mutex> lock(source->mutex);
+                source->stop = true;
+            }
+            source->consumed.notify_all();
+            source->produced.notify_all();
+            if (source->decoder.joinable())
+                source->decoder.join();
+            source->capture.release();
+            if (source->raw)
+                source->raw->release();
+            log->debug("release file: {}", id);
+        }
+        sources.clear();
+    }
+
+    void FileCamera::open(const SCamProp &prop) {
+        log->debug("open: {}, {}", prop.device_id, prop.name);
+        properties.push_back(prop);
+
+        auto device_id = (cl_device_id) cv::ocl::Device::getDefault().ptr();
+        auto ocl_context = (cl_context) cv::ocl::Context::getDefault().ptr();
+        command_queues[prop.device_id] = xm::ocl::cpu::enabled()
+                                         ? nullptr
+                                         : xm::ocl::create_queue_device(ocl_context, device_id, true, false);
+
+        if (sources.contains(prop.device_id)) {
+            log->debug("file: {} is already open", prop.device_id);
+            return;
+        }
+
+        if (prop.width <= 0 || prop.height <= 0)
+            throw std::runtime_error("Frame width or height cannot be <= 0 for device: " + prop.name);
+
+        auto source = std::make_unique<Source>();
+        double fps;
+        if (xm::RawReader::is_recording(prop.device_id)) {
+            source->raw = std::make_unique<xm::RawReader>();
+            source->raw->open(prop.device_id);
+            fps = source->raw->fps();
+            source->length = source->raw->length();
+            source->width = source->raw->width();
+            source->height = source->raw->height();
+        } else {
+            if (!source->capture.open(prop.device_id))
+                throw std::runtime_error("Cannot open video file: " + prop.device_id);
+            fps = source->capture.get(cv::CAP_PROP_FPS);
+            source->length = (int) source->capture.get(cv::CAP_PROP_FRAME_COUNT);
+            source->width = (int) source->capture.get(cv::CAP_PROP_FRAME_WIDTH);
+            source->height = (int) source->capture.get(cv::CAP_PROP_FRAME_HEIGHT);
+        }
+
+        source->fps = fps > 0 ? fps : prop.fps;
+        source->capacity = prop.buffer > 0 ? prop.buffer : PREFETCH;
+
+        log->info("file: {}, {}x{}, {} fps, {} frames", prop.device_id, source->width, source->height, source->fps, source->length);
+        if (source->width != prop.width || source->height != prop.height)
+            log->warn("file: {} is going to be resized to: {}x{}", prop.device_id, prop.width, prop.height);
+
+        auto &ref = *source;
+        sources[prop.device_id] = std::move(source);
+        ref.decoder = std::thread(&FileCamera::decode, this, std::ref(ref), prop);
+    }
+
+    void FileCamera::decode(Source &source, const SCamProp &prop) {
+        int index = 0;
+        while (true) {
+            int seek_to;
+            int generation;
+            bool looped;
+            {
+                std::unique_lock<std::mutex> lock(source.mutex);
+                source.consumed.wait(lock, [&source]() {
+                    return source.stop || source.seek >= 0 || (!source.eof && source.queue.size() < source.capacity);
+                });
+
+                if (source.stop)
+                    return;
+
+                seek_to = source.seek;
+                generation = source.generation;
+                looped = loop;
+                source.seek = -1;
+            }
+
+            if (seek_to >= 0) {
+                seek(source, source.length > 0 ? seek_to % source.length : seek_to);
+                index = seek_to;
+            }
+
+            cv::Mat image;
+            bool ok = read(source, image);
+            if (!ok && looped && index > 0) {
+                // frame indexes keep going, so pacing and ordering stay the same
+                seek(source, 0);
+                ok = read(source, image);
+            }
+
+            if (ok && (image.cols != prop.width || image.rows != prop.height))
+                cv::resize(image, image, cv::Size(prop.width, prop.height), 0, 0, cv::INTER_LINEAR);
+
+            {
+                std::lock_guard<std::mutex> lock(source.mutex);
+
+                // seek requested in the meantime, frame is not needed anymore
+                if (generation != source.generation)
+                    continue;
+
+                if (ok)
+                    source.queue.push_back({.image = image, .index = index++, .generation = generation});
+                else
+                    source.eof = true;
+            }
+            source.produced.notify_all();
+        }
+    }
+
+    bool FileCamera::next(Source &source, int index, Frame &out) {
+        std::unique_lock<std::mutex> lock(source.mutex);
+        while (true) {
+            source.produced.wait(lock, [&source]() {
+                return source.stop || source.eof || !source.queue.empty();
+            });
+
+            if (source.stop || source.queue.empty())
+                return false;
+
+            auto frame = std::move(source.queue.front());
+            source.queue.pop_front();
+            source.consumed.notify_all();
+
+            // frame from before the seek or already late
+            if (frame.generation != source.generation || frame.index < index)
+                continue;
+
+            out = std::move(frame);
+            return true;
+        }
+    }
+
+    bool FileCamera::read(Source &source, cv::Mat &image) {
+        if (!source.raw)
+            return source.capture.read(image) && !image.empty();
+
+        try {
+            return source.raw->read(image) && !image.empty();
+        } catch (const std::exception &e) {
+            // damaged recording ends right there
+            log->error("cannot read recording: {}", e.what());
+            return false;
+        }
+    }
+
+    void FileCamera::seek(Source &source, int frame) {
+        if (source.raw) {
+            source.raw->seek(frame);
+            return;
+        }
+
+        auto &capture = source.capture;
+        capture.set(cv::CAP_PROP_POS_FRAMES, frame);
+        if ((int) capture.get(cv::CAP_PROP_POS_FRAMES) == frame)
+            return;
+
+        // container does not support accurate seeking, decoding from the very beginning
+        capture.set(cv::CAP_PROP_POS_FRAMES, 0);
+        for (int i = 0; i < frame; i++) {
+            if (!capture.grab())
+                break;
+        }
+    }
+
+    std::map<std::string, xm::ocl::Image2D> FileCamera::captureWithName() {
+        if (sources.empty()) {
+            log->warn("FileCamera is not initialized");
+            return {};
+        }
+
+        int index = current + 1;
+        if (real_time) {
+            const auto fps = sources.begin()->second->fps;
+            const auto now = std::chrono::steady_clock::now();
+            if (!clock_started) {
+                clock_start = now;
+                clock_origin = index;
+                clock_started = true;
+            }
+
+            const auto elapsed = std::chrono::duration<double>(now - clock_start).count();
+            const int due = clock_origin + (int) (elapsed * fps);
+            if (due > index) {
+                // consumer is late, frames are dropped just like with cameras
+                index = due;
+            } else if (due < index) {
+                std::this_thread::sleep_until(clock_start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                        std::chrono::duration<double>((index - clock_origin) / fps)));
+            }
+        }
+
+        std::map<std::string, Frame> decoded;
+        int latest = index;
+        for (auto &[id, source]: sources) {
+            Frame frame;
+            if (next(*source, index, frame)) {
+                latest = std::max(latest, frame.index);
+                decoded[id] = std::move(frame);
+            }
+        }
+
+        // one of the files skipped some frames, the others catch up
+        for (auto &[id, frame]: decoded) {
+            if (frame.index < latest)
+                next(*sources.at(id), latest, frame);
+        }
+
+        std::map<std::string, xm::ocl::Image2D> frames;
+        for (auto &[id, source]: sources) {
+            if (decoded.contains(id))
+                source->last = decoded.at(id).image;
+
+            // end of non-looped file, last frame is repeated
+            if (source->last.empty())
+                return {};
+
+            frames[id] = xm::ocl::iop::from_cv_mat(source->last, command_queues.at(id)).waitFor().getImage2D();
+        }
+
+        if (!decoded.empty())
+            current = latest;
+
+        return transform(frames);
+    }
+
+    void FileCamera::enqueue() {}
+
+    std::vector<xm::ocl::Image2D> FileCamera::dequeue() {
+        return capture();
+    }
+
+    std::map<std::string, xm::ocl::Image2D> FileCamera::dequeueWithName() {
+        return captureWithName();
+    }
+
+    void FileCamera::seek(int frame) {
+        frame = std::max(0, frame);
+        for (auto &[id, source]: sources) {
+            {
+                std::lock_guard<std::mutex> lock(source->mutex);
+                source->generation++;
+                source->seek = frame;
+                source->queue.clear();
+                source->eof = false;
+            }
+            source->consumed.notify_all();
+        }
+
+        current = frame - 1;
+        clock_started = false;
+    }
+
+    int FileCamera::position() const {
+        return current;
+    }
+
+    int FileCamera::length() const {
+        int n = 0;
+        for (const auto &[id, source]: sources)
+            n = n == 0 ? source->length : std::min(n, source->length);
+        return n;
+    }
+
+    bool FileCamera::finished() const {
+        if (loop)
+            return false;
+        for (const auto &[id, source]: sources) {
+            std::lock_guard<std::mutex> lock(source->mutex);
+            if (!source->eof || !source->queue.empty())
+                return false;
+        }
+        return !sources.empty();
+    }
+
+    double FileCamera::fps() const {
+        return sources.empty() ? 0 : sources.begin()->second->fps;
+    }
+
+    void FileCamera::setRealTime(bool _real_time) {
+        real_time = _real_time;
+        clock_started = false;
+    }
+
+    void FileCamera::setLoop(bool _loop) {
+        loop = _loop;
+        if (!_loop)
+            return;
+
+        // decoders stopped at the end of the file have to go on from the start now
+        for (const auto &[id, source]: sources) {
+            {
+                std::lock_guard<std::mutex> lock(source->mutex);
+                source->eof = false;
+            }
+            source->consumed.notify_all();
+        }
+    }
+
+    bool FileCamera::getRealTime() const {
+        return real_time;
+    }
+
+    bool FileCamera::getLoop() const {
+        return loop;
+    }
+
+    void FileCamera::setControl(const std::string &device_id, uint prop_id, int value) {}
+
+    void FileCamera::resetControls(const std::string &device_id) {}
+
+    void FileCamera::resetControls() {}
+
+    void FileCamera::save(std::ostream &output_stream, const std::string &device_id, const std::string &name) const {}
+
+    void FileCamera::read(std::istream &input_stream, const std::string &device_id, const std::string &name) {}
+
+    platform::cap::camera_controls FileCamera::getControls(const std::string &device_id) const {
+        return {
+            .id = device_id,
+            .controls = {}
+        };
+    }
+
+    std::vector<platform::cap::camera_controls> FileCamera::getControls() const {
+        return {};
+    }
+
+}
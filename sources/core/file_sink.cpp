@@ -0,0 +1,47 @@
+//
+// Created by henryco on 14/07/24.
+//
+
+#include "../../xmotion/core/sink/file_sink.h"
+#include "../../xmotion/core/sink/pose_packet.h"
+
+namespace xm::sink {
+
+    FileSink::FileSink(std::string path): path(std::move(path)) {}
+
+    FileSink::~FileSink() {
+        close();
+    }
+
+    void FileSink::open() {
+        if (stream.is_open())
+            return;
+
+        stream.open(path, std::ios::binary | std::ios::out | std::ios::trunc);
+        if (!stream.is_open())
+            throw std::runtime_error("Cannot open sink file: " + path);
+
+        log->info("recording results to: {}", path);
+    }
+
+    void FileSink::publish(const xm::nview::Result &result) {
+        if (!stream.is_open())
+            return;
+
+        const auto size = xm::sink::encode(result, buffer);
+        stream.write(buffer.data(), (std::streamsize) size);
+
+        if (!stream.good()) {
+            log->error("cannot write to sink file: {}, closing", path);
+            stream.close();
+        }
+    }
+
+    void FileSink::close() {
+        if (!stream.is_open())
+            return;
+        stream.flush();
+        stream.close();
+    }
+
+} // xm::sink
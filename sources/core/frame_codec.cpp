@@ -0,0 +1,245 @@
+//
+// Created by henryco on 21/07/24.
+//
+
+#include "../../xmotion/core/utils/frame_codec.h"
+
+#include <cstring>
+#include <stdexcept>
+
+namespace xm::util::codec {
+
+    namespace {
+        constexpr uint8_t OP_INDEX = 0x00; // 00xxxxxx
+        constexpr uint8_t OP_DIFF = 0x40;  // 01xxxxxx
+        constexpr uint8_t OP_LUMA = 0x80;  // 10xxxxxx
+        constexpr uint8_t OP_RUN = 0xc0;   // 11xxxxxx
+        constexpr uint8_t OP_RGB = 0xfe;
+        constexpr uint8_t OP_RGBA = 0xff;
+        constexpr uint8_t MASK = 0xc0;
+
+        /**
+         * Longest run, 63 and 64 would collide with OP_RGB and OP_RGBA
+         */
+        constexpr int RUN_MAX = 62;
+
+        typedef union Pixel {
+            struct {
+                uint8_t c0, c1, c2, a;
+            } c;
+            uint32_t v;
+        } Pixel;
+
+        inline int hash(const Pixel &p) {
+            return (p.c.c0 * 3 + p.c.c1 * 5 + p.c.c2 * 7 + p.c.a * 11) & 63;
+        }
+
+        template<int N>
+        inline Pixel load(const uint8_t *src) {
+            Pixel p;
+            if constexpr (N == 1)
+                p.c = {src[0], src[0], src[0], 255};
+            else if constexpr (N == 3)
+                p.c = {src[0], src[1], src[2], 255};
+            else
+                p.c = {src[0], src[1], src[2], src[3]};
+            return p;
+        }
+
+        template<int N>
+        inline void store(uint8_t *dst, const Pixel &p) {
+            dst[0] = p.c.c0;
+            if constexpr (N > 1) {
+                dst[1] = p.c.c1;
+                dst[2] = p.c.c2;
+            }
+            if constexpr (N == 4)
+                dst[3] = p.c.a;
+        }
+
+        template<int N>
+        size_t encode_n(const cv::Mat &frame, uint8_t *out) {
+            Pixel index[64];
+            std::memset(index, 0, sizeof(index));
+
+            Pixel prev;
+            prev.c = {0, 0, 0, 255};
+
+            uint8_t *dst = out;
+            int run = 0;
+
+            for (int y = 0; y < frame.rows; y++) {
+                const uint8_t *row = frame.ptr<uint8_t>(y);
+                for (int x = 0; x < frame.cols; x++, row += N) {
+                    const Pixel px = load<N>(row);
+
+                    if (px.v == prev.v) {
+                        if (++run == RUN_MAX) {
+                            *dst++ = OP_RUN | (run - 1);
+                            run = 0;
+                        }
+                        continue;
+                    }
+
+                    if (run > 0) {
+                        *dst++ = OP_RUN | (run - 1);
+                        run = 0;
+                    }
+
+                    const int h = hash(px);
+                    if (index[h].v == px.v) {
+                        *dst++ = OP_INDEX | h;
+                        prev = px;
+                        continue;
+                    }
+                    index[h] = px;
+
+                    if (px.c.a != prev.c.a) {
+                        *dst++ = OP_RGBA;
+                        *dst++ = px.c.c0;
+                        *dst++ = px.c.c1;
+                        *dst++ = px.c.c2;
+                        *dst++ = px.c.a;
+                        prev = px;
+                        continue;
+                    }
+
+                    const auto d0 = (int8_t) (px.c.c0 - prev.c.c0);
+                    const auto d1 = (int8_t) (px.c.c1 - prev.c.c1);
+                    const auto d2 = (int8_t) (px.c.c2 - prev.c.c2);
+                    const int d0_1 = d0 - d1;
+                    const int d2_1 = d2 - d1;
+
+                    if (d0 > -3 && d0 < 2 && d1 > -3 && d1 < 2 && d2 > -3 && d2 < 2) {
+                        *dst++ = OP_DIFF | (d0 + 2) << 4 | (d1 + 2) << 2 | (d2 + 2);
+                    } else if (d1 > -33 && d1 < 32 && d0_1 > -9 && d0_1 < 8 && d2_1 > -9 && d2_1 < 8) {
+                        *dst++ = OP_LUMA | (d1 + 32);
+                        *dst++ = (d0_1 + 8) << 4 | (d2_1 + 8);
+                    } else {
+                        *dst++ = OP_RGB;
+                        *dst++ = px.c.c0;
+                        *dst++ = px.c.c1;
+                        *dst++ = px.c.c2;
+                    }
+                    prev = px;
+                }
+            }
+
+            if (run > 0)
+                *dst++ = OP_RUN | (run - 1);
+
+            return dst - out;
+        }
+
+        template<int N>
+        void decode_n(const uint8_t *data, size_t size, cv::Mat &out) {
+            Pixel index[64];
+            std::memset(index, 0, sizeof(index));
+
+            Pixel px;
+            px.c = {0, 0, 0, 255};
+
+            const uint8_t *src = data;
+            const uint8_t *end = data + size;
+            int run = 0;
+
+            for (int y = 0; y < out.rows; y++) {
+                uint8_t *row = out.ptr<uint8_t>(y);
+                for (int x = 0; x < out.cols; x++, row += N) {
+                    if (run > 0) {
+                        run--;
+                        store<N>(row, px);
+                        continue;
+                    }
+
+                    if (src >= end)
+                        throw std::runtime_error("Malformed frame data");
+
+                    const uint8_t b = *src++;
+                    const long left = end - src;
+                    if ((b == OP_RGB && left < 3) || (b == OP_RGBA && left < 4) || ((b & MASK) == OP_LUMA && left < 1))
+                        throw std::runtime_error("Malformed frame data");
+
+                    if (b == OP_RGB) {
+                        px.c.c0 = *src++;
+                        px.c.c1 = *src++;
+                        px.c.c2 = *src++;
+                    } else if (b == OP_RGBA) {
+                        px.c.c0 = *src++;
+                        px.c.c1 = *src++;
+                        px.c.c2 = *src++;
+                        px.c.a = *src++;
+                    } else if ((b & MASK) == OP_INDEX) {
+                        px = index[b];
+                    } else if ((b & MASK) == OP_DIFF) {
+                        px.c.c0 += ((b >> 4) & 0x03) - 2;
+                        px.c.c1 += ((b >> 2) & 0x03) - 2;
+                        px.c.c2 += (b & 0x03) - 2;
+                    } else if ((b & MASK) == OP_LUMA) {
+                        const uint8_t b2 = *src++;
+                        const int d1 = (b & 0x3f) - 32;
+                        px.c.c0 += d1 - 8 + ((b2 >> 4) & 0x0f);
+                        px.c.c1 += d1;
+                        px.c.c2 += d1 - 8 + (b2 & 0x0f);
+                    } else {
+                        run = b & 0x3f;
+                    }
+
+                    index[hash(px)] = px;
+                    store<N>(row, px);
+                }
+            }
+        }
+    }
+
+    size_t bound(int cols, int rows, int channels) {
+        // worst case: every pixel is OP_RGBA (or OP_RGB)
+        return (size_t) cols * rows * (channels == 4 ? 5 : 4);
+    }
+
+    size_t encode(const cv::Mat &frame, std::vector<uint8_t> &out) {
+        if (frame.depth() != CV_8U)
+            throw std::runtime_error("Only 8 bit frames are supported");
+
+        // never shrinks, so there is no zeroing of reallocated tail on every frame
+        const auto max = bound(frame.cols, frame.rows, frame.channels());
+        if (out.size() < max)
+            out.resize(max);
+
+        size_t size;
+        switch (frame.channels()) {
+            case 1:
+                size = encode_n<1>(frame, out.data());
+                break;
+            case 3:
+                size = encode_n<3>(frame, out.data());
+                break;
+            case 4:
+                size = encode_n<4>(frame, out.data());
+                break;
+            default:
+                throw std::runtime_error("Unsupported number of channels: " + std::to_string(frame.channels()));
+        }
+        return size;
+    }
+
+    void decode(const uint8_t *data, size_t size, cv::Mat &out) {
+        if (out.depth() != CV_8U)
+            throw std::runtime_error("Only 8 bit frames are supported");
+
+        switch (out.channels()) {
+            case 1:
+                decode_n<1>(data, size, out);
+                return;
+            case 3:
+                decode_n<3>(data, size, out);
+                return;
+            case 4:
+                decode_n<4>(data, size, out);
+                return;
+            default:
+                throw std::runtime_error("Unsupported number of channels: " + std::to_string(out.channels()));
+        }
+    }
+
+} // xm::util::codec
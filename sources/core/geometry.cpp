@@ -0,0 +1,176 @@
+//
+// Created by henryco on 20/07/24.
+//
+
+#include "../../xmotion/core/utils/geometry.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace xm::util::geom {
+
+    Mat3 mat3(const cv::Mat &m) {
+        cv::Mat src;
+        m.convertTo(src, CV_64F);
+        Mat3 out(1.0);
+        for (int r = 0; r < 3; r++)
+            for (int c = 0; c < 3; c++)
+                out[c][r] = src.at<double>(r, c);
+        return out;
+    }
+
+    Mat4 mat4(const cv::Mat &m) {
+        cv::Mat src;
+        m.convertTo(src, CV_64F);
+        Mat4 out(1.0);
+        for (int r = 0; r < std::min(4, src.rows); r++)
+            for (int c = 0; c < 4; c++)
+                out[c][r] = src.at<double>(r, c);
+        return out;
+    }
+
+    EpiFixed epi_fixed(const cv::Mat &RT, const cv::Mat &E, const cv::Mat &F) {
+        return {
+                .RT = RT.empty() ? Mat4(1.0) : mat4(RT),
+                .E = E.empty() ? Mat3(1.0) : mat3(E),
+                .F = F.empty() ? Mat3(1.0) : mat3(F)
+        };
+    }
+
+    Camera camera(const cv::Mat &K, const cv::Mat &D) {
+        Camera out{};
+        out.K = mat3(K);
+        out.K_inv = glm::inverse(out.K);
+        out.supported = D.empty() || D.total() <= 8;
+        out.distorted = false;
+
+        if (D.empty())
+            return out;
+
+        cv::Mat d;
+        D.convertTo(d, CV_64F);
+        for (int i = 0; i < std::min(8, (int) d.total()); i++) {
+            out.D[i] = d.at<double>(i);
+            out.distorted = out.distorted || out.D[i] != 0;
+        }
+        return out;
+    }
+
+    void epi_lines(const Mat3 &F, const Point *points, Line *lines, int n) {
+        for (int i = 0; i < n; i++) {
+            const Vec3 l = F * Vec3(points[i].x, points[i].y, 1.0);
+            const double norm = std::sqrt(l.x * l.x + l.y * l.y);
+            lines[i] = norm != 0 ? Line(l / norm) : Line(l);
+        }
+    }
+
+    void undistort(const Camera &camera, const Point *in, Point *out, int n, int iterations) {
+        const auto &K = camera.K;
+        const auto &k = camera.D;
+        const double fx = K[0][0], fy = K[1][1], cx = K[2][0], cy = K[2][1];
+
+        for (int i = 0; i < n; i++) {
+            if (!camera.distorted) {
+                out[i] = in[i];
+                continue;
+            }
+
+            // normalized camera coordinates
+            const double x0 = ((double) in[i].x - cx) / fx;
+            const double y0 = ((double) in[i].y - cy) / fy;
+            double x = x0, y = y0;
+
+            // same fixed point iteration as opencv
+            for (int j = 0; j < iterations; j++) {
+                const double r2 = x * x + y * y;
+                const double icdist = (1 + ((k[7] * r2 + k[6]) * r2 + k[5]) * r2)
+                                      / (1 + ((k[4] * r2 + k[1]) * r2 + k[0]) * r2);
+                if (icdist < 0) {
+                    x = x0;
+                    y = y0;
+                    break;
+                }
+                const double dx = 2 * k[2] * x * y + k[3] * (r2 + 2 * x * x);
+                const double dy = k[2] * (r2 + 2 * y * y) + 2 * k[3] * x * y;
+                x = (x0 - dx) * icdist;
+                y = (y0 - dy) * icdist;
+            }
+
+            out[i] = Point((float) (x * fx + cx), (float) (y * fy + cy));
+        }
+    }
+
+    Grid undistort_grid(const Camera &camera, int width, int height, int cols, int rows) {
+        Grid grid{};
+        grid.cols = std::max(2, cols);
+        grid.rows = std::max(2, rows);
+        grid.step_x = (float) (width - 1) / (float) (grid.cols - 1);
+        grid.step_y = (float) (height - 1) / (float) (grid.rows - 1);
+        grid.nodes.resize((size_t) grid.cols * grid.rows);
+
+        for (int r = 0; r < grid.rows; r++)
+            for (int c = 0; c < grid.cols; c++)
+                grid.nodes[(size_t) r * grid.cols + c] = {(float) c * grid.step_x, (float) r * grid.step_y};
+
+        undistort(camera, grid.nodes.data(), grid.nodes.data(), (int) grid.nodes.size());
+        return grid;
+    }
+
+    void undistort(const Grid &grid, const Point *in, Point *out, int n) {
+        const auto *nodes = grid.nodes.data();
+        for (int i = 0; i < n; i++) {
+            const float gx = in[i].x / grid.step_x;
+            const float gy = in[i].y / grid.step_y;
+
+            // edge cells are extrapolated
+            const int c = std::clamp((int) std::floor(gx), 0, grid.cols - 2);
+            const int r = std::clamp((int) std::floor(gy), 0, grid.rows - 2);
+            const float fx = gx - (float) c;
+            const float fy = gy - (float) r;
+
+            const auto &p00 = nodes[(size_t) r * grid.cols + c];
+            const auto &p10 = nodes[(size_t) r * grid.cols + c + 1];
+            const auto &p01 = nodes[(size_t) (r + 1) * grid.cols + c];
+            const auto &p11 = nodes[(size_t) (r + 1) * grid.cols + c + 1];
+
+            out[i] = glm::mix(glm::mix(p00, p10, fx), glm::mix(p01, p11, fx), fy);
+        }
+    }
+
+    float grid_error(const Grid &grid, const Camera &camera) {
+        float error = 0.f;
+        for (int r = 0; r < grid.rows - 1; r++) {
+            for (int c = 0; c < grid.cols - 1; c++) {
+                const Point p = {((float) c + .5f) * grid.step_x, ((float) r + .5f) * grid.step_y};
+                Point exact, approx;
+                undistort(camera, &p, &exact, 1);
+                undistort(grid, &p, &approx, 1);
+                error = std::max(error, glm::distance(exact, approx));
+            }
+        }
+        return error;
+    }
+
+    void distort(const Camera &camera, const Point *in, Point *out, int n) {
+        const auto &K = camera.K;
+        const auto &k = camera.D;
+        const double fx = K[0][0], fy = K[1][1], cx = K[2][0], cy = K[2][1];
+
+        for (int i = 0; i < n; i++) {
+            if (!camera.distorted) {
+                out[i] = in[i];
+                continue;
+            }
+
+            const double x = ((double) in[i].x - cx) / fx;
+            const double y = ((double) in[i].y - cy) / fy;
+            const double r2 = x * x + y * y;
+            const double radial = (1 + ((k[4] * r2 + k[1]) * r2 + k[0]) * r2)
+                                  / (1 + ((k[7] * r2 + k[6]) * r2 + k[5]) * r2);
+            const double xd = x * radial + 2 * k[2] * x * y + k[3] * (r2 + 2 * x * x);
+            const double yd = y * radial + k[2] * (r2 + 2 * y * y) + 2 * k[3] * x * y;
+
+            out[i] = Point((float) (xd * fx + cx), (float) (yd * fy + cy));
+        }
+    }
+}
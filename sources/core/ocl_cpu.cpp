@@ -0,0 +1,58 @@
+//
+// Created by henryco on 21/07/24.
+//
+
+#include "../../xmotion/core/ocl/ocl_cpu.h"
+
+#include <spdlog/spdlog.h>
+#include <spdlog/sinks/stdout_color_sinks.h>
+#include <opencv2/core/ocl.hpp>
+#include <atomic>
+#include <thread>
+
+namespace xm::ocl::cpu {
+
+    static const auto log =
+            spdlog::stdout_color_mt("ocl_cpu");
+
+    namespace {
+        std::atomic<bool> cpu_backend = false;
+
+        bool opencl_usable() {
+            if (!cv::ocl::haveOpenCL())
+                return false;
+            try {
+                const auto &device = cv::ocl::Device::getDefault();
+                return device.ptr() != nullptr && device.available() && device.compilerAvailable();
+            } catch (const std::exception &e) {
+                log->warn("OpenCL device probe failed: {}", e.what());
+                return false;
+            }
+        }
+    }
+
+    bool select(const std::string &mode) {
+        if (mode != "auto" && mode != "opencl" && mode != "cpu")
+            throw std::invalid_argument("Unknown compute backend: " + mode + ", expected: auto, opencl or cpu");
+
+        const bool usable = mode != "cpu" && opencl_usable();
+        if (mode == "opencl" && !usable)
+            throw std::runtime_error("OpenCL compute backend requested, but no usable OpenCL device found");
+
+        cpu_backend = !usable;
+        cv::ocl::setUseOpenCL(usable);
+
+        if (usable)
+            log->info("compute backend: opencl, device: {}", cv::ocl::Device::getDefault().name());
+        else
+            log->info("compute backend: cpu ({}), threads: {}", mode == "cpu" ? "forced" : "no usable OpenCL device",
+                      std::thread::hardware_concurrency());
+
+        return cpu_backend;
+    }
+
+    bool enabled() {
+        return cpu_backend;
+    }
+
+}
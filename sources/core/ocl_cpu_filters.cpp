@@ -0,0 +1,750 @@
+//
+// Created by henryco on 21/07/24.
+//
+
+#include "../../xmotion/core/ocl/ocl_cpu.h"
+#include "../../xmotion/core/utils/thread_pool.h"
+#include "../../xmotion/core/utils/eox_globals.h"
+
+#include <opencv2/core/hal/intrin.hpp>
+#include <opencv2/imgproc.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <map>
+#include <mutex>
+
+namespace xm::ocl::cpu {
+
+    /**
+     * Smallest band of rows worth dispatching to the pool
+     */
+    constexpr int BAND_ROWS = 16;
+
+    namespace {
+
+        typedef struct Run {
+            int from;
+            int to;
+            int m; // mask column
+        } Run;
+
+        int concurrency() {
+            const auto hw = (size_t) std::max(1u, std::thread::hardware_concurrency());
+            return (int) std::clamp(hw, (size_t) 1, eox::globals::THREAD_POOL_CORES_MAX);
+        }
+
+        eox::util::ThreadPool &pool() {
+            // caller thread always takes one band itself
+            static eox::util::ThreadPool executor(std::max(1, concurrency() - 1));
+            return executor;
+        }
+
+        const std::vector<float> &gaussian(int kernel_size) {
+            static std::mutex mutex;
+            static std::map<int, std::vector<float>> kernels;
+
+            std::lock_guard<std::mutex> lock(mutex);
+            auto &kernel = kernels[kernel_size];
+            if (kernel.empty()) {
+                // same as Kernels::blur_kernels
+                const cv::Mat mat = cv::getGaussianKernel(kernel_size, ((float) kernel_size - 1.f) / 6.f, CV_32F);
+                kernel.assign(mat.ptr<float>(), mat.ptr<float>() + kernel_size);
+            }
+            return kernel;
+        }
+
+        inline uchar to_u8(float v) {
+            // kernels produce NaN for grey pixels (0 / 0), GPUs convert it to 0
+            return std::isnan(v) ? 0 : (uchar) (int) v;
+        }
+
+        inline void bgr_to_hls(const uchar *bgr, uchar *hls) {
+            const float b = ((float) bgr[0]) / 255.f;
+            const float g = ((float) bgr[1]) / 255.f;
+            const float r = ((float) bgr[2]) / 255.f;
+
+            const float c_max = std::fmax(b, std::fmax(g, r));
+            const float c_min = std::fmin(b, std::fmin(g, r));
+            const float c_dif = c_max - c_min;
+            const float c_sum = c_max + c_min;
+            const float c_fac = 60.f / c_dif;
+            const float L = (c_sum / 2.f);
+
+            float H = 0.f;
+            if (c_max == r)
+                H = c_fac * (g - b);
+            else if (c_max == g)
+                H = 120.f + (c_fac * (b - r));
+            else if (c_max == b)
+                H = 240.f + (c_fac * (r - g));
+            if (H < 0)
+                H += 360.f;
+
+            hls[0] = to_u8(H * 0.708333f);
+            hls[1] = to_u8(L * 255.f);
+            hls[2] = to_u8((L < 0.5f ? (c_dif / c_sum) : (c_dif / (2.f - c_sum))) * 255.f);
+        }
+
+        inline uchar in_range_hls(const uchar *bgr, const uchar *low, const uchar *up, bool wrap) {
+            uchar hls[3];
+            bgr_to_hls(bgr, hls);
+            const bool hue = wrap
+                             ? (hls[0] >= low[0] || hls[0] <= up[0])
+                             : (hls[0] >= low[0] && hls[0] <= up[0]);
+            return hue && hls[1] >= low[1] && hls[2] >= low[2] && hls[1] <= up[1] && hls[2] <= up[2] ? 255 : 0;
+        }
+
+        /**
+         * dst[i] = (uchar) (sum(src[k][i] * weights[k]) / weight_sum)
+         */
+        void weighted_sum(const uchar *const *src, const float *weights, int taps, float weight_sum, uchar *dst, int len) {
+            int i = 0;
+#if (CV_SIMD || CV_SIMD_SCALABLE)
+            const int lanes = cv::VTraits<cv::v_uint8>::vlanes();
+            const cv::v_float32 v_norm = cv::vx_setall_f32(weight_sum);
+            for (; i <= len - lanes; i += lanes) {
+                cv::v_float32 s0 = cv::vx_setzero_f32();
+                cv::v_float32 s1 = cv::vx_setzero_f32();
+                cv::v_float32 s2 = cv::vx_setzero_f32();
+                cv::v_float32 s3 = cv::vx_setzero_f32();
+                for (int k = 0; k < taps; k++) {
+                    cv::v_uint16 lo, hi;
+                    cv::v_uint32 p0, p1, p2, p3;
+                    cv::v_expand(cv::vx_load(src[k] + i), lo, hi);
+                    cv::v_expand(lo, p0, p1);
+                    cv::v_expand(hi, p2, p3);
+                    const cv::v_float32 w = cv::vx_setall_f32(weights[k]);
+                    s0 = cv::v_fma(cv::v_cvt_f32(cv::v_reinterpret_as_s32(p0)), w, s0);
+                    s1 = cv::v_fma(cv::v_cvt_f32(cv::v_reinterpret_as_s32(p1)), w, s1);
+                    s2 = cv::v_fma(cv::v_cvt_f32(cv::v_reinterpret_as_s32(p2)), w, s2);
+                    s3 = cv::v_fma(cv::v_cvt_f32(cv::v_reinterpret_as_s32(p3)), w, s3);
+                }
+                const cv::v_int16 lo = cv::v_pack(cv::v_trunc(cv::v_div(s0, v_norm)), cv::v_trunc(cv::v_div(s1, v_norm)));
+                const cv::v_int16 hi = cv::v_pack(cv::v_trunc(cv::v_div(s2, v_norm)), cv::v_trunc(cv::v_div(s3, v_norm)));
+                cv::v_store(dst + i, cv::v_pack_u(lo, hi));
+            }
+            cv::vx_cleanup();
+#endif
+            for (; i < len; i++) {
+                float sum = 0.f;
+                for (int k = 0; k < taps; k++)
+                    sum += (float) src[k][i] * weights[k];
+                dst[i] = (uchar) (sum / weight_sum);
+            }
+        }
+
+        /**
+         * dst[i] = max(src[k][i]) or min(src[k][i])
+         */
+        template<bool MAX>
+        void extremum(const uchar *const *src, int taps, uchar *dst, int len) {
+            int i = 0;
+#if (CV_SIMD || CV_SIMD_SCALABLE)
+            const int lanes = cv::VTraits<cv::v_uint8>::vlanes();
+            for (; i <= len - lanes; i += lanes) {
+                cv::v_uint8 v = cv::vx_load(src[0] + i);
+                for (int k = 1; k < taps; k++) {
+                    if constexpr (MAX)
+                        v = cv::v_max(v, cv::vx_load(src[k] + i));
+                    else
+                        v = cv::v_min(v, cv::vx_load(src[k] + i));
+                }
+                cv::v_store(dst + i, v);
+            }
+            cv::vx_cleanup();
+#endif
+            for (; i < len; i++) {
+                uchar v = src[0][i];
+                for (int k = 1; k < taps; k++)
+                    v = MAX ? std::max(v, src[k][i]) : std::min(v, src[k][i]);
+                dst[i] = v;
+            }
+        }
+
+        template<bool MAX>
+        void morph_pass(const cv::Mat &in, cv::Mat &tmp, cv::Mat &out, int half) {
+            const int cols = in.cols;
+            const int rows = in.rows;
+            const int taps = half * 2 + 1;
+
+            // horizontal, out of bounds pixels are skipped
+            parallel_rows(rows, [&](int from, int to) {
+                std::vector<const uchar *> src(taps);
+                const int inner_from = std::min(half, cols);
+                const int inner_to = std::max(inner_from, cols - half);
+                for (int y = from; y < to; y++) {
+                    const auto row = in.ptr<uchar>(y);
+                    const auto dst = tmp.ptr<uchar>(y);
+                    for (int x = 0; x < cols; x = (x + 1 == inner_from && inner_to > inner_from) ? inner_to : x + 1) {
+                        uchar v = row[x];
+                        for (int ix = std::max(0, x - half); ix <= std::min(cols - 1, x + half); ix++)
+                            v = MAX ? std::max(v, row[ix]) : std::min(v, row[ix]);
+                        dst[x] = v;
+                    }
+                    if (inner_to > inner_from) {
+                        for (int k = 0; k < taps; k++)
+                            src[k] = row + inner_from + k - half;
+                        extremum<MAX>(src.data(), taps, dst + inner_from, inner_to - inner_from);
+                    }
+                }
+            });
+
+            // vertical
+            parallel_rows(rows, [&](int from, int to) {
+                std::vector<const uchar *> src(taps);
+                for (int y = from; y < to; y++) {
+                    int n = 0;
+                    for (int iy = std::max(0, y - half); iy <= std::min(rows - 1, y + half); iy++)
+                        src[n++] = tmp.ptr<uchar>(iy);
+                    extremum<MAX>(src.data(), n, out.ptr<uchar>(y), cols);
+                }
+            });
+        }
+
+        template<bool MAX>
+        void morph(const cv::Mat &in, cv::Mat &out, int iterations, int kernel_size) {
+            if (kernel_size < 3 || kernel_size % 2 == 0)
+                throw std::runtime_error("Invalid kernel size: " + std::to_string(kernel_size));
+            if (in.type() != CV_8UC1)
+                throw std::runtime_error("Morphology requires single channel uchar image");
+
+            const cv::Mat source = in;
+            cv::Mat tmp(in.rows, in.cols, CV_8UC1);
+            out.create(in.rows, in.cols, CV_8UC1);
+
+            if (iterations <= 0) {
+                if (source.data != out.data)
+                    source.copyTo(out);
+                return;
+            }
+
+            // first pass reads the source into tmp, so in-place calls are fine
+            morph_pass<MAX>(source, tmp, out, kernel_size / 2);
+            for (int i = 1; i < iterations; i++)
+                morph_pass<MAX>(out, tmp, out, kernel_size / 2);
+        }
+
+        /**
+         * Gaussian blur normalized by weights of in bounds samples only (see 'downscale_blur_hls_threshold')
+         */
+        void blur_bounded(const cv::Mat &in, cv::Mat &out, int kernel_size) {
+            const auto &w = gaussian(kernel_size);
+            const int half = kernel_size / 2;
+            const int cols = in.cols;
+            const int rows = in.rows;
+
+            // weights are separable, so are the sums: (sum_x * sum_y) / (w_x * w_y)
+            cv::Mat sums(rows, cols, CV_32FC3);
+            std::vector<float> w_x(cols);
+            for (int x = 0; x < cols; x++) {
+                w_x[x] = 0.f;
+                for (int k = -half; k <= half; k++)
+                    if (x + k >= 0 && x + k < cols)
+                        w_x[x] += w[half + k];
+            }
+
+            parallel_rows(rows, [&](int from, int to) {
+                for (int y = from; y < to; y++) {
+                    const auto src = in.ptr<uchar>(y);
+                    const auto dst = sums.ptr<float>(y);
+                    for (int x = 0; x < cols; x++) {
+                        float s[3] = {0.f, 0.f, 0.f};
+                        for (int ix = std::max(0, x - half); ix <= std::min(cols - 1, x + half); ix++) {
+                            const float weight = w[half + ix - x];
+                            s[0] += (float) src[ix * 3 + 0] * weight;
+                            s[1] += (float) src[ix * 3 + 1] * weight;
+                            s[2] += (float) src[ix * 3 + 2] * weight;
+                        }
+                        std::memcpy(dst + x * 3, s, sizeof(s));
+                    }
+                }
+            });
+
+            parallel_rows(rows, [&](int from, int to) {
+                std::vector<float> s((size_t) cols * 3);
+                for (int y = from; y < to; y++) {
+                    float w_y = 0.f;
+                    std::fill(s.begin(), s.end(), 0.f);
+                    for (int iy = std::max(0, y - half); iy <= std::min(rows - 1, y + half); iy++) {
+                        const float weight = w[half + iy - y];
+                        const auto src = sums.ptr<float>(iy);
+                        for (int i = 0; i < cols * 3; i++)
+                            s[i] += src[i] * weight;
+                        w_y += weight;
+                    }
+                    const auto dst = out.ptr<uchar>(y);
+                    for (int x = 0; x < cols; x++) {
+                        const float norm = w_x[x] * w_y;
+                        for (int i = 0; i < 3; i++)
+                            dst[x * 3 + i] = (uchar) (s[x * 3 + i] / norm);
+                    }
+                }
+            });
+        }
+
+        /**
+         * Consecutive image columns sampling the same mask column
+         */
+        std::vector<Run> runs(int cols, int mask_cols, const std::function<int(int)> &mapping) {
+            std::vector<Run> list;
+            for (int x = 0; x < cols; x++) {
+                const int m = std::clamp(mapping(x), 0, mask_cols - 1);
+                if (list.empty() || list.back().m != m)
+                    list.push_back({x, x + 1, m});
+                else
+                    list.back().to = x + 1;
+            }
+            return list;
+        }
+
+        void apply_runs(const uchar *src, const uchar *mask, uchar *dst, const std::vector<Run> &list, const uchar *color) {
+            for (const auto &run: list) {
+                if (mask[run.m] == 0) {
+                    if (src != dst)
+                        std::memcpy(dst + run.from * 3, src + run.from * 3, (size_t) (run.to - run.from) * 3);
+                    continue;
+                }
+                for (int x = run.from; x < run.to; x++)
+                    std::memcpy(dst + x * 3, color, 3);
+            }
+        }
+
+        void apply_row(const uchar *src, const uchar *mask, uchar *dst, int cols, const uchar *color) {
+            int x = 0;
+#if (CV_SIMD || CV_SIMD_SCALABLE)
+            const int lanes = cv::VTraits<cv::v_uint8>::vlanes();
+            const cv::v_uint8 c_b = cv::vx_setall_u8(color[0]);
+            const cv::v_uint8 c_g = cv::vx_setall_u8(color[1]);
+            const cv::v_uint8 c_r = cv::vx_setall_u8(color[2]);
+            const cv::v_uint8 zero = cv::vx_setzero_u8();
+            for (; x <= cols - lanes; x += lanes) {
+                cv::v_uint8 b, g, r;
+                cv::v_load_deinterleave(src + x * 3, b, g, r);
+                const cv::v_uint8 m = cv::v_ne(cv::vx_load(mask + x), zero);
+                cv::v_store_interleave(dst + x * 3, cv::v_select(m, c_b, b), cv::v_select(m, c_g, g), cv::v_select(m, c_r, r));
+            }
+            cv::vx_cleanup();
+#endif
+            for (; x < cols; x++)
+                std::memcpy(dst + x * 3, mask[x] > 0 ? color : src + x * 3, 3);
+        }
+
+        void check_bgr(const cv::Mat &mat) {
+            if (mat.type() != CV_8UC3)
+                throw std::runtime_error("Expected BGR image (3 channels uchar), got type: " + std::to_string(mat.type()));
+        }
+    }
+
+    void parallel_rows(int rows, const std::function<void(int, int)> &fn) {
+        const int bands = std::min(concurrency(), rows / BAND_ROWS);
+        if (bands <= 1) {
+            fn(0, rows);
+            return;
+        }
+
+        const int band = (rows + bands - 1) / bands;
+        std::vector<std::future<void>> futures;
+        futures.reserve(bands);
+        for (int from = band; from < rows; from += band) {
+            const int to = std::min(rows, from + band);
+            futures.push_back(pool().execute(std::function<void()>([&fn, from, to]() {
+                fn(from, to);
+            })));
+        }
+
+        std::exception_ptr error;
+        try {
+            fn(0, band);
+        } catch (...) {
+            error = std::current_exception();
+        }
+
+        // bands reference the callback, so every one of them is awaited
+        for (auto &future: futures) {
+            try {
+                future.get();
+            } catch (...) {
+                if (!error)
+                    error = std::current_exception();
+            }
+        }
+
+        if (error)
+            std::rethrow_exception(error);
+    }
+
+    void downscale(const cv::Mat &in, cv::Mat &out, float scale_w, float scale_h, bool linear) {
+        const int in_w = in.cols;
+        const int in_h = in.rows;
+        const int cols = out.cols;
+        const int channels = (int) in.elemSize();
+
+        std::vector<int> x0(cols), x1(cols);
+        std::vector<float> dx(cols);
+        for (int x = 0; x < cols; x++) {
+            const float img_x = (float) x * scale_w;
+            x0[x] = linear ? (int) img_x : std::clamp((int) img_x, 0, in_w - 1);
+            x1[x] = std::min(x0[x] + 1, in_w - 1);
+            dx[x] = img_x - (float) (int) img_x;
+        }
+
+        parallel_rows(out.rows, [&](int from, int to) {
+            for (int y = from; y < to; y++) {
+                const float img_y = (float) y * scale_h;
+                const auto dst = out.ptr<uchar>(y);
+
+                if (!linear) {
+                    const auto row = in.ptr<uchar>(std::clamp((int) img_y, 0, in_h - 1));
+                    for (int x = 0; x < cols; x++)
+                        std::memcpy(dst + x * channels, row + x0[x] * channels, channels);
+                    continue;
+                }
+
+                const int y0 = (int) img_y;
+                const int y1 = std::min(y0 + 1, in_h - 1);
+                const float dy = img_y - (float) y0;
+                const auto r0 = in.ptr<uchar>(y0);
+                const auto r1 = in.ptr<uchar>(y1);
+                for (int x = 0; x < cols; x++) {
+                    for (int i = 0; i < channels; i++) {
+                        const auto p00 = (float) r0[x0[x] * channels + i];
+                        const auto p10 = (float) r0[x1[x] * channels + i];
+                        const auto p01 = (float) r1[x0[x] * channels + i];
+                        const auto p11 = (float) r1[x1[x] * channels + i];
+                        const float p0 = p00 + (p10 - p00) * dx[x];
+                        const float p1 = p01 + (p11 - p01) * dx[x];
+                        dst[x * channels + i] = (uchar) (p0 + (p1 - p0) * dy);
+                    }
+                }
+            }
+        });
+    }
+
+    void blur(const cv::Mat &in, cv::Mat &out, int kernel_size) {
+        if (kernel_size < 3 || kernel_size % 2 == 0 || kernel_size > 31)
+            throw std::runtime_error("Invalid kernel size: " + std::to_string(kernel_size));
+        check_bgr(in);
+
+        const auto &w = gaussian(kernel_size);
+        const int half = kernel_size / 2;
+        const int cols = in.cols;
+        const int rows = in.rows;
+
+        float w_sum = 0.f;
+        for (const auto v: w)
+            w_sum += v;
+
+        // borders are clamped, so every pixel has full kernel
+        cv::Mat tmp(rows, cols, CV_8UC3);
+
+        parallel_rows(rows, [&](int from, int to) {
+            std::vector<const uchar *> src(kernel_size);
+            const int inner_from = std::min(half, cols);
+            const int inner_to = std::max(inner_from, cols - half);
+            for (int y = from; y < to; y++) {
+                const auto row = in.ptr<uchar>(y);
+                const auto dst = tmp.ptr<uchar>(y);
+                for (int x = 0; x < cols; x = (x + 1 == inner_from && inner_to > inner_from) ? inner_to : x + 1) {
+                    for (int i = 0; i < 3; i++) {
+                        float sum = 0.f;
+                        for (int k = -half; k <= half; k++)
+                            sum += (float) row[std::clamp(x + k, 0, cols - 1) * 3 + i] * w[k + half];
+                        dst[x * 3 + i] = (uchar) (sum / w_sum);
+                    }
+                }
+                if (inner_to > inner_from) {
+                    // interleaved BGR: tap k of byte i is byte i + 3k
+                    for (int k = 0; k < kernel_size; k++)
+                        src[k] = row + (inner_from + k - half) * 3;
+                    weighted_sum(src.data(), w.data(), kernel_size, w_sum, dst + inner_from * 3, (inner_to - inner_from) * 3);
+                }
+            }
+        });
+
+        out.create(rows, cols, CV_8UC3);
+
+        parallel_rows(rows, [&](int from, int to) {
+            std::vector<const uchar *> src(kernel_size);
+            for (int y = from; y < to; y++) {
+                for (int k = 0; k < kernel_size; k++)
+                    src[k] = tmp.ptr<uchar>(std::clamp(y + k - half, 0, rows - 1));
+                weighted_sum(src.data(), w.data(), kernel_size, w_sum, out.ptr<uchar>(y), cols * 3);
+            }
+        });
+    }
+
+    void range_hls(const cv::Mat &in, cv::Mat &out, const cv::Scalar &hls_low, const cv::Scalar &hls_up) {
+        check_bgr(in);
+
+        const uchar low[3] = {(uchar) hls_low[0], (uchar) hls_low[1], (uchar) hls_low[2]};
+        const uchar up[3] = {(uchar) hls_up[0], (uchar) hls_up[1], (uchar) hls_up[2]};
+        const bool wrap = low[0] > up[0];
+
+        const cv::Mat source = in;
+        out.create(in.rows, in.cols, CV_8UC1);
+
+        parallel_rows(source.rows, [&](int from, int to) {
+            for (int y = from; y < to; y++) {
+                const auto src = source.ptr<uchar>(y);
+                const auto dst = out.ptr<uchar>(y);
+                for (int x = 0; x < source.cols; x++)
+                    dst[x] = in_range_hls(src + x * 3, low, up, wrap);
+            }
+        });
+    }
+
+    void dilate(const cv::Mat &in, cv::Mat &out, int iterations, int kernel_size) {
+        morph<true>(in, out, iterations, kernel_size);
+    }
+
+    void erode(const cv::Mat &in, cv::Mat &out, int iterations, int kernel_size) {
+        morph<false>(in, out, iterations, kernel_size);
+    }
+
+    void mask_apply(const cv::Mat &img, const cv::Mat &mask, cv::Mat &out, const cv::Scalar &color) {
+        check_bgr(img);
+
+        const uchar bgr[3] = {(uchar) color[0], (uchar) color[1], (uchar) color[2]};
+        const auto s_w = (float) mask.cols / (float) img.cols;
+        const auto s_h = (float) mask.rows / (float) img.rows;
+        const bool same = mask.cols == img.cols && mask.rows == img.rows;
+
+        const cv::Mat source = img;
+        out.create(img.rows, img.cols, CV_8UC3);
+
+        const auto list = runs(source.cols, mask.cols, [s_w](int x) { return (int) ((float) x * s_w); });
+        parallel_rows(source.rows, [&](int from, int to) {
+            for (int y = from; y < to; y++) {
+                if (same) {
+                    apply_row(source.ptr<uchar>(y), mask.ptr<uchar>(y), out.ptr<uchar>(y), source.cols, bgr);
+                    continue;
+                }
+                const int m_y = std::min((int) ((float) y * s_h), mask.rows - 1);
+                apply_runs(source.ptr<uchar>(y), mask.ptr<uchar>(m_y), out.ptr<uchar>(y), list, bgr);
+            }
+        });
+    }
+
+    void segmentation_apply(const float *logits, int seg_width, int seg_height, float threshold_logit,
+                            float roi_x, float roi_y, float roi_w, float roi_h,
+                            const cv::Mat &img, cv::Mat &out) {
+        const cv::Mat source = img;
+        const int cols = source.cols;
+        const size_t pixel = source.elemSize();
+
+        cv::Mat result(source.rows, cols, source.type());
+
+        // bilinear sampling of the logits (pixel centers), columns are shared by all rows
+        std::vector<int> x0(cols), x1(cols);
+        std::vector<float> fx(cols);
+        std::vector<uchar> inside(cols);
+        for (int x = 0; x < cols; x++) {
+            const float u = ((float) x + 0.5f - roi_x) / roi_w;
+            const float sx = u * (float) seg_width - 0.5f;
+            inside[x] = u >= 0.f && u < 1.f;
+            fx[x] = sx - std::floor(sx);
+            x0[x] = std::clamp((int) std::floor(sx), 0, seg_width - 1);
+            x1[x] = std::min(x0[x] + 1, seg_width - 1);
+        }
+
+        parallel_rows(source.rows, [&](int from, int to) {
+            for (int y = from; y < to; y++) {
+                const auto src = source.ptr<uchar>(y);
+                const auto dst = result.ptr<uchar>(y);
+
+                const float v = ((float) y + 0.5f - roi_y) / roi_h;
+                if (!(v >= 0.f && v < 1.f)) {
+                    std::memset(dst, 0, pixel * cols);
+                    continue;
+                }
+
+                const float sy = v * (float) seg_height - 0.5f;
+                const float fy = sy - std::floor(sy);
+                const int y0 = std::clamp((int) std::floor(sy), 0, seg_height - 1);
+                const int y1 = std::min(y0 + 1, seg_height - 1);
+                const float *r0 = logits + y0 * seg_width;
+                const float *r1 = logits + y1 * seg_width;
+
+                for (int x = 0; x < cols; x++) {
+                    bool keep = false;
+                    if (inside[x]) {
+                        const float l0 = r0[x0[x]] + (r0[x1[x]] - r0[x0[x]]) * fx[x];
+                        const float l1 = r1[x0[x]] + (r1[x1[x]] - r1[x0[x]]) * fx[x];
+                        keep = l0 + (l1 - l0) * fy > threshold_logit;
+                    }
+                    if (keep)
+                        std::memcpy(dst + x * pixel, src + x * pixel, pixel);
+                    else
+                        std::memset(dst + x * pixel, 0, pixel);
+                }
+            }
+        });
+
+        out = result;
+    }
+
+    void chroma_mask(const cv::Mat &in, cv::Mat &out,
+                     const xm::ds::Color4u &hls_low, const xm::ds::Color4u &hls_up,
+                     bool linear, int mask_size, int blur, int fine, int refine) {
+        check_bgr(in);
+
+        const auto ratio = (float) in.cols / (float) in.rows;
+        const auto n_w = mask_size;
+        const auto n_h = (int) ((float) n_w / ratio);
+        const auto scale_w = (float) in.cols / (float) n_w;
+        const auto scale_h = (float) in.rows / (float) n_h;
+
+        // downscale -> (blur) -> range_hls -> (erode_h -> erode_v) -> (dilate_h -> dilate_v)
+        cv::Mat small(n_h, n_w, CV_8UC3);
+        downscale(in, small, scale_w, scale_h, linear);
+
+        if (blur >= 3) {
+            cv::Mat blurred(n_h, n_w, CV_8UC3);
+            blur_bounded(small, blurred, blur);
+            small = blurred;
+        }
+
+        const uchar low[3] = {hls_low.h, hls_low.l, hls_low.s};
+        const uchar up[3] = {hls_up.h, hls_up.l, hls_up.s};
+        const bool wrap = !(low[0] < up[0]); // chroma_key.cl: equal bounds wrap too
+
+        out.create(n_h, n_w, CV_8UC1);
+        parallel_rows(n_h, [&](int from, int to) {
+            for (int y = from; y < to; y++) {
+                const auto src = small.ptr<uchar>(y);
+                const auto dst = out.ptr<uchar>(y);
+                for (int x = 0; x < n_w; x++)
+                    dst[x] = in_range_hls(src + x * 3, low, up, wrap);
+            }
+        });
+
+        if (fine >= 3 && refine > 0) {
+            erode(out, out, refine, fine);
+            dilate(out, out, refine, fine);
+        }
+    }
+
+    void chroma_apply(const cv::Mat &in, const cv::Mat &mask, cv::Mat &out, const xm::ds::Color4u &color) {
+        check_bgr(in);
+
+        const uchar bgr[3] = {color.b, color.g, color.r};
+        const auto scale_w = (float) in.cols / (float) mask.cols;
+        const auto scale_h = (float) in.rows / (float) mask.rows;
+
+        const cv::Mat source = in;
+        out.create(in.rows, in.cols, CV_8UC3);
+
+        // each output pixel samples the mask pixel whose upscaled block covers it
+        const auto list = runs(source.cols, mask.cols, [scale_w](int x) { return (int) ((float) x / scale_w); });
+        parallel_rows(source.rows, [&](int from, int to) {
+            for (int y = from; y < to; y++) {
+                const int m_y = std::min((int) ((float) y / scale_h), mask.rows - 1);
+                apply_runs(source.ptr<uchar>(y), mask.ptr<uchar>(m_y), out.ptr<uchar>(y), list, bgr);
+            }
+        });
+    }
+
+    void chroma_blob(const cv::Mat &in, const cv::Mat &mask, cv::Mat &out, const xm::ds::Color4u &color,
+                     float roi_x, float roi_y, float roi_w, float roi_h, int width, int height) {
+        check_bgr(in);
+
+        // letterbox, same paddings as in eox::dnn::get_letterbox_paddings
+        const float box_scale = std::min((float) width / roi_w, (float) height / roi_h);
+        const int n_w = (int) (roi_w * box_scale);
+        const int n_h = (int) (roi_h * box_scale);
+        const auto pad_x = (float) (int) ((float) (width - n_w) / 2.f);
+        const auto pad_y = (float) (int) ((float) (height - n_h) / 2.f);
+        const auto scale = 1.f / box_scale;
+
+        const int input_w = in.cols;
+        const int input_h = in.rows;
+        const auto mask_scale_w = (float) input_w / (float) mask.cols;
+        const auto mask_scale_h = (float) input_h / (float) mask.rows;
+        const float key[3] = {(float) color.b, (float) color.g, (float) color.r};
+
+        const auto masked = [&](int x, int y, float *bgr) {
+            const int m_x = std::min((int) ((float) x / mask_scale_w), mask.cols - 1);
+            const int m_y = std::min((int) ((float) y / mask_scale_h), mask.rows - 1);
+            if (mask.ptr<uchar>(m_y)[m_x] > 0) {
+                std::memcpy(bgr, key, sizeof(key));
+                return;
+            }
+            const auto pix = in.ptr<uchar>(y) + x * 3;
+            bgr[0] = (float) pix[0];
+            bgr[1] = (float) pix[1];
+            bgr[2] = (float) pix[2];
+        };
+
+        out.create(height, width, CV_32FC3);
+        parallel_rows(height, [&](int from, int to) {
+            for (int y = from; y < to; y++) {
+                const auto dst = out.ptr<float>(y);
+                const float r_y = (((float) y - pad_y) + 0.5f) * scale - 0.5f;
+                for (int x = 0; x < width; x++) {
+                    const float r_x = (((float) x - pad_x) + 0.5f) * scale - 0.5f;
+                    if (r_x < -0.5f || r_y < -0.5f || r_x > roi_w - 0.5f || r_y > roi_h - 0.5f) {
+                        dst[x * 3 + 0] = 0.f;
+                        dst[x * 3 + 1] = 0.f;
+                        dst[x * 3 + 2] = 0.f;
+                        continue;
+                    }
+
+                    const float i_x = std::clamp(roi_x + r_x, 0.f, (float) (input_w - 1));
+                    const float i_y = std::clamp(roi_y + r_y, 0.f, (float) (input_h - 1));
+                    const int x0 = (int) i_x;
+                    const int y0 = (int) i_y;
+                    const int x1 = std::min(x0 + 1, input_w - 1);
+                    const int y1 = std::min(y0 + 1, input_h - 1);
+                    const float dx = i_x - (float) x0;
+                    const float dy = i_y - (float) y0;
+
+                    float p00[3], p10[3], p01[3], p11[3];
+                    masked(x0, y0, p00);
+                    masked(x1, y0, p10);
+                    masked(x0, y1, p01);
+                    masked(x1, y1, p11);
+
+                    // BGR -> RGB
+                    for (int i = 0; i < 3; i++) {
+                        const float p0 = p00[i] + (p10[i] - p00[i]) * dx;
+                        const float p1 = p01[i] + (p11[i] - p01[i]) * dx;
+                        dst[x * 3 + (2 - i)] = (p0 + (p1 - p0) * dy) / 255.f;
+                    }
+                }
+            }
+        });
+    }
+
+    void flip_rotate(const cv::Mat &in, cv::Mat &out, bool flip_x, bool flip_y, bool rotate) {
+        const int cols = in.cols;
+        const int rows = in.rows;
+        const cv::Mat source = in.data == out.data ? in.clone() : in;
+
+        if (!rotate) {
+            out.create(rows, cols, in.type());
+            parallel_rows(rows, [&](int from, int to) {
+                const auto src = flip_y ? source.rowRange(rows - to, rows - from) : source.rowRange(from, to);
+                auto dst = out.rowRange(from, to);
+                if (flip_x || flip_y)
+                    cv::flip(src, dst, flip_x && flip_y ? -1 : flip_x ? 1 : 0);
+                else
+                    src.copyTo(dst);
+            });
+            return;
+        }
+
+        // out(x, rows - 1 - y) = in(f_y(y), f_x(x)), ie: flip then 90 degrees clockwise
+        out.create(cols, rows, in.type());
+        parallel_rows(cols, [&](int from, int to) {
+            cv::Mat transposed;
+            cv::transpose(flip_x ? source.colRange(cols - to, cols - from) : source.colRange(from, to), transposed);
+            auto dst = out.rowRange(from, to);
+            if (flip_x || !flip_y)
+                cv::flip(transposed, dst, flip_x && !flip_y ? -1 : flip_x ? 0 : 1);
+            else
+                transposed.copyTo(dst);
+        });
+    }
+
+}
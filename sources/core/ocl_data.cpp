@@ -3,6 +3,7 @@
 //
 
 #include <stdexcept>
+#include <algorithm>
 #include "../../xmotion/core/ocl/ocl_data.h"
 
 namespace xm::ocl {
@@ -10,12 +11,16 @@ namespace xm::ocl {
     Image2D &Image2D::decrement_ref() {
         if (handle != nullptr)
             clReleaseMemObject(handle);
+        if (image != nullptr)
+            clReleaseMemObject(image);
         return *this;
     }
 
     void Image2D::release() {
         if (handle != nullptr && !is_detached)
             clReleaseMemObject(handle);
+        if (image != nullptr && !is_detached)
+            clReleaseMemObject(image);
         reset_state(*this);
     }
 
@@ -24,7 +29,19 @@ namespace xm::ocl {
     }
 
     bool Image2D::empty() const {
-        return handle == nullptr || size() == 0;
+        return (handle == nullptr && !host) || size() == 0;
+    }
+
+    bool Image2D::on_host() const {
+        return host != nullptr;
+    }
+
+    uint8_t *Image2D::data() const {
+        return host.get();
+    }
+
+    bool Image2D::has_image() const {
+        return image != nullptr;
     }
 
     cl_mem Image2D::get_handle(ACCESS desired) const {
@@ -53,6 +70,8 @@ namespace xm::ocl {
         context = other.context;
         device = other.device;
         handle = other.handle;
+        host = other.host;
+        image = other.image;
     }
 
     void Image2D::reset_state(Image2D &other) {
@@ -60,6 +79,8 @@ namespace xm::ocl {
         other.context = nullptr;
         other.device = nullptr;
         other.handle = nullptr;
+        other.host = nullptr;
+        other.image = nullptr;
         other.channel_size = 0;
         other.channels = 0;
         other.cols = 0;
@@ -68,17 +89,24 @@ namespace xm::ocl {
 
     Image2D::Image2D(const Image2D &other) {
         copy_from(other);
-        clRetainMemObject(handle);
+        if (handle != nullptr)
+            clRetainMemObject(handle);
+        if (image != nullptr)
+            clRetainMemObject(image);
     }
 
     Image2D::Image2D(const Image2D &other, cl_mem _handle) {
         copy_from(other);
         handle = _handle;
+        host = nullptr;
+        image = nullptr;
     }
 
     Image2D::Image2D(const Image2D &other, cl_mem _handle, ACCESS modifier) {
         copy_from(other);
         handle = _handle;
+        host = nullptr;
+        image = nullptr;
         access = modifier;
     }
 
@@ -90,11 +118,15 @@ namespace xm::ocl {
     Image2D::Image2D(const Image2D &&other, cl_mem _handle) {
         copy_from(other);
         handle = _handle;
+        host = nullptr;
+        image = nullptr;
     }
 
     Image2D::Image2D(const Image2D &&other, cl_mem _handle, ACCESS modifier) {
         copy_from(other);
         handle = _handle;
+        host = nullptr;
+        image = nullptr;
         access = modifier;
     }
 
@@ -104,7 +136,10 @@ namespace xm::ocl {
     }
 
     Image2D &Image2D::retain() {
-        clRetainMemObject(handle);
+        if (handle != nullptr)
+            clRetainMemObject(handle);
+        if (image != nullptr)
+            clRetainMemObject(image);
         return *this;
     }
 
@@ -113,7 +148,10 @@ namespace xm::ocl {
             return *this;
         release();
         copy_from(other);
-        clRetainMemObject(handle);
+        if (handle != nullptr)
+            clRetainMemObject(handle);
+        if (image != nullptr)
+            clRetainMemObject(image);
         return *this;
     }
 
@@ -163,7 +201,40 @@ namespace xm::ocl {
         return Image2D(cols, rows, channels, channel_size, buffer, context, device, access);
     }
 
+    Image2D Image2D::allocate_host(size_t cols, size_t rows, size_t channels, size_t channel_size, ACCESS access) {
+        Image2D image(cols, rows, channels, channel_size, nullptr, nullptr, nullptr, access);
+        image.host = std::shared_ptr<uint8_t[]>(new uint8_t[std::max((size_t) 1, image.size())]);
+        return image;
+    }
+
+    cl_mem Image2D::allocate_image(size_t cols, size_t rows, size_t channels, cl_context context, ACCESS access) {
+        cl_image_format format;
+        format.image_channel_data_type = CL_UNORM_INT8;
+        if (channels == 1) format.image_channel_order = CL_R;
+        else if (channels == 3 || channels == 4) format.image_channel_order = CL_RGBA;
+        else throw std::invalid_argument("Unsupported number of image channels: " + std::to_string(channels));
+
+        cl_image_desc desc = {};
+        desc.image_type = CL_MEM_OBJECT_IMAGE2D;
+        desc.image_width = cols;
+        desc.image_height = rows;
+
+        cl_mem_flags flags;
+        if (access == ACCESS::RO) flags = CL_MEM_READ_ONLY;
+        else if (access == ACCESS::WO) flags = CL_MEM_WRITE_ONLY;
+        else if (access == ACCESS::RW) flags = CL_MEM_READ_WRITE;
+        else throw std::invalid_argument("Invalid access modifier: " + std::to_string((int) access));
+
+        cl_int err;
+        cl_mem image = clCreateImage(context, flags, &format, &desc, NULL, &err);
+        if (err != CL_SUCCESS)
+            throw std::runtime_error("Cannot create cl image: " + std::to_string(err));
+        return image;
+    }
+
     Image2D Image2D::allocate_like(const Image2D &t, ACCESS access) {
+        if (t.on_host())
+            return allocate_host(t.cols, t.rows, t.channels, t.channel_size, access);
         return allocate(t.cols, t.rows, t.channels, t.channel_size, t.context, t.device, access);
     }
 }
\ No newline at end of file
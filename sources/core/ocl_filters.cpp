@@ -8,6 +8,8 @@
 #pragma ide diagnostic ignored "bugprone-easily-swappable-parameters"
 
 #include "../../xmotion/core/ocl/ocl_filters.h"
+#include "../../xmotion/core/ocl/ocl_cpu.h"
+#include "../../xmotion/core/ocl/cl_tuner.h"
 
 #include "../../kernels/chroma_key.h"
 #include "../../kernels/flip_rotate.h"
@@ -17,6 +19,7 @@
 
 #include <CL/cl.h>
 #include <opencv2/imgproc.hpp>
+#include <algorithm>
 #include <cmath>
 #include <thread>
 
@@ -26,6 +29,18 @@ namespace xm::ocl {
         std::mutex GLOBAL_MUTEX;
     }
 
+    namespace {
+        /**
+         * @return number of rows of single frame of the stacked image (see stack)
+         */
+        int layer_rows(const xm::ocl::Image2D &in, int layers) {
+            if (layers < 1 || in.rows % layers != 0)
+                throw std::invalid_argument("Invalid number of stacked frames: " + std::to_string(layers)
+                                            + ", rows: " + std::to_string(in.rows));
+            return (int) in.rows / layers;
+        }
+    }
+
     Kernels::Kernels() {
         std::ostringstream oss;
         oss << std::this_thread::get_id();
@@ -83,12 +98,22 @@ namespace xm::ocl {
         kernel_mask_apply = xm::ocl::build_kernel(program_color_space, "kernel_simple_mask_apply");
         mask_apply_local_size = xm::ocl::optimal_local_size(device_id, kernel_mask_apply);
 
+        kernel_image_to_packed = xm::ocl::build_kernel(program_color_space, "kernel_image_to_packed");
+
+        kernel_segmentation_apply = xm::ocl::build_kernel(program_color_space, "kernel_segmentation_apply");
+        segmentation_apply_local_size = xm::ocl::optimal_local_size(device_id, kernel_segmentation_apply);
+
         kernel_power_chroma = xm::ocl::build_kernel(program_power_chroma, "power_chromakey");
         kernel_power_apply = xm::ocl::build_kernel(program_power_chroma, "power_apply");
         kernel_power_mask = xm::ocl::build_kernel(program_power_chroma, "power_mask");
+        kernel_power_mask_image = xm::ocl::build_kernel(program_power_chroma, "power_mask_image");
         power_chroma_local_size = xm::ocl::optimal_local_size(device_id, kernel_power_chroma);
 
+        kernel_power_blob = xm::ocl::build_kernel(program_power_chroma, "power_blob");
+        power_blob_local_size = xm::ocl::optimal_local_size(device_id, kernel_power_blob);
+
         kernel_flip_rotate = xm::ocl::build_kernel(program_flip_rotate, "flip_rotate");
+        kernel_flip_rotate_image = xm::ocl::build_kernel(program_flip_rotate, "flip_rotate_image");
         flip_rotate_local_size = xm::ocl::optimal_local_size(device_id, kernel_flip_rotate);
 
         kernel_lbp_texture = xm::ocl::build_kernel(program_background, "kernel_lbp");
@@ -121,14 +146,19 @@ namespace xm::ocl {
 
         clReleaseKernel(kernel_range_hls);
         clReleaseKernel(kernel_mask_apply);
+        clReleaseKernel(kernel_image_to_packed);
+        clReleaseKernel(kernel_segmentation_apply);
         clReleaseProgram(program_color_space);
 
         clReleaseKernel(kernel_power_chroma);
         clReleaseKernel(kernel_power_apply);
         clReleaseKernel(kernel_power_mask);
+        clReleaseKernel(kernel_power_mask_image);
+        clReleaseKernel(kernel_power_blob);
         clReleaseProgram(program_power_chroma);
 
         clReleaseKernel(kernel_flip_rotate);
+        clReleaseKernel(kernel_flip_rotate_image);
         clReleaseProgram(program_flip_rotate);
 
         clReleaseKernel(kernel_lbp_texture);
@@ -172,24 +202,123 @@ namespace xm::ocl {
     }
 
 
-    xm::ocl::iop::ClImagePromise blur(const iop::ClImagePromise &in, int kernel_size, int queue_index) {
+    xm::ocl::iop::ClImagePromise stack(const std::vector<xm::ocl::Image2D> &frames, int queue_index) {
+        return stack(Kernels::instance().retrieve_queue(queue_index), frames);
+    }
+
+    xm::ocl::iop::ClImagePromise stack(cl_command_queue queue, const std::vector<xm::ocl::Image2D> &frames) {
+        xm::ocl::Image2D out;
+        return stack(queue, frames, out);
+    }
+
+    xm::ocl::iop::ClImagePromise stack(cl_command_queue queue, const std::vector<xm::ocl::Image2D> &frames, xm::ocl::Image2D &out) {
+        if (frames.empty())
+            throw std::invalid_argument("Nothing to stack");
+
+        const auto &first = frames.front();
+        for (const auto &frame: frames) {
+            if (frame.on_host())
+                throw std::invalid_argument("Only OpenCL images can be stacked");
+            if (frame.cols != first.cols || frame.rows != first.rows
+                || frame.channels != first.channels || frame.channel_size != first.channel_size)
+                throw std::invalid_argument("Stacked frames have to be of the same size and type");
+        }
+
+        const auto size = first.size();
+        const auto rows = first.rows * frames.size();
+
+        // frames unstacked from previous stack might be still in use (sub-buffers retain it)
+        if (out.handle == nullptr || out.cols != first.cols || out.rows != rows
+            || out.channels != first.channels || out.channel_size != first.channel_size
+            || out.context != first.context || xm::ocl::get_ref_count(out.handle) > 1) {
+            out = xm::ocl::Image2D::allocate(
+                    first.cols, rows, first.channels, first.channel_size,
+                    first.context, first.device);
+        }
+
+        for (size_t i = 0; i < frames.size(); i++) {
+            const cl_int err = clEnqueueCopyBuffer(queue, frames[i].handle, out.handle, 0, i * size, size, 0, NULL, NULL);
+            if (err != CL_SUCCESS)
+                throw std::runtime_error("Cannot copy cl buffer: " + std::to_string(err));
+        }
+
+        return xm::ocl::iop::ClImagePromise(out, queue);
+    }
+
+    std::vector<xm::ocl::iop::ClImagePromise> unstack(const iop::ClImagePromise &in, int layers, int queue_index) {
         auto queue = queue_index < 0 && in.queue() != nullptr
                      ? in.queue()
                      : Kernels::instance().retrieve_queue(queue_index);
-        return blur(queue, in, kernel_size);
+        return unstack(queue, in, layers);
     }
 
-    xm::ocl::iop::ClImagePromise blur(cl_command_queue queue, const iop::ClImagePromise &in_p, int kernel_size) {
+    std::vector<xm::ocl::iop::ClImagePromise> unstack(cl_command_queue queue, const iop::ClImagePromise &in_p, int layers) {
+        const auto &in = in_p.getImage2D();
+        const int rows = layer_rows(in, layers);
+        const auto size = in.size() / layers;
+
+        if (in.on_host())
+            throw std::invalid_argument("Only OpenCL images can be unstacked");
+
+        // sub-buffer origin has to be aligned to CL_DEVICE_MEM_BASE_ADDR_ALIGN (bits)
+        cl_uint align = 0;
+        clGetDeviceInfo(in.device, CL_DEVICE_MEM_BASE_ADDR_ALIGN, sizeof(align), &align, nullptr);
+        const bool views = align > 0 && size % std::max<size_t>(1, align / 8) == 0;
+
+        std::vector<xm::ocl::iop::ClImagePromise> frames;
+        frames.reserve(layers);
+        for (int i = 0; i < layers; i++) {
+            cl_int err;
+            cl_mem handle;
+
+            if (views) {
+                // keeps the stack alive, no copy
+                const cl_buffer_region region = {i * size, size};
+                handle = clCreateSubBuffer(in.handle, CL_MEM_READ_WRITE, CL_BUFFER_CREATE_TYPE_REGION, &region, &err);
+                if (err != CL_SUCCESS)
+                    throw std::runtime_error("Cannot create cl sub-buffer: " + std::to_string(err));
+            } else {
+                handle = clCreateBuffer(in.context, CL_MEM_READ_WRITE, size, NULL, &err);
+                if (err != CL_SUCCESS)
+                    throw std::runtime_error("Cannot create cl buffer: " + std::to_string(err));
+                err = clEnqueueCopyBuffer(queue, in.handle, handle, i * size, 0, size, 0, NULL, NULL);
+                if (err != CL_SUCCESS) {
+                    clReleaseMemObject(handle);
+                    throw std::runtime_error("Cannot copy cl buffer: " + std::to_string(err));
+                }
+            }
+
+            const auto frame = xm::ocl::Image2D(in.cols, rows, in.channels, in.channel_size, handle, in.context, in.device);
+            frames.push_back(xm::ocl::iop::ClImagePromise(frame, queue).withCleanup(in_p));
+        }
+
+        return frames;
+    }
+
+    xm::ocl::iop::ClImagePromise blur(const iop::ClImagePromise &in, int kernel_size, int queue_index, int layers) {
+        if (in.getImage2D().on_host())
+            return blur(nullptr, in, kernel_size, layers);
+        auto queue = queue_index < 0 && in.queue() != nullptr
+                     ? in.queue()
+                     : Kernels::instance().retrieve_queue(queue_index);
+        return blur(queue, in, kernel_size, layers);
+    }
+
+    xm::ocl::iop::ClImagePromise blur(cl_command_queue queue, const iop::ClImagePromise &in_p, int kernel_size, int layers) {
         if (kernel_size < 3 || kernel_size % 2 == 0 || kernel_size > 31)
             throw std::runtime_error("Invalid kernel size: " + std::to_string(kernel_size));
 
         const auto &in = in_p.getImage2D();
+        const int rows = layer_rows(in, layers);
+        if (in.on_host()) {
+            auto out = xm::ocl::Image2D::allocate_like(in);
+            auto dst = xm::ocl::iop::to_host_mat(out);
+            xm::ocl::cpu::blur(xm::ocl::iop::to_host_mat(in), dst, kernel_size);
+            return xm::ocl::iop::ClImagePromise(out);
+        }
 
         const auto context = Kernels::instance().ocl_context;
         const auto pref_size = Kernels::instance().blur_local_size;
-        size_t l_size[2] = {pref_size, pref_size};
-        size_t g_size[2] = {xm::ocl::optimal_global_size((int) in.cols, pref_size),
-                            xm::ocl::optimal_global_size((int) in.rows, pref_size)};
 
         cl_int err;
 
@@ -199,7 +328,7 @@ namespace xm::ocl {
         cl_mem buffer_2 = clCreateBuffer(context, CL_MEM_READ_WRITE, in.size(), NULL, &err);
 
         auto width = (uint) in.cols;
-        auto height = (uint) in.rows;
+        auto height = (uint) rows;
         auto kh_size = (int) (kernel_size / 2);
 
         auto kernel_h = Kernels::instance().kernel_blur_h;
@@ -219,15 +348,9 @@ namespace xm::ocl {
         xm::ocl::set_kernel_arg(kernel_v, 4, sizeof(uint), &height);
         xm::ocl::set_kernel_arg(kernel_v, 5, sizeof(int), &kh_size);
 
-        xm::ocl::enqueue_kernel_fast(
-                queue, kernel_h, 2,
-                g_size,
-                l_size);
+        xm::ocl::tuner::enqueue_3d(queue, kernel_h, (int) in.cols, rows, layers, pref_size);
 
-        xm::ocl::enqueue_kernel_fast(
-                queue, kernel_v, 2,
-                g_size,
-                l_size);
+        xm::ocl::tuner::enqueue_3d(queue, kernel_v, (int) in.cols, rows, layers, pref_size);
 
         xm::ocl::Image2D image(in, buffer_2);
         return xm::ocl::iop::ClImagePromise(image, queue)
@@ -238,6 +361,13 @@ namespace xm::ocl {
     }
 
     void bgr_in_range_hls(const cv::Scalar &hls_low, const cv::Scalar &hls_up, const cv::UMat &in, cv::UMat &out, int queue_index) {
+        if (xm::ocl::cpu::enabled()) {
+            cv::Mat result;
+            xm::ocl::cpu::range_hls(in.getMat(cv::ACCESS_READ), result, hls_low, hls_up);
+            result.copyTo(out);
+            return;
+        }
+
         cv::UMat result(in.rows, in.cols, CV_8UC1, cv::USAGE_ALLOCATE_DEVICE_MEMORY);
 
         const auto queue = Kernels::instance().retrieve_queue(queue_index);
@@ -285,6 +415,13 @@ namespace xm::ocl {
         if (kernel_size < 3 || kernel_size % 2 == 0)
             throw std::runtime_error("Invalid kernel size: " + std::to_string(kernel_size));
 
+        if (xm::ocl::cpu::enabled()) {
+            cv::Mat result;
+            xm::ocl::cpu::dilate(in.getMat(cv::ACCESS_READ), result, iterations, kernel_size);
+            result.copyTo(out);
+            return;
+        }
+
         cv::UMat result_1(in.rows, in.cols, CV_8UC1, cv::USAGE_ALLOCATE_DEVICE_MEMORY);
         cv::UMat result_2(in.rows, in.cols, CV_8UC1, cv::USAGE_ALLOCATE_DEVICE_MEMORY);
 
@@ -349,6 +486,13 @@ namespace xm::ocl {
         if (kernel_size < 3 || kernel_size % 2 == 0)
             throw std::runtime_error("Invalid kernel size: " + std::to_string(kernel_size));
 
+        if (xm::ocl::cpu::enabled()) {
+            cv::Mat result;
+            xm::ocl::cpu::erode(in.getMat(cv::ACCESS_READ), result, iterations, kernel_size);
+            result.copyTo(out);
+            return;
+        }
+
         cv::UMat result_1(in.rows, in.cols, CV_8UC1, cv::USAGE_ALLOCATE_DEVICE_MEMORY);
         cv::UMat result_2(in.rows, in.cols, CV_8UC1, cv::USAGE_ALLOCATE_DEVICE_MEMORY);
 
@@ -410,6 +554,13 @@ namespace xm::ocl {
     }
 
     void apply_mask_with_color(const cv::Scalar &color, const cv::UMat &img, const cv::UMat &mask, cv::UMat &out, int queue_index) {
+        if (xm::ocl::cpu::enabled()) {
+            cv::Mat result;
+            xm::ocl::cpu::mask_apply(img.getMat(cv::ACCESS_READ), mask.getMat(cv::ACCESS_READ), result, color);
+            result.copyTo(out);
+            return;
+        }
+
         cv::UMat result(img.rows, img.cols, CV_8UC3, cv::USAGE_ALLOCATE_DEVICE_MEMORY);
 
         const auto queue = Kernels::instance().retrieve_queue(queue_index);
@@ -456,40 +607,125 @@ namespace xm::ocl {
         out = result;
     }
 
-    xm::ocl::iop::ClImagePromise chroma_key(cl_command_queue queue, const iop::ClImagePromise &in_p, const xm::ds::Color4u &hls_low, const xm::ds::Color4u &hls_up,
-                                            const xm::ds::Color4u &color, bool linear, int mask_size, int blur, int fine, int refine) {
+    void apply_segmentation(const float *logits, int seg_width, int seg_height, float threshold,
+                            float roi_x, float roi_y, float roi_w, float roi_h,
+                            const cv::UMat &img, cv::UMat &out) {
+        const auto t = std::clamp(threshold, 1e-6f, 1.f - 1e-6f);
+        auto threshold_logit = (float) std::log(t / (1.f - t));
+
+        if (xm::ocl::cpu::enabled()) {
+            cv::Mat result;
+            xm::ocl::cpu::segmentation_apply(logits, seg_width, seg_height, threshold_logit,
+                                             roi_x, roi_y, roi_w, roi_h, img.getMat(cv::ACCESS_READ), result);
+            result.copyTo(out);
+            return;
+        }
+
+        // reused between calls (per thread), logits are staged on the host,
+        // so the segmentation buffer can go back to its pool before the upload completes
+        thread_local cv::UMat buffer;
+        thread_local std::vector<float> staging;
+        thread_local cl_event staged = nullptr;
+
+        if (staged != nullptr) {
+            // previous upload is long done by now, it is waited for only to reuse staging memory
+            clWaitForEvents(1, &staged);
+            clReleaseEvent(staged);
+            staged = nullptr;
+        }
+
+        const cv::UMat source = img.isContinuous() ? img : img.clone();
+
+        // pixels are processed in place, so output must not share memory with the source
+        if (out.u != nullptr && out.u == source.u)
+            out.release();
+        out.create(source.rows, source.cols, source.type(), cv::USAGE_ALLOCATE_DEVICE_MEMORY);
+        buffer.create(seg_height, seg_width, CV_32F, cv::USAGE_ALLOCATE_DEVICE_MEMORY);
+
+        // source is produced on OpenCV's queue, so everything stays ordered there without host waits
+        const auto queue = (cl_command_queue) cv::ocl::Queue::getDefault().ptr();
+        const auto pref_size = Kernels::instance().segmentation_apply_local_size;
+        auto kernel = Kernels::instance().kernel_segmentation_apply;
+
+        auto buffer_logits = (cl_mem) buffer.handle(cv::ACCESS_WRITE);
+        auto buffer_image = (cl_mem) source.handle(cv::ACCESS_READ);
+        auto buffer_result = (cl_mem) out.handle(cv::ACCESS_WRITE);
+
+        // only network output travels to the device (64 KB at most)
+        const auto logits_n = (size_t) seg_width * seg_height;
+        staging.assign(logits, logits + logits_n);
+        if (clEnqueueWriteBuffer(queue, buffer_logits, CL_FALSE, 0, logits_n * sizeof(float), staging.data(),
+                                 0, nullptr, &staged) != CL_SUCCESS)
+            throw std::runtime_error("Cannot write segmentation logits to device");
+
+        auto seg_w = (uint) seg_width;
+        auto seg_h = (uint) seg_height;
+        auto width = (uint) source.cols;
+        auto height = (uint) source.rows;
+        auto channels = (uint) source.channels();
+
+        xm::ocl::set_kernel_arg(kernel, (cl_uint) 0, sizeof(cl_mem), &buffer_logits);
+        xm::ocl::set_kernel_arg(kernel, (cl_uint) 1, sizeof(cl_mem), &buffer_image);
+        xm::ocl::set_kernel_arg(kernel, (cl_uint) 2, sizeof(cl_mem), &buffer_result);
+        xm::ocl::set_kernel_arg(kernel, (cl_uint) 3, sizeof(uint), &seg_w);
+        xm::ocl::set_kernel_arg(kernel, (cl_uint) 4, sizeof(uint), &seg_h);
+        xm::ocl::set_kernel_arg(kernel, (cl_uint) 5, sizeof(uint), &width);
+        xm::ocl::set_kernel_arg(kernel, (cl_uint) 6, sizeof(uint), &height);
+        xm::ocl::set_kernel_arg(kernel, (cl_uint) 7, sizeof(uint), &channels);
+        xm::ocl::set_kernel_arg(kernel, (cl_uint) 8, sizeof(cl_float), &roi_x);
+        xm::ocl::set_kernel_arg(kernel, (cl_uint) 9, sizeof(cl_float), &roi_y);
+        xm::ocl::set_kernel_arg(kernel, (cl_uint) 10, sizeof(cl_float), &roi_w);
+        xm::ocl::set_kernel_arg(kernel, (cl_uint) 11, sizeof(cl_float), &roi_h);
+        xm::ocl::set_kernel_arg(kernel, (cl_uint) 12, sizeof(cl_float), &threshold_logit);
+
+        const auto event = xm::ocl::tuner::enqueue_2d(queue, kernel, source.cols, source.rows, pref_size, aux::DEBUG);
+        if (event != nullptr)
+            clReleaseEvent(event);
+    }
+
+    xm::ocl::iop::ClImagePromise chroma_mask(cl_command_queue queue, const iop::ClImagePromise &in_p, const xm::ds::Color4u &hls_low, const xm::ds::Color4u &hls_up,
+                                             bool linear, int mask_size, int blur, int fine, int refine, int layers) {
         const auto &in = in_p.getImage2D();
+        const int rows = layer_rows(in, layers);
 
-        const auto ratio = (float) in.cols / (float) in.rows;
+        const auto ratio = (float) in.cols / (float) rows;
         const auto n_w = mask_size;
         const auto n_h = (int) ((float) n_w / ratio);
 
-        // power_mask -> (erode_h -> erode_v) -> (dilate_h -> dilate_v) -> mask_apply
+        if (in.on_host()) {
+            auto out = xm::ocl::Image2D::allocate_host(n_w, n_h, 1, 1);
+            auto dst = xm::ocl::iop::to_host_mat(out);
+            xm::ocl::cpu::chroma_mask(xm::ocl::iop::to_host_mat(in), dst, hls_low, hls_up, linear, mask_size, blur, fine, refine);
+            return xm::ocl::iop::ClImagePromise(out);
+        }
+
+        // power_mask -> (erode_h -> erode_v) -> (dilate_h -> dilate_v)
 
         cl_int err;
 
         const auto context = Kernels::instance().ocl_context;
-        const auto inter_size = n_w * n_h * 1; // grayscale/black-white mask, only one channel
+        const auto inter_size = n_w * n_h * layers; // grayscale/black-white mask, only one channel
         const auto pref_size = Kernels::instance().mask_apply_local_size;
-        size_t l_size[2] = {pref_size, pref_size};
-        size_t g_size[2] = {xm::ocl::optimal_global_size(n_w, pref_size),
-                            xm::ocl::optimal_global_size(n_h, pref_size)};
+
+        // attached image object is sampled by hardware (same arguments, different kernel),
+        // it holds whole stack as one image, so stacked frames are read from the buffer
+        const bool sampled = in.has_image() && layers == 1;
 
         // ======= BUFFERS ALLOCATION !
-        cl_mem buffer_in = (cl_mem) in.handle;
+        cl_mem buffer_in = sampled ? in.image : in.handle;
         cl_mem buffer_blur = (cl_mem) Kernels::instance().blur_kernels[(blur - 1) / 2].handle;
         cl_mem buffer_io_1 = clCreateBuffer(context, CL_MEM_READ_WRITE, inter_size, NULL, &err);
         cl_mem buffer_io_2 = clCreateBuffer(context, CL_MEM_READ_WRITE, inter_size, NULL, &err);
-        cl_mem buffer_out = clCreateBuffer(context, CL_MEM_READ_WRITE, in.size(), NULL, &err);
 
 
         // ======= KERNELS ALLOCATION !
-        auto kernel_power_mask = Kernels::instance().kernel_power_mask;
+        auto kernel_power_mask = sampled
+                ? Kernels::instance().kernel_power_mask_image
+                : Kernels::instance().kernel_power_mask;
         auto kernel_erode_h = Kernels::instance().kernel_erode_h;
         auto kernel_erode_v = Kernels::instance().kernel_erode_v;
         auto kernel_dilate_h = Kernels::instance().kernel_dilate_h;
         auto kernel_dilate_v = Kernels::instance().kernel_dilate_v;
-        auto kernel_power_apply = Kernels::instance().kernel_power_apply;
 
 
         // ======= KERNEL PARAMETERS !
@@ -497,9 +733,9 @@ namespace xm::ocl {
         auto blur_kern_half_size = (int) (blur / 2);
         auto mask_height = (uint) n_h;
         auto mask_width = (uint) n_w;
-        auto out_height = (uint) in.rows;
+        auto out_height = (uint) rows;
         auto out_width = (uint) in.cols;
-        auto scale_h = (float) in.rows / (float) n_h;
+        auto scale_h = (float) rows / (float) n_h;
         auto scale_w = (float) in.cols / (float) n_w;
         auto lower_h = (uchar) hls_low.h;
         auto lower_l = (uchar) hls_low.l;
@@ -507,13 +743,8 @@ namespace xm::ocl {
         auto upper_h = (uchar) hls_up.h;
         auto upper_l = (uchar) hls_up.l;
         auto upper_s = (uchar) hls_up.s;
-        auto color_b = (uchar) color.b;
-        auto color_g = (uchar) color.g;
-        auto color_r = (uchar) color.r;
         auto is_linear = (uchar) linear ? 1 : 0;
         auto is_blur = (uchar) (blur >= 3);
-        auto dx = (uint) std::ceil(scale_w);
-        auto dy = (uint) std::ceil(scale_h);
 
 
         // ======= KERNEL ARGUMENTS !
@@ -564,88 +795,203 @@ namespace xm::ocl {
             xm::ocl::set_kernel_arg(kernel_dilate_v, 4, sizeof(uint), &mask_height);
         }
 
-        {
-            xm::ocl::set_kernel_arg(kernel_power_apply, 0, sizeof(cl_mem), &buffer_in);
-            xm::ocl::set_kernel_arg(kernel_power_apply, 1, sizeof(cl_mem), &buffer_io_1);
-            xm::ocl::set_kernel_arg(kernel_power_apply, 2, sizeof(cl_mem), &buffer_out);
-            xm::ocl::set_kernel_arg(kernel_power_apply, 3, sizeof(uint), &mask_width);
-            xm::ocl::set_kernel_arg(kernel_power_apply, 4, sizeof(uint), &mask_height);
-            xm::ocl::set_kernel_arg(kernel_power_apply, 5, sizeof(uint), &out_width);
-            xm::ocl::set_kernel_arg(kernel_power_apply, 6, sizeof(uint), &out_height);
-            xm::ocl::set_kernel_arg(kernel_power_apply, 7, sizeof(cl_float), &scale_w);
-            xm::ocl::set_kernel_arg(kernel_power_apply, 8, sizeof(cl_float), &scale_h);
-            xm::ocl::set_kernel_arg(kernel_power_apply, 9, sizeof(uint), &dx);
-            xm::ocl::set_kernel_arg(kernel_power_apply, 10, sizeof(uint), &dy);
-            xm::ocl::set_kernel_arg(kernel_power_apply, 11, sizeof(uchar), &color_b);
-            xm::ocl::set_kernel_arg(kernel_power_apply, 12, sizeof(uchar), &color_g);
-            xm::ocl::set_kernel_arg(kernel_power_apply, 13, sizeof(uchar), &color_r);
-        }
-
         // ======= KERNEL ENQUEUE !
-        xm::ocl::enqueue_kernel_fast(
-                queue,
-                kernel_power_mask,
-                2,
-                g_size,
-                l_size,
-                false);
+        xm::ocl::tuner::enqueue_3d(queue, kernel_power_mask, n_w, n_h, layers, pref_size);
 
-        for (int i = 0; i < refine; i++) {
-            xm::ocl::enqueue_kernel_fast(
-                    queue,
-                    kernel_erode_h,
-                    2,
-                    g_size,
-                    l_size,
-                    false);
-            xm::ocl::enqueue_kernel_fast(
-                    queue,
-                    kernel_erode_v,
-                    2,
-                    g_size,
-                    l_size,
-                    false);
+        for (int i = 0; i < refine && fine >= 3; i++) {
+            xm::ocl::tuner::enqueue_3d(queue, kernel_erode_h, n_w, n_h, layers, pref_size);
+            xm::ocl::tuner::enqueue_3d(queue, kernel_erode_v, n_w, n_h, layers, pref_size);
         }
 
-        for (int i = 0; i < refine; i++) {
-            xm::ocl::enqueue_kernel_fast(
-                    queue,
-                    kernel_dilate_h,
-                    2,
-                    g_size,
-                    l_size,
-                    false);
-            xm::ocl::enqueue_kernel_fast(
-                    queue,
-                    kernel_dilate_v,
-                    2,
-                    g_size,
-                    l_size,
-                    false);
+        for (int i = 0; i < refine && fine >= 3; i++) {
+            xm::ocl::tuner::enqueue_3d(queue, kernel_dilate_h, n_w, n_h, layers, pref_size);
+            xm::ocl::tuner::enqueue_3d(queue, kernel_dilate_v, n_w, n_h, layers, pref_size);
         }
 
-        xm::ocl::enqueue_kernel_fast(
-                queue,
-                kernel_power_apply,
-                2,
-                g_size,
-                l_size,
-                false);
-
-        return xm::ocl::iop::ClImagePromise(xm::ocl::Image2D(in, buffer_out), queue)
+        const auto mask = xm::ocl::Image2D(n_w, n_h * layers, 1, 1, buffer_io_1, in.context, in.device);
+        return xm::ocl::iop::ClImagePromise(mask, queue)
         .withCleanup(in_p)
-        .withCleanup(new std::function<void()>([buffer_io_1, buffer_io_2]() {
-            clReleaseMemObject(buffer_io_1);
+        .withCleanup(new std::function<void()>([buffer_io_2]() {
             clReleaseMemObject(buffer_io_2);
         }));
     }
 
+    xm::ocl::iop::ClImagePromise chroma_mask(const iop::ClImagePromise &in, const xm::ds::Color4u &hls_low, const xm::ds::Color4u &hls_up,
+                                             bool linear, int mask_size, int blur, int fine, int refine, int queue_index, int layers) {
+        if (in.getImage2D().on_host())
+            return chroma_mask(nullptr, in, hls_low, hls_up, linear, mask_size, blur, fine, refine, layers);
+        auto queue = queue_index < 0 && in.queue() != nullptr
+                     ? in.queue()
+                     : Kernels::instance().retrieve_queue(queue_index);
+        return chroma_mask(queue, in, hls_low, hls_up, linear, mask_size, blur, fine, refine, layers);
+    }
+
+    xm::ocl::iop::ClImagePromise chroma_apply(cl_command_queue queue, const iop::ClImagePromise &in_p, const iop::ClImagePromise &mask_p,
+                                              const xm::ds::Color4u &color, int layers) {
+        const auto &in = in_p.getImage2D();
+        const auto &mask = mask_p.getImage2D();
+        const int rows = layer_rows(in, layers);
+        const int mask_rows = layer_rows(mask, layers);
+
+        if (in.on_host()) {
+            auto out = xm::ocl::Image2D::allocate_like(in);
+            auto dst = xm::ocl::iop::to_host_mat(out);
+            xm::ocl::cpu::chroma_apply(xm::ocl::iop::to_host_mat(in), xm::ocl::iop::to_host_mat(mask), dst, color);
+            return xm::ocl::iop::ClImagePromise(out);
+        }
+
+        const auto pref_size = Kernels::instance().mask_apply_local_size;
+
+        cl_int err;
+
+        cl_mem buffer_in = in.handle;
+        cl_mem buffer_mask = mask.handle;
+        cl_mem buffer_out = clCreateBuffer(in.context, CL_MEM_READ_WRITE, in.size(), NULL, &err);
+
+        auto kernel_power_apply = Kernels::instance().kernel_power_apply;
+
+        auto mask_height = (uint) mask_rows;
+        auto mask_width = (uint) mask.cols;
+        auto out_height = (uint) rows;
+        auto out_width = (uint) in.cols;
+        auto scale_h = (float) rows / (float) mask_rows;
+        auto scale_w = (float) in.cols / (float) mask.cols;
+        auto color_b = (uchar) color.b;
+        auto color_g = (uchar) color.g;
+        auto color_r = (uchar) color.r;
+        auto dx = (uint) std::ceil(scale_w);
+        auto dy = (uint) std::ceil(scale_h);
+
+        xm::ocl::set_kernel_arg(kernel_power_apply, 0, sizeof(cl_mem), &buffer_in);
+        xm::ocl::set_kernel_arg(kernel_power_apply, 1, sizeof(cl_mem), &buffer_mask);
+        xm::ocl::set_kernel_arg(kernel_power_apply, 2, sizeof(cl_mem), &buffer_out);
+        xm::ocl::set_kernel_arg(kernel_power_apply, 3, sizeof(uint), &mask_width);
+        xm::ocl::set_kernel_arg(kernel_power_apply, 4, sizeof(uint), &mask_height);
+        xm::ocl::set_kernel_arg(kernel_power_apply, 5, sizeof(uint), &out_width);
+        xm::ocl::set_kernel_arg(kernel_power_apply, 6, sizeof(uint), &out_height);
+        xm::ocl::set_kernel_arg(kernel_power_apply, 7, sizeof(cl_float), &scale_w);
+        xm::ocl::set_kernel_arg(kernel_power_apply, 8, sizeof(cl_float), &scale_h);
+        xm::ocl::set_kernel_arg(kernel_power_apply, 9, sizeof(uint), &dx);
+        xm::ocl::set_kernel_arg(kernel_power_apply, 10, sizeof(uint), &dy);
+        xm::ocl::set_kernel_arg(kernel_power_apply, 11, sizeof(uchar), &color_b);
+        xm::ocl::set_kernel_arg(kernel_power_apply, 12, sizeof(uchar), &color_g);
+        xm::ocl::set_kernel_arg(kernel_power_apply, 13, sizeof(uchar), &color_r);
+
+        xm::ocl::tuner::enqueue_3d(queue, kernel_power_apply, (int) mask.cols, mask_rows, layers, pref_size);
+
+        return xm::ocl::iop::ClImagePromise(xm::ocl::Image2D(in, buffer_out), queue)
+        .withCleanup(in_p)
+        .withCleanup(mask_p);
+    }
+
+    xm::ocl::iop::ClImagePromise chroma_apply(const iop::ClImagePromise &in, const iop::ClImagePromise &mask, const xm::ds::Color4u &color,
+                                              int queue_index, int layers) {
+        if (in.getImage2D().on_host())
+            return chroma_apply(nullptr, in, mask, color, layers);
+        auto queue = queue_index < 0 && in.queue() != nullptr
+                     ? in.queue()
+                     : Kernels::instance().retrieve_queue(queue_index);
+        return chroma_apply(queue, in, mask, color, layers);
+    }
+
+    xm::ocl::iop::ClImagePromise chroma_key(cl_command_queue queue, const iop::ClImagePromise &in_p, const xm::ds::Color4u &hls_low, const xm::ds::Color4u &hls_up,
+                                            const xm::ds::Color4u &color, bool linear, int mask_size, int blur, int fine, int refine,
+                                            int layers) {
+        // (power_mask -> erode -> dilate) -> power_apply
+        const auto mask = chroma_mask(queue, in_p, hls_low, hls_up, linear, mask_size, blur, fine, refine, layers);
+        return chroma_apply(queue, in_p, mask, color, layers);
+    }
+
+    xm::ocl::iop::ClImagePromise chroma_blob(cl_command_queue queue, const iop::ClImagePromise &in_p, const iop::ClImagePromise &mask_p,
+                                             const xm::ds::Color4u &color, float roi_x, float roi_y, float roi_w, float roi_h,
+                                             int width, int height) {
+        const auto &in = in_p.getImage2D();
+        const auto &mask = mask_p.getImage2D();
+
+        if (in.on_host()) {
+            auto out = xm::ocl::Image2D::allocate_host(width, height, 3, sizeof(float));
+            auto dst = xm::ocl::iop::to_host_mat(out, CV_32FC3);
+            xm::ocl::cpu::chroma_blob(xm::ocl::iop::to_host_mat(in), xm::ocl::iop::to_host_mat(mask), dst, color,
+                                      roi_x, roi_y, roi_w, roi_h, width, height);
+            return xm::ocl::iop::ClImagePromise(out);
+        }
+
+        const auto pref_size = Kernels::instance().power_blob_local_size;
+
+        // letterbox, same paddings as in eox::dnn::get_letterbox_paddings
+        const float box_scale = std::min((float) width / roi_w, (float) height / roi_h);
+        const int n_w = (int) (roi_w * box_scale);
+        const int n_h = (int) (roi_h * box_scale);
+
+        cl_int err;
+
+        const auto out_size = width * height * 3 * sizeof(float);
+
+        cl_mem buffer_in = in.handle;
+        cl_mem buffer_mask = mask.handle;
+        cl_mem buffer_out = clCreateBuffer(in.context, CL_MEM_READ_WRITE, out_size, NULL, &err);
+
+        auto kernel_power_blob = Kernels::instance().kernel_power_blob;
+
+        auto input_w = (uint) in.cols;
+        auto input_h = (uint) in.rows;
+        auto mask_w = (uint) mask.cols;
+        auto mask_h = (uint) mask.rows;
+        auto output_w = (uint) width;
+        auto output_h = (uint) height;
+        auto pad_x = (float) (int) ((float) (width - n_w) / 2.f);
+        auto pad_y = (float) (int) ((float) (height - n_h) / 2.f);
+        auto scale = 1.f / box_scale;
+        auto color_b = (uchar) color.b;
+        auto color_g = (uchar) color.g;
+        auto color_r = (uchar) color.r;
+
+        xm::ocl::set_kernel_arg(kernel_power_blob, 0, sizeof(cl_mem), &buffer_in);
+        xm::ocl::set_kernel_arg(kernel_power_blob, 1, sizeof(cl_mem), &buffer_mask);
+        xm::ocl::set_kernel_arg(kernel_power_blob, 2, sizeof(cl_mem), &buffer_out);
+        xm::ocl::set_kernel_arg(kernel_power_blob, 3, sizeof(uint), &input_w);
+        xm::ocl::set_kernel_arg(kernel_power_blob, 4, sizeof(uint), &input_h);
+        xm::ocl::set_kernel_arg(kernel_power_blob, 5, sizeof(uint), &mask_w);
+        xm::ocl::set_kernel_arg(kernel_power_blob, 6, sizeof(uint), &mask_h);
+        xm::ocl::set_kernel_arg(kernel_power_blob, 7, sizeof(uint), &output_w);
+        xm::ocl::set_kernel_arg(kernel_power_blob, 8, sizeof(uint), &output_h);
+        xm::ocl::set_kernel_arg(kernel_power_blob, 9, sizeof(float), &roi_x);
+        xm::ocl::set_kernel_arg(kernel_power_blob, 10, sizeof(float), &roi_y);
+        xm::ocl::set_kernel_arg(kernel_power_blob, 11, sizeof(float), &roi_w);
+        xm::ocl::set_kernel_arg(kernel_power_blob, 12, sizeof(float), &roi_h);
+        xm::ocl::set_kernel_arg(kernel_power_blob, 13, sizeof(float), &pad_x);
+        xm::ocl::set_kernel_arg(kernel_power_blob, 14, sizeof(float), &pad_y);
+        xm::ocl::set_kernel_arg(kernel_power_blob, 15, sizeof(float), &scale);
+        xm::ocl::set_kernel_arg(kernel_power_blob, 16, sizeof(uchar), &color_b);
+        xm::ocl::set_kernel_arg(kernel_power_blob, 17, sizeof(uchar), &color_g);
+        xm::ocl::set_kernel_arg(kernel_power_blob, 18, sizeof(uchar), &color_r);
+
+        cl_event blob_event = xm::ocl::tuner::enqueue_2d(queue, kernel_power_blob, width, height, pref_size, aux::DEBUG);
+
+        const auto blob = xm::ocl::Image2D(width, height, 3, sizeof(float), buffer_out, in.context, in.device);
+        return xm::ocl::iop::ClImagePromise(blob, queue, blob_event)
+        .withCleanup(in_p)
+        .withCleanup(mask_p);
+    }
+
+    xm::ocl::iop::ClImagePromise chroma_blob(const iop::ClImagePromise &in, const iop::ClImagePromise &mask, const xm::ds::Color4u &color,
+                                             float roi_x, float roi_y, float roi_w, float roi_h, int width, int height, int queue_index) {
+        if (in.getImage2D().on_host())
+            return chroma_blob(nullptr, in, mask, color, roi_x, roi_y, roi_w, roi_h, width, height);
+        auto queue = queue_index < 0 && in.queue() != nullptr
+                     ? in.queue()
+                     : Kernels::instance().retrieve_queue(queue_index);
+        return chroma_blob(queue, in, mask, color, roi_x, roi_y, roi_w, roi_h, width, height);
+    }
+
     xm::ocl::iop::ClImagePromise chroma_key(const iop::ClImagePromise &in, const xm::ds::Color4u &hls_low, const xm::ds::Color4u &hls_up, const xm::ds::Color4u &color,
-                    bool linear, int mask_size, int blur, int fine, int refine, int queue_index) {
+                    bool linear, int mask_size, int blur, int fine, int refine, int queue_index, int layers) {
+        if (in.getImage2D().on_host())
+            return chroma_key(nullptr, in, hls_low, hls_up, color, linear, mask_size, blur, fine, refine, layers);
         auto queue = queue_index < 0 && in.queue() != nullptr
                      ? in.queue()
                      : Kernels::instance().retrieve_queue(queue_index);
-        return chroma_key(queue, in, hls_low, hls_up, color, linear, mask_size, blur, fine, refine);
+        return chroma_key(queue, in, hls_low, hls_up, color, linear, mask_size, blur, fine, refine, layers);
     }
 
     xm::ocl::iop::ClImagePromise chroma_key_single_pass(
@@ -656,21 +1002,31 @@ namespace xm::ocl {
             const xm::ds::Color4u &color,
             bool linear,
             int mask_size,
-            int blur
+            int blur,
+            int layers
     ) {
         const auto &in = in_p.getImage2D();
+        const int rows = layer_rows(in, layers);
+
+        if (in.on_host()) {
+            // same as chroma_mask without morphology
+            cv::Mat mask;
+            auto out = xm::ocl::Image2D::allocate_like(in);
+            auto dst = xm::ocl::iop::to_host_mat(out);
+            const auto src = xm::ocl::iop::to_host_mat(in);
+            xm::ocl::cpu::chroma_mask(src, mask, hls_low, hls_up, linear, mask_size, blur, 0, 0);
+            xm::ocl::cpu::chroma_apply(src, mask, dst, color);
+            return xm::ocl::iop::ClImagePromise(out);
+        }
 
         const auto kernel_blur_buffer = Kernels::instance().blur_kernels[(blur - 1) / 2];
-        const auto ratio = (float) in.cols / (float) in.rows;
+        const auto ratio = (float) in.cols / (float) rows;
         const auto n_w = mask_size;
         const auto n_h = (int) ((float) n_w / ratio);
 
         const auto context = in.context;
         const auto inter_size = in.cols * in.rows * 3;
         const auto pref_size = Kernels::instance().power_chroma_local_size;
-        size_t l_size[2] = {pref_size, pref_size};
-        size_t g_size[2] = {xm::ocl::optimal_global_size(n_w, pref_size),
-                            xm::ocl::optimal_global_size(n_h, pref_size)};
 
         // resize -> (blur_h -> blur_v) -> range_hls -> mask_apply
         cl_int err;
@@ -684,9 +1040,9 @@ namespace xm::ocl {
         auto blur_kern_half_size = (int) (blur / 2);
         auto mask_height = (uint) n_h;
         auto mask_width = (uint) n_w;
-        auto out_height = (uint) in.rows;
+        auto out_height = (uint) rows;
         auto out_width = (uint) in.cols;
-        auto scale_h = (float) in.rows / (float) n_h;
+        auto scale_h = (float) rows / (float) n_h;
         auto scale_w = (float) in.cols / (float) n_w;
         auto lower_h = (uchar) hls_low.h;
         auto lower_l = (uchar) hls_low.l;
@@ -731,13 +1087,7 @@ namespace xm::ocl {
         xm::ocl::set_kernel_arg(kernel_chroma, 21, sizeof(uint), &dx);
         xm::ocl::set_kernel_arg(kernel_chroma, 22, sizeof(uint), &dy);
 
-        cl_event chroma_event = xm::ocl::enqueue_kernel_fast(
-                queue,
-                kernel_chroma,
-                2,
-                g_size,
-                l_size,
-                aux::DEBUG);
+        cl_event chroma_event = xm::ocl::tuner::enqueue_3d(queue, kernel_chroma, n_w, n_h, layers, pref_size, aux::DEBUG);
 
         return xm::ocl::iop::ClImagePromise(xm::ocl::Image2D(in, buffer_out), queue, chroma_event)
         .withCleanup(in_p);
@@ -745,32 +1095,141 @@ namespace xm::ocl {
 
     xm::ocl::iop::ClImagePromise chroma_key_single_pass(const iop::ClImagePromise &in, const xm::ds::Color4u &hls_low, const xm::ds::Color4u &hls_up,
                                                         const xm::ds::Color4u &color, bool linear, int mask_size, int blur,
-                                                        int queue_index) {
+                                                        int queue_index, int layers) {
+        if (in.getImage2D().on_host())
+            return chroma_key_single_pass(nullptr, in, hls_low, hls_up, color, linear, mask_size, blur, layers);
+        auto queue = queue_index < 0 && in.queue() != nullptr
+                     ? in.queue()
+                     : Kernels::instance().retrieve_queue(queue_index);
+        return chroma_key_single_pass(queue, in, hls_low, hls_up, color, linear, mask_size, blur, layers);
+    }
+
+    xm::ocl::iop::ClImagePromise attach_image(const iop::ClImagePromise &in, int queue_index) {
+        if (in.getImage2D().on_host())
+            return attach_image(nullptr, in);
         auto queue = queue_index < 0 && in.queue() != nullptr
                      ? in.queue()
                      : Kernels::instance().retrieve_queue(queue_index);
-        return chroma_key_single_pass(queue, in, hls_low, hls_up, color, linear, mask_size, blur);
+        return attach_image(queue, in);
+    }
+
+    xm::ocl::iop::ClImagePromise attach_image(cl_command_queue queue, const iop::ClImagePromise &in_p) {
+        const auto &in = in_p.getImage2D();
+
+        // CPU backend samples host memory directly
+        if (in.on_host() || in.has_image())
+            return in_p;
+
+        if (in.channel_size != 1)
+            throw std::invalid_argument("Image objects are supported for uchar images only");
+
+        cl_event event = nullptr;
+        cl_mem image = xm::ocl::Image2D::allocate_image(in.cols, in.rows, in.channels, in.context);
+
+        if (in.channels == 3) {
+            // packed BGR -> RGBA texels (BGR in RGB channels)
+            event = packed_to_image(queue, in, image, false);
+        } else {
+            // same memory layout, plain copy
+            const size_t origin[3] = {0, 0, 0};
+            const size_t region[3] = {in.cols, in.rows, 1};
+            const cl_int err = clEnqueueCopyBufferToImage(queue, in.handle, image, 0, origin, region, 0, NULL, NULL);
+            if (err != CL_SUCCESS) {
+                clReleaseMemObject(image);
+                throw std::runtime_error("Cannot copy cl buffer to image: " + std::to_string(err));
+            }
+        }
+
+        xm::ocl::Image2D out = in;
+        out.image = image;
+        return xm::ocl::iop::ClImagePromise(out, queue, event)
+                .withCleanup(in_p);
     }
 
-    xm::ocl::iop::ClImagePromise flip_rotate(const iop::ClImagePromise &in, bool flip_x, bool flip_y, bool rotate, int queue_index) {
+    xm::ocl::iop::ClImagePromise image_to_packed(const iop::ClImagePromise &in, int queue_index) {
+        if (in.getImage2D().on_host())
+            return image_to_packed(nullptr, in);
+        auto queue = queue_index < 0 && in.queue() != nullptr
+                     ? in.queue()
+                     : Kernels::instance().retrieve_queue(queue_index);
+        return image_to_packed(queue, in);
+    }
+
+    xm::ocl::iop::ClImagePromise image_to_packed(cl_command_queue queue, const iop::ClImagePromise &in_p) {
+        const auto &in = in_p.getImage2D();
+
+        if (in.on_host())
+            return in_p;
+
+        if (!in.has_image())
+            throw std::invalid_argument("Image object is not attached");
+
+        cl_int err;
+        cl_event event = nullptr;
+        cl_mem image_in = in.image;
+        cl_mem buffer_out = clCreateBuffer(in.context, CL_MEM_READ_WRITE, in.size(), NULL, &err);
+        if (err != CL_SUCCESS)
+            throw std::runtime_error("Cannot create cl buffer: " + std::to_string(err));
+
+        if (in.channels == 3) {
+            const auto kernel = Kernels::instance().kernel_image_to_packed;
+            const auto pref_size = Kernels::instance().packed_to_image_local_size;
+            auto width = (uint) in.cols;
+            auto height = (uint) in.rows;
+
+            xm::ocl::set_kernel_arg(kernel, 0, sizeof(cl_mem), &image_in);
+            xm::ocl::set_kernel_arg(kernel, 1, sizeof(cl_mem), &buffer_out);
+            xm::ocl::set_kernel_arg(kernel, 2, sizeof(uint), &width);
+            xm::ocl::set_kernel_arg(kernel, 3, sizeof(uint), &height);
+
+            event = xm::ocl::tuner::enqueue_2d(queue, kernel, (int) in.cols, (int) in.rows, pref_size, aux::DEBUG);
+        } else {
+            const size_t origin[3] = {0, 0, 0};
+            const size_t region[3] = {in.cols, in.rows, 1};
+            err = clEnqueueCopyImageToBuffer(queue, image_in, buffer_out, origin, region, 0, 0, NULL, NULL);
+            if (err != CL_SUCCESS) {
+                clReleaseMemObject(buffer_out);
+                throw std::runtime_error("Cannot copy cl image to buffer: " + std::to_string(err));
+            }
+        }
+
+        return xm::ocl::iop::ClImagePromise(xm::ocl::Image2D(in, buffer_out), queue, event)
+                .withCleanup(in_p);
+    }
+
+    xm::ocl::iop::ClImagePromise flip_rotate(const iop::ClImagePromise &in, bool flip_x, bool flip_y, bool rotate, int queue_index,
+                                             bool image, int layers) {
+        if (in.getImage2D().on_host())
+            return flip_rotate(nullptr, in, flip_x, flip_y, rotate, image, layers);
         auto queue = queue_index < 0 && in.queue() != nullptr
                 ? in.queue()
                 : Kernels::instance().retrieve_queue(queue_index);
-        return flip_rotate(queue, in, flip_x, flip_y, rotate);
+        return flip_rotate(queue, in, flip_x, flip_y, rotate, image, layers);
     }
 
-    xm::ocl::iop::ClImagePromise flip_rotate(cl_command_queue queue, const iop::ClImagePromise &in_p, bool flip_x, bool flip_y, bool rotate) {
+    xm::ocl::iop::ClImagePromise flip_rotate(cl_command_queue queue, const iop::ClImagePromise &in_p, bool flip_x, bool flip_y, bool rotate,
+                                             bool image, int layers) {
         const auto &in = in_p.getImage2D();
+        const int rows = layer_rows(in, layers);
+
+        if (image && layers > 1)
+            throw std::invalid_argument("Image objects of stacked frames are not supported");
+
+        if (in.on_host()) {
+            auto out = xm::ocl::Image2D::allocate_host(rotate ? in.rows : in.cols, rotate ? in.cols : in.rows,
+                                                       in.channels, in.channel_size);
+            auto dst = xm::ocl::iop::to_host_mat(out);
+            xm::ocl::cpu::flip_rotate(xm::ocl::iop::to_host_mat(in), dst, flip_x, flip_y, rotate);
+            return xm::ocl::iop::ClImagePromise(out);
+        }
 
         const auto context = in.context;
-        const auto kernel = Kernels::instance().kernel_flip_rotate;
+        const auto kernel = image
+                ? Kernels::instance().kernel_flip_rotate_image
+                : Kernels::instance().kernel_flip_rotate;
         const auto pref_size = Kernels::instance().flip_rotate_local_size;
         const auto inter_size = in.cols * in.rows * in.channels;
 
-        size_t l_size[2] = {pref_size, pref_size};
-        size_t g_size[2] = {xm::ocl::optimal_global_size((int) in.cols, pref_size),
-                            xm::ocl::optimal_global_size((int) in.rows, pref_size)};
-
         cl_int err;
         cl_mem buffer_in = in.handle;
         cl_mem buffer_out = clCreateBuffer(context, CL_MEM_READ_WRITE, inter_size, NULL, &err);
@@ -778,35 +1237,38 @@ namespace xm::ocl {
             throw std::runtime_error("Cannot create cl buffer: " + std::to_string(err));
 
         auto width = (int) in.cols;
-        auto height = (int) in.rows;
+        auto height = (int) rows;
         auto c_size = (int) in.channels;
         auto _x = (int) (flip_x ? 1 : 0);
         auto _y = (int) (flip_y ? 1 : 0);
         auto _r = (int) (rotate ? 1 : 0);
 
-        xm::ocl::set_kernel_arg(kernel, 0, sizeof(cl_mem), &buffer_in);
-        xm::ocl::set_kernel_arg(kernel, 1, sizeof(cl_mem), &buffer_out);
-        xm::ocl::set_kernel_arg(kernel, 2, sizeof(int), &width);
-        xm::ocl::set_kernel_arg(kernel, 3, sizeof(int), &height);
-        xm::ocl::set_kernel_arg(kernel, 4, sizeof(int), &c_size);
-        xm::ocl::set_kernel_arg(kernel, 5, sizeof(int), &_x);
-        xm::ocl::set_kernel_arg(kernel, 6, sizeof(int), &_y);
-        xm::ocl::set_kernel_arg(kernel, 7, sizeof(int), &_r);
-
-        cl_event flip_rotate_event = xm::ocl::enqueue_kernel_fast(
-                queue,
-                kernel,
-                2,
-                g_size,
-                l_size,
-                aux::DEBUG);
-
-        return xm::ocl::iop::ClImagePromise(xm::ocl::Image2D(
+        // packed output and its image object are written in the same pass
+        cl_mem image_out = image
+                ? xm::ocl::Image2D::allocate_image(rotate ? in.rows : in.cols, rotate ? in.cols : in.rows, in.channels, context)
+                : nullptr;
+
+        cl_uint idx = 0;
+        idx = xm::ocl::set_kernel_arg(kernel, idx, sizeof(cl_mem), &buffer_in);
+        idx = xm::ocl::set_kernel_arg(kernel, idx, sizeof(cl_mem), &buffer_out);
+        if (image)
+            idx = xm::ocl::set_kernel_arg(kernel, idx, sizeof(cl_mem), &image_out);
+        idx = xm::ocl::set_kernel_arg(kernel, idx, sizeof(int), &width);
+        idx = xm::ocl::set_kernel_arg(kernel, idx, sizeof(int), &height);
+        idx = xm::ocl::set_kernel_arg(kernel, idx, sizeof(int), &c_size);
+        idx = xm::ocl::set_kernel_arg(kernel, idx, sizeof(int), &_x);
+        idx = xm::ocl::set_kernel_arg(kernel, idx, sizeof(int), &_y);
+        idx = xm::ocl::set_kernel_arg(kernel, idx, sizeof(int), &_r);
+
+        cl_event flip_rotate_event = xm::ocl::tuner::enqueue_3d(queue, kernel, width, height, layers, pref_size, aux::DEBUG);
+
+        auto out = xm::ocl::Image2D(
                 rotate ? height : width,
-                rotate ? width : height,
+                (rotate ? width : height) * layers,
                 in.channels, in.channel_size,
-                buffer_out, in.context, in.device, xm::ocl::ACCESS::RW),
-                                            queue, flip_rotate_event)
+                buffer_out, in.context, in.device, xm::ocl::ACCESS::RW);
+        out.image = image_out;
+        return xm::ocl::iop::ClImagePromise(out, queue, flip_rotate_event)
                 .withCleanup(in_p);
     }
 
@@ -3,10 +3,25 @@
 //
 
 #include <opencv2/core/ocl.hpp>
+#include <cstring>
 #include "../../xmotion/core/ocl/ocl_interop.h"
+#include "../../xmotion/core/ocl/ocl_cpu.h"
 
 namespace xm::ocl::iop {
 
+    namespace {
+        xm::ocl::Image2D host_copy(const cv::Mat &mat, xm::ocl::ACCESS access) {
+            auto image = xm::ocl::Image2D::allocate_host(
+                    mat.cols,
+                    mat.rows,
+                    (size_t) mat.channels(),
+                    mat.elemSize1(),
+                    access);
+            mat.copyTo(to_host_mat(image, mat.type()));
+            return image;
+        }
+    }
+
     cv::AccessFlag access_to_cv(ACCESS access) {
         if (access == ACCESS::RW)
             return cv::ACCESS_RW;
@@ -28,6 +43,9 @@ namespace xm::ocl::iop {
     }
 
     xm::ocl::Image2D from_cv_mat(const cv::Mat &mat, cl_context context, cl_device_id device, xm::ocl::ACCESS access) {
+        if (xm::ocl::cpu::enabled())
+            return host_copy(mat, access);
+
         cl_int err;
         cl_mem buffer = clCreateBuffer(context, access_to_cl(access), mat.total() * mat.elemSize(), mat.data, &err);
         if (err != CL_SUCCESS)
@@ -44,6 +62,8 @@ namespace xm::ocl::iop {
     }
 
     xm::ocl::Image2D from_cv_mat(const cv::Mat &source, xm::ocl::ACCESS modifier) {
+        if (xm::ocl::cpu::enabled())
+            return host_copy(source, modifier);
         return from_cv_mat(
                 source,
                 (cl_context) cv::ocl::Context::getDefault().ptr(),
@@ -52,6 +72,8 @@ namespace xm::ocl::iop {
     }
 
     ClImagePromise from_cv_mat(const cv::Mat &source, cl_command_queue command_queue, ACCESS modifier) {
+        if (xm::ocl::cpu::enabled())
+            return ClImagePromise(host_copy(source, modifier));
         return from_cv_mat(
                 source,
                 (cl_context) cv::ocl::Context::getDefault().ptr(),
@@ -62,6 +84,9 @@ namespace xm::ocl::iop {
 
     ClImagePromise from_cv_mat(const cv::Mat &mat, cl_context context,
                                cl_device_id device, cl_command_queue queue, ACCESS access) {
+        if (xm::ocl::cpu::enabled() || queue == nullptr)
+            return ClImagePromise(host_copy(mat, access));
+
         cl_int err;
         size_t size = mat.total() * mat.elemSize();
         cl_mem buffer = clCreateBuffer(context, access_to_cl(access), size, nullptr, &err);
@@ -88,6 +113,8 @@ namespace xm::ocl::iop {
     }
 
     xm::ocl::Image2D from_cv_umat(const cv::UMat &source, ACCESS modifier) {
+        if (xm::ocl::cpu::enabled())
+            return host_copy(source.getMat(cv::ACCESS_READ), modifier);
         return from_cv_umat(
                 source,
                 (cl_context) cv::ocl::Context::getDefault().ptr(),
@@ -96,6 +123,8 @@ namespace xm::ocl::iop {
     }
 
     xm::ocl::Image2D from_cv_umat(const cv::UMat &mat, cl_context context, cl_device_id device, ACCESS access) {
+        if (xm::ocl::cpu::enabled())
+            return host_copy(mat.getMat(cv::ACCESS_READ), access);
         return xm::ocl::Image2D(
                 mat.cols,
                 mat.rows,
@@ -114,15 +143,35 @@ namespace xm::ocl::iop {
     }
 
     void to_cv_umat(const Image2D &image, cv::UMat &out, int cv_type) {
+        if (image.on_host()) {
+            to_host_mat(image, cv_type).copyTo(out);
+            return;
+        }
         cv::ocl::convertFromBuffer(image.handle,
-                                   image.channels * image.cols,
+                                   image.channels * image.channel_size * image.cols,
                                    (int) image.rows,
                                    (int) image.cols,
                                    (cv_type < 0 ? (CV_8UC((int) image.channels)) : cv_type),
                                    out);
     }
 
+    cv::Mat to_host_mat(const Image2D &image, int cv_type) {
+        if (!image.on_host())
+            throw std::invalid_argument("Image is not stored in host memory");
+        return cv::Mat((int) image.rows,
+                       (int) image.cols,
+                       (cv_type < 0 ? (CV_8UC((int) image.channels)) : cv_type),
+                       image.data(),
+                       image.channels * image.channel_size * image.cols);
+    }
+
     ClImagePromise copy_ocl(const Image2D &image, cl_command_queue queue, xm::ocl::ACCESS access) {
+        if (image.on_host()) {
+            auto copy = Image2D::allocate_like(image, access);
+            std::memcpy(copy.data(), image.data(), image.size());
+            return ClImagePromise(copy);
+        }
+
         cl_int err;
         cl_mem buffer = clCreateBuffer(image.context,
                                        access_to_cl(access), image.size(), nullptr, &err);
@@ -142,8 +191,17 @@ namespace xm::ocl::iop {
     ClImagePromise copy_ocl(const Image2D &image, cl_command_queue queue,
                             int xo, int yo, int width, int height,
                             ACCESS access) {
-        cl_int err;
         const size_t c_size = image.channels * image.channel_size;
+        if (image.on_host()) {
+            auto crop = Image2D::allocate_host(width, height, image.channels, image.channel_size, access);
+            for (size_t row = 0; row < height; row++)
+                std::memcpy(crop.data() + row * width * c_size,
+                            image.data() + ((yo + row) * image.cols + xo) * c_size,
+                            width * c_size);
+            return ClImagePromise(crop);
+        }
+
+        cl_int err;
         const size_t size = (size_t) width * (size_t) height * c_size;
         cl_mem buffer = clCreateBuffer(image.context, access_to_cl(access), size,
                                        nullptr, &err);
@@ -186,6 +244,9 @@ namespace xm::ocl::iop {
     }
 
     CLPromise<cv::Mat> to_cv_mat(const Image2D &image, cl_command_queue queue, int cv_type) {
+        if (image.on_host())
+            return CLPromise<cv::Mat>(to_host_mat(image, cv_type).clone());
+
         cl_int err;
         cv::Mat dst((int) image.rows, (int) image.cols, (cv_type < 0 ? (CV_8UC((int) image.channels)) : cv_type));
         err = clEnqueueReadBuffer(queue,
@@ -232,6 +293,8 @@ namespace xm::ocl::iop {
     }
 
     cv::Mat ClImagePromise::getMat() const {
+        if (image.on_host())
+            return xm::ocl::iop::to_host_mat(image).clone();
         cv::UMat u_mat;
         xm::ocl::iop::to_cv_umat(image, u_mat);
         cv::Mat mat;
@@ -240,6 +303,10 @@ namespace xm::ocl::iop {
     }
 
     void ClImagePromise::toMat(cv::Mat &mat) const {
+        if (image.on_host()) {
+            xm::ocl::iop::to_host_mat(image).copyTo(mat);
+            return;
+        }
         cv::UMat u_mat;
         xm::ocl::iop::to_cv_umat(image, u_mat);
         u_mat.copyTo(mat);
@@ -258,7 +325,7 @@ namespace xm::ocl::iop {
             return *this;
         {
             cl_int err;
-            err = clFinish(ocl_queue);
+            err = ocl_queue == nullptr ? CL_SUCCESS : clFinish(ocl_queue);
             if (err != CL_SUCCESS)
                 throw std::runtime_error("Cannot finish command queue: " + std::to_string(err));
             completed = true;
@@ -271,6 +338,17 @@ namespace xm::ocl::iop {
         return *this;
     }
 
+    ClImagePromise &ClImagePromise::resolve() {
+        if (completed)
+            return *this;
+        completed = true;
+        if (cleanup_container) {
+            (*cleanup_container)();
+            cleanup_container = nullptr;
+        }
+        return *this;
+    }
+
     ClImagePromise &ClImagePromise::withCleanup(std::function<void()> *cb_ptr) {
         if (!cb_ptr)
             return *this;
@@ -338,7 +416,8 @@ namespace xm::ocl::iop {
         ocl_queue = other.ocl_queue;
         ocl_event = other.ocl_event;
         image = other.image;
-        clRetainEvent(ocl_event);
+        if (ocl_event != nullptr)
+            clRetainEvent(ocl_event);
     }
 
     ClImagePromise &ClImagePromise::operator=(ClImagePromise &&other) noexcept {
@@ -367,7 +446,8 @@ namespace xm::ocl::iop {
         ocl_event = other.ocl_event;
         ocl_queue = other.ocl_queue;
         image = other.image;
-        clRetainEvent(ocl_event);
+        if (ocl_event != nullptr)
+            clRetainEvent(ocl_event);
         return *this;
     }
 
@@ -410,7 +490,7 @@ namespace xm::ocl::iop {
             waiting_room:
             {
                 cl_int err;
-                err = clFinish(p.ocl_queue);
+                err = p.ocl_queue == nullptr ? CL_SUCCESS : clFinish(p.ocl_queue);
                 if (err != CL_SUCCESS) {
                     delete[] list;
                     throw std::runtime_error("Cannot finish command queue: " + std::to_string(err));
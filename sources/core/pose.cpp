@@ -3,15 +3,25 @@
 //
 
 #include <opencv2/calib3d.hpp>
+#include <chrono>
 #include "../../xmotion/core/algo/pose.h"
 #include "../../xmotion/core/utils/cv_utils.h"
+#include "../../xmotion/core/dnn/net/dnn_cache.h"
 
 void xm::Pose::init(const xm::nview::Initial &params) {
     results.error = false;
+    results.sequence = 0;
+    results.timestamp = 0;
+    results.marks.clear();
     config = params;
+    last_seen.assign(config.devices.size(), xm::nview::Marks{});
 
     init_validate();
     init_undistort_maps();
+    init_qualities();
+
+    // before any interpreter is built
+    eox::dnn::cache::set_directory(config.cache_dir);
 }
 
 void xm::Pose::init_validate() {
@@ -27,7 +37,14 @@ void xm::Pose::init_validate() {
 void xm::Pose::init_undistort_maps() {
     remap_maps.clear();
     remap_maps.reserve(config.devices.size());
+    cameras.clear();
+    cameras.reserve(config.devices.size());
+    grids.clear();
+    grids.reserve(config.devices.size());
     for (const auto &device: config.devices) {
+        cameras.push_back(xm::util::geom::camera(device.K, device.D));
+        grids.push_back(init_undistort_grid(device, cameras.back()));
+
         auto im_size = cv::Size(device.width, device.height);
         auto new_mat = cv::getOptimalNewCameraMatrix(
                 device.K,
@@ -48,10 +65,45 @@ void xm::Pose::init_undistort_maps() {
                 new_mat,
                 map_1,
                 map_2);
+
+        if (device.undistort_source && device.undistort_warp) {
+            auto &maps = remap_maps.back();
+            cv::convertMaps(map_1, map_2, maps.warp_x, maps.warp_y, CV_32FC1);
+        }
+    }
+}
+
+xm::util::geom::Grid xm::Pose::init_undistort_grid(const xm::nview::Device &device, const xm::util::geom::Camera &camera) const {
+    if (!device.undistort_points || device.undistort_source || !camera.supported || !camera.distorted)
+        return {};
+    if (device.undistort_grid_w < 2 || device.undistort_grid_h < 2)
+        return {};
+
+    auto grid = xm::util::geom::undistort_grid(
+            camera,
+            device.width,
+            device.height,
+            device.undistort_grid_w,
+            device.undistort_grid_h);
+
+    const auto error = xm::util::geom::grid_error(grid, camera);
+    if (error > device.undistort_tolerance) {
+        log->warn("Undistortion grid {}x{} error: {}px > {}px, using exact solver",
+                  grid.cols, grid.rows, error, device.undistort_tolerance);
+        return {};
     }
+
+    log->debug("Undistortion grid {}x{} error: {}px", grid.cols, grid.rows, error);
+    return grid;
 }
 
 xm::Pose &xm::Pose::proceed(float delta, const std::vector<xm::ocl::Image2D> &_frames) {
+    const auto timestamp = received_at > 0 ? received_at : std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+    received_at = 0;
+
+    results.marks.clear();
+
     if (!is_active() || _frames.empty()) {
         images.clear();
         images.reserve(_frames.size());
@@ -75,7 +127,8 @@ xm::Pose &xm::Pose::proceed(float delta, const std::vector<xm::ocl::Image2D> &_f
     for (int i = 0; i < _frames.size(); i++) {
         cv::UMat frame;
         xm::ocl::iop::to_cv_umat(_frames.at(i), frame);
-        input_frames.push_back(undistorted(frame, i));
+        // folded undistortion: pipeline samples original frame directly
+        input_frames.push_back(undistort_warp(i) ? frame : undistorted(frame, i));
     }
 
     std::vector<cv::UMat> output_frames;
@@ -98,50 +151,65 @@ xm::Pose &xm::Pose::proceed(float delta, const std::vector<xm::ocl::Image2D> &_f
 
     // TODO: PROCESS RESULTS ===========================================================================================
 
+    results.marks.reserve(outputs.size());
+    for (int i = 0; i < outputs.size(); i++) {
+        const auto &pose_output = outputs.at(i);
+        xm::nview::Marks marks{};
+        marks.present = pose_output.present;
+        marks.score = pose_output.score;
+
+        if (pose_output.present) {
+            xm::util::geom::Point points[39];
+            undistorted(pose_output.landmarks, 39, i, points);
+            for (int k = 0; k < 39; k++) {
+                marks.landmarks[k] = pose_output.landmarks[k];
+                marks.landmarks[k].x = points[k].x;
+                marks.landmarks[k].y = points[k].y;
+                marks.ws_landmarks[k] = pose_output.ws_landmarks[k];
+            }
+        }
 
+        if (marks.present)
+            last_seen.at(i) = marks;
 
+        results.marks.push_back(marks);
+    }
 
+    if (config.cross_seed)
+        seed_lost_views();
 
+    results.sequence += 1;
+    results.timestamp = timestamp;
 
-    for (int i = 0; i < output_frames.size(); i++) {
-        std::vector<std::vector<cv::Vec4f>> epi_vec;
-
-        const auto pose_output = outputs.at(i);
-        if (!pose_output.present)
+    // debug overlay: epilines of the right arm in every other view
+    for (int i = 0; DEBUG && config.show_epilines && i < output_frames.size(); i++) {
+        if (!outputs.at(i).present)
             continue;
 
-        const auto points = undistorted(pose_output.landmarks, 39, i);
-        const auto mid = points.at(eox::dnn::LM::R_MID);
-        const auto end = points.at(eox::dnn::LM::R_END);
+        const auto &points = results.marks.at(i).landmarks;
+        const xm::util::geom::Point anchors[2] = {
+                {points[eox::dnn::LM::R_MID].x, points[eox::dnn::LM::R_MID].y},
+                {points[eox::dnn::LM::R_END].x, points[eox::dnn::LM::R_END].y},
+        };
 
         for (int j = 0; j < output_frames.size(); j++) {
             if (i == j)
                 // pointless, so skip
                 continue;
 
-            const auto mid_line = epi_line_from_point(mid, i, j);
-            const auto end_line = epi_line_from_point(end, i, j);
+            xm::util::geom::Line lines[2];
+            epi_lines_from_points(anchors, 2, i, j, lines);
 
             cv::Point2i mp1, mp2, ep1, ep2;
-            points_from_epi_line(output_frames.at(j), mid_line, mp1, mp2);
-            points_from_epi_line(output_frames.at(j), end_line, ep1, ep2);
+            points_from_epi_line(output_frames.at(j), lines[0], mp1, mp2);
+            points_from_epi_line(output_frames.at(j), lines[1], ep1, ep2);
 
-            if (DEBUG && config.show_epilines) {
-                const auto color = xm::ocv::distinct_color(i, (int) output_frames.size());
-                cv::line(output_frames.at(j), mp1, mp2, color, 3);
-                cv::line(output_frames.at(j), ep1, ep2, color, 3);
-            }
+            const auto color = xm::ocv::distinct_color(i, (int) output_frames.size());
+            cv::line(output_frames.at(j), mp1, mp2, color, 3);
+            cv::line(output_frames.at(j), ep1, ep2, color, 3);
         }
-
-        if (epi_vec.empty())
-            continue;
     }
 
-
-
-
-
-
     // TODO: PROCESS RESULTS ===========================================================================================
 
     images.clear();
@@ -153,6 +221,11 @@ xm::Pose &xm::Pose::proceed(float delta, const std::vector<xm::ocl::Image2D> &_f
     return *this;
 }
 
+bool xm::Pose::undistort_warp(int index) const {
+    const auto &device = config.devices.at(index);
+    return device.undistort_source && device.undistort_warp && !device.chroma_fused;
+}
+
 cv::UMat xm::Pose::undistorted(const cv::UMat &in, int index) const {
     if (!config.devices.at(index).undistort_source)
         return in;
@@ -162,31 +235,161 @@ cv::UMat xm::Pose::undistorted(const cv::UMat &in, int index) const {
     return std::move(undistorted);
 }
 
-std::vector<cv::Point2f> xm::Pose::undistorted(const eox::dnn::Landmark *in, int num, int index) const {
-    std::vector<cv::Point2f> distorted_points;
+void xm::Pose::undistorted(const eox::dnn::Landmark *in, int num, int index, xm::util::geom::Point *out) const {
+    for (int i = 0; i < num; ++i)
+        out[i] = {in[i].x, in[i].y};
+    undistorted(out, num, index, out);
+}
+
+void xm::Pose::undistorted(const xm::util::geom::Point *in, int num, int index, xm::util::geom::Point *out) const {
+    const auto &device = config.devices.at(index);
+    if (!device.undistort_points || device.undistort_source) {
+        for (int i = 0; i < num; ++i)
+            out[i] = in[i];
+        return;
+    }
+
+    // precomputed lookup, just a few multiply-adds per point
+    const auto &grid = grids.at(index);
+    if (!grid.nodes.empty()) {
+        xm::util::geom::undistort(grid, in, out, num);
+        return;
+    }
+
+    const auto &camera = cameras.at(index);
+    if (camera.supported) {
+        xm::util::geom::undistort(camera, in, out, num);
+        return;
+    }
+
+    // exotic distortion model, opencv then
+    std::vector<cv::Point2f> distorted_points, points;
     distorted_points.reserve(num);
     for (int i = 0; i < num; ++i)
         distorted_points.emplace_back(in[i].x, in[i].y);
+    cv::undistortPoints(distorted_points, points, device.K, device.D, cv::noArray(), device.K);
+    for (int i = 0; i < num; ++i)
+        out[i] = {points.at(i).x, points.at(i).y};
+}
 
-    if (!config.devices.at(index).undistort_points)
-        return distorted_points;
+void xm::Pose::distorted(const xm::util::geom::Point *in, int num, int index, xm::util::geom::Point *out) const {
+    const auto &device = config.devices.at(index);
+    if (!device.undistort_points || device.undistort_source) {
+        for (int i = 0; i < num; ++i)
+            out[i] = in[i];
+        return;
+    }
 
-    if (config.devices.at(index).undistort_source)
-        return distorted_points;
+    const auto &camera = cameras.at(index);
+    if (camera.supported) {
+        xm::util::geom::distort(camera, in, out, num);
+        return;
+    }
 
-    const auto R = cv::Mat::eye(3, 3, CV_64F);
-    const auto K = config.devices.at(index).K.clone();
-    const auto D = config.devices.at(index).D.clone();
+    // back to normalized camera coordinates, then projected again but with distortion
+    std::vector<cv::Point3f> rays;
+    rays.reserve(num);
+    for (int i = 0; i < num; ++i) {
+        const auto ray = camera.K_inv * xm::util::geom::Vec3(in[i].x, in[i].y, 1.);
+        rays.emplace_back((float) (ray.x / ray.z), (float) (ray.y / ray.z), 1.f);
+    }
 
     std::vector<cv::Point2f> points;
-    cv::undistortPoints(distorted_points, points, K, D, R, K);
-    return points;
+    cv::projectPoints(rays, cv::Vec3d(), cv::Vec3d(), device.K, device.D, points);
+    for (int i = 0; i < num; ++i)
+        out[i] = {points.at(i).x, points.at(i).y};
+}
+
+void xm::Pose::seed_lost_views() {
+    const int anchors[] = {eox::dnn::LM::R_MID, eox::dnn::LM::R_END};
+    const int n = (int) poses.size();
+
+    std::vector<xm::util::geom::Line> lines;
+
+    for (int i = 0; i < n; i++) {
+        if (poses.at(i)->tracking())
+            continue;
+
+        // only when there is something lost
+        lines.resize(n);
+
+        xm::util::geom::Point seed[2];
+        int found = 0;
+
+        for (const auto &anchor: anchors) {
+            int count = 0;
+            for (int j = 0; j < n; j++) {
+                if (i == j || !results.marks.at(j).present)
+                    continue;
+                const auto &p = results.marks.at(j).landmarks[anchor];
+                const xm::util::geom::Point point = {p.x, p.y};
+                epi_lines_from_points(&point, 1, j, i, &lines.at(count++));
+            }
+
+            if (count == 0)
+                break;
+
+            if (epi_lines_intersection(lines.data(), count, seed[found])) {
+                // two or more views: anchor is where epilines meet
+                found++;
+                continue;
+            }
+
+            if (!last_seen.at(i).present)
+                break;
+
+            // single view: last known anchor of the lost view, moved onto the epiline
+            const auto &line = lines.front();
+            const auto &last = last_seen.at(i).landmarks[anchor];
+            const float d = line.x * last.x + line.y * last.y + line.z;
+            seed[found++] = {last.x - d * line.x, last.y - d * line.y};
+        }
+
+        if (found != 2 || glm::distance(seed[0], seed[1]) < 1.f)
+            continue;
+
+        // seed is in the same coordinates as the results, frames could be distorted tho
+        xm::util::geom::Point points[2];
+        distorted(seed, 2, i, points);
+        const auto &mid = points[0];
+        if (mid.x < 0 || mid.y < 0 || mid.x >= (float) config.devices.at(i).width || mid.y >= (float) config.devices.at(i).height)
+            continue;
+
+        const float p_mid[2] = {points[0].x, points[0].y};
+        const float p_end[2] = {points[1].x, points[1].y};
+        poses.at(i)->seedRoi(p_mid, p_end);
+    }
+}
+
+bool xm::Pose::epi_lines_intersection(const xm::util::geom::Line *lines, int n, xm::util::geom::Point &point) {
+    if (n < 2)
+        return false;
+
+    // normal equations of: min Σ (a*x + b*y + c)^2
+    double aa = 0, ab = 0, bb = 0, ac = 0, bc = 0;
+    for (int i = 0; i < n; i++) {
+        const auto &l = lines[i];
+        aa += l.x * l.x;
+        ab += l.x * l.y;
+        bb += l.y * l.y;
+        ac += l.x * l.z;
+        bc += l.y * l.z;
+    }
+
+    // for two normalized lines it is sin^2 of angle between them (~5 deg)
+    const double det = aa * bb - ab * ab;
+    if (det < 1e-2)
+        return false;
+
+    point.x = (float) ((ab * bc - bb * ac) / det);
+    point.y = (float) ((ab * ac - aa * bc) / det);
+    return true;
 }
 
-void xm::Pose::points_from_epi_line(const cv::UMat &img, const cv::Vec3f &line, cv::Point2i &p1, cv::Point2i &p2) const {
-    const float a = line[0];
-    const float b = line[1];
-    const float c = line[2];
+void xm::Pose::points_from_epi_line(const cv::UMat &img, const xm::util::geom::Line &line, cv::Point2i &p1, cv::Point2i &p2) const {
+    const float a = line.x;
+    const float b = line.y;
+    const float c = line.z;
 
     // Find two points on the line
     if (b != 0) {
@@ -202,26 +405,8 @@ void xm::Pose::points_from_epi_line(const cv::UMat &img, const cv::Vec3f &line,
     }
 }
 
-cv::Vec3f xm::Pose::epi_line_from_point(const cv::Point2f &point, int idx_point, int idx_line) const {
-
-    // map point to line: idx_point -> idx_line
-    const auto &F = config.epi_matrix[idx_point][idx_line].F;
-
-    {
-        const cv::Mat pt = (cv::Mat_<double>(3, 1) << point.x, point.y, 1.f);
-        const cv::Mat line = F * pt;
-        cv::Vec3f res = {
-                (float) line.at<double>(0, 0),
-                (float) line.at<double>(1, 0),
-                (float) line.at<double>(2, 0)
-        };
-        const auto norm = (float) std::sqrt(std::pow(res[0], 2) + std::pow(res[1], 2));
-        if (norm != 0) {
-            res[0] /= norm;
-            res[1] /= norm;
-            res[2] /= norm;
-        }
-        return res;
-    }
+void xm::Pose::epi_lines_from_points(const xm::util::geom::Point *points, int num, int idx_point, int idx_line,
+                                     xm::util::geom::Line *lines) const {
+    // map points to lines: idx_point -> idx_line
+    xm::util::geom::epi_lines(config.epi_matrix[idx_point][idx_line].fixed.F, points, lines, num);
 }
-
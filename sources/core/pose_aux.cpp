@@ -2,6 +2,8 @@
 // Created by henryco on 5/21/24.
 //
 
+#include <algorithm>
+#include <chrono>
 #include "../../xmotion/core/algo/pose.h"
 #include "../../xmotion/core/utils/eox_globals.h"
 
@@ -19,22 +21,29 @@ void xm::Pose::enqueue_inference(std::vector<std::future<eox::dnn::PosePipelineO
 
         const auto &frame = in_frames.at(i);
         const auto &pose = poses.at(i);
+        auto &latency = latencies.at(i);
 
         if (DEBUG) {
             out_frames.emplace_back();
             io_features.push_back(
                     workers.at(j)->execute<eox::dnn::PosePipelineOutput>(
-                            [i, frame, &pose, &out_frames]() -> eox::dnn::PosePipelineOutput {
+                            [i, frame, &pose, &out_frames, &latency]() -> eox::dnn::PosePipelineOutput {
+                                const auto t0 = std::chrono::steady_clock::now();
                                 cv::UMat segmented;
-                                return pose->pass(frame, segmented, out_frames.at(i));
+                                auto output = pose->pass(frame, segmented, out_frames.at(i));
+                                latency = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - t0).count();
+                                return output;
                             }));
         } else {
             out_frames.push_back(frame);
             io_features.push_back(
                     workers.at(j)->execute<eox::dnn::PosePipelineOutput>(
-                            [i, frame, &pose]() -> eox::dnn::PosePipelineOutput {
+                            [frame, &pose, &latency]() -> eox::dnn::PosePipelineOutput {
+                                const auto t0 = std::chrono::steady_clock::now();
                                 cv::UMat segmented;
-                                return pose->pass(frame, segmented);
+                                auto output = pose->pass(frame, segmented);
+                                latency = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - t0).count();
+                                return output;
                             }));
         }
 
@@ -45,6 +54,7 @@ void xm::Pose::enqueue_inference(std::vector<std::future<eox::dnn::PosePipelineO
 
 bool xm::Pose::resolve_inference(std::vector<std::future<eox::dnn::PosePipelineOutput>> &in_futures,
                                  std::vector<eox::dnn::PosePipelineOutput> &out_results) {
+    out_results.reserve(in_futures.size());
     for (auto &feature: in_futures) {
         if (!feature.valid())
             return false;
@@ -61,15 +71,18 @@ bool xm::Pose::resolve_inference(std::vector<std::future<eox::dnn::PosePipelineO
 
 void xm::Pose::start() {
     stop();
-    for (const auto &device: config.devices) {
+    for (int i = 0; i < config.devices.size(); i++) {
+        const auto &device = config.devices.at(i);
         auto p = std::make_unique<eox::dnn::PosePipeline>();
-        p->enableSegmentation(config.segmentation);
-        p->setBodyModel(device.body_model);
-        p->setDetectorModel(device.detector_model);
+        const auto &quality = qualities.at(i).at(quality_levels.at(i));
+        p->enableSegmentation(quality.segmentation);
+        p->setBodyModel(quality.body_model);
+        p->setDetectorModel(quality.detector_model);
         p->setDetectorThreshold(device.threshold_detector);
         p->setMarksThreshold(device.threshold_marks);
         p->setPoseThreshold(device.threshold_pose);
         p->setRoiThreshold(device.threshold_roi);
+        p->setSegmentationThreshold(device.threshold_segmentation);
         p->setFilterVelocityScale(device.filter_velocity_factor);
         p->setFilterWindowSize(device.filter_windows_size);
         p->setFilterTargetFps(device.filter_target_fps);
@@ -80,6 +93,14 @@ void xm::Pose::start() {
         p->setRoiMargin(device.roi_margin);
         p->setRoiPaddingX(device.roi_padding_x);
         p->setRoiPaddingY(device.roi_padding_y);
+        p->setMaxPeople(device.track_people);
+        p->setTrackIouThreshold(device.track_iou);
+        p->setTrackMaxMisses(device.track_misses);
+        p->setTrackReacquireInterval(device.track_reacquire);
+        if (device.chroma_fused)
+            p->setChromaKey(device.chroma);
+        if (undistort_warp(i))
+            p->setUndistortMaps(remap_maps.at(i).warp_x, remap_maps.at(i).warp_y);
         poses.push_back(std::move(p));
     }
 
@@ -89,6 +110,9 @@ void xm::Pose::start() {
         workers.push_back(std::move(p));
     }
 
+    latencies.assign(config.devices.size(), 0.f);
+    warm_up();
+
     results.error = false;
     active = true;
 }
@@ -121,6 +145,105 @@ void xm::Pose::debug(bool _debug) {
     DEBUG = _debug;
 }
 
+void xm::Pose::received(int64_t timestamp) {
+    received_at = timestamp;
+}
+
 xm::Pose::~Pose() {
     release();
-}
\ No newline at end of file
+}
+
+void xm::Pose::init_qualities() {
+    // lighter variant of the same kind (origin, f32, f16, i8): heavy -> full -> lite
+    const auto lighter = [](xm::nview::BodyModel model) {
+        return (int) model % 3 < 2 ? static_cast<xm::nview::BodyModel>((int) model + 1) : model;
+    };
+
+    qualities.clear();
+    qualities.reserve(config.devices.size());
+    for (const auto &device: config.devices) {
+        std::vector<xm::nview::Quality> levels;
+        xm::nview::Quality quality = {
+                .detector_model = device.detector_model,
+                .body_model = device.body_model,
+                .segmentation = config.segmentation
+        };
+        levels.push_back(quality);
+
+        if (config.adaptive) {
+            // cheapest to lose first
+            if (quality.segmentation) {
+                quality.segmentation = false;
+                levels.push_back(quality);
+            }
+            if (lighter(quality.body_model) != quality.body_model) {
+                quality.body_model = lighter(quality.body_model);
+                levels.push_back(quality);
+            }
+            // i8 detector runs on cpu, it is not heavier than f16 one
+            if (quality.detector_model == eox::dnn::box::ORIGIN || quality.detector_model == eox::dnn::box::F_32) {
+                quality.detector_model = eox::dnn::box::F_16;
+                levels.push_back(quality);
+            }
+            if (lighter(quality.body_model) != quality.body_model) {
+                quality.body_model = lighter(quality.body_model);
+                levels.push_back(quality);
+            }
+        }
+
+        qualities.push_back(levels);
+    }
+
+    quality_levels.assign(config.devices.size(), 0);
+}
+
+void xm::Pose::warm_up() {
+    std::vector<std::future<void>> futures;
+    futures.reserve(poses.size());
+    for (int i = 0; i < poses.size(); i++) {
+        // same worker as in enqueue_inference
+        auto &worker = workers.at(i % workers.size());
+        const auto &pose = poses.at(i);
+        const auto &levels = qualities.at(i);
+        futures.push_back(worker->execute([&pose, &levels]() {
+            // lower quality levels exist only in adaptive mode
+            for (int k = 1; k < levels.size(); k++) {
+                pose->warmBodyModel(levels[k].body_model);
+                pose->warmDetectorModel(levels[k].detector_model);
+            }
+            pose->prime();
+        }));
+    }
+
+    for (auto &future: futures)
+        future.get();
+
+    log->info("Warmed up interpreters of {} pipelines", poses.size());
+}
+
+const std::vector<float> &xm::Pose::latency() const {
+    return latencies;
+}
+
+int xm::Pose::qualities_n(int index) const {
+    return (int) qualities.at(index).size();
+}
+
+int xm::Pose::quality(int index) const {
+    return quality_levels.at(index);
+}
+
+void xm::Pose::set_quality(int index, int level) {
+    level = std::clamp(level, 0, qualities_n(index) - 1);
+    quality_levels.at(index) = level;
+
+    // applied by start() otherwise
+    if (!is_active() || index >= poses.size())
+        return;
+
+    const auto &quality = qualities.at(index).at(level);
+    const auto &pose = poses.at(index);
+    pose->enableSegmentation(quality.segmentation);
+    pose->setBodyModel(quality.body_model);
+    pose->setDetectorModel(quality.detector_model);
+}
@@ -4,22 +4,13 @@
 
 #include "../../xmotion/core/dnn/net/pose_detector.h"
 #include "../../xmotion/core/dnn/net/dnn_cl_utils.h"
+#include "../../xmotion/core/ocl/ocl_cpu.h"
 
 #include <filesystem>
 #include <opencv2/imgproc.hpp>
 
 namespace eox::dnn {
 
-    namespace dtc {
-        const float *detector_bboxes_1x2254x12(const tflite::Interpreter &interpreter, box::Model model) {
-            return interpreter.output_tensor(box::mappings[model].box_loc)->data.f;
-        }
-
-        const float *detector_scores_1x2254x1(const tflite::Interpreter &interpreter, box::Model model) {
-            return interpreter.output_tensor(box::mappings[model].score_loc)->data.f;
-        }
-    }
-
 //    const std::vector<std::string> PoseDetector::outputs = {
 //            "Identity",   // 441  | 0: [1, 2254, 12]           un-decoded face bboxes location and key-points
 //            "Identity_1", // 1429 | 4: [1, 2254, 1]            scores of the detected bboxes
@@ -49,7 +40,13 @@ namespace eox::dnn {
 
         with_box = true;
         init();
-        input_ocl(0, xm::dnn::ocl::getOpenCLBufferFromUMat(frame), get_in_w() * get_in_h() * 3 * 4);
+        if (quantized(0) || xm::ocl::cpu::enabled()) {
+            // integer tensor lives on host, quantized during the copy (or no OpenCL buffer on cpu backend)
+            const auto mat = blob.getMat(cv::ACCESS_READ);
+            input(0, mat.ptr<float>(0), get_in_w() * get_in_h() * 3 * 4);
+        } else {
+            input_ocl(0, xm::dnn::ocl::getOpenCLBufferFromUMat(frame), get_in_w() * get_in_h() * 3 * 4);
+        }
         const auto result = inference();
         with_box = false;
         return result;
@@ -66,6 +63,30 @@ namespace eox::dnn {
         return result;
     }
 
+    std::vector<DetectedPose> PoseDetector::inference(cl_command_queue queue, cl_mem blob, int width, int height) {
+        view_w = width;
+        view_h = height;
+
+        with_box = true;
+        init();
+        input(0, queue, blob, get_in_w() * get_in_h() * 3 * 4);
+        const auto result = inference();
+        with_box = false;
+        return result;
+    }
+
+    std::vector<DetectedPose> PoseDetector::inference(const float *blob, int width, int height) {
+        view_w = width;
+        view_h = height;
+
+        with_box = true;
+        init();
+        input(0, blob, get_in_w() * get_in_h() * 3 * 4);
+        const auto result = inference();
+        with_box = false;
+        return result;
+    }
+
     std::vector<DetectedPose> PoseDetector::inference(const float *frame) {
         init();
         input(0, frame, get_in_w() * get_in_h() * 3 * 4);
@@ -83,8 +104,9 @@ namespace eox::dnn {
         // detection output
         std::vector<eox::dnn::DetectedPose> output;
 
-        const auto bboxes = dtc::detector_bboxes_1x2254x12(*interpreter, model_type);
-        const auto scores = dtc::detector_scores_1x2254x1(*interpreter, model_type);
+        // [1, N, 12] un-decoded bboxes and key-points, [1, N, 1] scores
+        const auto bboxes = this->output(box::mappings[model_type].box_loc);
+        const auto scores = this->output(box::mappings[model_type].score_loc);
 
         std::vector<float> scores_vec;
         std::vector<std::array<float, 12>> bboxes_vec;
@@ -110,7 +132,12 @@ namespace eox::dnn {
                 bboxes_vec,
                 anchors_vec,
                 (float) get_in_w(),
-                true);
+                max_detections <= 1);
+
+        if (max_detections > 1) {
+            // neighbour anchors fire for the very same person
+            boxes = eox::dnn::ssd::suppress(std::move(boxes), nms_iou, max_detections);
+        }
 
         // correcting letterbox paddings
         const auto p = eox::dnn::get_letterbox_paddings(view_w, view_h, get_in_w(), get_in_h());
@@ -177,7 +204,19 @@ namespace eox::dnn {
     }
 
     std::string PoseDetector::get_model_file() {
-        return "./../models/blazepose/body/detector/" + box::models[model_type];
+        return model_file(model_type);
+    }
+
+    std::string PoseDetector::model_file(box::Model type) {
+        return "./../models/blazepose/body/detector/" + box::models[type];
+    }
+
+    void PoseDetector::warm(box::Model type) {
+        DnnRunner::warm(model_file(type));
+    }
+
+    void PoseDetector::prime() {
+        DnnRunner::prime();
     }
 
     float PoseDetector::getThreshold() const {
@@ -244,4 +283,20 @@ namespace eox::dnn {
         roi_margin = roiMargin;
     }
 
+    void PoseDetector::setMaxDetections(int max) {
+        max_detections = std::max(1, max);
+    }
+
+    int PoseDetector::getMaxDetections() const {
+        return max_detections;
+    }
+
+    void PoseDetector::setNmsThreshold(float iou) {
+        nms_iou = iou;
+    }
+
+    float PoseDetector::getNmsThreshold() const {
+        return nms_iou;
+    }
+
 } // eox
\ No newline at end of file
@@ -0,0 +1,57 @@
+//
+// Created by henryco on 14/07/24.
+//
+
+#include "../../xmotion/core/sink/pose_packet.h"
+#include <cstring>
+
+namespace xm::sink {
+
+    size_t packet_size(size_t devices) {
+        return sizeof(PacketHeader) + devices * sizeof(PacketDevice);
+    }
+
+    size_t encode(const xm::nview::Result &result, std::vector<char> &buffer) {
+        const auto size = packet_size(result.marks.size());
+        if (buffer.size() < size)
+            buffer.resize(size);
+
+        auto *header = reinterpret_cast<PacketHeader *>(buffer.data());
+        header->magic = PACKET_MAGIC;
+        header->version = PACKET_VERSION;
+        header->devices = (uint16_t) result.marks.size();
+        header->sequence = result.sequence;
+        header->timestamp = result.timestamp;
+        header->size = (uint32_t) size;
+        header->reserved = 0;
+
+        auto *devices = reinterpret_cast<PacketDevice *>(buffer.data() + sizeof(PacketHeader));
+        for (size_t i = 0; i < result.marks.size(); i++) {
+            const auto &marks = result.marks[i];
+            auto &device = devices[i];
+
+            std::memset(&device, 0, sizeof(PacketDevice));
+            device.present = marks.present ? 1 : 0;
+            device.score = marks.score;
+
+            if (!marks.present)
+                continue;
+
+            for (int k = 0; k < PACKET_MARKS; k++) {
+                const auto &lm = marks.landmarks[k];
+                const auto &ws = marks.ws_landmarks[k];
+                device.landmarks[k * 5 + 0] = lm.x;
+                device.landmarks[k * 5 + 1] = lm.y;
+                device.landmarks[k * 5 + 2] = lm.z;
+                device.landmarks[k * 5 + 3] = lm.v;
+                device.landmarks[k * 5 + 4] = lm.p;
+                device.ws_landmarks[k * 3 + 0] = ws.x;
+                device.ws_landmarks[k * 3 + 1] = ws.y;
+                device.ws_landmarks[k * 3 + 2] = ws.z;
+            }
+        }
+
+        return size;
+    }
+
+} // xm::sink
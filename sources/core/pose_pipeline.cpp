@@ -3,6 +3,11 @@
 //
 
 #include "../../xmotion/core/dnn/pose_pipeline.h"
+#include "../../xmotion/core/ocl/ocl_filters.h"
+#include "../../xmotion/core/ocl/ocl_cpu.h"
+#include <opencv2/core/ocl.hpp>
+#include <algorithm>
+#include <cmath>
 
 namespace eox::dnn {
 
@@ -13,6 +18,8 @@ namespace eox::dnn {
             log->debug("INIT FILTER: {}, {}, {}", f_win_size, f_v_scale, f_fps);
             filters.emplace_back(f_win_size, f_v_scale, f_fps);
         }
+        tracker.setFilter(f_win_size, f_v_scale, f_fps);
+        tracker.reset();
         initialized = true;
         prediction = false;
     }
@@ -38,6 +45,47 @@ namespace eox::dnn {
             init();
         }
 
+        if (chroma_key && rec_n == 1) {
+            // low resolution mask, once per frame
+            prepareChromaKey(frame, debug != nullptr);
+        }
+
+        const bool warp = undistortWarp();
+        if (warp && rec_n == 1 && (debug || segmentation())) {
+            // whole undistorted frame only when someone is going to look at it
+            undistortFrame(frame, warp_view);
+        }
+
+        // frame used for visual output, keyed only when there is a need to
+        const cv::UMat &view = (chroma_key && debug)
+                ? key_frame
+                : ((warp && (debug || segmentation())) ? warp_view : frame);
+
+        if (tracker.getCapacity() > 1) {
+            // own detector and ROI logic per track
+            return inferenceMulti(frame, view, segmented, debug, t0);
+        }
+
+        seeded_roi = false;
+
+        // seed from outside is used only once and only in place of the detector
+        if (seed_ready && !prediction && rec_n == 1) {
+            const auto clamped = eox::dnn::clamp_roi(seed, frame.cols, frame.rows);
+            if (clamped.w >= 1.f && clamped.h >= 1.f) {
+                roi = clamped;
+                seeded_roi = true;
+                prediction = true;
+
+                if (!discarded_roi) {
+                    // same as for clear detector run, previous points are gone
+                    for (auto &filter: filters) {
+                        filter.reset();
+                    }
+                }
+            }
+        }
+        seed_ready = false;
+
         // roi from previous iteration
         const auto previous_roi = roi;
 
@@ -52,7 +100,7 @@ namespace eox::dnn {
             _roi_score = 0;
 
             // crop using roi
-            source = frame(cv::Rect((int) roi.x,(int) roi.y,(int) roi.w,(int) roi.h));
+            source = cropRoi(frame, roi);
         }
 
             // No prediction or to close to the border
@@ -69,7 +117,9 @@ namespace eox::dnn {
             detector.setThreshold(std::min(0.1f, threshold_detector));
 
             // using pose detector
-            auto detections = detector.inference(frame);
+            auto detections = chroma_key
+                    ? keyedDetection(frame)
+                    : detector.inference(warp ? warpedDetectorView(frame) : frame);
 
             // nothing detected or results is just not satisfying
             if (detections.empty() || detections[0].score < threshold_detector) {
@@ -81,7 +131,7 @@ namespace eox::dnn {
                         _detector_score = detections[0].score;
                     roi = {};
 
-                    frame.copyTo(*debug);
+                    view.copyTo(*debug);
                     printMetadata(*debug, t0, rec_n);
                 }
 
@@ -92,35 +142,14 @@ namespace eox::dnn {
 
             auto &detected = detections[0];
 
-            auto &body = detected.body;
-            body.x *= (float) frame.cols;
-            body.y *= (float) frame.rows;
-            body.w *= (float) frame.cols;
-            body.h *= (float) frame.rows;
-
-            body.x += roi_padding_x - (roi_margin / 2.f);
-            body.y += roi_padding_y - (roi_margin / 2.f);
-            body.w += (roi_margin / 2.f);
-            body.h += (roi_margin / 2.f);
-
-            body.c.x *= (float) frame.cols;
-            body.c.y *= (float) frame.rows;
-            body.e.x *= (float) frame.cols;
-            body.e.y *= (float) frame.rows;
-
-            body.c.x += roi_padding_x - (roi_margin / 2.f);
-            body.c.y += roi_padding_y - (roi_margin / 2.f);
-            body.e.x += roi_padding_x - (roi_margin / 2.f);
-            body.e.y += roi_padding_y - (roi_margin / 2.f);
-
             auto &face = detected.face;
             face.x *= (float) frame.cols;
             face.y *= (float) frame.rows;
             face.w *= (float) frame.cols;
             face.h *= (float) frame.rows;
 
-            roi = eox::dnn::clamp_roi(body, frame.cols, frame.rows);
-            source = frame(cv::Rect((int) roi.x, (int) roi.y, (int) roi.w, (int) roi.h));
+            roi = eox::dnn::clamp_roi(detectedRoi(detected, frame.cols, frame.rows), frame.cols, frame.rows);
+            source = cropRoi(frame, roi);
 
             if (!discarded_roi) {
                 // Reset filters ONLY IF this is clear detector run (no points found previously)
@@ -131,7 +160,9 @@ namespace eox::dnn {
         }
 
         // Looking for body landmarks
-        auto result = pose.inference(source); // TODO
+        auto result = chroma_key
+                ? keyedPose(roi)
+                : pose.inference(source);
         const auto now = timestamp();
 
         // for debug purpose
@@ -208,7 +239,7 @@ namespace eox::dnn {
                     if (distance < threshold_roi) {
 
                         if (debug) {
-                            frame.copyTo(*debug);
+                            view.copyTo(*debug);
                             printMetadata(*debug, t0, rec_n);
                             drawRoi(*debug);
                         }
@@ -224,10 +255,10 @@ namespace eox::dnn {
             // perform segmentation
             if (segmentation()) {
                 // if needed
-                performSegmentation(result.segmentation, frame, segmented);
+                performSegmentation(result.segmentation, view, segmented);
             } else {
                 // or just use the very same frame
-                segmented = frame;
+                segmented = view;
             }
 
             /*
@@ -331,7 +362,7 @@ namespace eox::dnn {
             }
 
             // preparing output
-            memcpy(output.segmentation, result.segmentation, 256 * 256 * sizeof(float));
+            output.segmentation = std::move(result.segmentation);
             memcpy(output.ws_landmarks, result.landmarks_3d, 39 * sizeof(eox::dnn::Coord3d));
             memcpy(output.landmarks, landmarks, 39 * sizeof(eox::dnn::Landmark));
             output.score = result.score;
@@ -351,7 +382,7 @@ namespace eox::dnn {
             // still nothing
             if (debug) {
 
-                frame.copyTo(*debug);
+                view.copyTo(*debug);
                 printMetadata(*debug, t0, rec_n);
                 drawRoi(*debug);
             }
@@ -360,25 +391,120 @@ namespace eox::dnn {
         return output;
     }
 
-    void PosePipeline::performSegmentation(float *segmentation_array, const cv::UMat &frame, cv::UMat &out) const {
-        if (!segmentation()) {
+    void PosePipeline::prepareChromaKey(const cv::UMat &frame, bool materialize) {
+        // same queue as the one used by cv::UMat operations within this thread
+        const auto queue = xm::ocl::cpu::enabled() ? nullptr : (cl_command_queue) cv::ocl::Queue::getDefault().ptr();
+
+        key_source = xm::ocl::iop::ClImagePromise(xm::ocl::iop::from_cv_umat(frame, xm::ocl::ACCESS::RO), queue);
+        key_mask = chroma_key->mask(key_source);
+
+        if (!materialize)
+            return;
+
+        auto keyed = chroma_key->apply(key_source, key_mask);
+        key_frame = keyed.waitFor().getUMat();
+    }
+
+    std::vector<DetectedPose> PosePipeline::keyedDetection(const cv::UMat &frame) {
+        auto blob = chroma_key->blob(
+                key_source,
+                key_mask,
+                0.f, 0.f,
+                (float) frame.cols,
+                (float) frame.rows,
+                detector.get_in_w(),
+                detector.get_in_h());
+        const auto image = blob.waitFor().getImage2D();
+        if (image.on_host())
+            return detector.inference((const float *) image.data(), frame.cols, frame.rows);
+        return detector.inference(blob.queue(), image.handle, frame.cols, frame.rows);
+    }
+
+    PoseOutput PosePipeline::keyedPose(const eox::dnn::RoI &region) {
+        auto blob = chroma_key->blob(
+                key_source,
+                key_mask,
+                (float) (int) region.x,
+                (float) (int) region.y,
+                (float) (int) region.w,
+                (float) (int) region.h,
+                pose.get_in_w(),
+                pose.get_in_h());
+        const auto image = blob.waitFor().getImage2D();
+        if (image.on_host())
+            return pose.inference((const float *) image.data(), (int) region.w, (int) region.h);
+        return pose.inference(blob.queue(), image.handle, (int) region.w, (int) region.h);
+    }
+
+    eox::dnn::RoI PosePipeline::detectedRoi(const DetectedPose &detected, int width, int height) const {
+        auto body = detected.body;
+        body.x *= (float) width;
+        body.y *= (float) height;
+        body.w *= (float) width;
+        body.h *= (float) height;
+
+        body.x += roi_padding_x - (roi_margin / 2.f);
+        body.y += roi_padding_y - (roi_margin / 2.f);
+        body.w += (roi_margin / 2.f);
+        body.h += (roi_margin / 2.f);
+
+        body.c.x *= (float) width;
+        body.c.y *= (float) height;
+        body.e.x *= (float) width;
+        body.e.y *= (float) height;
+
+        body.c.x += roi_padding_x - (roi_margin / 2.f);
+        body.c.y += roi_padding_y - (roi_margin / 2.f);
+        body.e.x += roi_padding_x - (roi_margin / 2.f);
+        body.e.y += roi_padding_y - (roi_margin / 2.f);
+        return body;
+    }
+
+    cv::UMat PosePipeline::cropRoi(const cv::UMat &frame, const eox::dnn::RoI &region) const {
+        return undistortWarp()
+               ? warpedRoi(frame, region)
+               : frame(cv::Rect((int) region.x, (int) region.y, (int) region.w, (int) region.h));
+    }
+
+    void PosePipeline::performSegmentation(const eox::dnn::Segmentation &segmentation_buffer, const cv::UMat &frame, cv::UMat &out) const {
+        if (!segmentation() || segmentation_buffer.empty()) {
             out = frame;
             return;
         }
 
-        cv::Mat segmentation(256, 256, CV_32F, segmentation_array);
-        cv::Mat segmentation_mask;
-
-        cv::threshold(segmentation, segmentation_mask, 0.5, 1., cv::THRESH_BINARY);
-        cv::resize(segmentation_mask, segmentation_mask, cv::Size(roi.w, roi.h));
+        if (cv::ocl::useOpenCL()) {
+            // sigmoid, threshold, upsampling and masking in one kernel, result stays on device
+            xm::ocl::apply_segmentation(
+                    segmentation_buffer.data(),
+                    segmentation_buffer.width(),
+                    segmentation_buffer.height(),
+                    threshold_segmentation,
+                    roi.x, roi.y, roi.w, roi.h,
+                    frame, out);
+            return;
+        }
 
-        segmentation_mask.convertTo(segmentation_mask, CV_32FC1, 255.);
-        segmentation_mask.convertTo(segmentation_mask, CV_8UC1);
+        // CPU fallback, threshold applied to logits directly: sigmoid(l) > t <=> l > log(t / (1 - t))
+        const auto t = std::clamp(threshold_segmentation, 1e-6f, 1.f - 1e-6f);
+        const double threshold_logit = std::log(t / (1.f - t));
+        const cv::Mat logits(
+                segmentation_buffer.height(),
+                segmentation_buffer.width(),
+                CV_32F,
+                (void *) segmentation_buffer.data());
+        const cv::Rect rect = cv::Rect((int) roi.x, (int) roi.y, (int) roi.w, (int) roi.h)
+                & cv::Rect(0, 0, frame.cols, frame.rows);
+
+        out = cv::UMat::zeros(frame.rows, frame.cols, frame.type());
+        if (rect.empty())
+            return;
 
-        cv::Mat segmentation_frame = cv::Mat::zeros(frame.rows, frame.cols, CV_8UC1);
-        segmentation_mask.copyTo(segmentation_frame(cv::Rect(roi.x, roi.y, roi.w, roi.h))); // TODO
+        // vectorized (opencv hal) mask in model resolution, then ROI resolution only
+        cv::Mat mask, mask_u8;
+        cv::resize(logits, mask, rect.size(), 0, 0, cv::INTER_LINEAR);
+        cv::compare(mask, threshold_logit, mask_u8, cv::CMP_GT);
 
-        cv::bitwise_and(frame, frame, out, segmentation_frame);
+        frame(rect).copyTo(out(rect), mask_u8);
     }
 
 } // eox
\ No newline at end of file
@@ -16,6 +16,8 @@ namespace eox::dnn {
     }
 
     void PosePipeline::setDetectorModel(eox::dnn::box::Model model) {
+        if (model == detector.get_model_type())
+            return;
         detector.set_model_type(model);
     }
 
@@ -23,6 +25,19 @@ namespace eox::dnn {
         pose.set_model_type(model);
     }
 
+    void PosePipeline::warmDetectorModel(eox::dnn::box::Model model) {
+        detector.warm(model);
+    }
+
+    void PosePipeline::warmBodyModel(eox::dnn::pose::Model model) {
+        pose.warm(model);
+    }
+
+    void PosePipeline::prime() {
+        detector.prime();
+        pose.prime();
+    }
+
     eox::dnn::pose::Model PosePipeline::bodyModel() const {
         return pose.get_model_type();
     }
@@ -45,6 +60,7 @@ namespace eox::dnn {
 
     void PosePipeline::setFilterWindowSize(int size) {
         f_win_size = size;
+        tracker.setFilter(f_win_size, f_v_scale, f_fps);
         for (auto &filter: filters) {
             filter.setWindowSize(size);
         }
@@ -52,6 +68,7 @@ namespace eox::dnn {
 
     void PosePipeline::setFilterVelocityScale(float scale) {
         f_v_scale = scale;
+        tracker.setFilter(f_win_size, f_v_scale, f_fps);
         for (auto &filter: filters) {
             filter.setVelocityScale(scale);
         }
@@ -59,6 +76,7 @@ namespace eox::dnn {
 
     void PosePipeline::setFilterTargetFps(int fps) {
         f_fps = fps;
+        tracker.setFilter(f_win_size, f_v_scale, f_fps);
         for (auto &filter: filters) {
             filter.setTargetFps(fps);
         }
@@ -148,6 +166,24 @@ namespace eox::dnn {
         return threshold_marks;
     }
 
+    void PosePipeline::setSegmentationThreshold(float threshold) {
+        threshold_segmentation = threshold;
+    }
+
+    float PosePipeline::getSegmentationThreshold() const {
+        return threshold_segmentation;
+    }
+
+    void PosePipeline::setChromaKey(const xm::filters::chroma::Conf &conf) {
+        chroma_key = std::make_unique<xm::filters::ChromaKey>();
+        chroma_key->init(conf);
+        chroma_key->start();
+    }
+
+    bool PosePipeline::chromaKey() const {
+        return chroma_key != nullptr;
+    }
+
     void PosePipeline::enableSegmentation(bool enable) {
         pose.set_segmentation(enable);
     }
@@ -156,4 +192,54 @@ namespace eox::dnn {
         return pose.segmentation();
     }
 
+    void PosePipeline::seedRoi(const float mid[2], const float end[2]) {
+        seed = roiPredictor
+                .setMargin(roi_margin)
+                .setFixX(roi_padding_x)
+                .setFixY(roi_padding_y)
+                .setScale(roi_scale)
+                .forward(eox::dnn::roiFromPoints(mid, end));
+        seed_ready = true;
+    }
+
+    bool PosePipeline::tracking() const {
+        return tracker.getCapacity() > 1
+               ? !tracker.needsDetection()
+               : prediction;
+    }
+
+    void PosePipeline::setMaxPeople(int n) {
+        tracker.setCapacity(n);
+        detector.setMaxDetections(tracker.getCapacity());
+        pose.set_batch_size(tracker.getCapacity());
+    }
+
+    int PosePipeline::getMaxPeople() const {
+        return tracker.getCapacity();
+    }
+
+    void PosePipeline::setTrackIouThreshold(float threshold) {
+        tracker.setIouThreshold(threshold);
+    }
+
+    float PosePipeline::getTrackIouThreshold() const {
+        return tracker.getIouThreshold();
+    }
+
+    void PosePipeline::setTrackMaxMisses(int n) {
+        tracker.setMaxMisses(n);
+    }
+
+    int PosePipeline::getTrackMaxMisses() const {
+        return tracker.getMaxMisses();
+    }
+
+    void PosePipeline::setTrackReacquireInterval(int n) {
+        tracker.setReacquireInterval(n);
+    }
+
+    int PosePipeline::getTrackReacquireInterval() const {
+        return tracker.getReacquireInterval();
+    }
+
 } // eox
\ No newline at end of file
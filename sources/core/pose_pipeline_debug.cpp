@@ -69,13 +69,17 @@ namespace eox::dnn {
     }
 
     void PosePipeline::drawRoi(cv::UMat &output) const {
-        const auto p1 = cv::Point(roi.x, roi.y);
-        const auto p2 = cv::Point(roi.x + roi.w, roi.y + roi.h);
+        drawRoi(output, roi);
+    }
+
+    void PosePipeline::drawRoi(cv::UMat &output, const eox::dnn::RoI &region) const {
+        const auto p1 = cv::Point(region.x, region.y);
+        const auto p2 = cv::Point(region.x + region.w, region.y + region.h);
         cv::Scalar color(255, 255, 255);
-        cv::line(output, p1, cv::Point(roi.x + roi.w, roi.y), color, 2);
-        cv::line(output, p1, cv::Point(roi.x, roi.y + roi.h), color, 2);
-        cv::line(output, p2, cv::Point(roi.x, roi.y + roi.h), color, 2);
-        cv::line(output, p2, cv::Point(roi.x + roi.w, roi.y), color, 2);
+        cv::line(output, p1, cv::Point(region.x + region.w, region.y), color, 2);
+        cv::line(output, p1, cv::Point(region.x, region.y + region.h), color, 2);
+        cv::line(output, p2, cv::Point(region.x, region.y + region.h), color, 2);
+        cv::line(output, p2, cv::Point(region.x + region.w, region.y), color, 2);
     }
 
     void PosePipeline::printMetadata(cv::UMat &output, PoseTimePoint t0, int rec_n) const {
@@ -159,6 +163,21 @@ namespace eox::dnn {
                     cv::Point(40, 560),
                     cv::FONT_HERSHEY_SIMPLEX, 0.7,
                     cv::Scalar(0, 0, 255), 2);
+
+        cv::putText(output,
+                    "SEEDED    ROI: " + (std::string) (seeded_roi ? "T" : "F"),
+                    cv::Point(40, 600),
+                    cv::FONT_HERSHEY_SIMPLEX, 0.7,
+                    cv::Scalar(0, 0, 255), 2);
+
+        if (tracker.getCapacity() > 1) {
+            cv::putText(output,
+                        "TRACKS: " + std::to_string(tracker.getTracks().size())
+                        + " / " + std::to_string(tracker.getCapacity()),
+                        cv::Point(40, 640),
+                        cv::FONT_HERSHEY_SIMPLEX, 0.7,
+                        cv::Scalar(0, 0, 255), 2);
+        }
     }
 
 }
\ No newline at end of file
@@ -0,0 +1,132 @@
+//
+// Created by henryco on 21/07/24.
+//
+
+#include "../../xmotion/core/dnn/pose_pipeline.h"
+
+namespace eox::dnn {
+
+    PosePipelineOutput PosePipeline::inferenceMulti(const cv::UMat &frame, const cv::UMat &view, cv::UMat &segmented, cv::UMat *debug, PoseTimePoint t0) {
+        const bool warp = undistortWarp();
+
+        PosePipelineOutput output;
+        output.present = false;
+        output.score = 0.f;
+
+        _detector_score = 0;
+        _pose_score = 0;
+        _roi_score = 0;
+
+        // single detector run per frame, only when some track needs it
+        prediction = !tracker.needsDetection();
+        if (!prediction) {
+            detector.setRoiMargin(roi_margin);
+            detector.setRoiPaddingX(roi_padding_x);
+            detector.setRoiPaddingY(roi_padding_y);
+            detector.setRoiScale(roi_scale);
+            detector.setThreshold(std::min(0.1f, threshold_detector));
+
+            const auto detections = chroma_key
+                    ? keyedDetection(frame)
+                    : detector.inference(warp ? warpedDetectorView(frame) : frame);
+
+            std::vector<eox::dnn::RoI> detected;
+            detected.reserve(detections.size());
+            for (const auto &detection: detections) {
+                if (detection.score < threshold_detector)
+                    continue;
+                _detector_score = std::max(_detector_score, detection.score);
+                detected.push_back(eox::dnn::clamp_roi(
+                        detectedRoi(detection, frame.cols, frame.rows),
+                        frame.cols,
+                        frame.rows));
+            }
+
+            tracker.associate(detected);
+        }
+
+        // ROIs used in this pass, tracks predict new ones during update
+        const auto active = tracker.active();
+        std::vector<eox::dnn::RoI> regions;
+        regions.reserve(active.size());
+        for (const auto &index: active)
+            regions.push_back(tracker.getTracks().at(index).roi);
+
+        // all the people within single landmarks model invocation
+        std::vector<PoseOutput> results;
+        if (chroma_key) {
+            // keyed blobs are produced on device one by one
+            results.reserve(regions.size());
+            for (const auto &region: regions)
+                results.push_back(keyedPose(region));
+        } else {
+            std::vector<cv::UMat> sources;
+            sources.reserve(regions.size());
+            for (const auto &region: regions)
+                sources.push_back(cropRoi(frame, region));
+            results = pose.inference(sources);
+        }
+
+        const auto now = timestamp();
+        const auto &predictor = roiPredictor
+                .setMargin(roi_margin)
+                .setFixX(roi_padding_x)
+                .setFixY(roi_padding_y)
+                .setScale(roi_scale);
+
+        int primary = -1;
+        output.people.reserve(active.size());
+        for (int k = 0; k < active.size(); k++) {
+            auto &result = results.at(k);
+            _pose_score = std::max(_pose_score, result.score);
+
+            if (!tracker.update(active[k], result, now, predictor, frame.cols, frame.rows, threshold_pose, roi_clamp_window))
+                continue;
+
+            const auto &track = tracker.getTracks().at(active[k]);
+            PoseTrackOutput person;
+            person.id = track.id;
+            person.roi = regions[k];
+            person.score = result.score;
+            memcpy(person.landmarks, track.landmarks, 39 * sizeof(eox::dnn::Landmark));
+            memcpy(person.ws_landmarks, result.landmarks_3d, 39 * sizeof(eox::dnn::Coord3d));
+
+            // tracks are ordered by age, the first one found is the oldest one
+            if (primary < 0) {
+                primary = k;
+                output.segmentation = std::move(result.segmentation);
+                memcpy(output.landmarks, person.landmarks, 39 * sizeof(eox::dnn::Landmark));
+                memcpy(output.ws_landmarks, person.ws_landmarks, 39 * sizeof(eox::dnn::Coord3d));
+                output.score = person.score;
+                output.present = true;
+            }
+
+            output.people.push_back(person);
+        }
+
+        tracker.commit();
+
+        // primary person's ROI is the one used for segmentation and debug metadata
+        roi = primary >= 0 ? regions[primary] : eox::dnn::RoI{};
+
+        if (output.present && segmentation()) {
+            performSegmentation(output.segmentation, view, segmented);
+        } else {
+            segmented = view;
+        }
+
+        if (debug) {
+            segmented.copyTo(*debug);
+            printMetadata(*debug, t0, 1);
+            for (const auto &person: output.people) {
+                drawJoints(person.landmarks, *debug);
+                drawLandmarks(person.landmarks, person.ws_landmarks, *debug);
+            }
+            for (const auto &region: regions)
+                drawRoi(*debug, region);
+        }
+
+        return output;
+    }
+
+} // eox
@@ -0,0 +1,77 @@
+//
+// Created by henryco on 21/07/24.
+//
+
+#include "../../xmotion/core/dnn/pose_pipeline.h"
+#include <opencv2/imgproc.hpp>
+
+namespace eox::dnn {
+
+    void PosePipeline::setUndistortMaps(const cv::Mat &map_x, const cv::Mat &map_y) {
+        if (map_x.empty() || map_y.empty()) {
+            undistort_map_x.release();
+            undistort_map_y.release();
+            return;
+        }
+
+        map_x.copyTo(undistort_map_x);
+        map_y.copyTo(undistort_map_y);
+    }
+
+    bool PosePipeline::undistortWarp() const {
+        return !undistort_map_x.empty() && !chroma_key;
+    }
+
+    void PosePipeline::undistortFrame(const cv::UMat &frame, cv::UMat &out) const {
+        cv::remap(frame, out, undistort_map_x, undistort_map_y, cv::INTER_LINEAR);
+    }
+
+    cv::UMat PosePipeline::warpedDetectorView(const cv::UMat &frame) const {
+        // detector input is the whole frame, far smaller than the frame itself,
+        // maps resized to it would sample the frame sparsely, so it is averaged down after the remap
+        const auto scale = std::min(1.f, std::min(
+                (float) detector.get_in_w() / (float) undistort_map_x.cols,
+                (float) detector.get_in_h() / (float) undistort_map_x.rows));
+        const cv::Size size(
+                std::max(1, (int) std::round((float) undistort_map_x.cols * scale)),
+                std::max(1, (int) std::round((float) undistort_map_x.rows * scale)));
+
+        cv::UMat out;
+        undistortFrame(frame, out);
+        if (size == out.size())
+            return out;
+
+        cv::UMat resized;
+        cv::resize(out, resized, size, 0, 0, cv::INTER_AREA);
+        return resized;
+    }
+
+    cv::UMat PosePipeline::warpedRoi(const cv::UMat &frame, const eox::dnn::RoI &region) const {
+        const auto rect = cv::Rect((int) region.x, (int) region.y, (int) region.w, (int) region.h)
+                & cv::Rect(0, 0, undistort_map_x.cols, undistort_map_x.rows);
+
+        // degenerate or off-frame region, nothing to sample
+        if (rect.empty())
+            return {};
+
+        // never upscale, network input resolution at most
+        const auto scale = std::min(1.f, std::min(
+                (float) pose.get_in_w() / (float) rect.width,
+                (float) pose.get_in_h() / (float) rect.height));
+        const cv::Size size(
+                std::max(1, (int) std::round((float) rect.width * scale)),
+                std::max(1, (int) std::round((float) rect.height * scale)));
+
+        // crop of the maps == maps of crop of undistorted frame
+        cv::UMat out;
+        cv::remap(frame, out, undistort_map_x(rect), undistort_map_y(rect), cv::INTER_LINEAR);
+        if (size == rect.size())
+            return out;
+
+        // resized maps would sample the frame sparsely (aliasing), so crop is averaged down after the remap
+        cv::UMat resized;
+        cv::resize(out, resized, size, 0, 0, cv::INTER_AREA);
+        return resized;
+    }
+
+} // eox
@@ -0,0 +1,247 @@
+//
+// Created by henryco on 21/07/24.
+//
+
+#include "../../xmotion/core/dnn/pose_tracker.h"
+#include "../../xmotion/core/dnn/net/ssd_anchors.h"
+
+#include <algorithm>
+
+namespace eox::dnn {
+
+    /**
+     * Tracks with ROIs overlapping more than this are following the same person
+     */
+    constexpr float DUPLICATE_IOU = 0.6f;
+
+    static eox::dnn::Box box(const eox::dnn::RoI &roi) {
+        return {roi.x, roi.y, roi.w, roi.h};
+    }
+
+    bool PoseTracker::needsDetection() const {
+        if (tracks.empty())
+            return true;
+
+        // lost tracks are waiting for re-acquisition
+        for (const auto &track: tracks)
+            if (!track.prediction)
+                return true;
+
+        return (int) tracks.size() < capacity && passes >= reacquire;
+    }
+
+    void PoseTracker::associate(const std::vector<eox::dnn::RoI> &detected) {
+        passes = 0;
+
+        std::vector<bool> matched(tracks.size(), false);
+        for (const auto &roi: detected) {
+            int best = -1;
+            float best_score = 0.f;
+
+            for (int i = 0; i < tracks.size(); i++) {
+                if (matched[i])
+                    continue;
+
+                // landmarks are more reliable than overlap
+                const float overlap = ssd::region_iou(box(tracks[i].roi), box(roi));
+                const bool inside = within(roi, tracks[i].landmarks);
+                if (overlap < iou_threshold && !inside)
+                    continue;
+
+                const float score = overlap + (inside ? 1.f : 0.f);
+                if (score > best_score) {
+                    best_score = score;
+                    best = i;
+                }
+            }
+
+            if (best >= 0) {
+                matched[best] = true;
+                auto &track = tracks[best];
+
+                // own prediction is always better than detector
+                if (track.prediction)
+                    continue;
+
+                if (track.misses > 0) {
+                    // previous points are gone
+                    for (auto &filter: track.filters)
+                        filter.reset();
+                }
+
+                track.roi = roi;
+                track.ready = true;
+                continue;
+            }
+
+            if ((int) tracks.size() < capacity) {
+                emplace(roi);
+                matched.push_back(true);
+            }
+        }
+    }
+
+    std::vector<int> PoseTracker::active() const {
+        std::vector<int> indexes;
+        indexes.reserve(tracks.size());
+        for (int i = 0; i < tracks.size(); i++)
+            if (tracks[i].ready)
+                indexes.push_back(i);
+        return indexes;
+    }
+
+    bool PoseTracker::update(int index,
+                             const eox::dnn::PoseOutput &result,
+                             std::chrono::nanoseconds now,
+                             const eox::dnn::PoseRoi &predictor,
+                             int width,
+                             int height,
+                             float threshold,
+                             float clamp_window) {
+        auto &track = tracks.at(index);
+        track.updated = true;
+        track.ready = false;
+
+        if (result.score <= threshold) {
+            track.present = false;
+            track.prediction = false;
+            return false;
+        }
+
+        const auto &roi = track.roi;
+        for (int i = 0; i < 39; i++) {
+            const auto idx = i * 3;
+            auto &mark = track.landmarks[i];
+
+            // back to frame's coordinate system, z is still normalized
+            mark.x = track.filters[idx + 0].filter(now, (result.landmarks_norm[i].x * roi.w) + roi.x);
+            mark.y = track.filters[idx + 1].filter(now, (result.landmarks_norm[i].y * roi.h) + roi.y);
+            mark.z = track.filters[idx + 2].filter(now, result.landmarks_norm[i].z);
+            mark.v = result.landmarks_norm[i].v;
+            mark.p = result.landmarks_norm[i].p;
+        }
+
+        const auto next = predictor.forward(eox::dnn::roiFromPoseLandmarks39(track.landmarks));
+        const auto clamped = eox::dnn::clamp_roi(next, width, height);
+
+        // clamped roi too small, gotta use detector
+        track.prediction = clamped.w / next.w > clamp_window && clamped.h / next.h > clamp_window;
+        track.ready = track.prediction;
+        track.roi = clamped;
+        track.present = true;
+        track.misses = 0;
+        return true;
+    }
+
+    void PoseTracker::commit() {
+        for (auto &track: tracks) {
+            if (!track.updated)
+                track.present = false;
+            if (!track.present)
+                track.misses++;
+            track.updated = false;
+        }
+
+        // older track wins, newer ones are later in the vector
+        for (int i = 0; i < tracks.size(); i++) {
+            if (!tracks[i].present)
+                continue;
+            for (int j = i + 1; j < tracks.size(); j++) {
+                if (tracks[j].present && ssd::region_iou(box(tracks[i].roi), box(tracks[j].roi)) > DUPLICATE_IOU)
+                    tracks[j].misses = max_misses + 1;
+            }
+        }
+
+        tracks.erase(std::remove_if(tracks.begin(), tracks.end(), [this](const Track &track) {
+            return track.misses > max_misses;
+        }), tracks.end());
+
+        passes++;
+    }
+
+    void PoseTracker::reset() {
+        tracks.clear();
+        passes = 0;
+    }
+
+    PoseTracker::Track &PoseTracker::emplace(const eox::dnn::RoI &roi) {
+        Track track{};
+        track.filters.reserve(117); // 39 * (x,y,z)
+        for (int i = 0; i < 117; i++)
+            track.filters.emplace_back(f_win_size, f_v_scale, f_fps);
+        track.roi = roi;
+        track.id = next_id++;
+        track.ready = true;
+        tracks.push_back(std::move(track));
+        return tracks.back();
+    }
+
+    bool PoseTracker::within(const eox::dnn::RoI &roi, const eox::dnn::Landmark landmarks[39]) {
+        float x0 = landmarks[0].x, x1 = landmarks[0].x;
+        float y0 = landmarks[0].y, y1 = landmarks[0].y;
+
+        // body landmarks only, no auxiliary points
+        for (int i = 1; i < 33; i++) {
+            x0 = std::min(x0, landmarks[i].x);
+            x1 = std::max(x1, landmarks[i].x);
+            y0 = std::min(y0, landmarks[i].y);
+            y1 = std::max(y1, landmarks[i].y);
+        }
+
+        // no landmarks yet
+        if (x1 - x0 <= 0 || y1 - y0 <= 0)
+            return false;
+
+        return roi.c.x >= x0 && roi.c.x <= x1 && roi.c.y >= y0 && roi.c.y <= y1;
+    }
+
+    const std::vector<PoseTracker::Track> &PoseTracker::getTracks() const {
+        return tracks;
+    }
+
+    void PoseTracker::setCapacity(int n) {
+        capacity = std::max(1, n);
+    }
+
+    void PoseTracker::setIouThreshold(float threshold) {
+        iou_threshold = threshold;
+    }
+
+    void PoseTracker::setMaxMisses(int n) {
+        max_misses = std::max(0, n);
+    }
+
+    void PoseTracker::setReacquireInterval(int n) {
+        reacquire = std::max(0, n);
+    }
+
+    void PoseTracker::setFilter(int window, float velocity, int fps) {
+        f_win_size = window;
+        f_v_scale = velocity;
+        f_fps = fps;
+        for (auto &track: tracks) {
+            for (auto &filter: track.filters) {
+                filter.setWindowSize(window);
+                filter.setVelocityScale(velocity);
+                filter.setTargetFps(fps);
+            }
+        }
+    }
+
+    int PoseTracker::getCapacity() const {
+        return capacity;
+    }
+
+    float PoseTracker::getIouThreshold() const {
+        return iou_threshold;
+    }
+
+    int PoseTracker::getMaxMisses() const {
+        return max_misses;
+    }
+
+    int PoseTracker::getReacquireInterval() const {
+        return reacquire;
+    }
+
+} // eox
@@ -0,0 +1,122 @@
+//
+// Created by henryco on 21/07/24.
+//
+
+#include "../../xmotion/core/utils/quality_governor.h"
+
+#include <algorithm>
+
+namespace xm::util {
+
+    void QualityGovernor::init(const GovernorConf &_conf, const std::vector<int> &_max_levels) {
+        conf = _conf;
+        max_levels = _max_levels;
+        limits = _max_levels;
+        levels.assign(max_levels.size(), 0);
+        latencies.assign(max_levels.size(), 0.f);
+        pending.assign(max_levels.size(), 0.f);
+        frame_ms = 0.f;
+        over = 0;
+        under = 0;
+        hold = 0;
+    }
+
+    void QualityGovernor::report(int index, float ms) {
+        pending.at(index) += ms;
+    }
+
+    int QualityGovernor::update(float ms) {
+        const auto average = [this](float value, float ema) {
+            return ema <= 0.f ? value : conf.alpha * value + (1.f - conf.alpha) * ema;
+        };
+
+        frame_ms = average(ms, frame_ms);
+        for (int i = 0; i < pending.size(); i++) {
+            if (pending[i] > 0.f)
+                latencies[i] = average(pending[i], latencies[i]);
+            pending[i] = 0.f;
+        }
+
+        if (!enabled())
+            return -1;
+
+        // new level has to settle first
+        if (hold > 0) {
+            hold--;
+            return -1;
+        }
+
+        const float budget = 1000.f / conf.fps;
+        over = frame_ms > budget * (1.f + conf.margin_down) ? over + 1 : 0;
+        under = frame_ms < budget * (1.f - conf.margin_up) ? under + 1 : 0;
+
+        int index = -1;
+        if (over >= conf.window_down)
+            index = step_down();
+        else if (under >= conf.window_up)
+            index = step_up();
+
+        if (index >= 0) {
+            over = 0;
+            under = 0;
+            hold = conf.cooldown;
+        }
+
+        return index;
+    }
+
+    int QualityGovernor::step_down() {
+        int index = -1;
+        for (int i = 0; i < levels.size(); i++) {
+            if (levels[i] >= limits[i])
+                continue;
+            if (index < 0 || latencies[i] > latencies[index])
+                index = i;
+        }
+
+        if (index >= 0)
+            levels[index]++;
+        return index;
+    }
+
+    int QualityGovernor::step_up() {
+        int index = -1;
+        for (int i = 0; i < levels.size(); i++) {
+            if (levels[i] <= 0)
+                continue;
+            if (index < 0
+                || levels[i] > levels[index]
+                || (levels[i] == levels[index] && latencies[i] < latencies[index]))
+                index = i;
+        }
+
+        if (index >= 0)
+            levels[index]--;
+        return index;
+    }
+
+    bool QualityGovernor::limit(int index, int max_level) {
+        limits.at(index) = std::clamp(max_level, 0, max_levels.at(index));
+        if (levels.at(index) <= limits.at(index))
+            return false;
+        levels.at(index) = limits.at(index);
+        return true;
+    }
+
+    int QualityGovernor::level(int index) const {
+        return levels.at(index);
+    }
+
+    float QualityGovernor::latency(int index) const {
+        return latencies.at(index);
+    }
+
+    float QualityGovernor::frame_time() const {
+        return frame_ms;
+    }
+
+    bool QualityGovernor::enabled() const {
+        return conf.fps > 0 && std::any_of(max_levels.begin(), max_levels.end(), [](int l) { return l > 0; });
+    }
+
+} // xm::util
@@ -0,0 +1,194 @@
+//
+// Created by henryco on 21/07/24.
+//
+
+#include "../../xmotion/core/camera/raw_reader.h"
+#include "../../xmotion/core/sink/raw_recorder.h"
+#include "../../xmotion/core/utils/frame_codec.h"
+
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+
+namespace xm {
+
+    namespace {
+        template<typename T>
+        inline const uint8_t *get(const uint8_t *src, T &value) {
+            std::memcpy(&value, src, sizeof(T)); // little endian
+            return src + sizeof(T);
+        }
+
+        std::filesystem::path chunk_file(const std::filesystem::path &dir, int chunk) {
+            char name[32];
+            snprintf(name, sizeof(name), "chunk_%05d.xmr", chunk);
+            return dir / name;
+        }
+    }
+
+    bool RawReader::is_recording(const std::filesystem::path &dir) {
+        std::error_code error;
+        return std::filesystem::is_directory(dir, error) && std::filesystem::exists(dir / "index.csv", error);
+    }
+
+    void RawReader::open(const std::filesystem::path &_dir) {
+        release();
+        dir = _dir;
+
+        std::ifstream index(dir / "index.csv");
+        if (!index.is_open())
+            throw std::runtime_error("Cannot open recording index: " + (dir / "index.csv").string());
+
+        std::string line;
+        std::getline(index, line); // header
+        while (std::getline(index, line)) {
+            if (line.empty())
+                continue;
+            std::replace(line.begin(), line.end(), ',', ' ');
+            std::istringstream ss(line);
+            Entry e{};
+            if (ss >> e.seq >> e.timestamp >> e.chunk >> e.offset >> e.size)
+                entries.push_back(e);
+        }
+
+        if (entries.empty())
+            throw std::runtime_error("Recording is empty: " + dir.string());
+
+        // frames are written in order per camera, but just in case
+        std::sort(entries.begin(), entries.end(), [](const Entry &a, const Entry &b) { return a.seq < b.seq; });
+
+        cv::Mat first;
+        load(entries.front(), first);
+        cols = first.cols;
+        rows = first.rows;
+    }
+
+    bool RawReader::isOpened() const {
+        return !entries.empty();
+    }
+
+    void RawReader::release() {
+        entries.clear();
+        stream.close();
+        stream_chunk = -1;
+        last.release();
+        frame = 0;
+        entry = 0;
+    }
+
+    bool RawReader::read(cv::Mat &out) {
+        if (entries.empty() || frame >= length())
+            return false;
+
+        const auto seq = entries.front().seq + frame;
+        if (entry < entries.size() && entries[entry].seq == seq) {
+            // delivered frames may still be in use, never decoded into
+            last.release();
+            load(entries[entry], last);
+            entry++;
+        }
+
+        // dropped while recording, previous frame is repeated
+        if (last.empty())
+            return false;
+
+        out = last;
+        frame++;
+        return true;
+    }
+
+    void RawReader::seek(int _frame) {
+        if (entries.empty())
+            return;
+
+        frame = std::clamp(_frame, 0, length());
+        const auto seq = entries.front().seq + frame;
+        const auto it = std::lower_bound(entries.begin(), entries.end(), seq,
+                                         [](const Entry &e, uint64_t s) { return e.seq < s; });
+        entry = it - entries.begin();
+
+        // frame to be repeated if the very frame has been dropped
+        last.release();
+        if (entry > 0 && (entry == entries.size() || entries[entry].seq != seq))
+            load(entries[entry - 1], last);
+    }
+
+    int RawReader::position() const {
+        return frame;
+    }
+
+    int RawReader::length() const {
+        if (entries.empty())
+            return 0;
+        return (int) (entries.back().seq - entries.front().seq + 1);
+    }
+
+    double RawReader::fps() const {
+        if (entries.size() < 2)
+            return 0;
+        const auto span = (double) (entries.back().timestamp - entries.front().timestamp) / 1e9;
+        const auto frames = (double) (entries.back().seq - entries.front().seq);
+        return span > 0 ? frames / span : 0;
+    }
+
+    int RawReader::width() const {
+        return cols;
+    }
+
+    int RawReader::height() const {
+        return rows;
+    }
+
+    void RawReader::load(const Entry &e, cv::Mat &out) {
+        if (stream_chunk != e.chunk) {
+            stream.close();
+            stream.clear();
+            stream.open(chunk_file(dir, e.chunk), std::ios::binary);
+            if (!stream.is_open())
+                throw std::runtime_error("Cannot open recording chunk: " + chunk_file(dir, e.chunk).string());
+            stream_chunk = e.chunk;
+        }
+
+        uint8_t header[xm::sink::RawRecorder::HEADER_SIZE];
+        stream.clear();
+        stream.seekg((std::streamoff) e.offset);
+        stream.read(reinterpret_cast<char *>(header), sizeof(header));
+
+        uint32_t magic, cols_, rows_, size;
+        uint64_t seq, timestamp;
+        uint8_t channels, codec;
+        uint16_t reserved;
+        const uint8_t *src = header;
+        src = get(src, magic);
+        src = get(src, seq);
+        src = get(src, timestamp);
+        src = get(src, cols_);
+        src = get(src, rows_);
+        src = get(src, channels);
+        src = get(src, codec);
+        src = get(src, reserved);
+        get(src, size);
+
+        if (!stream.good() || magic != xm::sink::RawRecorder::MAGIC || size != e.size)
+            throw std::runtime_error("Malformed recording: " + dir.string() + ", frame: " + std::to_string(e.seq));
+
+        if (buffer.size() < size)
+            buffer.resize(size);
+        stream.read(reinterpret_cast<char *>(buffer.data()), size);
+        if (!stream.good())
+            throw std::runtime_error("Truncated recording: " + dir.string() + ", frame: " + std::to_string(e.seq));
+
+        if (codec == xm::util::codec::QOI) {
+            out.create((int) rows_, (int) cols_, CV_8UC(channels));
+            xm::util::codec::decode(buffer.data(), size, out);
+            return;
+        }
+
+        // raw pixels, depth is not recorded (8 bit for cameras anyway)
+        const size_t elements = (size_t) cols_ * rows_ * channels;
+        const int depth = size == elements * 2 ? CV_16U : size == elements * 4 ? CV_32F : CV_8U;
+        out.create((int) rows_, (int) cols_, CV_MAKETYPE(depth, channels));
+        std::memcpy(out.data, buffer.data(), std::min<size_t>(size, out.total() * out.elemSize()));
+    }
+
+} // xm
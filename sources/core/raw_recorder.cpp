@@ -0,0 +1,310 @@
+//
+// Created by henryco on 21/07/24.
+//
+
+#include "../../xmotion/core/sink/raw_recorder.h"
+#include "../../xmotion/core/utils/frame_codec.h"
+#include "../../xmotion/core/ocl/ocl_interop.h"
+#include "../../xmotion/core/ocl/cl_kernel.h"
+
+#include <cstring>
+#include <type_traits>
+
+namespace xm::sink {
+
+    namespace {
+        template<typename T>
+        inline uint8_t *put(uint8_t *dst, T value) {
+            std::memcpy(dst, &value, sizeof(T)); // little endian
+            return dst + sizeof(T);
+        }
+    }
+
+    RawRecorder::RawRecorder(std::string _path, const std::vector<std::string> &names, int _threads, int queue, int _chunk):
+            path(std::move(_path)),
+            capacity((size_t) std::max(1, queue) * std::max<size_t>(1, names.size())),
+            threads(std::max(1, _threads)),
+            chunk(std::max(1, _chunk)) {
+        streams.reserve(names.size());
+        for (const auto &name: names) {
+            auto stream = std::make_unique<Stream>();
+            stream->name = name;
+            stream->dir = path / name;
+            streams.push_back(std::move(stream));
+        }
+    }
+
+    RawRecorder::~RawRecorder() {
+        close();
+    }
+
+    void RawRecorder::open() {
+        if (running)
+            return;
+
+        for (auto &stream: streams) {
+            std::filesystem::create_directories(stream->dir);
+            stream->index.open(stream->dir / "index.csv", std::ios::out | std::ios::trunc);
+            if (!stream->index.is_open())
+                throw std::runtime_error("Cannot open recording index: " + (stream->dir / "index.csv").string());
+            stream->index << "seq,timestamp,chunk,offset,size\n";
+        }
+
+        stop = false;
+        running = true;
+        started = std::chrono::steady_clock::now();
+        workers.reserve(threads);
+        for (int i = 0; i < threads; i++)
+            workers.emplace_back(&RawRecorder::worker, this);
+
+        log->info("recording {} cameras to: {}, {} threads", streams.size(), path.string(), threads);
+    }
+
+    void RawRecorder::push(const std::vector<xm::ocl::Image2D> &frames) {
+        enqueue(frames);
+    }
+
+    void RawRecorder::push(const std::vector<cv::Mat> &frames) {
+        enqueue(frames);
+    }
+
+    template<typename T>
+    void RawRecorder::enqueue(const std::vector<T> &frames) {
+        if (!running)
+            return;
+
+        const auto timestamp = (uint64_t) std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - started).count();
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            const auto n = (int) std::min(frames.size(), streams.size());
+            for (int i = 0; i < n; i++) {
+                if (frames[i].empty())
+                    continue;
+
+                // backpressure: capture loop is never stalled, frame is lost instead
+                if (queue.size() >= capacity) {
+                    streams[i]->dropped++;
+                    continue;
+                }
+
+                Job job = {
+                        .stream = i,
+                        .order = streams[i]->accepted++,
+                        .seq = seq,
+                        .timestamp = timestamp
+                };
+                if constexpr (std::is_same_v<T, cv::Mat>)
+                    job.frame = frames[i];
+                else
+                    job.image = frames[i];
+                queue.push_back(std::move(job));
+            }
+            seq++;
+        }
+        flag.notify_all();
+    }
+
+    void RawRecorder::worker() {
+        cl_command_queue ocl_queue = nullptr;
+        Encoded encoded{};
+
+        while (true) {
+            Job job;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                flag.wait(lock, [this]() { return stop || !queue.empty(); });
+                if (queue.empty())
+                    break;
+                job = std::move(queue.front());
+                queue.pop_front();
+            }
+
+            const auto t0 = std::chrono::steady_clock::now();
+            auto &stream = *streams.at(job.stream);
+
+            try {
+                encode(job, encoded, ocl_queue);
+            } catch (const std::exception &e) {
+                // still committed (as empty), otherwise following frames would wait forever
+                log->error("cannot encode frame {} of: {}, {}", job.seq, stream.name, e.what());
+                encoded.size = 0;
+            }
+
+            commit(stream, job.order, encoded);
+            cpu_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - t0).count();
+        }
+
+        if (ocl_queue != nullptr)
+            clReleaseCommandQueue(ocl_queue);
+    }
+
+    void RawRecorder::encode(Job &job, Encoded &out, cl_command_queue &ocl_queue) {
+        if (job.frame.empty()) {
+            if (ocl_queue == nullptr && !job.image.on_host())
+                ocl_queue = xm::ocl::create_queue_device(job.image.context, job.image.device, true, false);
+            xm::ocl::iop::to_cv_mat(job.image, job.frame, ocl_queue);
+            job.image = {};
+        }
+
+        const auto &frame = job.frame;
+        const auto raw = frame.total() * frame.elemSize();
+
+        out.seq = job.seq;
+        out.timestamp = job.timestamp;
+        out.cols = frame.cols;
+        out.rows = frame.rows;
+        out.channels = frame.channels();
+        out.codec = xm::util::codec::RAW;
+        out.size = 0;
+
+        if (frame.depth() == CV_8U && (frame.channels() == 1 || frame.channels() == 3 || frame.channels() == 4)) {
+            out.size = xm::util::codec::encode(frame, out.data);
+            out.codec = xm::util::codec::QOI;
+        }
+
+        // noise does not compress, stored as is
+        if (out.codec == xm::util::codec::RAW || out.size >= raw) {
+            const cv::Mat continuous = frame.isContinuous() ? frame : frame.clone();
+            if (out.data.size() < raw)
+                out.data.resize(raw);
+            std::memcpy(out.data.data(), continuous.data, raw);
+            out.codec = xm::util::codec::RAW;
+            out.size = raw;
+        }
+    }
+
+    void RawRecorder::commit(Stream &stream, uint64_t order, const Encoded &encoded) {
+        std::lock_guard<std::mutex> lock(stream.mutex);
+
+        if (order != stream.written) {
+            Encoded copy = {
+                    .seq = encoded.seq,
+                    .timestamp = encoded.timestamp,
+                    .cols = encoded.cols,
+                    .rows = encoded.rows,
+                    .channels = encoded.channels,
+                    .codec = encoded.codec,
+                    .data = std::vector<uint8_t>(encoded.data.begin(), encoded.data.begin() + (long) encoded.size),
+                    .size = encoded.size
+            };
+            stream.pending.emplace(order, std::move(copy));
+            return;
+        }
+
+        write(stream, encoded);
+        stream.written++;
+
+        while (!stream.pending.empty() && stream.pending.begin()->first == stream.written) {
+            write(stream, stream.pending.begin()->second);
+            stream.pending.erase(stream.pending.begin());
+            stream.written++;
+        }
+    }
+
+    void RawRecorder::write(Stream &stream, const Encoded &encoded) const {
+        if (encoded.size == 0)
+            return;
+
+        if (!stream.chunk.is_open() || stream.chunk_frames >= chunk) {
+            if (stream.chunk.is_open())
+                stream.chunk.close();
+
+            char name[32];
+            snprintf(name, sizeof(name), "chunk_%05d.xmr", ++stream.chunk_id);
+            stream.chunk.open(stream.dir / name, std::ios::binary | std::ios::out | std::ios::trunc);
+            if (!stream.chunk.is_open()) {
+                log->error("cannot open recording chunk: {}", (stream.dir / name).string());
+                return;
+            }
+
+            stream.chunk_frames = 0;
+            stream.offset = 0;
+        }
+
+        uint8_t header[HEADER_SIZE];
+        uint8_t *dst = header;
+        dst = put<uint32_t>(dst, MAGIC);
+        dst = put<uint64_t>(dst, encoded.seq);
+        dst = put<uint64_t>(dst, encoded.timestamp);
+        dst = put<uint32_t>(dst, encoded.cols);
+        dst = put<uint32_t>(dst, encoded.rows);
+        dst = put<uint8_t>(dst, encoded.channels);
+        dst = put<uint8_t>(dst, encoded.codec);
+        dst = put<uint16_t>(dst, 0);
+        put<uint32_t>(dst, (uint32_t) encoded.size);
+
+        stream.chunk.write(reinterpret_cast<const char *>(header), HEADER_SIZE);
+        stream.chunk.write(reinterpret_cast<const char *>(encoded.data.data()), (std::streamsize) encoded.size);
+        if (!stream.chunk.good()) {
+            log->error("cannot write recording chunk of: {}, closing", stream.name);
+            stream.chunk.close();
+            return;
+        }
+
+        stream.index << encoded.seq << ',' << encoded.timestamp << ',' << stream.chunk_id << ','
+                     << stream.offset << ',' << encoded.size << '\n';
+
+        stream.offset += HEADER_SIZE + encoded.size;
+        stream.chunk_frames++;
+        stream.bytes_in += (uint64_t) encoded.cols * encoded.rows * encoded.channels;
+        stream.bytes_out += HEADER_SIZE + encoded.size;
+    }
+
+    void RawRecorder::close() {
+        if (!running)
+            return;
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stop = true;
+        }
+        flag.notify_all();
+        for (auto &worker: workers)
+            worker.join();
+        workers.clear();
+        running = false;
+
+        for (auto &stream: streams) {
+            std::lock_guard<std::mutex> lock(stream->mutex);
+            if (stream->chunk.is_open())
+                stream->chunk.close();
+            if (stream->index.is_open())
+                stream->index.close();
+        }
+
+        report();
+    }
+
+    RawRecorder::Stats RawRecorder::stats() const {
+        Stats stats;
+        for (const auto &stream: streams) {
+            std::lock_guard<std::mutex> lock(stream->mutex);
+            stats.frames += stream->written;
+            stats.dropped += stream->dropped;
+            stats.bytes_in += stream->bytes_in;
+            stats.bytes_out += stream->bytes_out;
+        }
+        stats.cpu_ms = (double) cpu_ns / 1e6;
+        return stats;
+    }
+
+    void RawRecorder::report() const {
+        const auto seconds = std::max(1e-3, std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count());
+        for (const auto &stream: streams) {
+            std::lock_guard<std::mutex> lock(stream->mutex);
+            const auto in = (double) stream->bytes_in;
+            const auto out = (double) stream->bytes_out;
+            log->info("recorded: {}, frames: {}, dropped: {}, {:.1f} MB/s in, {:.1f} MB/s out, ratio: {:.3f}",
+                      stream->name, stream->written, stream->dropped.load(),
+                      in / seconds / 1e6, out / seconds / 1e6, in > 0 ? out / in : 0.);
+        }
+
+        const auto total = stats();
+        log->info("compression cpu: {:.2f} ms/frame, {:.2f} cores",
+                  total.frames > 0 ? total.cpu_ms / (double) total.frames : 0.,
+                  total.cpu_ms / 1e3 / seconds);
+    }
+
+} // xm::sink
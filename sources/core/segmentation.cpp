@@ -0,0 +1,80 @@
+//
+// Created by henryco on 19/07/24.
+//
+
+#include "../../xmotion/core/dnn/net/segmentation.h"
+
+namespace eox::dnn {
+
+    Segmentation::Segmentation(std::shared_ptr<SegmentationBuffer> buffer): buffer(std::move(buffer)) {
+    }
+
+    Segmentation Segmentation::share() const {
+        return Segmentation(buffer);
+    }
+
+    bool Segmentation::empty() const {
+        return buffer == nullptr;
+    }
+
+    int Segmentation::width() const {
+        return buffer ? buffer->width : 0;
+    }
+
+    int Segmentation::height() const {
+        return buffer ? buffer->height : 0;
+    }
+
+    const float *Segmentation::data() const {
+        return buffer ? buffer->data.data() : nullptr;
+    }
+
+    float *Segmentation::data() {
+        return buffer ? buffer->data.data() : nullptr;
+    }
+
+    Segmentation::operator bool() const {
+        return buffer != nullptr;
+    }
+
+    SegmentationPool::SegmentationPool(size_t capacity): capacity(capacity) {
+    }
+
+    Segmentation SegmentationPool::acquire(int width, int height) {
+        std::unique_ptr<SegmentationBuffer> buffer;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!available.empty()) {
+                buffer = std::move(available.back());
+                available.pop_back();
+            }
+        }
+
+        if (!buffer)
+            buffer = std::make_unique<SegmentationBuffer>();
+
+        // capacity is preserved, so there is no allocation for the same size
+        buffer->data.resize((size_t) width * height);
+        buffer->width = width;
+        buffer->height = height;
+
+        // pool can be gone before the last handle
+        std::weak_ptr<SegmentationPool> pool = weak_from_this();
+        return Segmentation(std::shared_ptr<SegmentationBuffer>(
+                buffer.release(),
+                [pool](SegmentationBuffer *ptr) {
+                    if (auto p = pool.lock())
+                        p->release(ptr);
+                    else
+                        delete ptr;
+                }));
+    }
+
+    void SegmentationPool::release(SegmentationBuffer *buffer) {
+        std::unique_ptr<SegmentationBuffer> ptr(buffer);
+        std::lock_guard<std::mutex> lock(mutex);
+        if (available.size() < capacity)
+            available.push_back(std::move(ptr));
+    }
+
+} // eox
@@ -0,0 +1,114 @@
+//
+// Created by henryco on 16/07/24.
+//
+
+#include "../../xmotion/core/sink/shm_ring.h"
+
+#include <climits>
+#include <cstring>
+#include <stdexcept>
+
+namespace xm::sink {
+
+    ShmRing::ShmRing(std::string name, uint32_t slots, uint32_t slot_size):
+            name(std::move(name)), slots(slots), slot_size(slot_size) {
+        if (slots < 2)
+            throw std::invalid_argument("Shared memory ring requires at least 2 slots");
+    }
+
+    ShmRing::~ShmRing() {
+        close();
+    }
+
+    void ShmRing::open() {
+        if (header != nullptr)
+            return;
+
+        length = xm_ring_length(slots, slot_size);
+
+        // stale object from previous run may have different geometry
+        shm_unlink(name.c_str());
+
+        const int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+        if (fd < 0)
+            throw std::runtime_error("Cannot create shared memory: " + name + ", " + std::strerror(errno));
+
+        if (ftruncate(fd, (off_t) length) != 0) {
+            const auto err = std::string(std::strerror(errno));
+            ::close(fd);
+            shm_unlink(name.c_str());
+            throw std::runtime_error("Cannot resize shared memory: " + name + ", " + err);
+        }
+
+        void *ptr = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (ptr == MAP_FAILED) {
+            shm_unlink(name.c_str());
+            throw std::runtime_error("Cannot map shared memory: " + name + ", " + std::strerror(errno));
+        }
+
+        // fresh object is zero filled, so every slot lock is 0 (empty)
+        header = static_cast<xm_ring_header *>(ptr);
+        slots_base = static_cast<uint8_t *>(ptr) + sizeof(xm_ring_header);
+        header->version = XM_RING_VERSION;
+        header->slots = slots;
+        header->slot_size = slot_size;
+        header->stride = (uint32_t) xm_ring_stride(slot_size);
+        header->futex = 0;
+        header->head = 0;
+
+        // readers validate magic, so it goes last
+        __atomic_store_n(&header->magic, XM_RING_MAGIC, __ATOMIC_RELEASE);
+        head = 0;
+
+        log->info("shared memory ring: {}, slots: {}, slot size: {}, total: {}", name, slots, slot_size, length);
+    }
+
+    bool ShmRing::publish(const void *data, uint32_t size) {
+        if (header == nullptr)
+            return false;
+        if (size > slot_size)
+            return false;
+
+        const uint64_t n = head + 1;
+        auto *slot = reinterpret_cast<xm_ring_slot *>(slots_base + (size_t) (n % slots) * header->stride);
+
+        // odd -> slot is being written, payload stores must not move above it
+        __atomic_store_n(&slot->lock, 2 * n - 1, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_RELEASE);
+
+        std::memcpy(reinterpret_cast<uint8_t *>(slot) + sizeof(xm_ring_slot), data, size);
+        slot->size = size;
+        slot->published = xm_ring_now();
+
+        __atomic_store_n(&slot->lock, 2 * n, __ATOMIC_RELEASE);
+        __atomic_store_n(&header->head, n, __ATOMIC_RELEASE);
+        __atomic_fetch_add(&header->futex, 1, __ATOMIC_RELEASE);
+
+        // shared (not private) futex, readers are in other processes
+        syscall(SYS_futex, &header->futex, FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+
+        head = n;
+        return true;
+    }
+
+    void ShmRing::close() {
+        if (header == nullptr)
+            return;
+
+        munmap(header, length);
+        shm_unlink(name.c_str());
+        header = nullptr;
+        slots_base = nullptr;
+        length = 0;
+    }
+
+    uint64_t ShmRing::sequence() const {
+        return head;
+    }
+
+    uint32_t ShmRing::capacity() const {
+        return slot_size;
+    }
+
+} // xm::sink
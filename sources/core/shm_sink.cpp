@@ -0,0 +1,30 @@
+//
+// Created by henryco on 16/07/24.
+//
+
+#include "../../xmotion/core/sink/shm_sink.h"
+#include "../../xmotion/core/sink/pose_packet.h"
+
+namespace xm::sink {
+
+    ShmSink::ShmSink(std::string name, uint32_t slots, size_t devices):
+            ring(std::move(name), slots, (uint32_t) xm::sink::packet_size(devices)) {}
+
+    void ShmSink::open() {
+        ring.open();
+    }
+
+    void ShmSink::publish(const xm::nview::Result &result) {
+        const auto size = xm::sink::encode(result, buffer);
+        if (ring.publish(buffer.data(), (uint32_t) size) || oversize)
+            return;
+
+        oversize = true;
+        log->error("packet does not fit into the ring slot: {} > {}, dropping", size, ring.capacity());
+    }
+
+    void ShmSink::close() {
+        ring.close();
+    }
+
+} // xm::sink
@@ -0,0 +1,105 @@
+//
+// Created by henryco on 14/07/24.
+//
+
+#include "../../xmotion/core/sink/socket_sink.h"
+#include "../../xmotion/core/sink/pose_packet.h"
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <cerrno>
+#include <cstring>
+
+namespace xm::sink {
+
+    SocketSink::SocketSink(std::string path, size_t max_clients):
+            path(std::move(path)), max_clients(max_clients) {}
+
+    SocketSink::~SocketSink() {
+        close();
+    }
+
+    void SocketSink::open() {
+        if (server >= 0)
+            return;
+
+        sockaddr_un address{};
+        if (path.size() >= sizeof(address.sun_path))
+            throw std::runtime_error("Socket path is too long: " + path);
+
+        server = ::socket(AF_UNIX, SOCK_SEQPACKET | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (server < 0)
+            throw std::runtime_error("Cannot create socket: " + std::string(std::strerror(errno)));
+
+        address.sun_family = AF_UNIX;
+        std::strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+
+        // leftover from previous run
+        ::unlink(path.c_str());
+
+        if (::bind(server, (sockaddr *) &address, sizeof(address)) < 0 || ::listen(server, (int) max_clients) < 0) {
+            const auto err = std::string(std::strerror(errno));
+            ::close(server);
+            server = -1;
+            throw std::runtime_error("Cannot bind socket: " + path + ", " + err);
+        }
+
+        log->info("streaming results to: {}", path);
+    }
+
+    void SocketSink::accept_pending() {
+        while (true) {
+            const int client = ::accept4(server, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (client < 0)
+                return;
+
+            if (clients.size() >= max_clients) {
+                log->warn("too many clients, rejecting");
+                ::close(client);
+                continue;
+            }
+
+            log->info("client connected: {}", client);
+            clients.push_back(client);
+        }
+    }
+
+    void SocketSink::publish(const xm::nview::Result &result) {
+        if (server < 0)
+            return;
+
+        accept_pending();
+        if (clients.empty())
+            return;
+
+        const auto size = xm::sink::encode(result, buffer);
+
+        for (auto it = clients.begin(); it != clients.end();) {
+            const auto sent = ::send(*it, buffer.data(), size, MSG_DONTWAIT | MSG_NOSIGNAL);
+            if (sent < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+                // EAGAIN means slow reader, just drop the frame for it
+                log->info("client disconnected: {}", *it);
+                ::close(*it);
+                it = clients.erase(it);
+                continue;
+            }
+            ++it;
+        }
+    }
+
+    void SocketSink::close() {
+        for (const auto client: clients)
+            ::close(client);
+        clients.clear();
+
+        if (server < 0)
+            return;
+
+        ::close(server);
+        ::unlink(path.c_str());
+        server = -1;
+    }
+
+} // xm::sink
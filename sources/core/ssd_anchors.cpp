@@ -4,6 +4,7 @@
 
 #include "../../xmotion/core/dnn/net/ssd_anchors.h"
 
+#include <algorithm>
 #include <cmath>
 
 namespace eox::dnn::ssd {
@@ -157,4 +158,41 @@ namespace eox::dnn::ssd {
 
         return regions;
     }
-}
\ No newline at end of file
+
+    float region_iou(const eox::dnn::Box &a, const eox::dnn::Box &b) {
+        const float x0 = std::max(a.x, b.x);
+        const float y0 = std::max(a.y, b.y);
+        const float x1 = std::min(a.x + a.w, b.x + b.w);
+        const float y1 = std::min(a.y + a.h, b.y + b.h);
+        const float intersection = std::max(0.f, x1 - x0) * std::max(0.f, y1 - y0);
+        const float total = a.w * a.h + b.w * b.h - intersection;
+        return total > 0 ? intersection / total : 0.f;
+    }
+
+    std::vector<eox::dnn::DetectedRegion> suppress(std::vector<eox::dnn::DetectedRegion> regions,
+                                                   float iou,
+                                                   int max) {
+        std::stable_sort(regions.begin(), regions.end(), [](const auto &a, const auto &b) {
+            return a.score > b.score;
+        });
+
+        std::vector<eox::dnn::DetectedRegion> kept;
+        kept.reserve(std::min((int) regions.size(), std::max(0, max)));
+        for (auto &region: regions) {
+            if ((int) kept.size() >= max)
+                break;
+
+            bool overlaps = false;
+            for (const auto &k: kept) {
+                if (region_iou(k.box, region.box) > iou) {
+                    overlaps = true;
+                    break;
+                }
+            }
+
+            if (!overlaps)
+                kept.push_back(std::move(region));
+        }
+        return kept;
+    }
+}
@@ -2,11 +2,13 @@
 // Created by henryco on 4/19/24.
 //
 
+#include <algorithm>
 #include <utility>
 #include <opencv2/core/ocl.hpp>
 
 #include "../../xmotion/core/camera/stereo_camera.h"
 #include "../../xmotion/core/ocl/ocl_filters.h"
+#include "../../xmotion/core/ocl/ocl_cpu.h"
 
 namespace xm {
     int fourCC(const char *name) {
@@ -19,6 +21,7 @@ namespace xm {
 
     StereoCamera::~StereoCamera() {
         log->debug("release stereo camera");
+        stop_grabbers();
         for (auto &queue: command_queues) {
             if (queue.second == nullptr)
                 continue;
@@ -37,6 +40,7 @@ namespace xm {
 
     void StereoCamera::release() {
         log->debug("release captures");
+        stop_grabbers();
         for (auto &capture: captures) {
             log->debug("release capture: {}", capture.first);
             capture.second.release();
@@ -50,7 +54,9 @@ namespace xm {
 
         auto device_id = (cl_device_id) cv::ocl::Device::getDefault().ptr();
         auto ocl_context = (cl_context) cv::ocl::Context::getDefault().ptr();
-        command_queues[prop.device_id] = xm::ocl::create_queue_device(ocl_context, device_id, true, false);
+        command_queues[prop.device_id] = xm::ocl::cpu::enabled()
+                                         ? nullptr
+                                         : xm::ocl::create_queue_device(ocl_context, device_id, true, false);
 
         if (captures.contains(prop.device_id) && captures.at(prop.device_id).isOpened()) {
             log->debug("capture: {} is already open", prop.device_id);
@@ -81,6 +87,12 @@ namespace xm {
             return;
         }
 
+        if (latest) {
+            // frames are captured continuously, nothing to enqueue
+            start_grabbers();
+            return;
+        }
+
         if (!executor) {
             log->debug("no active executors, creating one");
 
@@ -119,6 +131,9 @@ namespace xm {
             return {};
         }
 
+        if (latest)
+            return dequeue_latest();
+
         if (!executor) {
             log->debug("no active executors, creating one");
 
@@ -170,9 +185,15 @@ namespace xm {
             frames[pair.first] = pair.second;
         }
 
+        return transform(frames);
+    }
+
+    std::map<std::string, xm::ocl::Image2D> StereoCamera::transform(const std::map<std::string, xm::ocl::Image2D> &frames) {
         // CROPPING AND FLIPPING
         std::map<std::string, xm::ocl::iop::ClImagePromise> promises;
         for (const auto &property: properties) {
+            if (!frames.contains(property.device_id))
+                continue;
 
             const auto &src = frames.at(property.device_id);
             auto queue = command_queues.at(property.device_id);
@@ -193,8 +214,10 @@ namespace xm {
             }
 
             if (property.flip_x || property.flip_y || property.rotate) {
-                auto promise = xm::ocl::flip_rotate(queue, dst, property.flip_x, property.flip_y, property.rotate);
+                auto promise = xm::ocl::flip_rotate(queue, dst, property.flip_x, property.flip_y, property.rotate, images);
                 promises[property.name] = promise;
+            } else if (images) {
+                promises[property.name] = xm::ocl::attach_image(queue, promises[property.name]);
             }
         }
 
@@ -206,6 +229,124 @@ namespace xm {
         return images;
     }
 
+    void StereoCamera::start_grabbers() {
+        for (const auto &[id, capture]: captures) {
+            if (grabbers.contains(id))
+                continue;
+
+            auto grabber = std::make_unique<Grabber>();
+            for (const auto &prop: properties) {
+                if (prop.device_id != id)
+                    continue;
+                const std::chrono::duration<double> period(1. / std::max(1, prop.fps));
+                grabber->stale_after = std::chrono::duration_cast<std::chrono::steady_clock::duration>(period * 2);
+                break;
+            }
+
+            auto &ref = *grabber;
+            grabbers[id] = std::move(grabber);
+            ref.thread = std::thread(&StereoCamera::grab, this, std::ref(ref), id);
+            log->debug("capture thread started: {}", id);
+        }
+    }
+
+    void StereoCamera::stop_grabbers() {
+        for (auto &[id, grabber]: grabbers)
+            grabber->stop = true;
+
+        for (auto &[id, grabber]: grabbers) {
+            // capture thread finishes with the frame it is waiting for
+            if (grabber->thread.joinable())
+                grabber->thread.join();
+            log->info("camera: {}, captured: {}, delivered: {}, dropped: {}, duplicated: {}, stale: {}",
+                      id, grabber->captured.load(), grabber->delivered.load(), grabber->dropped.load(),
+                      grabber->duplicated.load(), grabber->stale.load());
+        }
+
+        grabbers.clear();
+    }
+
+    void StereoCamera::grab(Grabber &grabber, const std::string &device_id) {
+        auto &capture = captures.at(device_id);
+        auto queue = command_queues.at(device_id);
+
+        while (!grabber.stop) {
+            try {
+                // blocks until driver delivers next frame, so thread runs at camera's pace
+                if (!capture.grab()) {
+                    log->warn("cannot grab frame: {}", device_id);
+                    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+                    continue;
+                }
+
+                const auto timestamp = std::chrono::steady_clock::now();
+
+                cv::Mat frame;
+                capture.retrieve(frame);
+                if (frame.empty()) {
+                    log->warn("empty frame: {}", device_id);
+                    continue;
+                }
+
+                Latest value;
+                value.frames = transform({{device_id, xm::ocl::iop::from_cv_mat(frame, queue).waitFor().getImage2D()}});
+                value.timestamp = timestamp;
+
+                if (grabber.mailbox.push(std::move(value)))
+                    grabber.dropped++;
+                grabber.captured++;
+            } catch (const std::exception &e) {
+                log->error("capture thread failed: {}, {}", device_id, e.what());
+                grabber.stop = true;
+            }
+        }
+    }
+
+    std::map<std::string, xm::ocl::Image2D> StereoCamera::dequeue_latest() {
+        start_grabbers();
+
+        std::map<std::string, xm::ocl::Image2D> frames;
+        for (auto &[id, grabber]: grabbers) {
+            // waits for the first frame only, newest one is returned immediately afterwards
+            while (true) {
+                // capture thread stops on its own only when it fails, its last frame would be repeated forever
+                if (grabber->stop)
+                    throw std::runtime_error("Capture thread has stopped: " + id);
+                if (grabber->captured > 0)
+                    break;
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+
+            if (grabber->mailbox.fetch())
+                grabber->delivered++;
+            else
+                grabber->duplicated++;
+
+            const auto &value = grabber->mailbox.latest();
+            if (std::chrono::steady_clock::now() - value.timestamp > grabber->stale_after)
+                grabber->stale++;
+
+            for (const auto &[name, frame]: value.frames)
+                frames[name] = frame;
+        }
+
+        return frames;
+    }
+
+    std::map<std::string, SCamStats> StereoCamera::getStats() const {
+        std::map<std::string, SCamStats> stats;
+        for (const auto &[id, grabber]: grabbers) {
+            stats[id] = {
+                    .captured = grabber->captured,
+                    .delivered = grabber->delivered,
+                    .dropped = grabber->dropped,
+                    .duplicated = grabber->duplicated,
+                    .stale = grabber->stale,
+            };
+        }
+        return stats;
+    }
+
     std::vector<xm::ocl::Image2D> StereoCamera::capture() {
         const auto results = captureWithName();
         std::vector<xm::ocl::Image2D> vec;
@@ -280,6 +421,24 @@ namespace xm {
         return fast;
     }
 
+    void StereoCamera::setImageObjects(bool _images) {
+        images = _images;
+    }
+
+    bool StereoCamera::getImageObjects() const {
+        return images;
+    }
+
+    void StereoCamera::setLatestMode(bool _latest) {
+        latest = _latest;
+        if (!latest)
+            stop_grabbers();
+    }
+
+    bool StereoCamera::getLatestMode() const {
+        return latest;
+    }
+
     void StereoCamera::setThreadPool(std::shared_ptr<eox::util::ThreadPool> _executor) {
         this->executor = std::move(_executor);
     }
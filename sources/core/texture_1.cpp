@@ -122,6 +122,10 @@ namespace xogl {
             glBindTexture(GL_TEXTURE_2D, 0);
         }
 
+        { // PBO
+            glGenBuffers(2, pbo);
+        }
+
         shader.init();
         tex_loc = glGetUniformLocation(shader.getHandle(), "textureSampler");
     }
@@ -131,6 +135,10 @@ namespace xogl {
             return;
         }
 
+        // storage is replaced, stream has to reallocate it
+        stream_w = 0;
+        stream_h = 0;
+
         glBindTexture(GL_TEXTURE_2D, texture);
         glTexImage2D(GL_TEXTURE_2D,
                      0,
@@ -159,6 +167,84 @@ namespace xogl {
         return texture;
     }
 
+    GLuint Texture1::allocate(GLsizei width, GLsizei height, GLint internal_format, GLenum format) {
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glTexImage2D(GL_TEXTURE_2D,
+                     0,
+                     internal_format,
+                     width,
+                     height,
+                     0,
+                     format,
+                     GL_UNSIGNED_BYTE,
+                     NULL);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        return texture;
+    }
+
+    unsigned char *Texture1::mapStream(GLsizei width, GLsizei height, GLenum format) {
+        const size_t channels = (format == GL_RGBA || format == GL_BGRA) ? 4 : 3;
+        const size_t size = (size_t) width * (size_t) height * channels;
+
+        if (width != stream_w || height != stream_h || format != stream_format) {
+            allocate(width, height, GL_RGB8, format);
+            for (const auto &buffer: pbo) {
+                glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer);
+                glBufferData(GL_PIXEL_UNPACK_BUFFER, (GLsizeiptr) size, NULL, GL_STREAM_DRAW);
+            }
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+            stream_w = width;
+            stream_h = height;
+            stream_format = format;
+            pbo_size = size;
+        }
+
+        // previous buffer may still be in use by the upload, so just use another one
+        pbo_index = (pbo_index + 1) % 2;
+
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo[pbo_index]);
+        auto *ptr = (unsigned char *) glMapBufferRange(
+                GL_PIXEL_UNPACK_BUFFER,
+                0,
+                (GLsizeiptr) pbo_size,
+                GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+        if (ptr == nullptr)
+            log->error("Cannot map pixel buffer: {}", glGetError());
+        stream_mapped = ptr != nullptr;
+        return ptr;
+    }
+
+    void Texture1::unmapStream() {
+        if (!stream_mapped)
+            return;
+        stream_mapped = false;
+
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo[pbo_index]);
+        if (glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER) == GL_FALSE) {
+            // buffer content is undefined, skip this frame
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+            return;
+        }
+
+        // data offset within bound PBO, not a pointer (upload is asynchronous)
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glTexSubImage2D(GL_TEXTURE_2D,
+                        0,
+                        0,
+                        0,
+                        stream_w,
+                        stream_h,
+                        stream_format,
+                        GL_UNSIGNED_BYTE,
+                        0); // NOLINT(*-use-nullptr)
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    }
+
     void Texture1::render() {
         glUseProgram(shader.getHandle());
         glUniform1i(tex_loc, 0);
@@ -178,6 +264,7 @@ namespace xogl {
         glDeleteBuffers(1, &vbo);
         glDeleteBuffers(1, &ebo);
         glDeleteTextures(1, &texture);
+        glDeleteBuffers(2, pbo);
     }
 
     Texture1::~Texture1() {
@@ -190,6 +277,13 @@ namespace xogl {
     ebo(ref.ebo),
     texture(ref.texture),
     tex_loc(ref.tex_loc),
+    pbo{ref.pbo[0], ref.pbo[1]},
+    pbo_index(ref.pbo_index),
+    pbo_size(ref.pbo_size),
+    stream_w(ref.stream_w),
+    stream_h(ref.stream_h),
+    stream_format(ref.stream_format),
+    stream_mapped(ref.stream_mapped),
     shader(std::move(ref.shader)) {}
 
     GLint Texture1::getTexLoc() const {
@@ -200,5 +294,17 @@ namespace xogl {
         return texture;
     }
 
+    GLsizei Texture1::getStreamWidth() const {
+        return stream_w;
+    }
+
+    GLsizei Texture1::getStreamHeight() const {
+        return stream_h;
+    }
+
+    bool Texture1::isStreamMapped() const {
+        return stream_mapped;
+    }
+
 } // xogl
 #pragma clang diagnostic pop
\ No newline at end of file
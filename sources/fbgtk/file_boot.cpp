@@ -7,6 +7,8 @@
 
 #include "../../xmotion/fbgtk/file_boot.h"
 #include "../../xmotion/core/utils/eox_globals.h"
+#include "../../xmotion/core/ocl/ocl_cpu.h"
+#include "../../xmotion/core/ocl/cl_tuner.h"
 #include "../../xmotion/fbgtk/file_worker.h"
 
 namespace xm {
@@ -16,6 +18,8 @@ namespace xm {
         config = xm::data::config_from_file(project_file);
 
         eox::globals::THREAD_POOL_CORES_MAX = config.misc.cpu;
+        xm::ocl::cpu::select(config.misc.compute);
+        xm::ocl::tuner::set_mode(config.misc.tune);
     }
 
     int FileBoot::boostrap(int &argc, char **&argv) {
@@ -6,6 +6,7 @@
 #include "../../xmotion/core/algo/calibration.h"
 #include "../../xmotion/core/algo/chain.h"
 #include "../../xmotion/core/algo/pose.h"
+#include "../../xmotion/core/ocl/cl_tuner.h"
 #include "../../xmotion/fbgtk/data/json_ocv.h"
 
 #pragma clang diagnostic push
@@ -20,23 +21,65 @@ namespace xm {
             config(_config), project_file(_project_file),
             window(_window), params_window(_params_window) {
 
+        prepare_tuner();
         prepare_filters();
         prepare_logic();
+        prepare_governor();
+        prepare_sinks();
+        prepare_recorder();
         prepare_cam();
         prepare_gui();
     }
 
+    FileWorker::FileWorker(const xm::data::JsonConfig &_config,
+                           const std::string &_project_file):
+            config(_config), project_file(_project_file),
+            window(nullptr), params_window(nullptr) {
+
+        headless = true;
+        bypass = true;
+
+        // nobody is going to look at debug frames anyway
+        config.misc.debug = false;
+
+        prepare_tuner();
+        prepare_filters();
+        prepare_logic();
+        prepare_governor();
+        prepare_sinks();
+        prepare_recorder();
+        prepare_cam();
+
+        do_filter = true;
+        logic->start();
+    }
+
+    FileWorker::~FileWorker() {
+        for (auto &sink: sinks)
+            sink->close();
+        if (recorder)
+            recorder->close();
+    }
+
     void xm::FileWorker::update(float dt, float latency, float fps) {
 //        const auto t0 = std::chrono::system_clock::now();
 
         std::vector<xm::ocl::Image2D> frames = camera->dequeue();
         camera->enqueue();
+        logic->received(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::system_clock::now().time_since_epoch()).count());
+
+        // unfiltered frames, compressed and written by recorder's own threads
+        if (recorder)
+            recorder->push(frames);
 
+        const auto t0 = std::chrono::steady_clock::now();
         filter_frames(frames);
         logic->proceed(dt, frames);
+        govern(std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - t0).count());
         process_results();
 
-        if (!bypass)
+        if (!headless && !bypass)
             update_gui(fps);
 
 
@@ -144,6 +187,18 @@ namespace xm {
         std::exit(0);
     }
 
+    void FileWorker::prepare_tuner() {
+        xm::ocl::tuner::set_directory(cache_dir());
+    }
+
+    std::string FileWorker::cache_dir() const {
+        if (config.misc.dnn_cache.empty())
+            return "";
+        const std::filesystem::path root = project_file;
+        const std::filesystem::path name = config.misc.dnn_cache;
+        return (name.is_absolute() ? name : (root.parent_path() / name)).string();
+    }
+
     void FileWorker::opt_single_calibration() {
         logic = std::make_unique<xm::Calibration>();
         logic->debug(config.misc.debug);
@@ -163,6 +218,8 @@ namespace xm {
                 .height = r ? w : h
         };
 
+        params.detect_size = config.calibration.detect_size;
+
         params.fx = config.calibration.intrinsics.f.x;
         params.fy = config.calibration.intrinsics.f.y;
         params.cx = config.calibration.intrinsics.c.x;
@@ -187,6 +244,7 @@ namespace xm {
         };
 
         params.closed = config.calibration.chain.closed;
+        params.detect_size = config.calibration.detect_size;
         params.views = (int) config.calibration.chain.intrinsics.size();
         if (params.views <= 0)
             throw std::runtime_error("Cross calibration requires at least two calibrated cameras");
@@ -230,6 +288,13 @@ namespace xm {
             const auto rotate = config.captures[i].rotate;
             const auto width = config.captures[i].region.w;
             const auto height = config.captures[i].region.h;
+
+            // chroma key fused with pose preprocessing (if any)
+            const xm::data::Chroma *chroma = nullptr;
+            for (const auto &f: config.captures[i].filters)
+                if (f.chroma._present && f.chroma.fused)
+                    chroma = &f.chroma;
+
             vec.push_back({
                 .detector_model = static_cast<xm::nview::DetectorModel>(static_cast<int>(device.model.detector)),
                 .body_model = static_cast<xm::nview::BodyModel>(static_cast<int>(device.model.body)),
@@ -244,16 +309,27 @@ namespace xm {
                 .threshold_marks = device.threshold.marks,
                 .threshold_pose = device.threshold.pose,
                 .threshold_roi = device.threshold.roi,
+                .threshold_segmentation = device.threshold.segmentation,
                 .filter_velocity_factor = device.filter.velocity,
                 .filter_windows_size = device.filter.window,
                 .filter_target_fps = device.filter.fps,
+                .track_people = device.tracking.people,
+                .track_iou = device.tracking.iou,
+                .track_misses = device.tracking.misses,
+                .track_reacquire = device.tracking.reacquire,
                 .undistort_source = device.undistort.source,
+                .undistort_warp = device.undistort.warp,
                 .undistort_points = device.undistort.points,
                 .undistort_alpha = device.undistort.alpha,
+                .undistort_grid_w = device.undistort.grid_w,
+                .undistort_grid_h = device.undistort.grid_h,
+                .undistort_tolerance = device.undistort.tolerance,
                 .width = rotate ? height : width,
                 .height = rotate ? width : height,
                 .K = calibration.K,
-                .D = calibration.D
+                .D = calibration.D,
+                .chroma_fused = chroma != nullptr,
+                .chroma = chroma != nullptr ? chroma_conf(*chroma, true) : xm::filters::chroma::Conf{}
             });
             i++;
         }
@@ -303,9 +379,12 @@ namespace xm {
                 .epi_matrix = epi_matrix,
                 .segmentation = config.pose.segmentation,
                 .show_epilines = config.pose.show_epilines,
+                .cross_seed = config.pose.cross_seed,
                 .threads = config.pose.threads <= 0
                            ? config.misc.cpu
                            : std::min(config.pose.threads, config.misc.cpu),
+                .adaptive = config.pose.governor._present,
+                .cache_dir = cache_dir(),
         };
 
         (static_cast<xm::Pose *>(logic.get()))->init(params);
@@ -381,7 +460,18 @@ namespace xm {
     }
 
     void FileWorker::on_pose_results() {
-        // TODO
+        const auto &results = (static_cast<xm::Pose *>(logic.get()))->result();
+        if (results.error) {
+            log->warn("pose estimation error: {}", results.err_msg);
+            return;
+        }
+
+        // nothing new since last frame
+        if (results.marks.empty() || results.sequence == published)
+            return;
+
+        published = results.sequence;
+        publish_results(results);
     }
 
 } // xm
@@ -5,17 +5,36 @@
 #include <fstream>
 #include "../../xmotion/fbgtk/file_worker.h"
 #include "../../xmotion/core/camera/d_dummy_camera.h"
+#include "../../xmotion/core/camera/file_camera.h"
 
 namespace xm {
 
     void FileWorker::prepare_cam() {
-        camera = config.misc.capture_dummy
-                ? std::make_unique<xm::DummyCamera>()
-                : std::make_unique<xm::StereoCamera>();
+        if (config.misc.capture_file) {
+            auto files = std::make_unique<xm::FileCamera>();
+            files->setRealTime(config.misc.capture_realtime);
+            files->setLoop(config.misc.capture_loop);
+            camera = std::move(files);
+        } else if (config.misc.capture_dummy) {
+            camera = std::make_unique<xm::DummyCamera>();
+        } else {
+            camera = std::make_unique<xm::StereoCamera>();
+        }
+
         camera->setFastMode(config.misc.capture_fast);
+        camera->setLatestMode(config.misc.capture_latest);
+        camera->setImageObjects(config.misc.capture_image);
         for (const auto &c: config.captures) {
+            std::string device_id = c.id;
+            if (config.misc.capture_file) {
+                // video files are relative to the project file
+                const std::filesystem::path root = project_file;
+                const std::filesystem::path name = c.id;
+                device_id = (name.is_absolute() ? name : (root.parent_path() / name)).string();
+            }
+
             camera->open({
-                                .device_id = c.id,
+                                .device_id = device_id,
                                 .name = c.name,
                                 .codec = c.codec,
                                 .width = c.width,
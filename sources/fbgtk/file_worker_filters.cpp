@@ -7,18 +7,30 @@
 #include "../../xmotion/core/utils/cv_utils.h"
 #include "../../xmotion/core/filter/bg_subtract.h"
 #include "../../xmotion/core/filter/blur.h"
+#include "../../xmotion/core/ocl/cl_graph.h"
+#include "../../xmotion/core/ocl/ocl_filters.h"
+#include "../../xmotion/core/ocl/ocl_cpu.h"
 
 namespace xm {
 
     void FileWorker::filter_frames(std::vector<xm::ocl::Image2D> &frames) {
         const auto t0 = std::chrono::system_clock::now();
 
-        std::vector<xm::ocl::iop::ClImagePromise> frames_p_vec;
-        frames_p_vec.reserve(frames.size());
-        for (const auto &frame: frames)
-            frames_p_vec.push_back(frame);
+        if (filter_stacked(frames)) {
+            const auto t1 = std::chrono::system_clock::now();
+            const auto d = duration_cast<std::chrono::nanoseconds>((t1 - t0)).count();
+            log->info("time: {}", d);
+            return;
+        }
+
+        // camera chains are lanes of one graph: they overlap on the device
+        // and host waits once for the last filter of every camera
+        xm::ocl::Graph graph;
+        std::vector<int> outputs;
+        outputs.reserve(frames.size());
 
-        int i = 0; for (auto &frame: frames_p_vec) {
+        int i = 0; for (const auto &frame: frames) {
+            int id = graph.source(frame);
 
             for (auto &filter: filters.at(i)) {
 
@@ -29,16 +41,19 @@ namespace xm {
                     filter->start();
                 }
 
-                frame = filter->filter(frame);
+                id = graph.node(i, {id}, [&filter](const std::vector<xm::ocl::iop::ClImagePromise> &in) {
+                    return filter->filter(in[0]);
+                });
             }
 
+            outputs.push_back(id);
             i++;
         }
 
-        xm::ocl::iop::ClImagePromise::finalizeAll(frames_p_vec);
+        const auto results = graph.run(outputs);
         std::vector<xm::ocl::Image2D> out;
-        out.reserve(frames_p_vec.size());
-        for (auto &frame_p: frames_p_vec)
+        out.reserve(results.size());
+        for (const auto &frame_p: results)
             out.push_back(frame_p.getImage2D());
 
         frames = out;
@@ -48,88 +63,175 @@ namespace xm {
         log->info("time: {}", d);
     }
 
-    void FileWorker::prepare_filters() {
+    bool FileWorker::filter_stacked(std::vector<xm::ocl::Image2D> &frames) {
+        if (stacked_filters.empty() || frames.empty())
+            return false;
+
+        bool same = frames.size() > 1;
+        const auto &first = frames.front();
+        for (const auto &frame: frames) {
+            same = same && !frame.on_host() && frame.cols == first.cols && frame.rows == first.rows
+                   && frame.channels == first.channels && frame.channel_size == first.channel_size;
+        }
+
+        if (!same) {
+            // background models are learned from scratch once, not on every frame
+            log->warn("Filters are not batched anymore, frames can't be stacked");
+            stacked_frame = xm::ocl::Image2D();
+            prepare_filters(false);
+            return false;
+        }
+
+        // every kernel runs once for all cameras: camera is the third dimension of the launch
+        const int layers = (int) frames.size();
+        auto stacked = xm::ocl::stack(xm::ocl::Kernels::instance().retrieve_queue(1), frames, stacked_frame);
+
+        for (auto &filter: stacked_filters) {
+
+            if (!do_filter) {
+                filter->reset();
+                filter->stop();
+            } else {
+                filter->start();
+            }
+
+            stacked = filter->filter_stacked(stacked, layers, -1);
+        }
+
+        auto results = xm::ocl::unstack(stacked, layers);
+
+        // every frame is on the same queue
+        results.front().waitFor();
+
+        frames.clear();
+        for (auto &frame_p: results)
+            frames.push_back(frame_p.resolve().getImage2D());
+
+        return true;
+    }
+
+    xm::filters::chroma::Conf FileWorker::chroma_conf(const xm::data::Chroma &conf, bool fused) {
+        return {
+            .range = xm::ds::Color4u::hls((int) (conf.range.h * 255.f), (int) (conf.range.l * 255.f), (int) (conf.range.s * 255.f)),
+            .color = xm::ocv::parse_hex_to_bgr_4u(conf.replace),
+            .key = xm::ocv::parse_hex_to_bgr_4u(conf.key),
+            .refine = conf.refine,
+            .fine = conf.fine,
+            .blur = conf.blur,
+            .power = conf.power,
+            .linear = conf.linear,
+            .fused = fused
+        };
+    }
+
+    void FileWorker::prepare_filters(bool stacked) {
+        stacked_filters.clear();
+        if (stacked && stackable())
+            stacked_filters = create_filters(config.captures.front().filters);
+
         filters.clear();
         filters.reserve(config.captures.size());
         for (const auto &capture: config.captures) {
-            std::vector<std::unique_ptr<xm::Filter>> vec;
-
-            for (const auto &f: capture.filters) {
-                if (f.blur._present) {
-                    auto filter = std::make_unique<xm::filters::Blur>();
-                    filter->init(f.blur.blur);
-                    vec.push_back(std::move(filter));
-                    continue;
-                }
+            if (stacked_filters.empty())
+                filters.push_back(create_filters(capture.filters));
+            else
+                filters.emplace_back();
+        }
+    }
 
-                if (f.chroma._present) {
-                    const auto &conf = f.chroma;
-                    auto filter = std::make_unique<xm::filters::ChromaKey>();
-                    filter->init({
-                        .range = xm::ds::Color4u::hls((int) (conf.range.h * 255.f), (int) (conf.range.l * 255.f), (int) (conf.range.s * 255.f)),
-                        .color = xm::ocv::parse_hex_to_bgr_4u(conf.replace),
-                        .key = xm::ocv::parse_hex_to_bgr_4u(conf.key),
-                        .refine = conf.refine,
-                        .fine = conf.fine,
-                        .blur = conf.blur,
-                        .power = conf.power,
-                        .linear = conf.linear
-                    });
-                    vec.push_back(std::move(filter));
-                    continue;
-                }
+    bool FileWorker::stackable() const {
+        if (!config.misc.batch_filters || config.captures.size() < 2)
+            return false;
 
-                if (f.difference._present) {
-                    const auto &conf = f.difference;
-                    auto filter = std::make_unique<xm::filters::BgSubtract>();
-                    filter->init({
-                        .BASE_RESOLUTION = conf.BASE_RESOLUTION,
-                        .color_channels = 3,
-                        .adapt_on = conf.adapt_on,
-                        .debug_on = conf.debug_on,
-                        .morph_on = (conf.refine_gate + conf.refine_erode + conf.refine_dilate) > 0,
-                        .ghost_on = conf.ghost_on,
-                        .lbsp_on = conf.lbsp_on,
-                        .norm_l2 = conf.norm_l2,
-                        .mask_xc = false,
-                        .linear = conf.linear,
-                        .color_0 = conf.color_0,
-                        .lbsp_0 = conf.lbsp_0,
-                        .lbsp_d = conf.lbsp_d,
-                        .n_matches = conf.n_matches,
-                        .t_upper = conf.t_upper,
-                        .t_lower = conf.t_lower,
-                        .model_size = conf.model_size,
-                        .ghost_l = conf.ghost_l,
-                        .ghost_n = conf.ghost_n,
-                        .ghost_n_inc = conf.ghost_n_inc,
-                        .ghost_n_dec = conf.ghost_n_dec,
-                        .alpha_d_min = conf.alpha_d_min,
-                        .alpha_norm = conf.alpha_norm,
-                        .ghost_t = conf.ghost_t,
-                        .r_scale = conf.r_scale,
-                        .r_cap = conf.r_cap,
-                        .t_scale_inc = conf.t_scale_inc,
-                        .t_scale_dec = conf.t_scale_dec,
-                        .v_flicker_inc = conf.v_flicker_inc,
-                        .v_flicker_dec = conf.v_flicker_dec,
-                        .v_flicker_cap = conf.v_flicker_cap,
-                        .kernel = static_cast<xm::filters::bgs::KernelType>((int) conf.kernel),
-                        .color = xm::ocv::parse_hex_to_bgr_4u(conf.color),
-                        .refine_gate = conf.refine_gate,
-                        .refine_erode = conf.refine_erode,
-                        .refine_dilate = conf.refine_dilate,
-                        .refine_gate_threshold = conf.gate_threshold,
-                        .gate_kernel = static_cast<xm::filters::bgs::KernelType>((int) conf.gate_kernel),
-                        .erode_kernel = static_cast<xm::filters::bgs::KernelType>((int) conf.erode_kernel),
-                        .dilate_kernel = static_cast<xm::filters::bgs::KernelType>((int) conf.dilate_kernel),
-                    });
-                    vec.push_back(std::move(filter));
-                    continue;
-                }
+        // governor changes filters resolution of every camera on its own
+        if (xm::ocl::cpu::enabled() || (config.type == data::POSE && config.pose.governor._present))
+            return false;
+
+        const auto &first = config.captures.front();
+        for (const auto &capture: config.captures) {
+            if (capture.filters != first.filters) {
+                log->warn("Filters are not batched, cameras have different filters");
+                return false;
             }
+            if (capture.width != first.width || capture.height != first.height) {
+                log->warn("Filters are not batched, cameras have different frame size");
+                return false;
+            }
+        }
 
-            filters.push_back(std::move(vec));
+        return true;
+    }
+
+    std::vector<std::unique_ptr<xm::Filter>> FileWorker::create_filters(const std::vector<xm::data::Filter> &chain) {
+        std::vector<std::unique_ptr<xm::Filter>> vec;
+
+        for (const auto &f: chain) {
+            if (f.blur._present) {
+                auto filter = std::make_unique<xm::filters::Blur>();
+                filter->init(f.blur.blur);
+                vec.push_back(std::move(filter));
+                continue;
+            }
+
+            if (f.chroma._present) {
+                const auto &conf = f.chroma;
+                auto filter = std::make_unique<xm::filters::ChromaKey>();
+                // fused chroma key is handled by pose pipeline itself
+                filter->init(chroma_conf(conf, conf.fused && config.type == data::POSE));
+                vec.push_back(std::move(filter));
+                continue;
+            }
+
+            if (f.difference._present) {
+                const auto &conf = f.difference;
+                auto filter = std::make_unique<xm::filters::BgSubtract>();
+                filter->init({
+                    .BASE_RESOLUTION = conf.BASE_RESOLUTION,
+                    .color_channels = 3,
+                    .adapt_on = conf.adapt_on,
+                    .debug_on = conf.debug_on,
+                    .morph_on = (conf.refine_gate + conf.refine_erode + conf.refine_dilate) > 0,
+                    .ghost_on = conf.ghost_on,
+                    .lbsp_on = conf.lbsp_on,
+                    .norm_l2 = conf.norm_l2,
+                    .mask_xc = false,
+                    .linear = conf.linear,
+                    .color_0 = conf.color_0,
+                    .lbsp_0 = conf.lbsp_0,
+                    .lbsp_d = conf.lbsp_d,
+                    .n_matches = conf.n_matches,
+                    .t_upper = conf.t_upper,
+                    .t_lower = conf.t_lower,
+                    .model_size = conf.model_size,
+                    .ghost_l = conf.ghost_l,
+                    .ghost_n = conf.ghost_n,
+                    .ghost_n_inc = conf.ghost_n_inc,
+                    .ghost_n_dec = conf.ghost_n_dec,
+                    .alpha_d_min = conf.alpha_d_min,
+                    .alpha_norm = conf.alpha_norm,
+                    .ghost_t = conf.ghost_t,
+                    .r_scale = conf.r_scale,
+                    .r_cap = conf.r_cap,
+                    .t_scale_inc = conf.t_scale_inc,
+                    .t_scale_dec = conf.t_scale_dec,
+                    .v_flicker_inc = conf.v_flicker_inc,
+                    .v_flicker_dec = conf.v_flicker_dec,
+                    .v_flicker_cap = conf.v_flicker_cap,
+                    .kernel = static_cast<xm::filters::bgs::KernelType>((int) conf.kernel),
+                    .color = xm::ocv::parse_hex_to_bgr_4u(conf.color),
+                    .refine_gate = conf.refine_gate,
+                    .refine_erode = conf.refine_erode,
+                    .refine_dilate = conf.refine_dilate,
+                    .refine_gate_threshold = conf.gate_threshold,
+                    .gate_kernel = static_cast<xm::filters::bgs::KernelType>((int) conf.gate_kernel),
+                    .erode_kernel = static_cast<xm::filters::bgs::KernelType>((int) conf.erode_kernel),
+                    .dilate_kernel = static_cast<xm::filters::bgs::KernelType>((int) conf.dilate_kernel),
+                });
+                vec.push_back(std::move(filter));
+                continue;
+            }
         }
+
+        return vec;
     }
 }
\ No newline at end of file
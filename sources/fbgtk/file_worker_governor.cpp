@@ -0,0 +1,111 @@
+//
+// Created by henryco on 21/07/24.
+//
+
+#include "../../xmotion/fbgtk/file_worker.h"
+#include "../../xmotion/core/algo/pose.h"
+#include "../../xmotion/core/filter/bg_subtract.h"
+
+#include <cmath>
+
+#pragma clang diagnostic push
+#pragma ide diagnostic ignored "cppcoreguidelines-pro-type-static-cast-downcast"
+
+namespace xm {
+
+    /**
+     * Number of difference filter resolution steps, applied after all the pose levels
+     */
+    constexpr int FILTER_LEVELS = 2;
+
+    /**
+     * Difference filter resolution factor per step
+     */
+    constexpr float FILTER_SCALE = 0.75f;
+
+    void FileWorker::prepare_governor() {
+        governor_pose_max.clear();
+        governor_base.clear();
+
+        if (config.type != data::POSE || !config.pose.governor._present)
+            return;
+
+        const auto pose = static_cast<xm::Pose *>(logic.get());
+        const auto n = config.pose.devices.size();
+
+        std::vector<int> max_levels;
+        max_levels.reserve(n);
+        for (int i = 0; i < n; i++) {
+            int base = 0;
+            if (i < filters.size()) {
+                for (const auto &filter: filters.at(i)) {
+                    if (const auto bgs = dynamic_cast<xm::filters::BgSubtract *>(filter.get()))
+                        base = bgs->resolution();
+                }
+            }
+
+            governor_pose_max.push_back(pose->qualities_n(i) - 1);
+            governor_base.push_back(base);
+
+            // background model is learned from scratch after resolution change, so it goes last
+            max_levels.push_back(governor_pose_max.back() + (base > 0 ? FILTER_LEVELS : 0));
+        }
+
+        const auto &conf = config.pose.governor;
+        governor.init({
+            .fps = conf.fps,
+            .margin_down = conf.margin_down,
+            .margin_up = conf.margin_up,
+            .window_down = conf.window_down,
+            .window_up = conf.window_up,
+            .cooldown = conf.cooldown
+        }, max_levels);
+
+        log->info("Quality governor: {} fps, {} cameras", conf.fps, n);
+    }
+
+    void FileWorker::govern(float ms) {
+        if (!governor.enabled())
+            return;
+
+        // filter resolution steps make sense only while filters are applied
+        for (int i = 0; i < governor_pose_max.size(); i++) {
+            const int max = governor_pose_max.at(i) + (do_filter && governor_base.at(i) > 0 ? FILTER_LEVELS : 0);
+            if (governor.limit(i, max))
+                apply_quality(i, governor.level(i));
+        }
+
+        const auto pose = static_cast<xm::Pose *>(logic.get());
+        const auto &latencies = pose->latency();
+        for (int i = 0; i < latencies.size(); i++)
+            governor.report(i, latencies.at(i));
+
+        const int index = governor.update(ms);
+        if (index < 0)
+            return;
+
+        apply_quality(index, governor.level(index));
+        log->info("Quality of camera {} set to level {} (frame: {} ms, camera: {} ms)",
+                  index, governor.level(index), governor.frame_time(), governor.latency(index));
+    }
+
+    void FileWorker::apply_quality(int index, int level) {
+        const auto pose = static_cast<xm::Pose *>(logic.get());
+        const int pose_max = governor_pose_max.at(index);
+        pose->set_quality(index, std::min(level, pose_max));
+
+        const int base = governor_base.at(index);
+        if (base <= 0 || index >= filters.size())
+            return;
+
+        const int step = std::max(0, level - pose_max);
+        const int resolution = (int) std::round((float) base * std::pow(FILTER_SCALE, (float) step));
+        for (auto &filter: filters.at(index)) {
+            if (const auto bgs = dynamic_cast<xm::filters::BgSubtract *>(filter.get()))
+                bgs->set_resolution(resolution);
+        }
+    }
+
+} // xm
+
+#pragma clang diagnostic pop
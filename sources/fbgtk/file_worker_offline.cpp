@@ -0,0 +1,133 @@
+//
+// Created by henryco on 21/07/24.
+//
+
+#include "../../xmotion/fbgtk/file_worker.h"
+#include "../../xmotion/core/camera/file_camera.h"
+
+#include <deque>
+
+namespace xm {
+
+    /**
+     * Number of filtered frame sets waiting for inference
+     */
+    constexpr size_t OFFLINE_QUEUE = 2;
+
+    /**
+     * Progress report interval (seconds)
+     */
+    constexpr float OFFLINE_REPORT = 2.f;
+
+    void FileWorker::run_offline(const std::atomic<bool> &alive) {
+        const auto files = dynamic_cast<xm::FileCamera *>(camera.get());
+        if (files == nullptr)
+            throw std::runtime_error("Offline processing requires recorded inputs (misc.capture_file)");
+
+        const int total = files->length();
+        log->info("offline processing: {} cameras, {} frames, {} fps recorded", config.captures.size(), total, files->fps());
+
+        std::mutex mutex;
+        std::condition_variable produced;
+        std::condition_variable consumed;
+        // {received at (ns since epoch): frames}
+        std::deque<std::pair<int64_t, std::vector<xm::ocl::Image2D>>> queue;
+        std::exception_ptr error;
+        std::atomic<uint64_t> processed = 0;
+        bool done = false;
+
+        // inference stage: pose (and its temporal filters) gets frame sets strictly in order,
+        // cameras are processed concurrently by pose's own per device workers
+        std::thread inference([&]() {
+            auto t0 = std::chrono::steady_clock::now();
+            while (true) {
+                int64_t timestamp;
+                std::vector<xm::ocl::Image2D> frames;
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    produced.wait(lock, [&]() { return done || !queue.empty(); });
+                    if (queue.empty())
+                        return;
+                    timestamp = queue.front().first;
+                    frames = std::move(queue.front().second);
+                    queue.pop_front();
+                }
+                consumed.notify_all();
+
+                try {
+                    const auto t1 = std::chrono::steady_clock::now();
+                    logic->received(timestamp);
+                    logic->proceed(std::chrono::duration<float, std::milli>(t1 - t0).count(), frames);
+                    process_results();
+                    t0 = t1;
+                } catch (...) {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    error = std::current_exception();
+                    done = true;
+                    consumed.notify_all();
+                    return;
+                }
+                processed++;
+            }
+        });
+
+        // decoding is prefetched by file decoder threads,
+        // filtering (ordered per camera, background models are temporal) runs right here
+        const auto started = std::chrono::steady_clock::now();
+        auto reported = started;
+        int position = files->position();
+        while (alive) {
+            const auto named = camera->captureWithName();
+            if (named.empty() || files->position() == position)
+                break; // end of recordings, last frame is being repeated
+
+            const auto received = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::system_clock::now().time_since_epoch()).count();
+
+            position = files->position();
+
+            std::vector<xm::ocl::Image2D> frames;
+            frames.reserve(config.captures.size());
+            for (const auto &c: config.captures)
+                frames.push_back(named.at(c.name));
+
+            filter_frames(frames);
+
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                consumed.wait(lock, [&]() { return done || queue.size() < OFFLINE_QUEUE; });
+                if (done)
+                    break;
+                queue.emplace_back(received, std::move(frames));
+            }
+            produced.notify_all();
+
+            const auto now = std::chrono::steady_clock::now();
+            if (std::chrono::duration<float>(now - reported).count() < OFFLINE_REPORT)
+                continue;
+
+            reported = now;
+            const auto seconds = std::chrono::duration<double>(now - started).count();
+            const auto fps = (double) processed / seconds;
+            const auto left = total > 0 && fps > 0 ? (double) std::max(0, total - position - 1) / fps : 0.;
+            log->info("offline: {}/{} frames, {:.1f} fps, eta: {}m {:02d}s",
+                      processed.load(), total, fps, (int) left / 60, (int) left % 60);
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            done = true;
+        }
+        produced.notify_all();
+        inference.join();
+
+        if (error)
+            std::rethrow_exception(error);
+
+        const auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+        const auto fps = (double) processed / std::max(1e-3, seconds);
+        log->info("offline: {} frames in {:.1f}s, {:.1f} fps ({:.2f}x real time)",
+                  processed.load(), seconds, fps, files->fps() > 0 ? fps / files->fps() : 0.);
+    }
+
+} // xm
@@ -0,0 +1,73 @@
+//
+// Created by henryco on 14/07/24.
+//
+
+#include "../../xmotion/fbgtk/file_worker.h"
+#include "../../xmotion/core/sink/file_sink.h"
+#ifdef __linux__
+#include "../../xmotion/core/sink/socket_sink.h"
+#include "../../xmotion/core/sink/shm_sink.h"
+#endif
+
+namespace xm {
+
+    void FileWorker::prepare_sinks() {
+        sinks.clear();
+        sinks.reserve(config.output.sinks.size());
+        for (const auto &s: config.output.sinks) {
+
+            if (s.type == XM_SINK_TYPE_FILE) {
+                const std::filesystem::path root = project_file;
+                const std::filesystem::path name = s.path;
+                const auto file = (name.is_absolute() ? name : (root.parent_path() / name)).string();
+                sinks.push_back(std::make_unique<xm::sink::FileSink>(file));
+            }
+
+            else if (s.type == XM_SINK_TYPE_SOCKET) {
+#ifdef __linux__
+                sinks.push_back(std::make_unique<xm::sink::SocketSink>(s.path, std::max(1, s.clients)));
+#else
+                throw std::runtime_error("UNIX-domain socket sink is not supported on this platform");
+#endif
+            }
+
+            else if (s.type == XM_SINK_TYPE_SHM) {
+#ifdef __linux__
+                const auto name = s.path.starts_with("/") ? s.path : ("/" + s.path);
+                const auto devices = std::max(config.captures.size(), config.pose.devices.size());
+                sinks.push_back(std::make_unique<xm::sink::ShmSink>(name, (uint32_t) std::max(2, s.slots), devices));
+#else
+                throw std::runtime_error("Shared memory sink is not supported on this platform");
+#endif
+            }
+
+            else throw std::invalid_argument("Unknown sink type: " + s.type);
+
+            sinks.back()->open();
+        }
+    }
+
+    void FileWorker::prepare_recorder() {
+        const auto &conf = config.output.record;
+        if (!conf.enabled)
+            return;
+
+        const std::filesystem::path root = project_file;
+        const std::filesystem::path name = conf.path;
+        const auto dir = (name.is_absolute() ? name : (root.parent_path() / name)).string();
+
+        std::vector<std::string> names;
+        names.reserve(config.captures.size());
+        for (const auto &c: config.captures)
+            names.push_back(c.name);
+
+        recorder = std::make_unique<xm::sink::RawRecorder>(dir, names, conf.threads, conf.queue, conf.chunk);
+        recorder->open();
+    }
+
+    void FileWorker::publish_results(const xm::nview::Result &result) {
+        for (auto &sink: sinks)
+            sink->publish(result);
+    }
+
+}
@@ -5,6 +5,9 @@
 #include "../../xmotion/fbgtk/gtk/gl_image.h"
 #include "../../xmotion/core/dnn/net/dnn_cl_utils.h"
 #include "../../xmotion/core/ocl/ocl_interop.h"
+#include "../../xmotion/core/ocl/ocl_filters.h"
+#include "../../xmotion/core/ocl/cl_kernel.h"
+#include <cstring>
 #include <utility>
 #include <gtkmm/eventbox.h>
 #include <opencv2/imgproc.hpp>
@@ -16,6 +19,7 @@
 namespace eox::xgtk {
 
     GLImage::~GLImage() {
+        releasePending();
         textures.clear();
         glAreas.clear();
         u_frames.clear();
@@ -44,29 +48,39 @@ namespace eox::xgtk {
             glClear(GL_COLOR_BUFFER_BIT);
 
             if (!frames.empty()) {
+                finishPending(num);
                 cv::Mat frame = fitSize(frames[num]);
                 texture->setImage(xogl::Image(frame.data, width, height, format));
                 texture->render();
             }
 
             else if (!u_frames.empty()) {
+                const auto &frame = u_frames[num];
+                const size_t size = frame.total() * frame.elemSize();
+                // view of continuous frame is read from its parent buffer at its offset
+                const auto handle = cv::ocl::useOpenCL() && frame.isContinuous()
+                        ? (cl_mem) frame.handle(cv::ACCESS_READ)
+                        : nullptr;
+                if (handle != nullptr) {
+                    renderStream(num, handle, frame.offset, size, frame.cols, frame.rows, frame.channels(), nullptr);
+                } else {
+                    // no OpenCL (or non-continuous view), frame is on the host anyway
+                    const auto mat = frame.getMat(cv::ACCESS_READ);
+                    const cv::Mat host = mat.isContinuous() ? mat : mat.clone();
+                    renderStream(num, nullptr, 0, size, host.cols, host.rows, host.channels(), host.data);
+                }
+            }
 
-                // TODO FIXME: TEMPORARY SOLUTION BECAUSE OpenCL <-> OpenGL interop on linux nvidia devices is GARBAGE!
-
-                cv::Mat temp;
-                fitSize(u_frames[num]).copyTo(temp);
-                texture->setImage(xogl::Image(temp.data, width, height, format));
-
-                // TODO FIXME: TEMPORARY SOLUTION BECAUSE OpenCL <-> OpenGL interop on linux nvidia devices is GARBAGE!
-
-                texture->render();
-
-            } else if (!cl_frames.empty()) {
-                cv::Mat temp;
-                xm::ocl::iop::to_cv_mat(cl_frames[num], temp, (cl_command_queue) cv::ocl::Queue::getDefault().ptr());
-                temp = fitSize(temp);
-                texture->setImage(xogl::Image(temp.data, width, height, format));
-                texture->render();
+            else if (!cl_frames.empty()) {
+                const auto &frame = cl_frames[num];
+                renderStream(num,
+                             frame.on_host() ? nullptr : frame.handle,
+                             0,
+                             frame.cols * frame.rows * frame.channels * frame.channel_size,
+                             (int) frame.cols,
+                             (int) frame.rows,
+                             (int) frame.channels,
+                             frame.on_host() ? frame.data() : nullptr);
             }
 
             return true;
@@ -143,6 +157,10 @@ namespace eox::xgtk {
         initialized.clear();
         initialized.reserve(_number);
 
+        releasePending();
+        cl_gl_pending.clear();
+        cl_gl_pending.reserve(_number);
+
         textures.clear();
         textures.reserve(_number);
 
@@ -240,6 +258,7 @@ namespace eox::xgtk {
                 glAreas.push_back(std::move(area));
                 textures.push_back(std::make_unique<xogl::Texture1>());
                 initialized.push_back(false);
+                cl_gl_pending.push_back(nullptr);
 
                 index += 1;
             }
@@ -301,6 +320,90 @@ namespace eox::xgtk {
         this->callback = std::move(_callback);
     }
 
+    void GLImage::renderFit(xogl::Texture1 &texture, int img_w, int img_h) const {
+        GLint viewport[4];
+        glGetIntegerv(GL_VIEWPORT, viewport);
+
+        const int v_width = viewport[2];
+        const int v_height = viewport[3];
+        if (v_width <= 0 || v_height <= 0 || img_w <= 0 || img_h <= 0) {
+            texture.render();
+            return;
+        }
+
+        // letterbox, same as fitSize but without touching pixels
+        const float scale = std::min((float) v_width / (float) img_w, (float) v_height / (float) img_h);
+        const int n_w = (int) ((float) img_w * scale);
+        const int n_h = (int) ((float) img_h * scale);
+        const int s_x = (v_width - n_w) / 2;
+        const int s_y = (v_height - n_h) / 2;
+
+        glViewport(viewport[0] + s_x, viewport[1] + s_y, n_w, n_h);
+        texture.render();
+        glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+    }
+
+    void GLImage::renderStream(size_t num, cl_mem buffer, size_t offset, size_t size, int f_cols, int f_rows, int channels, const void *host) {
+        auto &texture = textures[num];
+        auto &pending = cl_gl_pending[num];
+
+        if (pending != nullptr) {
+            cl_int status = CL_COMPLETE;
+            clGetEventInfo(pending, CL_EVENT_COMMAND_EXECUTION_STATUS, sizeof(cl_int), &status, nullptr);
+            if (status > CL_COMPLETE) {
+                // previous frame is still being read, texture is not changed
+                renderFit(*texture, texture->getStreamWidth(), texture->getStreamHeight());
+                return;
+            }
+            if (status < 0)
+                log->error("[{}] Cannot read frame into pixel buffer: {}", num, status);
+        }
+
+        // previous frame goes to the texture
+        finishPending(num);
+
+        const auto f_format = channels == 4 ? GL_BGRA : format;
+        auto ptr = texture->mapStream((GLsizei) f_cols, (GLsizei) f_rows, f_format);
+        if (ptr != nullptr && buffer == nullptr) {
+            std::memcpy(ptr, host, size);
+            texture->unmapStream();
+        } else if (ptr != nullptr) {
+            auto queue = (cl_command_queue) cv::ocl::Queue::getDefault().ptr();
+
+            // straight into the PBO, no intermediate cv::Mat, buffer stays mapped until the read is complete
+            cl_int err = clEnqueueReadBuffer(queue, buffer, CL_FALSE, offset, size, ptr, 0, nullptr, &pending);
+            if (err != CL_SUCCESS) {
+                log->error("[{}] Cannot read frame into pixel buffer: {}", num, err);
+                pending = nullptr;
+                texture->unmapStream();
+            } else {
+                clFlush(queue);
+            }
+        }
+
+        renderFit(*texture, texture->getStreamWidth(), texture->getStreamHeight());
+    }
+
+    void GLImage::finishPending(size_t num) {
+        auto &pending = cl_gl_pending[num];
+        if (pending != nullptr) {
+            clWaitForEvents(1, &pending);
+            clReleaseEvent(pending);
+            pending = nullptr;
+        }
+        textures[num]->unmapStream();
+    }
+
+    void GLImage::releasePending() {
+        for (auto &pending: cl_gl_pending) {
+            if (pending == nullptr)
+                continue;
+            clWaitForEvents(1, &pending);
+            clReleaseEvent(pending);
+            pending = nullptr;
+        }
+    }
+
     cv::Mat GLImage::fitSize(const cv::Mat &in) const {
         if (in.cols == width && in.rows == height) {
             return in;
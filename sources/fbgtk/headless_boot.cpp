@@ -0,0 +1,51 @@
+//
+// Created by henryco on 14/07/24.
+//
+
+#include <csignal>
+
+#include "../../xmotion/fbgtk/headless_boot.h"
+#include "../../xmotion/core/utils/eox_globals.h"
+#include "../../xmotion/core/ocl/ocl_cpu.h"
+#include "../../xmotion/core/ocl/cl_tuner.h"
+#include "../../xmotion/fbgtk/file_worker.h"
+
+namespace xm {
+
+    void HeadlessBoot::open_project(const char *argv) {
+        project_file = xm::data::prepare_project_file(argv);
+        config = xm::data::config_from_file(project_file);
+
+        eox::globals::THREAD_POOL_CORES_MAX = config.misc.cpu;
+        xm::ocl::cpu::select(config.misc.compute);
+        xm::ocl::tuner::set_mode(config.misc.tune);
+
+        if (config.output.sinks.empty())
+            log->warn("No output sinks configured, results will be discarded");
+    }
+
+    int HeadlessBoot::boostrap(int &argc, char **&argv) {
+        // block termination signals before loop thread is spawned,
+        // so it inherits the mask and only this thread receives them
+        sigset_t signals;
+        sigemptyset(&signals);
+        sigaddset(&signals, SIGINT);
+        sigaddset(&signals, SIGTERM);
+        pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+        start_loop(0);
+        log->info("running headless, waiting for SIGINT/SIGTERM");
+
+        int signal = 0;
+        sigwait(&signals, &signal);
+
+        log->info("received signal: {}, stopping", signal);
+        stop_loop();
+        return 0;
+    }
+
+    eox::util::DeltaWorker *HeadlessBoot::worker() {
+        return new xm::FileWorker(config, project_file);
+    }
+
+} // xm
@@ -48,9 +48,18 @@ namespace xm::data::def {
     Misc misc() {
         return {
             .capture_dummy = false,
+            .capture_file = false,
+            .capture_realtime = true,
+            .capture_loop = true,
             .capture_fast = false,
+            .capture_latest = false,
+            .capture_image = false,
+            .batch_filters = false,
             .debug = false,
-            .cpu = 8
+            .cpu = 8,
+            .dnn_cache = ".xmotion_cache",
+            .compute = "auto",
+            .tune = "auto"
         };
     }
 
@@ -69,8 +78,12 @@ namespace xm::data::def {
     PoseUndistort poseUndistort() {
         return {
           .source = false,
+          .warp = false,
           .points = false,
-          .alpha = 0.f
+          .alpha = 0.f,
+          .grid_w = 64,
+          .grid_h = 48,
+          .tolerance = 0.1f
         };
     }
 
@@ -79,7 +92,8 @@ namespace xm::data::def {
             .detector = 0.5f,
             .marks = 0.5f,
             .pose = 0.5f,
-            .roi = 0.f
+            .roi = 0.f,
+            .segmentation = 0.5f
         };
     }
 
@@ -91,6 +105,15 @@ namespace xm::data::def {
         };
     }
 
+    PoseTracking poseTracking() {
+        return {
+            .people = 1,
+            .iou = 0.3f,
+            .misses = 5,
+            .reacquire = 15
+        };
+    }
+
     PoseModel poseModel() {
         return {
             .detector = pose::F_16,
@@ -105,7 +128,20 @@ namespace xm::data::def {
             .undistort = xm::data::def::poseUndistort(),
             .filter = xm::data::def::poseFilter(),
             .model = xm::data::def::poseModel(),
-            .roi = xm::data::def::poseRoi()
+            .roi = xm::data::def::poseRoi(),
+            .tracking = xm::data::def::poseTracking()
+        };
+    }
+
+    PoseGovernor poseGovernor() {
+        return {
+            .fps = 30.f,
+            .margin_down = 0.1f,
+            .margin_up = 0.25f,
+            .window_down = 15,
+            .window_up = 90,
+            .cooldown = 30,
+            ._present = false
         };
     }
 
@@ -129,8 +165,10 @@ namespace xm::data::def {
             .chain = xm::data::def::chainCalibration(),
             .cross = xm::data::def::crossCalibration(),
             .show_epilines = false,
+            .cross_seed = true,
             .segmentation = false,
-            .threads = 0
+            .threads = 0,
+            .governor = xm::data::def::poseGovernor()
         };
     }
 
@@ -171,6 +209,7 @@ namespace xm::data::def {
             .fine = 0,
             .refine = 0,
             .linear = false,
+            .fused = false,
             ._present = false
         };
     }
@@ -190,6 +229,32 @@ namespace xm::data::def {
           .chain = {}
         };
     }
+
+    OutputSink outputSink() {
+        return {
+            .type = "",
+            .path = "",
+            .clients = 8,
+            .slots = 64
+        };
+    }
+
+    Record record() {
+        return {
+            .enabled = false,
+            .path = "record",
+            .threads = 4,
+            .queue = 4,
+            .chunk = 600
+        };
+    }
+
+    Output output() {
+        return {
+            .sinks = {},
+            .record = record()
+        };
+    }
 }
 
 namespace xm::data {
@@ -225,6 +290,10 @@ namespace xm::data {
             { HEAVY_F16, "heavy_f16" },
             { FULL_F16, "full_f16" },
             { LITE_F16, "lite_f16" },
+
+            { HEAVY_I8, "heavy_i8" },
+            { FULL_I8, "full_i8" },
+            { LITE_I8, "lite_i8" },
         })
 
         NLOHMANN_JSON_SERIALIZE_ENUM(ModeDetector, {
@@ -232,6 +301,7 @@ namespace xm::data {
             { ORIGIN, "origin" },
             { F_32, "f_32" },
             { F_16, "f_16" },
+            { I_8, "i_8" },
         })
     }
 
@@ -300,6 +370,7 @@ namespace xm::data {
         c.refine = j.value("fine", def.fine);
         c.refine = j.value("refine", def.refine);
         c.linear = j.value("linear", def.linear);
+        c.fused = j.value("fused", def.fused);
         c._present = true;
     }
 
@@ -402,6 +473,7 @@ namespace xm::data {
         c.chain = j.value("chain", xm::data::def::chain());
         c.delay = j.value("delay", 5000);
         c.total = j.value("total", 10);
+        c.detect_size = j.value("detect_size", 640);
     }
 
     void from_json(const nlohmann::json &j, PoseRoi &r) {
@@ -422,11 +494,23 @@ namespace xm::data {
         f.fps = j.value("fps", def.fps);
     }
 
+    void from_json(const nlohmann::json &j, PoseTracking &t) {
+        const auto def = xm::data::def::poseTracking();
+        t.people = j.value("people", def.people);
+        t.iou = j.value("iou", def.iou);
+        t.misses = j.value("misses", def.misses);
+        t.reacquire = j.value("reacquire", def.reacquire);
+    }
+
     void from_json(const nlohmann::json &j, PoseUndistort &u) {
         const auto def = xm::data::def::poseUndistort();
         u.source = j.value("source", def.source);
+        u.warp = j.value("warp", def.warp);
         u.points = j.value("points", def.points);
         u.alpha = j.value("alpha", def.alpha);
+        u.grid_w = j.value("grid_w", def.grid_w);
+        u.grid_h = j.value("grid_h", def.grid_h);
+        u.tolerance = j.value("tolerance", def.tolerance);
     }
 
     void from_json(const nlohmann::json &j, PoseThresholds &t) {
@@ -435,6 +519,7 @@ namespace xm::data {
         t.marks = j.value("marks", def.marks);
         t.pose = j.value("pose", def.pose);
         t.roi = j.value("roi", def.roi);
+        t.segmentation = j.value("segmentation", def.segmentation);
     }
 
     void from_json(const nlohmann::json &j, PoseModel &m) {
@@ -451,6 +536,18 @@ namespace xm::data {
         d.undistort = j.value("undistort", def.undistort);
         d.filter = j.value("filter", def.filter);
         d.roi = j.value("roi", def.roi);
+        d.tracking = j.value("tracking", def.tracking);
+    }
+
+    void from_json(const nlohmann::json &j, PoseGovernor &g) {
+        const auto def = xm::data::def::poseGovernor();
+        g.fps = j.value("fps", def.fps);
+        g.margin_down = j.value("margin_down", def.margin_down);
+        g.margin_up = j.value("margin_up", def.margin_up);
+        g.window_down = j.value("window_down", def.window_down);
+        g.window_up = j.value("window_up", def.window_up);
+        g.cooldown = j.value("cooldown", def.cooldown);
+        g._present = true;
     }
 
     void from_json(const nlohmann::json &j, ChainCalibration &c) {
@@ -471,8 +568,10 @@ namespace xm::data {
         p.chain = j.value("chain", def.chain);
         p.cross = j.value("cross", def.cross);
         p.show_epilines = j.value("epilines", def.show_epilines);
+        p.cross_seed = j.value("cross_seed", def.cross_seed);
         p.segmentation = j.value("segmentation", def.segmentation);
         p.threads = j.value("threads", def.threads);
+        p.governor = j.value("governor", def.governor);
     }
 
     void from_json(const nlohmann::json &j, Misc &m) {
@@ -480,7 +579,16 @@ namespace xm::data {
         m.cpu = j.value("cpu", def.cpu);
         m.debug = j.value("debug", def.debug);
         m.capture_fast = j.value("capture_fast", def.capture_fast);
+        m.capture_latest = j.value("capture_latest", def.capture_latest);
+        m.capture_image = j.value("capture_image", def.capture_image);
+        m.batch_filters = j.value("batch_filters", def.batch_filters);
         m.capture_dummy = j.value("capture_dummy", def.capture_dummy);
+        m.capture_file = j.value("capture_file", def.capture_file);
+        m.capture_realtime = j.value("capture_realtime", def.capture_realtime);
+        m.capture_loop = j.value("capture_loop", def.capture_loop);
+        m.dnn_cache = j.value("dnn_cache", def.dnn_cache);
+        m.compute = j.value("compute", def.compute);
+        m.tune = j.value("tune", def.tune);
     }
 
     void from_json(const nlohmann::json &j, Compose &c) {
@@ -489,6 +597,31 @@ namespace xm::data {
         c.chain = j.value("chain", def.chain);
     }
 
+    void from_json(const nlohmann::json &j, OutputSink &s) {
+        const auto def = xm::data::def::outputSink();
+        j.at("type").get_to(s.type);
+        j.at("path").get_to(s.path);
+        s.clients = j.value("clients", def.clients);
+        s.slots = j.value("slots", def.slots);
+        if (s.type != XM_SINK_TYPE_FILE && s.type != XM_SINK_TYPE_SOCKET && s.type != XM_SINK_TYPE_SHM)
+            throw std::invalid_argument("Unknown sink type: " + s.type);
+    }
+
+    void from_json(const nlohmann::json &j, Record &r) {
+        const auto def = xm::data::def::record();
+        r.enabled = j.value("enabled", def.enabled);
+        r.path = j.value("path", def.path);
+        r.threads = j.value("threads", def.threads);
+        r.queue = j.value("queue", def.queue);
+        r.chunk = j.value("chunk", def.chunk);
+    }
+
+    void from_json(const nlohmann::json &j, Output &o) {
+        const auto def = xm::data::def::output();
+        o.sinks = j.value("sinks", def.sinks);
+        o.record = j.value("record", def.record);
+    }
+
     void from_json(const nlohmann::json &j, JsonConfig &c) {
         j.at("type").get_to(c.type);
         j.at("captures").get_to(c.captures);
@@ -497,6 +630,7 @@ namespace xm::data {
         c.gui = j.value("gui", xm::data::def::gui());
         c.pose = j.value("pose", xm::data::def::pose());
         c.compose = j.value("compose", xm::data::def::compose());
+        c.output = j.value("output", xm::data::def::output());
 
         if (c.type == ConfigType::CALIBRATION || c.type == ConfigType::CROSS_CALIBRATION) {
             j.at("calibration").get_to(c.calibration);
@@ -0,0 +1,73 @@
+//
+// Created by henryco on 21/07/24.
+//
+
+#include <algorithm>
+#include <atomic>
+#include <csignal>
+#include <opencv2/core/ocl.hpp>
+
+#include "../../xmotion/fbgtk/offline_boot.h"
+#include "../../xmotion/core/utils/eox_globals.h"
+#include "../../xmotion/core/ocl/ocl_cpu.h"
+#include "../../xmotion/core/ocl/cl_tuner.h"
+#include "../../xmotion/fbgtk/file_worker.h"
+
+namespace xm {
+
+    namespace {
+        std::atomic<bool> alive = true;
+
+        void on_signal(int) {
+            alive = false;
+        }
+    }
+
+    void OfflineBoot::open_project(const char *argv) {
+        project_file = xm::data::prepare_project_file(argv);
+        config = xm::data::config_from_file(project_file);
+
+        eox::globals::THREAD_POOL_CORES_MAX = config.misc.cpu;
+        xm::ocl::cpu::select(config.misc.compute);
+        xm::ocl::tuner::set_mode(config.misc.tune);
+
+        if (!config.misc.capture_file)
+            log->warn("Captures are not marked as files (misc.capture_file), treating them as recordings anyway");
+
+        // every frame is processed, exactly once
+        config.misc.capture_file = true;
+        config.misc.capture_realtime = false;
+        config.misc.capture_loop = false;
+
+        // nothing to keep up with, quality stays as configured
+        config.pose.governor._present = false;
+        config.output.record.enabled = false;
+
+        const auto file = std::find_if(config.output.sinks.begin(), config.output.sinks.end(),
+                                       [](const auto &s) { return s.type == XM_SINK_TYPE_FILE; });
+        if (file == config.output.sinks.end()) {
+            config.output.sinks.push_back({
+                    .type = XM_SINK_TYPE_FILE,
+                    .path = "offline.xmp",
+                    .clients = 0,
+                    .slots = 0
+            });
+            log->info("No file sink configured, results are written to: offline.xmp");
+        }
+    }
+
+    int OfflineBoot::boot(int &argc, char **&argv) {
+        cv::ocl::setUseOpenCL(!xm::ocl::cpu::enabled());
+
+        std::signal(SIGINT, on_signal);
+        std::signal(SIGTERM, on_signal);
+
+        xm::FileWorker worker(config, project_file);
+        worker.run_offline(alive);
+
+        if (!alive)
+            log->info("interrupted");
+        return 0;
+    }
+
+} // xm
@@ -0,0 +1,282 @@
+//
+// Created by henryco on 21/07/24.
+//
+// Conformance of CPU backend (ocl_cpu.h) against OpenCL kernels: every op
+// runs on the same input on both backends, outputs are compared per channel value.
+// Rounding of float math might differ by one, so values within tolerance are not mismatches.
+// Image object variants (xm::ocl::attach_image, hardware samplers) are checked against CPU backend too.
+//
+// Output (one line per op): mismatch [%] and max absolute difference,
+// exit code is 1 when any op exceeds allowed mismatch.
+//
+// Input is either an image file or synthetic frame (gradient with green backdrop and noise).
+//
+// Usage: xmotion_cpu_conformance [image|-] [tolerance=1] [max_mismatch_percent=0.1]
+//
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <opencv2/core/ocl.hpp>
+#include <opencv2/imgcodecs.hpp>
+
+#include "../xmotion/core/ocl/ocl_filters.h"
+#include "../xmotion/core/ocl/ocl_interop.h"
+#include "../xmotion/core/ocl/ocl_cpu.h"
+
+namespace {
+
+    const auto HLS_LOW = xm::ds::Color4u::hls(70, 40, 80);
+    const auto HLS_UP = xm::ds::Color4u::hls(100, 220, 255);
+    const auto COLOR = xm::ds::Color4u::bgr(255, 255, 255);
+
+    // same ranges for cv::UMat based ops
+    const cv::Scalar HLS_LOW_S(70, 40, 80);
+    const cv::Scalar HLS_UP_S(100, 220, 255);
+    const cv::Scalar COLOR_S(255, 255, 255);
+
+    typedef struct Diff {
+        double mismatch = 0;
+        double max = 0;
+    } Diff;
+
+    cv::Mat synthetic() {
+        cv::Mat frame(720, 1280, CV_8UC3);
+        for (int y = 0; y < frame.rows; y++) {
+            auto *row = frame.ptr<uint8_t>(y);
+            for (int x = 0; x < frame.cols; x++) {
+                row[x * 3 + 0] = (uint8_t) (x / 8);
+                row[x * 3 + 1] = (uint8_t) (y / 5);
+                row[x * 3 + 2] = (uint8_t) ((x + y) / 12);
+            }
+        }
+
+        // backdrop, so chroma key has something to key out
+        frame(cv::Rect(0, 0, frame.cols / 2, frame.rows)).setTo(cv::Scalar(40, 180, 50));
+
+        cv::Mat noise(frame.size(), CV_8UC3);
+        cv::randu(noise, 0, 24);
+        cv::add(frame, noise, frame);
+        return frame;
+    }
+
+    Diff compare(const cv::Mat &ocl, const cv::Mat &cpu, double tolerance) {
+        if (ocl.size() != cpu.size() || ocl.type() != cpu.type())
+            throw std::runtime_error("Output shape mismatch: " + std::to_string(ocl.cols) + "x" + std::to_string(ocl.rows)
+                                     + " vs " + std::to_string(cpu.cols) + "x" + std::to_string(cpu.rows));
+
+        cv::Mat a, b, diff;
+        ocl.reshape(1).convertTo(a, CV_64F);
+        cpu.reshape(1).convertTo(b, CV_64F);
+        cv::absdiff(a, b, diff);
+
+        Diff result;
+        cv::minMaxLoc(diff, nullptr, &result.max);
+        result.mismatch = 100. * (double) cv::countNonZero(diff > tolerance) / (double) diff.total();
+        return result;
+    }
+
+    class Conformance {
+        const double tolerance;
+        const double allowed;
+        int failed = 0;
+
+    public:
+        Conformance(double tolerance, double allowed) : tolerance(tolerance), allowed(allowed) {}
+
+        void run(const std::string &name, const std::function<std::pair<cv::Mat, cv::Mat>()> &fn) {
+            try {
+                const auto [ocl, cpu] = fn();
+                const auto diff = compare(ocl, cpu, tolerance);
+                const bool ok = diff.mismatch <= allowed;
+                if (!ok)
+                    failed++;
+                std::printf("%-32s %8.4f%%  max: %6.2f  %s\n", name.c_str(), diff.mismatch, diff.max, ok ? "ok" : "FAIL");
+            } catch (const std::exception &e) {
+                failed++;
+                std::printf("%-32s error: %s\n", name.c_str(), e.what());
+            }
+        }
+
+        [[nodiscard]] int failures() const {
+            return failed;
+        }
+    };
+
+}
+
+int main(int argc, char **argv) {
+    const std::string path = argc > 1 ? argv[1] : "-";
+    const double tolerance = argc > 2 ? std::atof(argv[2]) : 1.;
+    const double allowed = argc > 3 ? std::atof(argv[3]) : .1;
+
+    try {
+        // OpenCL is the reference, CPU ops are called directly
+        xm::ocl::cpu::select("opencl");
+    } catch (const std::exception &e) {
+        std::printf("%s\n", e.what());
+        return 1;
+    }
+
+    const cv::Mat frame = path == "-" ? synthetic() : cv::imread(path, cv::IMREAD_COLOR);
+    if (frame.empty()) {
+        std::printf("Cannot read: %s\n", path.c_str());
+        return 1;
+    }
+
+    std::printf("device: %s, input: %dx%d, tolerance: %.2f, allowed mismatch: %.3f%%\n",
+                cv::ocl::Device::getDefault().name().c_str(), frame.cols, frame.rows, tolerance, allowed);
+
+    const auto queue = xm::ocl::Kernels::instance().retrieve_queue(0);
+    const auto download = [&](const xm::ocl::iop::ClImagePromise &promise, int type = -1) {
+        return xm::ocl::iop::to_cv_mat(promise.getImage2D(), queue, type).waitFor().get();
+    };
+    const auto upload = [&](const cv::Mat &mat) {
+        return xm::ocl::iop::from_cv_mat(mat, queue).waitFor();
+    };
+
+    const auto input = upload(frame);
+    cv::UMat u_frame;
+    frame.copyTo(u_frame);
+
+    cv::Mat mask;
+    xm::ocl::cpu::range_hls(frame, mask, HLS_LOW_S, HLS_UP_S);
+    cv::UMat u_mask;
+    mask.copyTo(u_mask);
+
+    Conformance conformance(tolerance, allowed);
+
+    for (const int k: {3, 5, 9, 15}) {
+        conformance.run("blur k=" + std::to_string(k), [&]() {
+            cv::Mat cpu(frame.size(), frame.type());
+            xm::ocl::cpu::blur(frame, cpu, k);
+            return std::make_pair(download(xm::ocl::blur(queue, input, k).waitFor()), cpu);
+        });
+    }
+
+    conformance.run("range_hls", [&]() {
+        cv::UMat ocl;
+        cv::Mat cpu;
+        xm::ocl::bgr_in_range_hls(HLS_LOW_S, HLS_UP_S, u_frame, ocl);
+        xm::ocl::cpu::range_hls(frame, cpu, HLS_LOW_S, HLS_UP_S);
+        return std::make_pair(ocl.getMat(cv::ACCESS_READ).clone(), cpu);
+    });
+
+    for (const int k: {3, 7}) {
+        conformance.run("dilate k=" + std::to_string(k), [&]() {
+            cv::UMat ocl;
+            cv::Mat cpu;
+            xm::ocl::dilate(u_mask, ocl, 2, k);
+            xm::ocl::cpu::dilate(mask, cpu, 2, k);
+            return std::make_pair(ocl.getMat(cv::ACCESS_READ).clone(), cpu);
+        });
+        conformance.run("erode k=" + std::to_string(k), [&]() {
+            cv::UMat ocl;
+            cv::Mat cpu;
+            xm::ocl::erode(u_mask, ocl, 2, k);
+            xm::ocl::cpu::erode(mask, cpu, 2, k);
+            return std::make_pair(ocl.getMat(cv::ACCESS_READ).clone(), cpu);
+        });
+    }
+
+    conformance.run("mask_apply", [&]() {
+        cv::UMat ocl;
+        cv::Mat cpu;
+        xm::ocl::apply_mask_with_color(COLOR_S, u_frame, u_mask, ocl);
+        xm::ocl::cpu::mask_apply(frame, mask, cpu, COLOR_S);
+        return std::make_pair(ocl.getMat(cv::ACCESS_READ).clone(), cpu);
+    });
+
+    conformance.run("segmentation_apply", [&]() {
+        constexpr int size = 256;
+        constexpr float threshold = .5f;
+        std::vector<float> logits(size * size);
+        std::mt19937 random(42);
+        std::normal_distribution<float> distribution(0.f, 4.f);
+        for (auto &logit: logits)
+            logit = distribution(random);
+
+        const float roi_x = (float) frame.cols / 4.f, roi_y = 0.f;
+        const float roi_w = (float) frame.cols / 2.f, roi_h = (float) frame.rows;
+
+        cv::UMat ocl;
+        cv::Mat cpu;
+        xm::ocl::apply_segmentation(logits.data(), size, size, threshold, roi_x, roi_y, roi_w, roi_h, u_frame, ocl);
+        xm::ocl::cpu::segmentation_apply(logits.data(), size, size, std::log(threshold / (1.f - threshold)),
+                                         roi_x, roi_y, roi_w, roi_h, frame, cpu);
+        return std::make_pair(ocl.getMat(cv::ACCESS_READ).clone(), cpu);
+    });
+
+    for (const bool linear: {false, true}) {
+        const std::string suffix = linear ? " linear" : " nearest";
+        const auto key = xm::ocl::chroma_mask(queue, input, HLS_LOW, HLS_UP, linear, 512, 5, 3, 1).waitFor();
+        const auto key_mat = download(key, CV_8UC1);
+
+        conformance.run("chroma_mask" + suffix, [&]() {
+            cv::Mat cpu(key_mat.size(), CV_8UC1);
+            xm::ocl::cpu::chroma_mask(frame, cpu, HLS_LOW, HLS_UP, linear, 512, 5, 3, 1);
+            return std::make_pair(key_mat, cpu);
+        });
+
+        // hardware bilinear weights have limited precision, linear mask might differ at key edges
+        conformance.run("chroma_mask image" + suffix, [&]() {
+            cv::Mat cpu(key_mat.size(), CV_8UC1);
+            xm::ocl::cpu::chroma_mask(frame, cpu, HLS_LOW, HLS_UP, linear, 512, 5, 3, 1);
+            const auto image = xm::ocl::attach_image(queue, input);
+            return std::make_pair(download(xm::ocl::chroma_mask(queue, image, HLS_LOW, HLS_UP, linear, 512, 5, 3, 1).waitFor(), CV_8UC1), cpu);
+        });
+
+        conformance.run("chroma_apply" + suffix, [&]() {
+            cv::Mat cpu(frame.size(), frame.type());
+            xm::ocl::cpu::chroma_apply(frame, key_mat, cpu, COLOR);
+            return std::make_pair(download(xm::ocl::chroma_apply(queue, input, key, COLOR).waitFor()), cpu);
+        });
+
+        conformance.run("chroma_blob" + suffix, [&]() {
+            const float roi_x = (float) frame.cols / 8.f, roi_y = (float) frame.rows / 8.f;
+            const float roi_w = (float) frame.cols / 2.f, roi_h = (float) frame.rows * .75f;
+            cv::Mat cpu(256, 256, CV_32FC3);
+            xm::ocl::cpu::chroma_blob(frame, key_mat, cpu, COLOR, roi_x, roi_y, roi_w, roi_h, 256, 256);
+            const auto ocl = xm::ocl::chroma_blob(queue, input, key, COLOR, roi_x, roi_y, roi_w, roi_h, 256, 256);
+            // float tensor, tolerance is scaled to [0 ... 1]
+            cv::Mat ocl_u8, cpu_u8;
+            download(ocl.waitFor(), CV_32FC3).convertTo(ocl_u8, CV_8UC3, 255.);
+            cpu.convertTo(cpu_u8, CV_8UC3, 255.);
+            return std::make_pair(ocl_u8, cpu_u8);
+        });
+    }
+
+    for (const int mode: {1, 2, 3, 4, 5}) {
+        const bool fx = mode & 1, fy = mode & 2, rot = mode & 4;
+        conformance.run("flip_rotate " + std::to_string(fx) + std::to_string(fy) + std::to_string(rot), [&]() {
+            cv::Mat cpu;
+            xm::ocl::cpu::flip_rotate(frame, cpu, fx, fy, rot);
+            return std::make_pair(download(xm::ocl::flip_rotate(queue, input, fx, fy, rot).waitFor()), cpu);
+        });
+        conformance.run("flip_rotate image " + std::to_string(fx) + std::to_string(fy) + std::to_string(rot), [&]() {
+            cv::Mat cpu;
+            xm::ocl::cpu::flip_rotate(frame, cpu, fx, fy, rot);
+            const auto flipped = xm::ocl::flip_rotate(queue, input, fx, fy, rot, true);
+            // texels written together with packed pixels
+            return std::make_pair(download(xm::ocl::image_to_packed(queue, flipped).waitFor()), cpu);
+        });
+    }
+
+    conformance.run("attach_image", [&]() {
+        const auto image = xm::ocl::attach_image(queue, input);
+        return std::make_pair(download(xm::ocl::image_to_packed(queue, image).waitFor()), frame);
+    });
+
+    if (conformance.failures() > 0) {
+        std::printf("failed: %d\n", conformance.failures());
+        return 1;
+    }
+    std::printf("all ops conform\n");
+    return 0;
+}
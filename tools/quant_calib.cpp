@@ -0,0 +1,245 @@
+//
+// Created by henryco on 21/07/24.
+//
+// Builds representative (calibration) dataset for full-integer quantization
+// of the body landmarks model out of own footage: ROI crops of a recorded clip,
+// tracked the very same way as in pose pipeline (detector + predicted ROI).
+//
+// Output:
+//   <out>/calibration.npy  float32 [N, 256, 256, 3], RGB [0..1], letterboxed
+//   <out>/crop_<i>.png     same samples, for inspection
+//
+// When INT8 model is already there, reports its landmarks error
+// against F32 one (same clip, same ROIs) and latency of both.
+//
+// Usage: xmotion_quant_calib <clip> <out> [heavy|full|lite=full] [samples=500] [stride=5]
+//
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <opencv2/imgcodecs.hpp>
+#include <opencv2/videoio.hpp>
+
+#include "../xmotion/core/dnn/net/blaze_pose.h"
+#include "../xmotion/core/dnn/net/pose_detector.h"
+#include "../xmotion/core/dnn/net/pose_roi.h"
+
+namespace {
+
+    /**
+     * Body landmarks only, auxiliary (ROI) points are not compared
+     */
+    constexpr int BODY = 33;
+
+    constexpr float THRESHOLD_DETECTOR = 0.5f;
+    constexpr float THRESHOLD_POSE = 0.5f;
+    constexpr float ROI_SCALE = 1.2f;
+
+    typedef struct Error {
+        double sum = 0;
+        double max = 0;
+        double score = 0;
+        double ms_ref = 0;
+        double ms_int = 0;
+        int n = 0;
+    } Error;
+
+    eox::dnn::RoI detected_roi(const eox::dnn::DetectedPose &detected, int width, int height) {
+        auto body = detected.body;
+        body.x *= (float) width;
+        body.y *= (float) height;
+        body.w *= (float) width;
+        body.h *= (float) height;
+        body.c.x *= (float) width;
+        body.c.y *= (float) height;
+        body.e.x *= (float) width;
+        body.e.y *= (float) height;
+        return body;
+    }
+
+    void write_npy(const std::filesystem::path &path, const std::vector<float> &data, int n, int w, int h) {
+        std::string header = "{'descr': '<f4', 'fortran_order': False, 'shape': ("
+                             + std::to_string(n) + ", " + std::to_string(h) + ", "
+                             + std::to_string(w) + ", 3), }";
+
+        // magic (6) + version (2) + header length (2) + header, aligned to 64 bytes
+        const size_t total = 10 + header.size() + 1;
+        header.append((64 - total % 64) % 64, ' ');
+        header.push_back('\n');
+
+        std::ofstream out(path, std::ios::binary);
+        if (!out.is_open())
+            throw std::runtime_error("Cannot write: " + path.string());
+
+        const char magic[8] = {'\x93', 'N', 'U', 'M', 'P', 'Y', 1, 0};
+        const auto length = (uint16_t) header.size();
+        out.write(magic, sizeof(magic));
+        out.write(reinterpret_cast<const char *>(&length), sizeof(length)); // little endian
+        out.write(header.data(), (std::streamsize) header.size());
+        out.write(reinterpret_cast<const char *>(data.data()), (std::streamsize) (data.size() * sizeof(float)));
+    }
+
+    double distance(const eox::dnn::PoseOutput &a, const eox::dnn::PoseOutput &b, int i) {
+        const double dx = a.landmarks_norm[i].x - b.landmarks_norm[i].x;
+        const double dy = a.landmarks_norm[i].y - b.landmarks_norm[i].y;
+        return std::sqrt(dx * dx + dy * dy);
+    }
+
+    double elapsed(std::chrono::steady_clock::time_point t0) {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+    }
+}
+
+int main(int argc, char **argv) {
+    if (argc < 3) {
+        std::printf("Usage: %s <clip> <out> [heavy|full|lite=full] [samples=500] [stride=5]\n", argv[0]);
+        return 1;
+    }
+
+    const std::string clip = argv[1];
+    const std::filesystem::path out = argv[2];
+    const std::string kind = argc > 3 ? argv[3] : "full";
+    const int samples = argc > 4 ? std::max(1, std::atoi(argv[4])) : 500;
+    const int stride = argc > 5 ? std::max(1, std::atoi(argv[5])) : 5;
+
+    const int k = kind == "heavy" ? 0 : kind == "lite" ? 2 : 1;
+    const auto model_ref = static_cast<eox::dnn::pose::Model>(eox::dnn::pose::HEAVY_F32 + k);
+    const auto model_int = static_cast<eox::dnn::pose::Model>(eox::dnn::pose::HEAVY_I8 + k);
+
+    cv::VideoCapture capture(clip);
+    if (!capture.isOpened()) {
+        std::printf("Cannot open clip: %s\n", clip.c_str());
+        return 1;
+    }
+
+    std::filesystem::create_directories(out);
+
+    eox::dnn::PoseDetector detector;
+    detector.set_model_type(eox::dnn::box::F_32);
+    detector.setThreshold(THRESHOLD_DETECTOR);
+
+    eox::dnn::BlazePose reference;
+    reference.set_model_type(model_ref);
+    reference.set_segmentation(false);
+
+    // evaluation only when there is something to evaluate
+    const bool evaluate = std::filesystem::exists(eox::dnn::BlazePose::model_file(model_int));
+    eox::dnn::BlazePose quantized;
+    quantized.set_model_type(model_int);
+    quantized.set_segmentation(false);
+
+    eox::dnn::PoseRoi predictor;
+    predictor.setScale(ROI_SCALE);
+
+    const int w = reference.get_in_w();
+    const int h = reference.get_in_h();
+
+    std::vector<float> dataset;
+    dataset.reserve((size_t) samples * w * h * 3);
+
+    Error error;
+    eox::dnn::RoI roi{};
+    bool tracking = false;
+    int frames = 0, n = 0;
+
+    cv::Mat frame;
+    while (n < samples && capture.read(frame)) {
+        frames++;
+
+        if (!tracking) {
+            const auto detections = detector.inference(frame);
+            if (detections.empty() || detections[0].score < THRESHOLD_DETECTOR)
+                continue;
+            roi = eox::dnn::clamp_roi(detected_roi(detections[0], frame.cols, frame.rows), frame.cols, frame.rows);
+        }
+
+        const auto rect = cv::Rect((int) roi.x, (int) roi.y, (int) roi.w, (int) roi.h)
+                          & cv::Rect(0, 0, frame.cols, frame.rows);
+        if (rect.width <= 0 || rect.height <= 0) {
+            tracking = false;
+            continue;
+        }
+
+        const cv::Mat crop = frame(rect);
+        auto t0 = std::chrono::steady_clock::now();
+        const auto result = reference.inference(crop);
+        const double ms_ref = elapsed(t0);
+
+        tracking = result.score > THRESHOLD_POSE;
+        if (!tracking)
+            continue;
+
+        eox::dnn::Landmark landmarks[39];
+        for (int i = 0; i < 39; i++) {
+            landmarks[i] = result.landmarks_norm[i];
+            landmarks[i].x = result.landmarks_norm[i].x * roi.w + roi.x;
+            landmarks[i].y = result.landmarks_norm[i].y * roi.h + roi.y;
+        }
+        const auto current = roi;
+        roi = eox::dnn::clamp_roi(predictor.forward(eox::dnn::roiFromPoseLandmarks39(landmarks)), frame.cols, frame.rows);
+
+        if (frames % stride != 0)
+            continue;
+
+        // exactly what the network gets: letterboxed RGB [0..1]
+        const cv::Mat blob = eox::dnn::convert_to_squared_blob(crop, w, h, true);
+        const auto ptr = blob.ptr<float>(0);
+        dataset.insert(dataset.end(), ptr, ptr + (size_t) w * h * 3);
+
+        cv::Mat png;
+        blob.convertTo(png, CV_8UC3, 255.);
+        cv::cvtColor(png, png, cv::COLOR_RGB2BGR);
+        cv::imwrite((out / ("crop_" + std::to_string(n) + ".png")).string(), png);
+        n++;
+
+        if (!evaluate)
+            continue;
+
+        t0 = std::chrono::steady_clock::now();
+        const auto other = quantized.inference(crop);
+        error.ms_int += elapsed(t0);
+        error.ms_ref += ms_ref;
+
+        // normalized ROI coordinates, to pixels of the ROI (longer side)
+        const double scale = std::max(current.w, current.h);
+        for (int i = 0; i < BODY; i++) {
+            const double d = distance(result, other, i) * scale;
+            error.sum += d;
+            error.max = std::max(error.max, d);
+        }
+        error.score += std::abs(result.score - other.score);
+        error.n++;
+    }
+
+    if (n == 0) {
+        std::printf("No pose found in: %s\n", clip.c_str());
+        return 1;
+    }
+
+    write_npy(out / "calibration.npy", dataset, n, w, h);
+    std::printf("samples: %d (frames: %d), model: %s\n", n, frames, eox::dnn::pose::models[model_ref].c_str());
+
+    if (!evaluate) {
+        std::printf("no int8 model (%s), evaluation skipped\n", eox::dnn::pose::models[model_int].c_str());
+        return 0;
+    }
+
+    std::printf("%-12s %14s %14s %12s %10s %10s\n",
+                "model", "mean err (px)", "max err (px)", "score diff", "f32 (ms)", "i8 (ms)");
+    std::printf("%-12s %14.3f %14.3f %12.4f %10.3f %10.3f\n",
+                kind.c_str(),
+                error.sum / (error.n * BODY),
+                error.max,
+                error.score / error.n,
+                error.ms_ref / error.n,
+                error.ms_int / error.n);
+    return 0;
+}
@@ -0,0 +1,72 @@
+//
+// Created by henryco on 18/07/24.
+//
+
+#ifndef XMOTION_CALIB_ENGINE_H
+#define XMOTION_CALIB_ENGINE_H
+
+#include <opencv2/core/mat.hpp>
+#include "../utils/thread_pool.h"
+#include "../utils/cv_utils.h"
+
+#include <spdlog/logger.h>
+#include <spdlog/sinks/stdout_color_sinks.h>
+
+namespace xm::calib {
+
+    /**
+     * Shared machinery of calibration logics:
+     * parallel pattern detection (one task per view) and
+     * background (incremental) solver, which runs while samples are still being collected.
+     */
+    class Engine {
+
+        static inline const auto log =
+                spdlog::stdout_color_mt("calib_engine");
+
+    private:
+        eox::util::ThreadPool detectors;
+        eox::util::ThreadPool solver;
+        std::future<void> solving;
+
+        uint columns = 0;
+        uint rows = 0;
+        bool sb = false;
+        int max_size = 640;
+
+    public:
+        Engine() = default;
+
+        ~Engine();
+
+        /**
+         * @param max_size longest side of the image used for pattern localization (see find_squares_fast)
+         * @param threads number of detector threads (usually number of views)
+         */
+        void init(uint columns, uint rows, bool sb, int max_size, size_t threads);
+
+        /**
+         * Detects pattern on every view in parallel
+         */
+        std::vector<xm::ocv::Squares> detect(const std::vector<cv::UMat> &views);
+
+        /**
+         * Schedules solver task in background, unless previous one is still running
+         * @return false if solver is busy (task is dropped)
+         */
+        bool solve(std::function<void()> task);
+
+        /**
+         * @return true if there is a solver task in progress
+         */
+        bool busy() const;
+
+        /**
+         * Waits for solver task in progress (if any)
+         */
+        void wait();
+    };
+
+} // xm::calib
+
+#endif //XMOTION_CALIB_ENGINE_H
@@ -9,7 +9,9 @@
 #define XMOTION_CALIBRATION_H
 
 #include "i_logic.h"
+#include "calib_engine.h"
 #include "../utils/timer.h"
+#include <mutex>
 
 namespace xm::calib {
 
@@ -84,6 +86,17 @@ namespace xm::calib {
          */
         float r;
 
+        /**
+         * Re-projection error (rms) of the background solver,
+         * updated while samples are still being collected
+         */
+        double rms_live;
+
+        /**
+         * Number of samples used for rms_live
+         */
+        int samples_live;
+
     } Result;
 
     typedef struct Initial {
@@ -102,6 +115,12 @@ namespace xm::calib {
         float cy = -1;
         bool fix_f = false;
         bool fix_c = false;
+
+        /**
+         * Longest side of the image used for pattern localization
+         * (refined at full resolution afterwards), non-positive to disable
+         */
+        int detect_size = 640;
     } Initial;
 }
 
@@ -119,6 +138,13 @@ namespace xm {
         bool active = false;
         bool DEBUG = false;
 
+        std::mutex live_mutex;
+        double live_rms = 0;
+        int live_samples = 0;
+
+        // must be last, background solver is using fields above
+        xm::calib::Engine engine;
+
     public:
         void init(const xm::calib::Initial &params);
 
@@ -141,6 +167,10 @@ namespace xm {
 
         void calibrate();
 
+        void calibrate_live();
+
+        void solve(const std::vector<std::vector<cv::Point2f>> &points, xm::calib::Result &out) const;
+
         void put_debug_text();
     };
 
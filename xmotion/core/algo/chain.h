@@ -8,7 +8,9 @@
 #define XMOTION_CROSS_H
 
 #include "i_logic.h"
+#include "calib_engine.h"
 #include "../utils/timer.h"
+#include <mutex>
 
 #include <spdlog/logger.h>
 #include <spdlog/sinks/stdout_color_sinks.h>
@@ -73,6 +75,17 @@ namespace xm::chain {
          * Current calibration pair (0-indexed)
          */
         int current;
+
+        /**
+         * Re-projection error (rms) of the background solver for current pair,
+         * updated while samples are still being collected
+         */
+        double rms_live;
+
+        /**
+         * Number of samples used for rms_live
+         */
+        int samples_live;
     } Result;
 
     typedef struct Initial {
@@ -87,6 +100,12 @@ namespace xm::chain {
         int views = 2;
         std::vector<cv::Mat> K;
         std::vector<cv::Mat> D;
+
+        /**
+         * Longest side of the image used for pattern localization
+         * (refined at full resolution afterwards), non-positive to disable
+         */
+        int detect_size = 640;
     } Initial;
 }
 
@@ -113,6 +132,14 @@ namespace xm {
         int total_pairs = 0;
         int current_pair = 0;
 
+        std::mutex live_mutex;
+        double live_rms = 0;
+        int live_samples = 0;
+        int live_pair = -1;
+
+        // must be last, background solver is using fields above
+        xm::calib::Engine engine;
+
     public:
         void init(const xm::chain::Initial &params);
 
@@ -135,6 +162,10 @@ namespace xm {
 
         void calibrate();
 
+        void calibrate_live();
+
+        xm::chain::Pair solve(int pair, const std::vector<std::vector<std::vector<cv::Point2f>>> &samples) const;
+
         void put_debug_text();
     };
 }
@@ -8,6 +8,7 @@
 #ifndef XMOTION_LOGIC_H
 #define XMOTION_LOGIC_H
 
+#include <cstdint>
 #include <vector>
 #include "../ocl/ocl_data.h"
 
@@ -20,6 +21,11 @@ namespace xm {
 
         virtual Logic& proceed(float delta, const std::vector<xm::ocl::Image2D> &frames) = 0;
 
+        /**
+         * @param timestamp time frames of the next proceed() were received from cameras, nanoseconds since epoch
+         */
+        virtual void received(int64_t timestamp) {}
+
         virtual const std::vector<xm::ocl::Image2D> &frames() const = 0;
 
         virtual bool is_active() const = 0;
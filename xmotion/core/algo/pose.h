@@ -12,6 +12,7 @@
 #include "../utils/thread_pool.h"
 #include "../dnn/pose_pipeline.h"
 #include "../utils/epi_util.h"
+#include "../utils/geometry.h"
 
 #include <spdlog/logger.h>
 #include <spdlog/sinks/stdout_color_sinks.h>
@@ -136,6 +137,13 @@ namespace xm::nview {
          */
         float threshold_roi = 0.f;
 
+        /**
+         * Segmentation probability threshold
+         *
+         * [0.0 ... 1.0]
+         */
+        float threshold_segmentation = 0.5f;
+
         /**
          * Low-pass filter velocity scale: lower -> smoother, but adds lag.
          */
@@ -152,11 +160,39 @@ namespace xm::nview {
          */
         int filter_target_fps = 30;
 
+        /**
+         * Max number of people tracked within the view, one (1) means single-person mode
+         */
+        int track_people = 1;
+
+        /**
+         * Min IoU of detected and tracked ROI to associate them (multi-person mode)
+         *
+         * [0.0 ... 1.0]
+         */
+        float track_iou = 0.3f;
+
+        /**
+         * Number of frames lost track is kept for re-acquisition (multi-person mode)
+         */
+        int track_misses = 5;
+
+        /**
+         * Number of frames between detector runs looking for new people (multi-person mode)
+         */
+        int track_reacquire = 15;
+
         /**
          * Undistort input image
          */
         bool undistort_source = false;
 
+        /**
+         * Fold source undistortion into ROI resampling of the network input
+         * (requires undistort_source), full frame is undistorted only for debug
+         */
+        bool undistort_warp = false;
+
         /**
          * Undistort position of localized points
          */
@@ -170,6 +206,23 @@ namespace xm::nview {
          */
         float undistort_alpha = 0;
 
+        /**
+         * Inverse distortion lookup grid size (nodes along x axis),
+         * used for undistortion of points. Zero (0) means exact solver
+         */
+        int undistort_grid_w = 64;
+
+        /**
+         * Inverse distortion lookup grid size (nodes along y axis)
+         */
+        int undistort_grid_h = 48;
+
+        /**
+         * Max acceptable error (pixels) of lookup grid comparing to exact solver,
+         * grid is discarded (exact solver is used) when exceeded
+         */
+        float undistort_tolerance = 0.1f;
+
         /**
            * Image width
            */
@@ -194,6 +247,17 @@ namespace xm::nview {
          * Distortion coefficients
          */
         cv::Mat D;
+
+        /**
+         * Chroma key fused with dnn preprocessing
+         * (applied only to the network input)
+         */
+        bool chroma_fused = false;
+
+        /**
+         * Fused chroma key configuration
+         */
+        xm::filters::chroma::Conf chroma{};
     } Device;
 
     typedef struct Initial {
@@ -218,22 +282,90 @@ namespace xm::nview {
         */
         bool show_epilines;
 
+        /**
+         * Seed ROI of views which lost track using
+         * epilines of views which still keep it
+         */
+        bool cross_seed;
+
         /**
          * Number of worker threads
          */
         int threads;
 
+        /**
+         * Prepare lower quality levels (lighter models, no segmentation)
+         * with warm interpreters, so quality can be changed at runtime without stalls
+         */
+        bool adaptive;
+
+        /**
+         * Directory for serialized GPU delegate programs, empty disables serialization
+         */
+        std::string cache_dir;
+
     } Initial;
 
+    typedef struct Quality {
+        DetectorModel detector_model;
+        BodyModel body_model;
+        bool segmentation;
+    } Quality;
+
     typedef struct ReMaps {
         cv::Mat newK;
         cv::Mat map1;
         cv::Mat map2;
+
+        /**
+         * Floating point maps (CV_32FC1) for undistortion warp, empty if not used
+         */
+        cv::Mat warp_x;
+        cv::Mat warp_y;
     } ReMaps;
 
+    typedef struct Marks {
+        /**
+         * Pose landmarks in frame's coordinate system
+         * (undistorted if required by device configuration)
+         */
+        eox::dnn::Landmark landmarks[39];
+
+        /**
+         * Pose landmarks in world space (relative to the hips, per device)
+         */
+        eox::dnn::Coord3d ws_landmarks[39];
+
+        /**
+         * Presence flag
+         */
+        bool present;
+
+        /**
+         * Presence score
+         */
+        float score;
+    } Marks;
+
     typedef struct Result {
         bool error;
         std::string err_msg;
+
+        /**
+         * Incremented for every processed (inferred) frame set
+         */
+        uint64_t sequence;
+
+        /**
+         * Time processed frame set was received from cameras (before filtering and inference),
+         * nanoseconds since epoch
+         */
+        int64_t timestamp;
+
+        /**
+         * Per device landmarks, empty when there is nothing new
+         */
+        std::vector<Marks> marks;
     } Result;
 }
 
@@ -245,6 +377,20 @@ namespace xm {
 
     private:
         std::vector<xm::nview::ReMaps> remap_maps{};
+        std::vector<xm::nview::Marks> last_seen{};
+        std::vector<xm::util::geom::Camera> cameras{};
+        std::vector<xm::util::geom::Grid> grids{};
+
+        /**
+         * Per device quality levels, the first one (0) is configured one
+         */
+        std::vector<std::vector<xm::nview::Quality>> qualities{};
+        std::vector<int> quality_levels{};
+
+        /**
+         * Per device pipeline latency of the last pass (ms)
+         */
+        std::vector<float> latencies{};
         std::vector<xm::ocl::Image2D> images{};
         xm::nview::Result results{};
         xm::nview::Initial config{};
@@ -252,6 +398,11 @@ namespace xm {
         std::vector<std::unique_ptr<eox::util::ThreadPool>> workers;
         std::vector<std::unique_ptr<eox::dnn::PosePipeline>> poses;
 
+        /**
+         * See received(), 0 if not set for the next frame set
+         */
+        int64_t received_at = 0;
+
         bool active = false;
         bool DEBUG = false;
 
@@ -268,6 +419,8 @@ namespace xm {
 
         Pose &proceed(float delta, const std::vector<xm::ocl::Image2D> &frames) override;
 
+        void received(int64_t timestamp) override;
+
         bool is_active() const override;
 
         void start() override;
@@ -280,6 +433,38 @@ namespace xm {
 
         const xm::nview::Result &result() const;
 
+        /**
+         * Pipeline latency of the last pass per device (ms)
+         */
+        const std::vector<float> &latency() const;
+
+        /**
+         * @return number of quality levels available for device (at least one)
+         */
+        int qualities_n(int index) const;
+
+        /**
+         * @return current quality level of device, 0 is the best one
+         */
+        int quality(int index) const;
+
+        /**
+         * Switches device's pipeline to given quality level (clamped),
+         * must not be called during proceed()
+         */
+        void set_quality(int index, int level);
+
+        /**
+         * Batch undistortion of frame points (lookup grid or exact solver),
+         * if required by device configuration. In place operation is allowed
+         */
+        void undistorted(const xm::util::geom::Point *in, int num, int index, xm::util::geom::Point *out) const;
+
+        /**
+         * Inverse of undistorted(), back to frame's coordinates. In place operation is allowed
+         */
+        void distorted(const xm::util::geom::Point *in, int num, int index, xm::util::geom::Point *out) const;
+
     protected:
         void release();
 
@@ -293,14 +478,49 @@ namespace xm {
 
         cv::UMat undistorted(const cv::UMat &in, int index) const;
 
-        std::vector<cv::Point2f> undistorted(const eox::dnn::Landmark *in, int num, int index) const;
+        /**
+         * Whether undistortion of device's frames is folded into pose pipeline
+         */
+        bool undistort_warp(int index) const;
 
-        cv::Vec3f epi_line_from_point(const cv::Point2f &point, int idx_point, int idx_line) const;
+        /**
+         * Landmarks positions, undistorted if required by device configuration
+         */
+        void undistorted(const eox::dnn::Landmark *in, int num, int index, xm::util::geom::Point *out) const;
 
-        void points_from_epi_line(const cv::UMat &img, const cv::Vec3f &line, cv::Point2i &p1, cv::Point2i &p2) const;
+        /**
+         * Suggests ROI for views which lost track of the body,
+         * using epilines of ROI anchor points from views which still keep it
+         */
+        void seed_lost_views();
+
+        /**
+         * Least squares intersection of (normalized) lines
+         *
+         * @return false if lines are (almost) parallel or there are less than two of them
+         */
+        static bool epi_lines_intersection(const xm::util::geom::Line *lines, int n, xm::util::geom::Point &point);
+
+        /**
+         * Batched epipolar lines (normalized) in view idx_line for points of view idx_point
+         */
+        void epi_lines_from_points(const xm::util::geom::Point *points, int num, int idx_point, int idx_line,
+                                   xm::util::geom::Line *lines) const;
+
+        void points_from_epi_line(const cv::UMat &img, const xm::util::geom::Line &line, cv::Point2i &p1, cv::Point2i &p2) const;
 
         void init_undistort_maps();
 
+        void init_qualities();
+
+        /**
+         * Builds interpreters of every quality level in advance and invokes them once,
+         * on the very same worker threads which are going to use them
+         */
+        void warm_up();
+
+        xm::util::geom::Grid init_undistort_grid(const xm::nview::Device &device, const xm::util::geom::Camera &camera) const;
+
         void init_validate();
     };
 
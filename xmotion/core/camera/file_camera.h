@@ -0,0 +1,195 @@
+//
+// Created by henryco on 21/07/24.
+//
+
+#ifndef XMOTION_FILE_CAMERA_H
+#define XMOTION_FILE_CAMERA_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+#include "stereo_camera.h"
+#include "raw_reader.h"
+
+namespace xm {
+
+    /**
+     * Video files as capture devices (device_id is the file path), one decoder thread
+     * per file with bounded prefetch queue. Captures sharing the same file share the decoder.
+     * Region, flip and rotation are applied the same way as for cameras.
+     *
+     * Directory recorded by xm::sink::RawRecorder (per camera) is accepted as well.
+     */
+    class FileCamera : public xm::StereoCamera {
+
+        static inline const auto log =
+                spdlog::stdout_color_mt("file_camera");
+
+        /**
+         * Default size of prefetch queue (frames), when capture buffer is not set
+         */
+        static constexpr int PREFETCH = 8;
+
+        typedef struct Frame {
+            cv::Mat image;
+            int index;
+            int generation;
+        } Frame;
+
+        typedef struct Source {
+            cv::VideoCapture capture;
+
+            /**
+             * Raw recording instead of video file, if not null
+             */
+            std::unique_ptr<xm::RawReader> raw;
+            std::thread decoder;
+
+            std::mutex mutex;
+            std::condition_variable produced;
+            std::condition_variable consumed;
+            std::deque<Frame> queue;
+            size_t capacity = PREFETCH;
+
+            /**
+             * Pending seek request (frame index), -1 if none
+             */
+            int seek = -1;
+
+            /**
+             * Incremented on every seek, frames of older generations are dropped
+             */
+            int generation = 0;
+
+            int length = 0;
+            double fps = 0;
+            int width = 0;
+            int height = 0;
+
+            bool eof = false;
+            bool stop = false;
+
+            /**
+             * Last delivered frame, repeated after the end of non-looped file
+             */
+            cv::Mat last;
+        } Source;
+
+        /**
+         * {device_id: source}
+         */
+        std::map<std::string, std::unique_ptr<Source>> sources{};
+
+        std::chrono::steady_clock::time_point clock_start{};
+        int clock_origin = 0;
+
+        /**
+         * Reset by setters, which can be called from other thread than capture
+         */
+        std::atomic<bool> clock_started = false;
+
+        /**
+         * Index of the last delivered frame
+         */
+        int current = -1;
+
+        std::atomic<bool> real_time = true;
+
+        /**
+         * Read by decoder threads (once per frame, under the source mutex)
+         */
+        std::atomic<bool> loop = true;
+
+    public:
+        ~FileCamera() override;
+
+        void release() override;
+
+        void open(const SCamProp &prop) override;
+
+        std::map<std::string, xm::ocl::Image2D> captureWithName() override;
+
+        /**
+         * Frames are prefetched by decoder threads already, nothing to enqueue
+         */
+        void enqueue() override;
+
+        std::vector<xm::ocl::Image2D> dequeue() override;
+
+        std::map<std::string, xm::ocl::Image2D> dequeueWithName() override;
+
+        void setControl(const std::string &device_id, uint prop_id, int value) override;
+
+        void resetControls(const std::string &device_id) override;
+
+        void resetControls() override;
+
+        [[nodiscard]] std::vector<platform::cap::camera_controls> getControls() const override;
+
+        [[nodiscard]] platform::cap::camera_controls getControls(const std::string &device_id) const override;
+
+        void save(std::ostream &output_stream, const std::string &device_id, const std::string &name) const override;
+
+        void read(std::istream &input_stream, const std::string &device_id, const std::string &name) override;
+
+        /**
+         * Real-time mode: frames are paced by file's fps, late frames are dropped (as with cameras).
+         * Otherwise every frame is delivered as fast as possible (throughput runs).
+         */
+        void setRealTime(bool real_time);
+
+        /**
+         * Restart from the first frame at the end of file
+         */
+        void setLoop(bool loop);
+
+        /**
+         * Frame accurate seek of all the files, next delivered frame is the given one
+         */
+        void seek(int frame);
+
+        /**
+         * @return index of the last delivered frame, -1 if none yet
+         */
+        [[nodiscard]] int position() const;
+
+        /**
+         * @return number of frames of the shortest file
+         */
+        [[nodiscard]] int length() const;
+
+        /**
+         * @return true if every frame of non-looped files has been delivered
+         */
+        [[nodiscard]] bool finished() const;
+
+        /**
+         * @return fps of the first file
+         */
+        [[nodiscard]] double fps() const;
+
+        [[nodiscard]] bool getRealTime() const;
+
+        [[nodiscard]] bool getLoop() const;
+
+    protected:
+        void decode(Source &source, const SCamProp &prop);
+
+        /**
+         * Blocks until frame with given index (or later one) is available
+         * @return false if source has reached the end
+         */
+        bool next(Source &source, int index, Frame &out);
+
+        static bool read(Source &source, cv::Mat &image);
+
+        static void seek(Source &source, int frame);
+    };
+
+} // xm
+
+#endif //XMOTION_FILE_CAMERA_H
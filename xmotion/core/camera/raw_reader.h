@@ -0,0 +1,100 @@
+//
+// Created by henryco on 21/07/24.
+//
+
+#ifndef XMOTION_RAW_READER_H
+#define XMOTION_RAW_READER_H
+
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+#include <opencv2/core/mat.hpp>
+
+namespace xm {
+
+    /**
+     * Sequential reader of single camera recording made by xm::sink::RawRecorder
+     * (directory with index.csv and chunk files).
+     *
+     * Frames are addressed by sequence number (relative to the first one), frames dropped
+     * while recording are substituted with the previous one, so recordings of all cameras
+     * of the same session stay in sync.
+     */
+    class RawReader {
+
+        typedef struct Entry {
+            uint64_t seq;
+            uint64_t timestamp;
+            int chunk;
+            uint64_t offset;
+            uint64_t size;
+        } Entry;
+
+        std::filesystem::path dir;
+        std::vector<Entry> entries;
+
+        std::ifstream stream;
+        int stream_chunk = -1;
+
+        std::vector<uint8_t> buffer;
+        cv::Mat last;
+
+        /**
+         * Next frame (relative sequence number) and next entry to read
+         */
+        int frame = 0;
+        size_t entry = 0;
+
+        int cols = 0;
+        int rows = 0;
+
+    public:
+        /**
+         * @return true if directory looks like a recording (has index.csv)
+         */
+        static bool is_recording(const std::filesystem::path &dir);
+
+        /**
+         * @throws std::runtime_error if recording is missing or empty
+         */
+        void open(const std::filesystem::path &dir);
+
+        [[nodiscard]] bool isOpened() const;
+
+        void release();
+
+        /**
+         * Reads next frame
+         * @return false at the end of the recording
+         */
+        bool read(cv::Mat &out);
+
+        /**
+         * Next read() returns given frame (relative sequence number)
+         */
+        void seek(int frame);
+
+        [[nodiscard]] int position() const;
+
+        /**
+         * @return number of frames (sequence numbers span, including dropped ones)
+         */
+        [[nodiscard]] int length() const;
+
+        /**
+         * @return fps estimated from recorded timestamps, 0 if unknown
+         */
+        [[nodiscard]] double fps() const;
+
+        [[nodiscard]] int width() const;
+
+        [[nodiscard]] int height() const;
+
+    private:
+        void load(const Entry &entry, cv::Mat &out);
+    };
+
+} // xm
+
+#endif //XMOTION_RAW_READER_H
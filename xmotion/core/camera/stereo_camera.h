@@ -5,8 +5,12 @@
 #ifndef XMOTION_STEREO_CAMERA_H
 #define XMOTION_STEREO_CAMERA_H
 
+#include <atomic>
+#include <chrono>
 #include <map>
+#include <memory>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include <fstream>
@@ -16,6 +20,7 @@
 
 #include "../ocl/ocl_data.h"
 #include "../utils/thread_pool.h"
+#include "../utils/mailbox.h"
 #include "../../../platforms/agnostic_cap.h"
 
 namespace xm {
@@ -37,11 +42,71 @@ namespace xm {
         int h;
     } SCamProp;
 
+    /**
+     * Frame accounting of single capture device (latest frame mode, see StereoCamera::setLatestMode)
+     */
+    typedef struct SCamStats {
+        /**
+         * Frames grabbed by capture thread
+         */
+        uint64_t captured = 0;
+
+        /**
+         * Frames returned by dequeue (new ones only)
+         */
+        uint64_t delivered = 0;
+
+        /**
+         * Frames overwritten by newer ones before dequeue
+         */
+        uint64_t dropped = 0;
+
+        /**
+         * Dequeues without new frame, previous one is returned again
+         */
+        uint64_t duplicated = 0;
+
+        /**
+         * Dequeues returning frame grabbed more than two frame periods (fps) ago
+         */
+        uint64_t stale = 0;
+    } SCamStats;
+
     class StereoCamera {
 
         static inline const auto log =
                 spdlog::stdout_color_mt("stereo_camera");
 
+        typedef struct Latest {
+            /**
+             * {name: frame}, transformed already
+             */
+            std::map<std::string, xm::ocl::Image2D> frames;
+            std::chrono::steady_clock::time_point timestamp;
+        } Latest;
+
+        typedef struct Grabber {
+            std::thread thread;
+            xm::util::Mailbox<Latest> mailbox;
+
+            /**
+             * Frame is stale when it is older than that
+             */
+            std::chrono::steady_clock::duration stale_after{};
+
+            std::atomic<bool> stop = false;
+            std::atomic<uint64_t> captured = 0;
+            std::atomic<uint64_t> delivered = 0;
+            std::atomic<uint64_t> dropped = 0;
+            std::atomic<uint64_t> duplicated = 0;
+            std::atomic<uint64_t> stale = 0;
+        } Grabber;
+
+        /**
+         * {id: grabber}, latest frame mode only
+         */
+        std::map<std::string, std::unique_ptr<Grabber>> grabbers{};
+
     protected:
 
         /**
@@ -71,6 +136,16 @@ namespace xm {
 
         bool fast = false;
 
+        /**
+         * Frames carry image objects (see xm::ocl::attach_image)
+         */
+        bool images = false;
+
+        /**
+         * Continuous capture, dequeue returns the newest frames (see setLatestMode)
+         */
+        bool latest = false;
+
     public:
         StereoCamera() = default;
 
@@ -88,12 +163,13 @@ namespace xm {
         virtual std::vector<xm::ocl::Image2D> capture();
 
         /**
-         * Enqueue asynchronous frame capturing
+         * Enqueue asynchronous frame capturing (starts capture threads in latest frame mode)
          */
         virtual void enqueue();
 
         /**
-         * @return asynchronously grabbed frames enqueued by calling "enqueue()"
+         * @return asynchronously grabbed frames enqueued by calling "enqueue()",
+         * newest frames in latest frame mode (without waiting, once every camera has delivered its first frame)
          */
         virtual std::vector<xm::ocl::Image2D> dequeue();
 
@@ -107,10 +183,32 @@ namespace xm {
 
         virtual void setFastMode(bool fast);
 
+        /**
+         * Attach 4 channel image objects (CL_RGBA) to captured frames, written together with flip / rotation,
+         * so resampling filters (chroma key mask, background subtraction) sample them by hardware
+         */
+        virtual void setImageObjects(bool images);
+
+        /**
+         * Latest frame mode: every camera is captured continuously by its own thread, which keeps only
+         * the newest frame (older ones are dropped instead of piling up in driver buffers),
+         * so processing always gets the most recent frames. Must be set before the first frame.
+         */
+        virtual void setLatestMode(bool latest);
+
         virtual void setThreadPool(std::shared_ptr<eox::util::ThreadPool> executor);
 
         [[nodiscard]] virtual bool getFastMode() const;
 
+        [[nodiscard]] virtual bool getImageObjects() const;
+
+        [[nodiscard]] virtual bool getLatestMode() const;
+
+        /**
+         * @return {device_id: stats}, empty if latest frame mode is not active
+         */
+        [[nodiscard]] virtual std::map<std::string, SCamStats> getStats() const;
+
         [[nodiscard]] virtual std::vector<platform::cap::camera_controls> getControls() const;
 
         [[nodiscard]] virtual platform::cap::camera_controls getControls(const std::string &device_id) const;
@@ -120,6 +218,30 @@ namespace xm {
         virtual void save(std::ostream &output_stream, const std::string &device_id, const std::string &name) const;
 
         virtual void read(std::istream &input_stream, const std::string &device_id, const std::string &name);
+
+    protected:
+        /**
+         * Applies region, flip and rotation of every configured capture (captures of devices without frame are skipped)
+         *
+         * @param frames {device_id: frame}
+         * @return {name: frame}
+         */
+        std::map<std::string, xm::ocl::Image2D> transform(const std::map<std::string, xm::ocl::Image2D> &frames);
+
+    private:
+        /**
+         * Starts capture thread of every opened camera which has none yet
+         */
+        void start_grabbers();
+
+        /**
+         * Stops and joins capture threads, logs their stats
+         */
+        void stop_grabbers();
+
+        void grab(Grabber &grabber, const std::string &device_id);
+
+        std::map<std::string, xm::ocl::Image2D> dequeue_latest();
     };
 
 } // xm
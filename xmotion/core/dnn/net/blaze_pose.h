@@ -32,7 +32,12 @@ namespace eox::dnn {
 
             HEAVY_F16 = 6,
             FULL_F16 = 7,
-            LITE_F16 = 8
+            LITE_F16 = 8,
+
+            // full-integer, quantized with our own footage (see tools/quant_calib.cpp)
+            HEAVY_I8 = 9,
+            FULL_I8 = 10,
+            LITE_I8 = 11
         };
 
         using Metadata = struct {
@@ -47,7 +52,7 @@ namespace eox::dnn {
             int flag;
         };
 
-        const Metadata mappings[9] = {
+        const Metadata mappings[12] = {
                 {256, 256, 256, 256, 0, 4, 3, 2, 1},
                 {256, 256, 256, 256, 0, 4, 3, 2, 1},
                 {256, 256, 256, 256, 0, 4, 3, 2, 1},
@@ -59,9 +64,13 @@ namespace eox::dnn {
                 {256, 256, 128, 128, 0, 1, 2, 3, 4},
                 {256, 256, 256, 256, 2, 3, 4, 0, 1},
                 {256, 256, 128, 128, 0, 1, 4, 2, 3},
+
+                {256, 256, 128, 128, 0, 1, 2, 3, 4},
+                {256, 256, 128, 128, 0, 1, 2, 3, 4},
+                {256, 256, 128, 128, 0, 1, 4, 2, 3},
         };
 
-        const std::string models[9] = {
+        const std::string models[12] = {
                 "landmark_heavy_o_f32.tflite",
                 "landmark_full_o_f32.tflite",
                 "landmark_lite_o_f32.tflite",
@@ -73,6 +82,10 @@ namespace eox::dnn {
                 "landmark_heavy_q_f16.tflite",
                 "landmark_full_q_f16.tflite",
                 "landmark_lite_q_f16.tflite",
+
+                "landmark_heavy_q_i8.tflite",
+                "landmark_full_q_i8.tflite",
+                "landmark_lite_q_i8.tflite",
         };
     }
 
@@ -83,14 +96,48 @@ namespace eox::dnn {
     private:
         eox::dnn::pose::Model model_type = pose::HEAVY_ORIGIN;
         bool with_box = false;
+
+        /**
+         * Segmentation buffers, reused once consumer drops them
+         */
+        std::shared_ptr<eox::dnn::SegmentationPool> segmentation_pool =
+                std::make_shared<eox::dnn::SegmentationPool>();
         int view_w = 0;
         int view_h = 0;
 
+        /**
+         * False once model turned out not to support batch size > 1
+         */
+        bool batching = true;
+
+        /**
+         * Batch of the interpreter used by inference of multiple frames (usually max number of people),
+         * kept fixed so the number of tracked people can change without tensors reallocation
+         */
+        int batch_size = 1;
+
     protected:
         std::string get_model_file() override;
 
         PoseOutput inference() override;
 
+        /**
+         * Decodes output of already invoked interpreter
+         * @param index index within the batch
+         */
+        PoseOutput decode(int index);
+
+        /**
+         * Initializes interpreter with batch of single frame
+         */
+        void init_single();
+
+        /**
+         * Writes letterboxed blob of the frame into given slot of the input tensor (host copy)
+         * @param index index within the batch
+         */
+        void input_slot(int index, const cv::UMat &frame);
+
     public:
         bool SEGMENTATION = true;
 
@@ -104,17 +151,60 @@ namespace eox::dnn {
          */
         PoseOutput inference(const cv::UMat &frame);
 
+        /**
+         * Single interpreter invocation for all the frames (batch of batch_size, unused slots are padding),
+         * falls back to invocation per frame when model does not support batching
+         * @param frames BGR images (ie. cv::UMat of CV_8UC3)
+         */
+        std::vector<PoseOutput> inference(const std::vector<cv::UMat> &frames);
+
         /**
          * @param frame pointer to 256x256 row-oriented 1D array representation of 256x256x3 RGB image
          */
         PoseOutput inference(const float *frame);
 
+        /**
+         * @param queue command queue on which blob was produced
+         * @param blob letterboxed RGB float tensor (get_in_w x get_in_h x 3) in opencl buffer
+         * @param width width of the source region (before letterbox)
+         * @param height height of the source region (before letterbox)
+         */
+        PoseOutput inference(cl_command_queue queue, cl_mem blob, int width, int height);
+
+        /**
+         * @param blob letterboxed RGB float tensor (get_in_w x get_in_h x 3) in host memory
+         * @param width width of the source region (before letterbox)
+         * @param height height of the source region (before letterbox)
+         */
+        PoseOutput inference(const float *blob, int width, int height);
+
         void set_segmentation(bool segmentation);
 
+        /**
+         * @param n batch size of inference of multiple frames, at least the max number of frames
+         */
+        void set_batch_size(int n);
+
+        /**
+         * Switches model, interpreter of previous one is kept warm,
+         * so switching back and forth does not stall
+         */
         void set_model_type(pose::Model type);
 
+        /**
+         * Prepares interpreter of given model in advance (slow), without switching to it
+         */
+        void warm(pose::Model type);
+
+        /**
+         * Invokes every prepared interpreter once (warm-up), see DnnRunner::prime()
+         */
+        void prime();
+
         [[nodiscard]] pose::Model get_model_type() const;
 
+        static std::string model_file(pose::Model type);
+
         [[nodiscard]] bool segmentation() const;
 
         [[nodiscard]] int get_in_w() const;
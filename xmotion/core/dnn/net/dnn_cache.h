@@ -0,0 +1,53 @@
+//
+// Created by henryco on 21/07/24.
+//
+
+#ifndef XMOTION_DNN_CACHE_H
+#define XMOTION_DNN_CACHE_H
+
+#include <string>
+#include "tensorflow/lite/delegates/gpu/delegate_options.h"
+
+namespace eox::dnn::cache {
+
+    /**
+     * Sets directory for serialized GPU delegate programs (created if missing),
+     * empty string disables serialization. Should be called before any interpreter is built.
+     */
+    void set_directory(const std::string &dir);
+
+    /**
+     * @return directory for serialized GPU delegate programs, empty if disabled
+     */
+    std::string directory();
+
+    /**
+     * Enables delegate serialization within options (if cache directory is set).
+     * Model token is derived from model file content, delegate options and OpenCL device,
+     * so any change of those invalidates the cache.
+     *
+     * Strings referenced by options live as long as the program does.
+     *
+     * @return true if interpreter for given model and options has been built before (see mark())
+     */
+    bool configure(TfLiteGpuDelegateOptionsV2 &options, const std::string &file);
+
+    /**
+     * Marks model token of configured options as serialized,
+     * should be called once interpreter is successfully built
+     */
+    void mark(const TfLiteGpuDelegateOptionsV2 &options);
+
+    /**
+     * Logs interpreter build time (model loading + delegate compilation or deserialization)
+     */
+    void report_build(const std::string &file, bool cached, float ms);
+
+    /**
+     * Logs time of the first (warm-up) invocation
+     */
+    void report_prime(const std::string &file, float ms);
+
+} // eox
+
+#endif //XMOTION_DNN_CACHE_H
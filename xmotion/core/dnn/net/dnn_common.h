@@ -7,6 +7,7 @@
 
 #include <vector>
 #include <opencv2/core/mat.hpp>
+#include "segmentation.h"
 
 namespace eox::dnn {
 
@@ -97,9 +98,10 @@ namespace eox::dnn {
         eox::dnn::Coord3d landmarks_3d[39];
 
         /**
-         * 1D 256x256 float32 array
+         * Pooled segmentation logits (sigmoid not applied) in model's
+         * output resolution, empty if segmentation is disabled
          */
-        float segmentation[256 * 256];
+        eox::dnn::Segmentation segmentation;
 
         /**
          * Probability [0,1]
@@ -7,38 +7,193 @@
 
 #include "tensorflow/lite/interpreter.h"
 #include "tensorflow/lite/kernels/register.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
 #include <filesystem>
+#include <map>
 #include <opencv2/core/mat.hpp>
 #include "tensorflow/lite/delegates/gpu/delegate_options.h"
 #include "tensorflow/lite/delegates/gpu/delegate.h"
+#include "dnn_cache.h"
+#include "../../ocl/ocl_cpu.h"
 
 #include <CL/cl.h>
 #include <opencv2/core/ocl.hpp>
 
 namespace eox::dnn {
 
+    typedef struct DnnInstance {
+        std::unique_ptr<tflite::FlatBufferModel> model;
+        std::unique_ptr<tflite::Interpreter> interpreter;
+        TfLiteDelegate *gpu_delegate = nullptr;
+    } DnnInstance;
+
     template <typename T>
     class DnnRunner {
 
+        /**
+         * Number of CPU threads of interpreters running without GPU delegate (full-integer models),
+         * every pipeline has its own worker already
+         */
+        static constexpr int CPU_THREADS = 2;
+
     protected:
         std::unique_ptr<tflite::FlatBufferModel> model;
         std::unique_ptr<tflite::Interpreter> interpreter;
         TfLiteDelegate* gpu_delegate = nullptr;
         bool initialized = false;
 
+        /**
+         * Model file of active interpreter
+         */
+        std::string active_file;
+
+        /**
+         * Ready to use (warm) interpreters of other model files,
+         * switching to any of them does not require model loading nor delegate compilation
+         */
+        std::map<std::string, DnnInstance> idle;
+
+        /**
+         * Float copies of integer (quantized) output tensors, per output index,
+         * valid only within the invocation they were made in
+         */
+        std::map<int, std::pair<uint64_t, std::vector<float>>> dequantized;
+        std::vector<float> staging;
+        uint64_t invocation = 0;
+
         virtual std::string get_model_file() = 0;
 
+        /**
+         * @return true if input tensor is integer one (full-integer quantized model)
+         */
+        [[nodiscard]] bool quantized(int index) const {
+            const auto type = interpreter->input_tensor(index)->type;
+            return type == kTfLiteInt8 || type == kTfLiteUInt8;
+        }
+
         void input(int index, const float *frame_ptr, size_t size) {
+            if (quantized(index)) {
+                input(index, 0, frame_ptr, size / sizeof(float));
+                return;
+            }
             auto input = interpreter->input_tensor(index)->data.f;
             std::memcpy(input, frame_ptr, size); // 256*256*3*4 = 786432
         }
 
+        /**
+         * Writes float values into the input tensor, quantized when tensor is integer one
+         * @param offset offset within the tensor (elements, not bytes)
+         * @param count number of elements
+         */
+        void input(int index, size_t offset, const float *data, size_t count) {
+            const auto tensor = interpreter->input_tensor(index);
+            if (tensor->type == kTfLiteFloat32) {
+                std::memcpy(tensor->data.f + offset, data, count * sizeof(float));
+                return;
+            }
+
+            const float scale = tensor->params.scale;
+            const int zero = tensor->params.zero_point;
+            if (tensor->type == kTfLiteInt8) {
+                auto out = tensor->data.int8 + offset;
+                for (size_t i = 0; i < count; i++)
+                    out[i] = (int8_t) std::clamp((int) std::lround(data[i] / scale) + zero, -128, 127);
+                return;
+            }
+            if (tensor->type == kTfLiteUInt8) {
+                auto out = tensor->data.uint8 + offset;
+                for (size_t i = 0; i < count; i++)
+                    out[i] = (uint8_t) std::clamp((int) std::lround(data[i] / scale) + zero, 0, 255);
+                return;
+            }
+
+            throw std::runtime_error("Unsupported input tensor type: " + std::to_string(tensor->type));
+        }
+
+        /**
+         * Blocking read of preprocessed tensor from opencl buffer
+         * @param queue queue on which buffer was produced (in-order)
+         */
+        void input(int index, cl_command_queue queue, cl_mem buffer, size_t size) {
+            const bool quantize = quantized(index);
+            if (quantize)
+                staging.resize(size / sizeof(float));
+
+            auto input = quantize ? staging.data() : interpreter->input_tensor(index)->data.f;
+            if (clEnqueueReadBuffer(queue, buffer, CL_TRUE, 0, size, input, 0, nullptr, nullptr) != CL_SUCCESS)
+                throw std::runtime_error("Failed to read input tensor from cl buffer");
+
+            if (quantize)
+                this->input(index, 0, staging.data(), staging.size());
+        }
+
+        /**
+         * @return output tensor as floats, integer tensors are dequantized (once per invocation)
+         */
+        const float *output(int index) {
+            const auto tensor = interpreter->output_tensor(index);
+            if (tensor->type == kTfLiteFloat32)
+                return tensor->data.f;
+
+            auto &[stamp, values] = dequantized[index];
+            if (stamp == invocation && !values.empty())
+                return values.data();
+
+            const size_t count = tensor->bytes / (tensor->type == kTfLiteInt16 ? 2 : 1);
+            const float scale = tensor->params.scale;
+            const int zero = tensor->params.zero_point;
+            values.resize(count);
+            if (tensor->type == kTfLiteInt8) {
+                for (size_t i = 0; i < count; i++)
+                    values[i] = scale * (float) (tensor->data.int8[i] - zero);
+            } else if (tensor->type == kTfLiteUInt8) {
+                for (size_t i = 0; i < count; i++)
+                    values[i] = scale * (float) (tensor->data.uint8[i] - zero);
+            } else if (tensor->type == kTfLiteInt16) {
+                for (size_t i = 0; i < count; i++)
+                    values[i] = scale * (float) (tensor->data.i16[i] - zero);
+            } else {
+                throw std::runtime_error("Unsupported output tensor type: " + std::to_string(tensor->type));
+            }
+
+            stamp = invocation;
+            return values.data();
+        }
+
         void input_ocl(int index, cl_mem ptr, size_t size) {
             interpreter->input_tensor(index)->data.data = reinterpret_cast<float*>(ptr);
             interpreter->input_tensor(index)->bytes = size;
         }
 
+        /**
+         * Resizes batch (first) dimension of the input tensor,
+         * delegate is re-applied by the interpreter on tensors allocation
+         * @return false if model does not support given batch size (input stays as it was)
+         */
+        bool batch(int index, int n) {
+            const auto tensor = interpreter->input_tensor(index);
+            if (tensor->dims->size == 0 || tensor->dims->data[0] == n)
+                return true;
+
+            std::vector<int> dims(tensor->dims->data, tensor->dims->data + tensor->dims->size);
+            const auto original = dims;
+            dims[0] = n;
+
+            const auto input = interpreter->inputs()[index];
+            if (interpreter->ResizeInputTensor(input, dims) == kTfLiteOk
+                && interpreter->AllocateTensors() == kTfLiteOk)
+                return true;
+
+            if (interpreter->ResizeInputTensor(input, original) != kTfLiteOk
+                || interpreter->AllocateTensors() != kTfLiteOk)
+                throw std::runtime_error("Failed to restore input tensor shape");
+            return false;
+        }
+
         void invoke() {
+            invocation++;
             if (interpreter->Invoke() != kTfLiteOk)
                 throw std::runtime_error("Failed to invoke interpreter");
         }
@@ -61,6 +216,8 @@ namespace eox::dnn {
         DnnRunner(DnnRunner<T> &&ref) noexcept {
             interpreter = std::move(ref.interpreter);
             model = std::move(ref.model);
+            idle = std::move(ref.idle);
+            active_file = std::move(ref.active_file);
 
             initialized = ref.initialized;
             gpu_delegate = ref.gpu_delegate;
@@ -70,53 +227,149 @@ namespace eox::dnn {
         }
 
         virtual ~DnnRunner() {
+            for (auto &[file, instance]: idle)
+                release(instance);
+            interpreter.reset();
             if (gpu_delegate) {
                 TfLiteGpuDelegateV2Delete(gpu_delegate);
             }
         }
 
         void reset() {
+            for (auto &[file, instance]: idle)
+                release(instance);
+            idle.clear();
+            interpreter.reset();
             if (gpu_delegate) {
                 TfLiteGpuDelegateV2Delete(gpu_delegate);
+                gpu_delegate = nullptr;
             }
+            active_file.clear();
             initialized = false;
         }
 
+        /**
+         * Loads model file (if not loaded yet) and prepares its interpreter in advance,
+         * without making it active. Slow (model loading, delegate compilation),
+         * should be called before processing starts.
+         */
+        void warm(const std::string &file) {
+            if ((initialized && file == active_file) || idle.contains(file))
+                return;
+            idle.emplace(file, build(file));
+        }
+
+        /**
+         * Initializes interpreter for current model file, if model file has changed
+         * since the last call, previous interpreter is kept idle (warm)
+         */
         void init() {
-            if (initialized)
+            const auto file = get_model_file();
+            if (initialized && file == active_file)
                 return;
 
             initialize();
 
-            if (!std::filesystem::exists(get_model_file())) {
-                throw std::runtime_error("File: " + get_model_file() + " does not exists!");
+            if (initialized) {
+                idle.emplace(active_file, DnnInstance{
+                        .model = std::move(model),
+                        .interpreter = std::move(interpreter),
+                        .gpu_delegate = gpu_delegate
+                });
+                gpu_delegate = nullptr;
+                initialized = false;
+            }
+
+            auto instance = idle.contains(file) ? std::move(idle.at(file)) : build(file);
+            idle.erase(file);
+
+            model = std::move(instance.model);
+            interpreter = std::move(instance.interpreter);
+            gpu_delegate = instance.gpu_delegate;
+            active_file = file;
+            initialized = true;
+            invocation++;
+        }
+
+        /**
+         * Initializes interpreter (if not initialized yet) and invokes every prepared
+         * interpreter once, so the first real frame does not pay for lazy allocations.
+         * Should be called on the thread which is going to run the inference.
+         */
+        void prime() {
+            init();
+            prime(active_file, *interpreter);
+            for (auto &[file, instance]: idle)
+                prime(file, *instance.interpreter);
+        }
+
+    private:
+        static void prime(const std::string &file, tflite::Interpreter &instance) {
+            const auto t0 = std::chrono::steady_clock::now();
+            if (instance.Invoke() != kTfLiteOk)
+                throw std::runtime_error("Failed to invoke interpreter: " + file);
+            eox::dnn::cache::report_prime(file, std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - t0).count());
+        }
+
+        static DnnInstance build(const std::string &file) {
+            if (!std::filesystem::exists(file)) {
+                throw std::runtime_error("File: " + file + " does not exists!");
             }
 
+            const auto t0 = std::chrono::steady_clock::now();
 
-            model = std::move(tflite::FlatBufferModel::BuildFromFile(std::filesystem::path(get_model_file()).string().c_str()));
-            if (!model) {
+            DnnInstance instance;
+            instance.model = std::move(tflite::FlatBufferModel::BuildFromFile(std::filesystem::path(file).string().c_str()));
+            if (!instance.model) {
                 throw std::runtime_error("Failed to load tflite model");
             }
 
             tflite::ops::builtin::BuiltinOpResolver resolver;
-            tflite::InterpreterBuilder(*model, resolver)(&interpreter);
-            if (!interpreter) {
+            tflite::InterpreterBuilder(*instance.model, resolver)(&instance.interpreter);
+            if (!instance.interpreter) {
                 throw std::runtime_error("Failed to create tflite interpreter");
             }
 
+            // full-integer models: GPU delegate would dequantize them anyway, CPU (XNNPACK) is way faster
+            // cpu compute backend: there is no usable OpenCL device for the GPU delegate either
+            const auto input_type = instance.interpreter->input_tensor(0)->type;
+            if (input_type == kTfLiteInt8 || input_type == kTfLiteUInt8 || xm::ocl::cpu::enabled()) {
+                instance.interpreter->SetNumThreads(CPU_THREADS);
+                if (instance.interpreter->AllocateTensors() != kTfLiteOk) {
+                    release(instance);
+                    throw std::runtime_error("Failed to allocate tensors for tflite interpreter");
+                }
+
+                eox::dnn::cache::report_build(file, false, std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - t0).count());
+                return instance;
+            }
+
             TfLiteGpuDelegateOptionsV2 options = TfLiteGpuDelegateOptionsV2Default();
             options.inference_preference = TFLITE_GPU_INFERENCE_PREFERENCE_SUSTAINED_SPEED;
-            gpu_delegate = TfLiteGpuDelegateV2Create(&options);
+            const bool cached = eox::dnn::cache::configure(options, file);
+            instance.gpu_delegate = TfLiteGpuDelegateV2Create(&options);
 
-            if (interpreter->ModifyGraphWithDelegate(gpu_delegate) != kTfLiteOk) {
+            if (instance.interpreter->ModifyGraphWithDelegate(instance.gpu_delegate) != kTfLiteOk) {
+                release(instance);
                 throw std::runtime_error("Failed to modify graph with GPU delegate");
             }
 
-            if (interpreter->AllocateTensors() != kTfLiteOk) {
+            if (instance.interpreter->AllocateTensors() != kTfLiteOk) {
+                release(instance);
                 throw std::runtime_error("Failed to allocate tensors for tflite interpreter");
             }
 
-            initialized = true;
+            eox::dnn::cache::mark(options);
+            eox::dnn::cache::report_build(file, cached, std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - t0).count());
+            return instance;
+        }
+
+        static void release(DnnInstance &instance) {
+            // interpreter first, it still references the delegate
+            instance.interpreter.reset();
+            if (instance.gpu_delegate)
+                TfLiteGpuDelegateV2Delete(instance.gpu_delegate);
+            instance.gpu_delegate = nullptr;
         }
     };
 
@@ -23,7 +23,10 @@ namespace eox::dnn {
         enum Model {
             ORIGIN = 0,
             F_32 = 1,
-            F_16 = 2
+            F_16 = 2,
+
+            // full-integer, quantized with our own footage (see tools/quant_calib.cpp)
+            I_8 = 3
         };
 
         using Metadata = struct {
@@ -35,16 +38,18 @@ namespace eox::dnn {
             int score_loc;
         };
 
-        const Metadata mappings[3] = {
+        const Metadata mappings[4] = {
                 {224, 224, 2254, 2254, 0, 1},
                 {224, 224, 2254, 2254, 0, 1},
-                {128, 128, 896,  896,  1, 0}
+                {128, 128, 896,  896,  1, 0},
+                {224, 224, 2254, 2254, 0, 1}
         };
 
-        const std::string models[3] = {
+        const std::string models[4] = {
                 "detection_o_f32.tflite",
                 "detection_q_f32.tflite",
                 "detection_q_f16.tflite",
+                "detection_q_i8.tflite",
         };
     }
 
@@ -93,6 +98,16 @@ namespace eox::dnn {
         float roi_padding_x = 0.f;
         float roi_padding_y = 0.f;
 
+        /**
+         * Max number of detected poses, one means best only (no NMS)
+         */
+        int max_detections = 1;
+
+        /**
+         * Max IoU of detected poses (NMS)
+         */
+        float nms_iou = 0.3f;
+
         bool with_box = false;
         int view_w = 0;
         int view_h = 0;
@@ -105,12 +120,39 @@ namespace eox::dnn {
     public:
         std::string get_model_file() override;
 
+        static std::string model_file(box::Model type);
+
+        /**
+         * Prepares interpreter of given model in advance (slow), without switching to it
+         */
+        void warm(box::Model type);
+
+        /**
+         * Invokes every prepared interpreter once (warm-up), see DnnRunner::prime()
+         */
+        void prime();
+
         std::vector<DetectedPose> inference(const float *frame);
 
         std::vector<DetectedPose> inference(const cv::Mat &frame);
 
         std::vector<DetectedPose> inference(const cv::UMat &frame);
 
+        /**
+         * @param queue command queue on which blob was produced
+         * @param blob letterboxed RGB float tensor (get_in_w x get_in_h x 3) in opencl buffer
+         * @param width width of the source region (before letterbox)
+         * @param height height of the source region (before letterbox)
+         */
+        std::vector<DetectedPose> inference(cl_command_queue queue, cl_mem blob, int width, int height);
+
+        /**
+         * @param blob letterboxed RGB float tensor (get_in_w x get_in_h x 3) in host memory
+         * @param width width of the source region (before letterbox)
+         * @param height height of the source region (before letterbox)
+         */
+        std::vector<DetectedPose> inference(const float *blob, int width, int height);
+
         void setRoiScale(float scale);
 
         void setThreshold(float threshold);
@@ -123,6 +165,14 @@ namespace eox::dnn {
 
         void setRoiMargin(float roiMargin);
 
+        void setMaxDetections(int max);
+
+        void setNmsThreshold(float iou);
+
+        [[nodiscard]] int getMaxDetections() const;
+
+        [[nodiscard]] float getNmsThreshold() const;
+
         [[nodiscard]] float getRoiScale() const;
 
         [[nodiscard]] float getThreshold() const;
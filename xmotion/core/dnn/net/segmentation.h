@@ -0,0 +1,90 @@
+//
+// Created by henryco on 19/07/24.
+//
+
+#ifndef XMOTION_SEGMENTATION_H
+#define XMOTION_SEGMENTATION_H
+
+#include <memory>
+#include <vector>
+#include <mutex>
+
+namespace eox::dnn {
+
+    typedef struct SegmentationBuffer {
+        /**
+         * Row-oriented 1D array of (width x height) float32 values
+         */
+        std::vector<float> data;
+        int width;
+        int height;
+    } SegmentationBuffer;
+
+    /**
+     * Move-only handle to (pooled) segmentation buffer,
+     * empty when segmentation was not requested.
+     * Extra references are possible only explicitly via share()
+     */
+    class Segmentation {
+    private:
+        std::shared_ptr<SegmentationBuffer> buffer;
+
+    public:
+        Segmentation() = default;
+
+        explicit Segmentation(std::shared_ptr<SegmentationBuffer> buffer);
+
+        Segmentation(Segmentation &&ref) noexcept = default;
+
+        Segmentation &operator=(Segmentation &&ref) noexcept = default;
+
+        Segmentation(const Segmentation &src) = delete;
+
+        Segmentation &operator=(const Segmentation &src) = delete;
+
+        /**
+         * @return new handle referencing the very same buffer
+         */
+        [[nodiscard]] Segmentation share() const;
+
+        [[nodiscard]] bool empty() const;
+
+        [[nodiscard]] int width() const;
+
+        [[nodiscard]] int height() const;
+
+        [[nodiscard]] const float *data() const;
+
+        [[nodiscard]] float *data();
+
+        explicit operator bool() const;
+    };
+
+    /**
+     * Thread safe pool of segmentation buffers,
+     * buffers return to the pool once the last handle is gone
+     */
+    class SegmentationPool : public std::enable_shared_from_this<SegmentationPool> {
+    private:
+        std::vector<std::unique_ptr<SegmentationBuffer>> available;
+        std::mutex mutex;
+        size_t capacity;
+
+    public:
+        /**
+         * @param capacity max number of idle buffers kept in the pool
+         */
+        explicit SegmentationPool(size_t capacity = 8);
+
+        /**
+         * Pool MUST be owned by std::shared_ptr
+         */
+        [[nodiscard]] Segmentation acquire(int width, int height);
+
+    protected:
+        void release(SegmentationBuffer *buffer);
+    };
+
+} // eox
+
+#endif //XMOTION_SEGMENTATION_H
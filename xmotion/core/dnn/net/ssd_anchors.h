@@ -34,6 +34,21 @@ namespace eox::dnn::ssd {
                                                         const std::vector<std::array<float, 4>> &anchors,
                                                         const float scale = 224.f,
                                                         bool best_only = false);
+
+    /**
+     * @return intersection over union of two boxes [0.0 ... 1.0]
+     */
+    float region_iou(const eox::dnn::Box &a, const eox::dnn::Box &b);
+
+    /**
+     * Non-maximum suppression, regions are sorted by score (descending)
+     * @param regions decoded regions
+     * @param iou max intersection over union of kept regions [0.0 ... 1.0]
+     * @param max max number of regions to keep
+     */
+    std::vector<eox::dnn::DetectedRegion> suppress(std::vector<eox::dnn::DetectedRegion> regions,
+                                                   float iou,
+                                                   int max);
 }
 
 #endif //STEREOX_SSD_ANCHORS_H
@@ -10,9 +10,11 @@
 #include <spdlog/sinks/stdout_color_sinks.h>
 
 #include "../utils/velocity_filter.h"
+#include "../filter/chroma_key.h"
 #include "net/pose_detector.h"
 #include "net/blaze_pose.h"
 #include "net/pose_roi.h"
+#include "pose_tracker.h"
 
 namespace eox::dnn {
 
@@ -31,9 +33,9 @@ namespace eox::dnn {
         eox::dnn::Coord3d ws_landmarks[39];
 
         /**
-         * segmentation array
+         * segmentation logits (model's output resolution), empty if disabled
          */
-        float segmentation[256 * 256];
+        eox::dnn::Segmentation segmentation;
 
         /**
          * presence flag
@@ -44,6 +46,12 @@ namespace eox::dnn {
          * presence score
          */
         float score;
+
+        /**
+         * every person found (multi-person mode only), the oldest track
+         * is the one above (landmarks, segmentation, etc)
+         */
+        std::vector<eox::dnn::PoseTrackOutput> people;
     };
 
     class PosePipeline {
@@ -57,11 +65,40 @@ namespace eox::dnn {
         eox::dnn::PoseDetector detector;
         eox::dnn::BlazePose pose;
 
+        /**
+         * Multi-person tracks, used only when max number of people > 1
+         */
+        eox::dnn::PoseTracker tracker;
+
+        /**
+         * Fused chroma key (optional), applied while sampling network input
+         */
+        std::unique_ptr<xm::filters::ChromaKey> chroma_key;
+        xm::ocl::iop::ClImagePromise key_source;
+        xm::ocl::iop::ClImagePromise key_mask;
+        cv::UMat key_frame;
+
+        /**
+         * Undistortion maps (optional), network input is sampled
+         * from distorted frame through them, instead of remapping whole frame
+         */
+        cv::UMat undistort_map_x;
+        cv::UMat undistort_map_y;
+        cv::UMat warp_view;
+
         bool preserved_roi = false;
         bool discarded_roi = false;
         bool rollback_roi = false;
         bool prediction = false;
         bool initialized = false;
+        bool seeded_roi = false;
+        bool seed_ready = false;
+
+        /**
+         * One-shot ROI suggested from outside (i.e. other views),
+         * used instead of detector when there is no prediction
+         */
+        eox::dnn::RoI seed;
 
         /**
          * Region of Interest
@@ -143,6 +180,13 @@ namespace eox::dnn {
          */
         float threshold_roi = 0.f;
 
+        /**
+         * Segmentation probability threshold, pixels below are masked out
+         *
+         * [0.0 ... 1.0]
+         */
+        float threshold_segmentation = 0.5f;
+
         /**
          * Low-pass filter velocity scale: lower -> smoother, but adds lag.
          */
@@ -173,18 +217,107 @@ namespace eox::dnn {
 
         PosePipelineOutput pass(const cv::UMat &frame, cv::UMat &segmented, cv::UMat &debug);
 
+        /**
+         * Suggests ROI for the next pass (consumed once),
+         * detector is skipped if there is no own ROI prediction.
+         * Falls back to detector when seeded ROI yields no pose.
+         *
+         * @param mid ROI middle point (hips) in frame's coordinate system
+         * @param end ROI end point (radius) in frame's coordinate system
+         */
+        void seedRoi(const float mid[2], const float end[2]);
+
+        /**
+         * @return true if next pass is going to use predicted ROI (no detector run)
+         */
+        [[nodiscard]] bool tracking() const;
+
+        /**
+         * Enables undistortion folded into the ROI resampling, frames passed to the pipeline
+         * are expected to be distorted (original) ones, landmarks are still undistorted.
+         * Whole undistorted frame is produced only for debug output and segmentation.
+         * Not compatible with fused chroma key (ignored then).
+         *
+         * @param map_x undistortion map (CV_32FC1), empty to disable
+         * @param map_y undistortion map (CV_32FC1), empty to disable
+         */
+        void setUndistortMaps(const cv::Mat &map_x, const cv::Mat &map_y);
+
+        [[nodiscard]] bool undistortWarp() const;
+
+        /**
+         * Max number of people tracked within the view, one (1) means single-person mode.
+         * In multi-person mode every track has its own ROI, all of them go through
+         * single (batched) landmarks model invocation, detector runs only
+         * to re-acquire lost tracks or to look for new people.
+         */
+        void setMaxPeople(int n);
+
+        /**
+         * Min IoU of detected and tracked ROI to associate them (multi-person mode)
+         */
+        void setTrackIouThreshold(float threshold);
+
+        /**
+         * Number of frames lost track is kept for re-acquisition (multi-person mode)
+         */
+        void setTrackMaxMisses(int n);
+
+        /**
+         * Number of frames between detector runs looking for new people (multi-person mode)
+         */
+        void setTrackReacquireInterval(int n);
+
+        [[nodiscard]] int getMaxPeople() const;
+
+        [[nodiscard]] float getTrackIouThreshold() const;
+
+        [[nodiscard]] int getTrackMaxMisses() const;
+
+        [[nodiscard]] int getTrackReacquireInterval() const;
+
+        /**
+         * Cheap once model is warm (see warmBodyModel), otherwise model
+         * is loaded within the next pass
+         */
         void setBodyModel(eox::dnn::pose::Model model);
 
         void setDetectorModel(eox::dnn::box::Model model);
 
+        /**
+         * Prepares interpreter of body model in advance (slow),
+         * so switching to it later does not stall the pipeline
+         */
+        void warmBodyModel(eox::dnn::pose::Model model);
+
+        /**
+         * Prepares interpreter of detector model in advance (slow),
+         * so switching to it later does not stall the pipeline
+         */
+        void warmDetectorModel(eox::dnn::box::Model model);
+
+        /**
+         * Builds interpreters of active models (if not built yet) and invokes
+         * all of them once, should be called on the thread which runs the pipeline
+         */
+        void prime();
+
         void enableSegmentation(bool enable);
 
+        /**
+         * Enables fused chroma key, mask is computed once per frame
+         * and applied only during letterbox resampling of the network input
+         */
+        void setChromaKey(const xm::filters::chroma::Conf &conf);
+
         void setMarksThreshold(float threshold);
 
         void setPoseThreshold(float threshold);
 
         void setDetectorThreshold(float threshold);
 
+        void setSegmentationThreshold(float threshold);
+
         void setFilterWindowSize(int size);
 
         void setFilterVelocityScale(float scale);
@@ -235,8 +368,12 @@ namespace eox::dnn {
 
         [[nodiscard]] float getMarksThreshold() const;
 
+        [[nodiscard]] float getSegmentationThreshold() const;
+
         [[nodiscard]] bool segmentation() const;
 
+        [[nodiscard]] bool chromaKey() const;
+
         [[nodiscard]] eox::dnn::pose::Model bodyModel() const;
 
         [[nodiscard]] eox::dnn::box::Model getDetectorModel() const;
@@ -249,7 +386,36 @@ namespace eox::dnn {
                 PoseTimePoint t0,
                 int rec_n);
 
-        void performSegmentation(float segmentation_array[128 * 128], const cv::UMat &frame, cv::UMat &out) const;
+        [[nodiscard]] PosePipelineOutput inferenceMulti(
+                const cv::UMat &frame,
+                const cv::UMat &view,
+                cv::UMat &segmented,
+                cv::UMat *debug,
+                PoseTimePoint t0);
+
+        /**
+         * Detected body ROI in frame's coordinate system (not clamped)
+         */
+        [[nodiscard]] eox::dnn::RoI detectedRoi(const DetectedPose &detected, int width, int height) const;
+
+        /**
+         * Network input region of the frame (undistorted if needed)
+         */
+        [[nodiscard]] cv::UMat cropRoi(const cv::UMat &frame, const eox::dnn::RoI &region) const;
+
+        void prepareChromaKey(const cv::UMat &frame, bool materialize);
+
+        [[nodiscard]] std::vector<DetectedPose> keyedDetection(const cv::UMat &frame);
+
+        [[nodiscard]] PoseOutput keyedPose(const eox::dnn::RoI &region);
+
+        void undistortFrame(const cv::UMat &frame, cv::UMat &out) const;
+
+        [[nodiscard]] cv::UMat warpedDetectorView(const cv::UMat &frame) const;
+
+        [[nodiscard]] cv::UMat warpedRoi(const cv::UMat &frame, const eox::dnn::RoI &region) const;
+
+        void performSegmentation(const eox::dnn::Segmentation &segmentation, const cv::UMat &frame, cv::UMat &out) const;
 
         void drawJoints(const eox::dnn::Landmark landmarks[39], cv::UMat &output) const;
 
@@ -257,6 +423,8 @@ namespace eox::dnn {
 
         void drawRoi(cv::UMat &output) const;
 
+        void drawRoi(cv::UMat &output, const eox::dnn::RoI &region) const;
+
         void printMetadata(cv::UMat &output, PoseTimePoint t0, int rec_n) const;
 
         [[nodiscard]] std::chrono::nanoseconds timestamp() const;
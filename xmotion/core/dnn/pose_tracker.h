@@ -0,0 +1,208 @@
+//
+// Created by henryco on 21/07/24.
+//
+
+#ifndef XMOTION_POSE_TRACKER_H
+#define XMOTION_POSE_TRACKER_H
+
+#include <chrono>
+#include <vector>
+
+#include "../utils/velocity_filter.h"
+#include "net/dnn_common.h"
+#include "net/pose_roi.h"
+
+namespace eox::dnn {
+
+    using PoseTrackOutput = struct {
+
+        /**
+         * Track identifier, stays the same as long as person is tracked
+         */
+        int id;
+
+        /**
+         * pose landmarks in frame's coordinate system
+         */
+        eox::dnn::Landmark landmarks[39];
+
+        /**
+         * pose landmarks in world space
+         */
+        eox::dnn::Coord3d ws_landmarks[39];
+
+        /**
+         * ROI used for this frame
+         */
+        eox::dnn::RoI roi;
+
+        /**
+         * presence score
+         */
+        float score;
+    };
+
+    /**
+     * Keeps up to N people tracked within single view, every track has its own
+     * ROI, low-pass filters and presence state. Detector is needed only
+     * to re-acquire lost tracks or to look for new people (periodically).
+     */
+    class PoseTracker {
+
+    public:
+        typedef struct Track {
+            std::vector<eox::sig::VelocityFilter> filters;
+
+            /**
+             * Filtered landmarks from the last successful pass
+             */
+            eox::dnn::Landmark landmarks[39];
+
+            /**
+             * ROI for the next pass
+             */
+            eox::dnn::RoI roi;
+
+            int id;
+
+            /**
+             * Number of consecutive passes without pose
+             */
+            int misses;
+
+            /**
+             * ROI is ready to use for the next pass (predicted or detected)
+             */
+            bool ready;
+
+            /**
+             * ROI predicted from own landmarks (not the detector)
+             */
+            bool prediction;
+
+            /**
+             * Pose found within the last pass
+             */
+            bool present;
+
+            /**
+             * Network result applied within the current pass
+             */
+            bool updated;
+        } Track;
+
+    private:
+        std::vector<Track> tracks;
+        int next_id = 0;
+
+        /**
+         * Passes since the last detector run
+         */
+        int passes = 0;
+
+        /**
+         * Max number of tracks
+         */
+        int capacity = 1;
+
+        /**
+         * Min IoU of detector and track ROI to associate them
+         */
+        float iou_threshold = 0.3f;
+
+        /**
+         * Max number of consecutive passes without pose before track is dropped
+         */
+        int max_misses = 5;
+
+        /**
+         * Number of passes between detector runs looking for new people,
+         * when there is still free capacity. Zero (0) means every pass
+         */
+        int reacquire = 15;
+
+        int f_win_size = 30;
+        float f_v_scale = 0.5f;
+        int f_fps = 30;
+
+    public:
+        /**
+         * @return true if the next pass has to run the detector
+         */
+        [[nodiscard]] bool needsDetection() const;
+
+        /**
+         * Matches detector ROIs (sorted by score, descending) with tracks, by IoU
+         * or by detector's mid point lying within track's landmarks. Matched tracks
+         * without own prediction take detector's ROI, unmatched detections
+         * become new tracks (up to the capacity).
+         *
+         * @param detected ROIs in frame's coordinate system
+         */
+        void associate(const std::vector<eox::dnn::RoI> &detected);
+
+        /**
+         * @return indexes of tracks with ROI ready for the next pass
+         */
+        [[nodiscard]] std::vector<int> active() const;
+
+        /**
+         * Applies network result to the track: denormalizes and filters
+         * landmarks, predicts ROI for the next pass
+         *
+         * @param index track index (see active())
+         * @param result network output for track's ROI
+         * @param now timestamp for the low-pass filters
+         * @param predictor configured ROI predictor
+         * @param width frame width
+         * @param height frame height
+         * @param threshold pose presence threshold
+         * @param clamp_window acceptable ratio of clamped to original ROI size
+         * @return true if pose is present
+         */
+        bool update(int index,
+                    const eox::dnn::PoseOutput &result,
+                    std::chrono::nanoseconds now,
+                    const eox::dnn::PoseRoi &predictor,
+                    int width,
+                    int height,
+                    float threshold,
+                    float clamp_window);
+
+        /**
+         * Ends the pass: drops expired and duplicated (converged on the same person) tracks.
+         * Indexes of tracks are not valid anymore.
+         */
+        void commit();
+
+        void reset();
+
+        [[nodiscard]] const std::vector<Track> &getTracks() const;
+
+        void setCapacity(int n);
+
+        void setIouThreshold(float threshold);
+
+        void setMaxMisses(int n);
+
+        void setReacquireInterval(int n);
+
+        void setFilter(int window, float velocity, int fps);
+
+        [[nodiscard]] int getCapacity() const;
+
+        [[nodiscard]] float getIouThreshold() const;
+
+        [[nodiscard]] int getMaxMisses() const;
+
+        [[nodiscard]] int getReacquireInterval() const;
+
+    protected:
+        Track &emplace(const eox::dnn::RoI &roi);
+
+        static bool within(const eox::dnn::RoI &roi, const eox::dnn::Landmark landmarks[39]);
+    };
+
+} // eox
+
+#endif //XMOTION_POSE_TRACKER_H
@@ -97,12 +97,14 @@ namespace xm::filters {
         cl_kernel kernel_prepare = nullptr;
         cl_kernel kernel_subsense = nullptr;
         cl_kernel kernel_downscale = nullptr;
+        cl_kernel kernel_downscale_image = nullptr;
         cl_kernel kernel_upscale = nullptr;
         cl_kernel kernel_dilate = nullptr;
         cl_kernel kernel_erode = nullptr;
         cl_kernel kernel_gate = nullptr;
         cl_kernel kernel_debug = nullptr;
         size_t pref_size = 0;
+        std::string build_options;
         // ===== OCL PART =====
 
         // uchar:  N * w * h * [ B, G, R, LBSP_1, LBSP_2, ... ]
@@ -127,10 +129,14 @@ namespace xm::filters {
 
         bool initialized = false;
         bool ready = false;
+        bool cpu = false;
 
         int debug_mode = -1;
         int model_i = 0;
 
+        // number of stacked frames (cameras), every one has its own model
+        int layers = 1;
+
     public:
         BgSubtract() = default;
 
@@ -142,6 +148,12 @@ namespace xm::filters {
 
         xm::ocl::iop::ClImagePromise filter(const ocl::iop::ClImagePromise &in, const ocl::iop::ClImagePromise &ex_mask, int q_idx);
 
+        /**
+         * Models of stacked frames are allocated together (one layer per frame),
+         * model is learned from scratch when number of layers changes
+         */
+        xm::ocl::iop::ClImagePromise filter_stacked(const ocl::iop::ClImagePromise &in, int layers, int q_idx) override;
+
         void reset() override;
 
         void start() override;
@@ -150,9 +162,26 @@ namespace xm::filters {
 
         void set_debug_mode(int mode);
 
+        /**
+         * Changes processing resolution, model is learned from scratch
+         */
+        void set_resolution(int base);
+
+        [[nodiscard]] int resolution() const;
+
     protected:
         cl_command_queue retrieve_queue(int index);
 
+        xm::ocl::iop::ClImagePromise filter_layers(const ocl::iop::ClImagePromise &in,
+                                                   const ocl::iop::ClImagePromise &ex_mask,
+                                                   int n_layers,
+                                                   int q_idx);
+
+        /**
+         * Releases model and state buffers, they are allocated again during the next pass
+         */
+        void release_model();
+
         void prepare_update_model(const ocl::iop::ClImagePromise &frame_in, int q_idx);
 
         xm::ocl::iop::ClImagePromise downscale(const ocl::iop::ClImagePromise &in, int base, int q_idx);
@@ -170,11 +199,28 @@ namespace xm::filters {
 
         int denorm_lbsp_threshold(float v) const;
 
-        void erode(cl_command_queue queue, size_t *l_size, size_t *g_size);
+        void erode(cl_command_queue queue);
+
+        void dilate(cl_command_queue queue);
+
+        void gate(cl_command_queue queue);
+
+        // ===== CPU PART (see bg_subtract_cpu.cpp) =====
+        xm::ocl::iop::ClImagePromise filter_cpu(const ocl::iop::ClImagePromise &in, const ocl::iop::ClImagePromise &ex_mask);
+
+        void prepare_update_model_cpu(const ocl::Image2D &in);
+
+        ocl::Image2D downscale_cpu(const ocl::Image2D &in, int base);
 
-        void dilate(cl_command_queue queue, size_t *l_size, size_t *g_size);
+        ocl::Image2D subsense_cpu(const ocl::Image2D &downscaled,
+                                  const ocl::Image2D &original,
+                                  const ocl::Image2D &exclusion); // optional
 
-        void gate(cl_command_queue queue, size_t *l_size, size_t *g_size);
+        /**
+         * @param operation 0 - erode, 1 - dilate, 2 - gate
+         */
+        void morph_cpu(int iterations, int operation, bgs::KernelType kernel, uint8_t threshold);
+        // ===== CPU PART =====
     };
 }
 
@@ -27,6 +27,8 @@ namespace xm::filters {
 
         xm::ocl::iop::ClImagePromise filter(const ocl::iop::ClImagePromise &in, int q_idx) override;
 
+        xm::ocl::iop::ClImagePromise filter_stacked(const ocl::iop::ClImagePromise &in, int layers, int q_idx) override;
+
         void reset() override;
 
         void start() override;
@@ -68,6 +68,13 @@ namespace xm::filters {
              * (mask is slower but smoother)
              */
             bool linear = false;
+
+            /**
+             * Should be fused with dnn preprocessing,
+             * (filter itself becomes passthrough, mask is
+             * applied only when sampling network input)
+             */
+            bool fused = false;
         };
     }
 
@@ -82,6 +89,7 @@ namespace xm::filters {
         xm::ds::Color4u bgr_bg_color;
 
         bool linear_interpolation = false;
+        bool fused_mode = false;
         int mask_iterations = 0;
         int mask_size = 0;
         int blur_kernel = 0;
@@ -94,6 +102,38 @@ namespace xm::filters {
 
         xm::ocl::iop::ClImagePromise filter(const ocl::iop::ClImagePromise &in, int q_idx) override;
 
+        xm::ocl::iop::ClImagePromise filter_stacked(const ocl::iop::ClImagePromise &in, int layers, int q_idx) override;
+
+        /**
+         * @param in input image in BGR color space (3 channels uchar)
+         * @return low resolution chroma key mask (1 channel uchar)
+         */
+        xm::ocl::iop::ClImagePromise mask(const ocl::iop::ClImagePromise &in, int q_idx = -1) const;
+
+        /**
+         * Materializes full resolution keyed image
+         * @param in input image in BGR color space (3 channels uchar)
+         * @param mask mask produced by mask()
+         */
+        xm::ocl::iop::ClImagePromise apply(const ocl::iop::ClImagePromise &in,
+                                           const ocl::iop::ClImagePromise &mask,
+                                           int q_idx = -1) const;
+
+        /**
+         * Keyed, letterboxed RGB float tensor of ROI
+         * @param in input image in BGR color space (3 channels uchar)
+         * @param mask mask produced by mask()
+         * @param width tensor width
+         * @param height tensor height
+         */
+        xm::ocl::iop::ClImagePromise blob(const ocl::iop::ClImagePromise &in,
+                                          const ocl::iop::ClImagePromise &mask,
+                                          float roi_x, float roi_y, float roi_w, float roi_h,
+                                          int width, int height,
+                                          int q_idx = -1) const;
+
+        [[nodiscard]] bool fused() const;
+
         void reset() override;
 
         void start() override;
@@ -16,6 +16,13 @@ namespace xm {
 
         xm::ocl::iop::ClImagePromise filter(const xm::ocl::iop::ClImagePromise &in) {return filter(in, -1);}
 
+        /**
+         * Filters frames of several cameras stacked into single image (see xm::ocl::stack),
+         * every kernel is launched once for all of them, state (if any) is kept for every frame separately
+         * @param layers number of stacked frames
+         */
+        virtual xm::ocl::iop::ClImagePromise filter_stacked(const xm::ocl::iop::ClImagePromise &in, int layers, int q_idx) = 0;
+
         virtual void reset() = 0;
 
         virtual void start() = 0;
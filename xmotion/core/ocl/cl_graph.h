@@ -0,0 +1,88 @@
+//
+// Created by henryco on 21/07/24.
+//
+
+#ifndef XMOTION_CL_GRAPH_H
+#define XMOTION_CL_GRAPH_H
+
+#include <CL/cl.h>
+#include <functional>
+#include <vector>
+
+#include "ocl_interop.h"
+
+namespace xm::ocl {
+
+    /**
+     * Small execution graph of image operations (ie: per camera filter chains).
+     *
+     * Every node declares its inputs (ids of already added nodes) and produces single output.
+     * Nodes are dispatched on in-order queue of their lane (one per camera), nodes of the same lane
+     * are ordered by the queue itself, dependencies between lanes are linked with cl_event barriers,
+     * so lanes overlap on the device. Host waits once, for events of the final nodes only.
+     *
+     * Not thread safe, dispatched on the calling thread (uses its xm::ocl::Kernels queues).
+     */
+    class Graph {
+    public:
+        /**
+         * Operation of the node, inputs are bound to the queue of node's lane
+         * (operation should enqueue its work on the queue of the input, ie: filter with queue index -1)
+         */
+        typedef std::function<xm::ocl::iop::ClImagePromise(const std::vector<xm::ocl::iop::ClImagePromise> &inputs)> Op;
+
+    private:
+        typedef struct Node {
+            int lane = -1;
+            std::vector<int> inputs;
+            Op op;
+            xm::ocl::iop::ClImagePromise value;
+            cl_command_queue queue = nullptr;
+            cl_event done = nullptr;
+            bool consumed = false;
+        } Node;
+
+        std::vector<Node> nodes;
+
+    public:
+        Graph() = default;
+
+        Graph(const Graph &) = delete;
+
+        Graph &operator=(const Graph &) = delete;
+
+        ~Graph();
+
+        /**
+         * @param value already available value, ie: captured frame
+         * @return id of the node
+         */
+        int source(const xm::ocl::iop::ClImagePromise &value);
+
+        /**
+         * @param lane index of the lane (queue), ie: camera index
+         * @param inputs ids of the nodes which output is used by this node
+         * @return id of the node
+         * @throws std::invalid_argument if any input is not added yet
+         */
+        int node(int lane, const std::vector<int> &inputs, Op op);
+
+        /**
+         * Dispatches every node and waits for the final ones (BLOCKING OPERATION)
+         * @param outputs ids of the nodes which values are returned
+         * @return resolved values of requested nodes
+         */
+        std::vector<xm::ocl::iop::ClImagePromise> run(const std::vector<int> &outputs);
+
+        /**
+         * Removes every node, graph can be built again
+         */
+        void clear();
+
+    private:
+        cl_command_queue lane_queue(int lane) const;
+    };
+
+}
+
+#endif //XMOTION_CL_GRAPH_H
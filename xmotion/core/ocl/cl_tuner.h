@@ -0,0 +1,76 @@
+//
+// Created by henryco on 21/07/24.
+//
+
+#ifndef XMOTION_CL_TUNER_H
+#define XMOTION_CL_TUNER_H
+
+#include <CL/cl.h>
+#include <string>
+
+/**
+ * Work-group (local) size autotuner for 2D kernels.
+ *
+ * Local size is tuned per device (name and driver), kernel, build options and global problem size:
+ * first launches of a kernel are timed with candidate local sizes (each real launch runs exactly once,
+ * so stateful kernels stay correct), once every candidate is measured the fastest one is used from then on.
+ * Winners are persisted (see set_directory) and reused by subsequent runs.
+ */
+namespace xm::ocl::tuner {
+
+    /**
+     * @param mode "auto" (tune on first use, reuse persisted winners),
+     *             "retune" (ignore persisted winners and tune again) or
+     *             "off" (preferred work-group size multiple squares, no tuning)
+     * @throws std::invalid_argument on unknown mode
+     */
+    void set_mode(const std::string &mode);
+
+    /**
+     * Sets directory in which winners are persisted (created if missing) and loads ones already there,
+     * empty string keeps them in memory only
+     */
+    void set_directory(const std::string &dir);
+
+    /**
+     * Forgets every winner (in memory and persisted), kernels are tuned again on next launch
+     */
+    void reset();
+
+    /**
+     * Enqueues 2D kernel over width x height (global size rounded up to the local one) with tuned local size.
+     * Kernel arguments must be already set.
+     *
+     * @param pref_size fallback local size (pref_size x pref_size), ie: xm::ocl::optimal_local_size
+     * @param options build options of the kernel program, part of the tuning key
+     * @return enqueued kernel event if profile is true, nullptr otherwise
+     */
+    cl_event enqueue_2d(
+            cl_command_queue queue,
+            cl_kernel kernel,
+            int width,
+            int height,
+            size_t pref_size,
+            bool profile = false,
+            const std::string &options = "");
+
+    /**
+     * Enqueues 2D kernel over width x height for every one of depth layers (third dimension, ie: stacked frames),
+     * local size is tuned as for 2D launches (one layer per work-group), depth is part of the tuning key.
+     * Kernel arguments must be already set.
+     *
+     * @throws std::invalid_argument if depth is less than 1
+     * @see enqueue_2d
+     */
+    cl_event enqueue_3d(
+            cl_command_queue queue,
+            cl_kernel kernel,
+            int width,
+            int height,
+            int depth,
+            size_t pref_size,
+            bool profile = false,
+            const std::string &options = "");
+}
+
+#endif //XMOTION_CL_TUNER_H
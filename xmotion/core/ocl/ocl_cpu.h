@@ -0,0 +1,120 @@
+//
+// Created by henryco on 21/07/24.
+//
+
+#ifndef XMOTION_OCL_CPU_H
+#define XMOTION_OCL_CPU_H
+
+#include <opencv2/core/mat.hpp>
+#include <functional>
+#include <string>
+
+#include "../utils/xm_data.h"
+
+/**
+ * CPU backend of xm::ocl image ops, for hosts without usable OpenCL driver.
+ * Images live in host memory (see Image2D::allocate_host), ops mirror OpenCL kernels
+ * (same sampling, rounding and borders), vectorized with OpenCV universal intrinsics
+ * and split into row bands executed on the thread pool.
+ */
+namespace xm::ocl::cpu {
+
+    /**
+     * Selects compute backend, should be called once at startup before any filter is created
+     * @param mode "auto" (OpenCL if device is usable, CPU otherwise), "opencl" or "cpu"
+     * @throws std::invalid_argument on unknown mode
+     * @throws std::runtime_error if "opencl" is requested but not available
+     * @return true if CPU backend is selected
+     */
+    bool select(const std::string &mode);
+
+    /**
+     * @return true if CPU backend is selected
+     */
+    bool enabled();
+
+    /**
+     * Splits [0, rows) into bands executed concurrently, blocks until all of them are done
+     * @param fn band callback (from, to)
+     */
+    void parallel_rows(int rows, const std::function<void(int, int)> &fn);
+
+    /**
+     * Downscale with the sampling of chroma_key.cl and subsense.cl kernels
+     * @param out preallocated destination, its size defines the output size
+     * @param scale_w input / output
+     * @param linear bilinear if true, nearest otherwise
+     */
+    void downscale(const cv::Mat &in, cv::Mat &out, float scale_w, float scale_h, bool linear);
+
+    /**
+     * Gaussian blur with separate horizontal and vertical pass, clamped borders
+     * @param in BGR (3 channels uchar)
+     * @param kernel_size odd: 3, 5, 7 ... 31
+     */
+    void blur(const cv::Mat &in, cv::Mat &out, int kernel_size);
+
+    /**
+     * @param in BGR (3 channels uchar)
+     * @param out mask (1 channel uchar), 255 for pixels within HLS range (hue wraps if low > up)
+     */
+    void range_hls(const cv::Mat &in, cv::Mat &out, const cv::Scalar &hls_low, const cv::Scalar &hls_up);
+
+    /**
+     * Separable (h -> v) dilation, out of bounds pixels are skipped
+     * @param in grayscale (1 channel uchar)
+     */
+    void dilate(const cv::Mat &in, cv::Mat &out, int iterations, int kernel_size);
+
+    /**
+     * Separable (h -> v) erosion, out of bounds pixels are skipped
+     * @param in grayscale (1 channel uchar)
+     */
+    void erode(const cv::Mat &in, cv::Mat &out, int iterations, int kernel_size);
+
+    /**
+     * @param img BGR (3 channels uchar)
+     * @param mask grayscale (1 channel uchar), any size, nearest sampled
+     * @param out img with pixels replaced by color where mask != 0
+     */
+    void mask_apply(const cv::Mat &img, const cv::Mat &mask, cv::Mat &out, const cv::Scalar &color);
+
+    /**
+     * @param logits seg_width x seg_height float32
+     * @param threshold_logit log(t / (1 - t))
+     * @param img uchar, any number of channels
+     */
+    void segmentation_apply(const float *logits, int seg_width, int seg_height, float threshold_logit,
+                            float roi_x, float roi_y, float roi_w, float roi_h,
+                            const cv::Mat &img, cv::Mat &out);
+
+    /**
+     * Low resolution chroma key mask (downscale -> blur -> hls range -> erode -> dilate)
+     * @param in BGR (3 channels uchar)
+     * @param out mask_size x (mask_size / aspect) mask (1 channel uchar)
+     */
+    void chroma_mask(const cv::Mat &in, cv::Mat &out,
+                     const xm::ds::Color4u &hls_low, const xm::ds::Color4u &hls_up,
+                     bool linear, int mask_size, int blur, int fine, int refine);
+
+    /**
+     * @param in BGR (3 channels uchar)
+     * @param mask produced by chroma_mask
+     */
+    void chroma_apply(const cv::Mat &in, const cv::Mat &mask, cv::Mat &out, const xm::ds::Color4u &color);
+
+    /**
+     * Keyed, letterboxed RGB float [0.0 ... 1.0] tensor of the ROI (see xm::ocl::chroma_blob)
+     */
+    void chroma_blob(const cv::Mat &in, const cv::Mat &mask, cv::Mat &out, const xm::ds::Color4u &color,
+                     float roi_x, float roi_y, float roi_w, float roi_h, int width, int height);
+
+    /**
+     * @param in any number of channels uchar
+     * @param rotate 90 degrees clockwise (after flipping)
+     */
+    void flip_rotate(const cv::Mat &in, cv::Mat &out, bool flip_x, bool flip_y, bool rotate);
+
+}
+
+#endif //XMOTION_OCL_CPU_H
@@ -6,6 +6,8 @@
 #define XMOTION_OCL_DATA_H
 
 #include <CL/cl.h>
+#include <memory>
+#include <cstdint>
 
 namespace xm::ocl {
 
@@ -33,6 +35,18 @@ namespace xm::ocl {
         cl_context context = nullptr;
         cl_device_id device = nullptr;
 
+        /**
+         * Host memory of CPU backend images (see xm::ocl::cpu), handle is null then
+         */
+        std::shared_ptr<uint8_t[]> host = nullptr;
+
+        /**
+         * Optional image object (image2d_t, CL_UNORM_INT8) with the same pixels as handle:
+         * CL_R for 1 channel, CL_RGBA for 3 and 4 channels (first channel in R, alpha is 1.0 for 3 channels).
+         * Resampling kernels read it through hardware samplers (see xm::ocl::attach_image)
+         */
+        cl_mem image = nullptr;
+
         ACCESS access = ACCESS::RW;
 
         bool is_detached = false;
@@ -41,6 +55,21 @@ namespace xm::ocl {
 
         bool empty() const;
 
+        /**
+         * @return true if image is stored in host memory (CPU backend)
+         */
+        bool on_host() const;
+
+        /**
+         * @return host memory of the image, nullptr for OpenCL buffers
+         */
+        uint8_t *data() const;
+
+        /**
+         * @return true if image object is attached
+         */
+        bool has_image() const;
+
         Image2D();
 
         Image2D(size_t cols,
@@ -93,6 +122,26 @@ namespace xm::ocl {
                                 cl_device_id device,
                                 ACCESS access = ACCESS::RW);
 
+        static Image2D allocate_host(size_t cols,
+                                     size_t rows,
+                                     size_t channels,
+                                     size_t channel_size,
+                                     ACCESS access = ACCESS::RW);
+
+        /**
+         * Allocates image object (not attached) for image of given dimensions
+         * @param channels 1 (CL_R), 3 or 4 (CL_RGBA)
+         * @throws std::invalid_argument on unsupported number of channels
+         */
+        static cl_mem allocate_image(size_t cols,
+                                     size_t rows,
+                                     size_t channels,
+                                     cl_context context,
+                                     ACCESS access = ACCESS::RW);
+
+        /**
+         * Allocates image of the same dimensions in the same memory (OpenCL buffer or host)
+         */
         static Image2D allocate_like(const Image2D &t,
                                      ACCESS access = ACCESS::RW);
     private:
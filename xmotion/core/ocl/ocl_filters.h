@@ -7,6 +7,7 @@
 
 #include <opencv2/core/mat.hpp>
 #include <string>
+#include <vector>
 #include <spdlog/logger.h>
 #include <spdlog/sinks/stdout_color_sinks.h>
 #include <CL/cl.h>
@@ -52,15 +53,22 @@ namespace xm::ocl {
         cl_kernel kernel_range_hls;
         size_t range_hls_local_size;
         size_t mask_apply_local_size;
+        cl_kernel kernel_image_to_packed;
+        cl_kernel kernel_segmentation_apply;
+        size_t segmentation_apply_local_size;
 
         cl_program program_power_chroma;
         cl_kernel kernel_power_chroma;
         cl_kernel kernel_power_apply;
         cl_kernel kernel_power_mask;
+        cl_kernel kernel_power_mask_image;
+        cl_kernel kernel_power_blob;
         size_t power_chroma_local_size;
+        size_t power_blob_local_size;
 
         cl_program program_flip_rotate;
         cl_kernel kernel_flip_rotate;
+        cl_kernel kernel_flip_rotate_image;
         size_t flip_rotate_local_size;
 
         cl_program program_background;
@@ -95,27 +103,72 @@ namespace xm::ocl {
         Kernels();
     };
 
+    /**
+     * Stacks frames of the same size and type into single image, frame i takes rows [i * rows, (i + 1) * rows).
+     * Operations with "layers" parameter process every frame of the stack with single kernel launch
+     * (frame is selected by the third dimension of NDRange), frames never bleed into each other.
+     * @param frames OpenCL images (ie: frames of every camera)
+     * @return stacked image, frames.size() layers
+     * @throws std::invalid_argument if frames are empty, on the host or differ in size or type
+     */
+    xm::ocl::iop::ClImagePromise stack(
+            cl_command_queue queue,
+            const std::vector<xm::ocl::Image2D> &frames);
+
+    xm::ocl::iop::ClImagePromise stack(
+            const std::vector<xm::ocl::Image2D> &frames,
+            int queue_index = -1);
+
+    /**
+     * Stacks frames into persistent image (see stack)
+     * @param out reused if it has the right size and is not referenced anywhere else, reallocated otherwise
+     */
+    xm::ocl::iop::ClImagePromise stack(
+            cl_command_queue queue,
+            const std::vector<xm::ocl::Image2D> &frames,
+            xm::ocl::Image2D &out);
+
+    /**
+     * Splits stacked image into frames: sub-buffers of the stack (no copy)
+     * if device alignment permits, copies otherwise
+     * @param layers number of stacked frames
+     * @throws std::invalid_argument if number of rows is not divisible by layers
+     */
+    std::vector<xm::ocl::iop::ClImagePromise> unstack(
+            cl_command_queue queue,
+            const xm::ocl::iop::ClImagePromise &in,
+            int layers);
+
+    std::vector<xm::ocl::iop::ClImagePromise> unstack(
+            const xm::ocl::iop::ClImagePromise &in,
+            int layers,
+            int queue_index = -1);
+
     /**
      * Gaussian blur with separate horizontal and vertical pass
      * @param in input image in BGR color space (3 channels uchar)
      * @param kernel_size should be odd: 3, 5, 7, 9 ... etc
      * @param queue_index index of command queue (optional)
+     * @param layers number of frames stacked in the input (see stack)
      */
     xm::ocl::iop::ClImagePromise blur(
             const xm::ocl::iop::ClImagePromise &in,
             int kernel_size,
-            int queue_index = -1);
+            int queue_index = -1,
+            int layers = 1);
 
     /**
      * Gaussian blur with separate horizontal and vertical pass
      * @param queue opencl command queue
      * @param in input image in BGR color space (3 channels uchar)
      * @param kernel_size should be odd: 3, 5, 7, 9 ... etc
+     * @param layers number of frames stacked in the input (see stack)
      */
     xm::ocl::iop::ClImagePromise blur(
             cl_command_queue queue,
             const xm::ocl::iop::ClImagePromise &in,
-            int kernel_size);
+            int kernel_size,
+            int layers = 1);
 
     /**
      * Returns mask that satisfies HLS range. This function supports HUE wrapping (!)
@@ -170,6 +223,29 @@ namespace xm::ocl {
                                cv::UMat &out,
                                int queue_index = -1);
 
+    /**
+     * Applies pose segmentation to the image in single pass: bilinear upsampling
+     * of logits into ROI, sigmoid with threshold and masking are fused.
+     * Pixels outside of the ROI are zeroed.
+     * Enqueued on OpenCV's default queue (the one which produces UMats) without waiting for it,
+     * logits buffer is reused between calls.
+     * @param logits raw segmentation logits (seg_width x seg_height float32, host memory, copied)
+     * @param threshold probability threshold [0.0 ... 1.0]
+     * @param roi_x ROI within the image which segmentation corresponds to
+     * @param img source image (uchar, any number of channels)
+     * @param out output image, same type as source, stays on the device (reused if it has the same size and type)
+     */
+    void apply_segmentation(const float *logits,
+                            int seg_width,
+                            int seg_height,
+                            float threshold,
+                            float roi_x,
+                            float roi_y,
+                            float roi_w,
+                            float roi_h,
+                            const cv::UMat &img,
+                            cv::UMat &out);
+
     xm::ocl::iop::ClImagePromise chroma_key(
             cl_command_queue queue,
             const xm::ocl::iop::ClImagePromise &in,
@@ -180,7 +256,8 @@ namespace xm::ocl {
             int mask_size, // 256, 512, ...
             int blur, // 3, 5, 7, 9, 11, ...
             int fine, // 3, 5, 7, 9, 11, ...
-            int refine // 0, 1, 2, ...
+            int refine, // 0, 1, 2, ...
+            int layers = 1 // stacked frames, see stack
     );
 
     xm::ocl::iop::ClImagePromise chroma_key(
@@ -193,6 +270,101 @@ namespace xm::ocl {
             int blur, // 3, 5, 7, 9, 11, ...
             int fine, // 3, 5, 7, 9, 11, ...
             int refine, // 0, 1, 2, ...
+            int queue_index = -1,
+            int layers = 1
+    );
+
+    /**
+     * Low resolution chroma key mask (power_mask -> erode -> dilate)
+     * @param in input image in BGR color space (3 channels uchar),
+     *           attached image object (see attach_image) is resampled by hardware samplers
+     * @param layers number of frames stacked in the input (see stack), mask is stacked the same way
+     * @return mask_size x (mask_size / aspect) grayscale mask (1 channel uchar), key pixels != 0
+     */
+    xm::ocl::iop::ClImagePromise chroma_mask(
+            cl_command_queue queue,
+            const xm::ocl::iop::ClImagePromise &in,
+            const xm::ds::Color4u &hls_low,
+            const xm::ds::Color4u &hls_up,
+            bool linear,
+            int mask_size, // 256, 512, ...
+            int blur, // 3, 5, 7, 9, 11, ...
+            int fine, // 3, 5, 7, 9, 11, ...
+            int refine, // 0, 1, 2, ...
+            int layers = 1
+    );
+
+    xm::ocl::iop::ClImagePromise chroma_mask(
+            const xm::ocl::iop::ClImagePromise &in,
+            const xm::ds::Color4u &hls_low,
+            const xm::ds::Color4u &hls_up,
+            bool linear,
+            int mask_size, // 256, 512, ...
+            int blur, // 3, 5, 7, 9, 11, ...
+            int fine, // 3, 5, 7, 9, 11, ...
+            int refine, // 0, 1, 2, ...
+            int queue_index = -1,
+            int layers = 1
+    );
+
+    /**
+     * Upscales chroma key mask and applies it to the full resolution image
+     * @param in input image in BGR color space (3 channels uchar)
+     * @param mask mask produced by chroma_mask
+     * @param color replacement color (BGR)
+     * @param layers number of frames stacked in the input and mask (see stack)
+     */
+    xm::ocl::iop::ClImagePromise chroma_apply(
+            cl_command_queue queue,
+            const xm::ocl::iop::ClImagePromise &in,
+            const xm::ocl::iop::ClImagePromise &mask,
+            const xm::ds::Color4u &color,
+            int layers = 1
+    );
+
+    xm::ocl::iop::ClImagePromise chroma_apply(
+            const xm::ocl::iop::ClImagePromise &in,
+            const xm::ocl::iop::ClImagePromise &mask,
+            const xm::ds::Color4u &color,
+            int queue_index = -1,
+            int layers = 1
+    );
+
+    /**
+     * Fused chroma key and dnn preprocessing: samples ROI of the input image,
+     * applies low resolution mask and writes letterboxed RGB float [0.0 ... 1.0] tensor.
+     * Keyed full resolution image is never materialized.
+     * @param in input image in BGR color space (3 channels uchar)
+     * @param mask mask produced by chroma_mask
+     * @param color replacement color (BGR)
+     * @param roi_x ROI within input image
+     * @param width tensor width
+     * @param height tensor height
+     * @return width x height RGB image (3 channels float)
+     */
+    xm::ocl::iop::ClImagePromise chroma_blob(
+            cl_command_queue queue,
+            const xm::ocl::iop::ClImagePromise &in,
+            const xm::ocl::iop::ClImagePromise &mask,
+            const xm::ds::Color4u &color,
+            float roi_x,
+            float roi_y,
+            float roi_w,
+            float roi_h,
+            int width,
+            int height
+    );
+
+    xm::ocl::iop::ClImagePromise chroma_blob(
+            const xm::ocl::iop::ClImagePromise &in,
+            const xm::ocl::iop::ClImagePromise &mask,
+            const xm::ds::Color4u &color,
+            float roi_x,
+            float roi_y,
+            float roi_w,
+            float roi_h,
+            int width,
+            int height,
             int queue_index = -1
     );
 
@@ -204,7 +376,8 @@ namespace xm::ocl {
             bool linear,
             int mask_size, // 256, 512, ...
             int blur, // 3, 5, 7, 9, 11, ...
-            int queue_index = -1
+            int queue_index = -1,
+            int layers = 1 // stacked frames, see stack
     );
 
     xm::ocl::iop::ClImagePromise chroma_key_single_pass(
@@ -215,15 +388,55 @@ namespace xm::ocl {
             const xm::ds::Color4u &color,
             bool linear,
             int mask_size, // 256, 512, ...
-            int blur // 3, 5, 7, 9, 11, ...
+            int blur, // 3, 5, 7, 9, 11, ...
+            int layers = 1
+    );
+
+    /**
+     * Attaches image object (see Image2D::image) with the same pixels, so resampling
+     * kernels read it through hardware samplers. No-op for host images and images which already have one.
+     * @param in input image (1, 3 or 4 channels uchar)
+     * @return the same image with attached image object
+     */
+    xm::ocl::iop::ClImagePromise attach_image(
+            cl_command_queue queue,
+            const xm::ocl::iop::ClImagePromise &in
     );
 
+    xm::ocl::iop::ClImagePromise attach_image(
+            const xm::ocl::iop::ClImagePromise &in,
+            int queue_index = -1
+    );
+
+    /**
+     * Reads attached image object back into new packed buffer
+     * @param in image with attached image object
+     * @throws std::invalid_argument if there is no image object attached
+     */
+    xm::ocl::iop::ClImagePromise image_to_packed(
+            cl_command_queue queue,
+            const xm::ocl::iop::ClImagePromise &in
+    );
+
+    xm::ocl::iop::ClImagePromise image_to_packed(
+            const xm::ocl::iop::ClImagePromise &in,
+            int queue_index = -1
+    );
+
+    /**
+     * @param rotate 90 degrees clockwise (after flipping)
+     * @param image attach image object to the output (written in the same pass), see attach_image
+     * @param layers number of frames stacked in the input (see stack), every one is flipped and rotated on its own
+     * @throws std::invalid_argument if image object is requested for stacked frames
+     */
     xm::ocl::iop::ClImagePromise flip_rotate(
             const xm::ocl::iop::ClImagePromise &in,
             bool flip_x,
             bool flip_y,
             bool rotate,
-            int queue_index = -1
+            int queue_index = -1,
+            bool image = false,
+            int layers = 1
     );
 
     xm::ocl::iop::ClImagePromise flip_rotate(
@@ -231,7 +444,9 @@ namespace xm::ocl {
             const xm::ocl::iop::ClImagePromise &in,
             bool flip_x,
             bool flip_y,
-            bool rotate
+            bool rotate,
+            bool image = false,
+            int layers = 1
     );
 
 }
@@ -55,6 +55,12 @@ namespace xm::ocl::iop {
           */
         ClImagePromise &waitFor();
 
+        /**
+         * Marks promise as completed without waiting and cleanups resources,
+         * caller must already know that the commands are finished (ie: waited for their event)
+         */
+        ClImagePromise &resolve();
+
         /**
          * Often you should call waitFor() first
          */
@@ -158,6 +164,13 @@ namespace xm::ocl::iop {
      */
     void to_cv_umat(const xm::ocl::Image2D &image, cv::UMat &out, int cv_type = -1);
 
+    /**
+     * Wraps host memory of CPU backend image (no copy)
+     * @param cv_type if -1, CV_8UC(image.channels) is used
+     * @throws std::invalid_argument if image is not stored in host memory
+     */
+    cv::Mat to_host_mat(const xm::ocl::Image2D &image, int cv_type = -1);
+
     void to_cv_mat(const xm::ocl::Image2D &image, cv::Mat &out, cl_command_queue queue, int cv_type = -1);
 
     CLPromise<cv::Mat> to_cv_mat(const xm::ocl::Image2D &image, cl_command_queue queue, int cv_type = -1);
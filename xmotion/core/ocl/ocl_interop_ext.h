@@ -51,7 +51,8 @@ namespace xm::ocl::iop {
             ocl_queue = other.ocl_queue;
             ocl_event = other.ocl_event;
             data = other.data;
-            clRetainEvent(ocl_event);
+            if (ocl_event != nullptr)
+                clRetainEvent(ocl_event);
         }
 
         CLPromise<T> &operator=(CLPromise<T> &&other) noexcept {
@@ -80,7 +81,8 @@ namespace xm::ocl::iop {
             ocl_queue = other.ocl_queue;
             ocl_event = other.ocl_event;
             data = other.data;
-            clRetainEvent(ocl_event);
+            if (ocl_event != nullptr)
+                clRetainEvent(ocl_event);
             return *this;
         }
 
@@ -99,7 +101,7 @@ namespace xm::ocl::iop {
                 return *this;
             {
                 cl_int err;
-                err = clFinish(ocl_queue);
+                err = ocl_queue == nullptr ? CL_SUCCESS : clFinish(ocl_queue);
                 if (err != CL_SUCCESS)
                     throw std::runtime_error("Cannot finish command queue: " + std::to_string(err));
                 completed = true;
@@ -152,7 +154,7 @@ namespace xm::ocl::iop {
                 waiting_room:
                 {
                     cl_int err;
-                    err = clFinish(p.ocl_queue);
+                    err = p.ocl_queue == nullptr ? CL_SUCCESS : clFinish(p.ocl_queue);
                     if (err != CL_SUCCESS) {
                         delete[] list;
                         throw std::runtime_error("Cannot finish command queue: " + std::to_string(err));
@@ -49,6 +49,15 @@ namespace xogl {
         GLuint texture;
         GLint tex_loc;
 
+        // double buffered pixel unpack buffers
+        GLuint pbo[2] = {0, 0};
+        int pbo_index = 0;
+        size_t pbo_size = 0;
+        GLsizei stream_w = 0;
+        GLsizei stream_h = 0;
+        GLenum stream_format = GL_RGB;
+        bool stream_mapped = false;
+
     public:
         Texture1() = default;
 
@@ -64,11 +73,38 @@ namespace xogl {
 
         GLuint createImage(const Image &image);
 
+        /**
+         * (Re)allocates texture storage without uploading any data
+         * @param internal_format ie: GL_RGB8, GL_RGBA8
+         */
+        GLuint allocate(GLsizei width, GLsizei height, GLint internal_format, GLenum format);
+
+        /**
+         * Maps next pixel buffer (double buffered) for writing,
+         * texture storage is (re)allocated when size or format changes.
+         * Must be followed by unmapStream(), buffer can stay mapped while it is written asynchronously
+         * (ie: non-blocking OpenCL read), as long as it is unmapped before the next mapStream().
+         * @return pointer to (width * height * channels) bytes, or nullptr on error
+         */
+        unsigned char *mapStream(GLsizei width, GLsizei height, GLenum format = GL_RGB);
+
+        /**
+         * Unmaps pixel buffer and schedules asynchronous upload into the texture,
+         * does nothing if there is no mapped buffer
+         */
+        void unmapStream();
+
         void cleanup();
 
         [[nodiscard]] GLuint getTexture() const;
 
         [[nodiscard]] GLint getTexLoc() const;
+
+        [[nodiscard]] GLsizei getStreamWidth() const;
+
+        [[nodiscard]] GLsizei getStreamHeight() const;
+
+        [[nodiscard]] bool isStreamMapped() const;
     };
 
 } // xogl
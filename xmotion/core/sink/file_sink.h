@@ -0,0 +1,43 @@
+//
+// Created by henryco on 14/07/24.
+//
+
+#ifndef XMOTION_FILE_SINK_H
+#define XMOTION_FILE_SINK_H
+
+#include "i_sink.h"
+#include <fstream>
+
+#include <spdlog/logger.h>
+#include <spdlog/sinks/stdout_color_sinks.h>
+
+namespace xm::sink {
+
+    /**
+     * Appends every published result (see pose_packet.h) to the binary file
+     */
+    class FileSink : public xm::Sink {
+
+        static inline const auto log =
+                spdlog::stdout_color_mt("sink_file");
+
+    private:
+        std::vector<char> buffer;
+        std::ofstream stream;
+        std::string path;
+
+    public:
+        explicit FileSink(std::string path);
+
+        ~FileSink() override;
+
+        void open() override;
+
+        void publish(const xm::nview::Result &result) override;
+
+        void close() override;
+    };
+
+} // xm::sink
+
+#endif //XMOTION_FILE_SINK_H
@@ -0,0 +1,28 @@
+//
+// Created by henryco on 14/07/24.
+//
+
+#ifndef XMOTION_I_SINK_H
+#define XMOTION_I_SINK_H
+
+#include "../algo/pose.h"
+
+namespace xm {
+
+    /**
+     * Output of processed results (landmarks), ie: file, socket, shared memory
+     */
+    class Sink {
+    public:
+        virtual void open() = 0;
+
+        virtual void publish(const xm::nview::Result &result) = 0;
+
+        virtual void close() = 0;
+
+        virtual ~Sink() = default;
+    };
+
+} // xm
+
+#endif //XMOTION_I_SINK_H
@@ -0,0 +1,80 @@
+//
+// Created by henryco on 14/07/24.
+//
+
+#ifndef XMOTION_POSE_PACKET_H
+#define XMOTION_POSE_PACKET_H
+
+#include <cstdint>
+#include <vector>
+#include "../algo/pose.h"
+
+/**
+ * Binary layout of published pose results (host byte order).
+ *
+ * \code
+ * ┌ PacketHeader             ┐ 32 bytes
+ * │ PacketDevice [devices]   │ 1256 bytes each
+ * └                          ┘
+ * \endcode
+ */
+namespace xm::sink {
+
+    constexpr uint32_t PACKET_MAGIC = 0x53504D58; // "XMPS"
+    constexpr uint16_t PACKET_VERSION = 1;
+    constexpr int PACKET_MARKS = 39;
+
+    typedef struct PacketHeader {
+        uint32_t magic;
+        uint16_t version;
+
+        /**
+         * Number of PacketDevice entries following the header
+         */
+        uint16_t devices;
+
+        uint64_t sequence;
+
+        /**
+         * Time frame set was received from cameras, nanoseconds since epoch (see Result::timestamp)
+         */
+        int64_t timestamp;
+
+        /**
+         * Total packet size in bytes (header included)
+         */
+        uint32_t size;
+
+        uint32_t reserved;
+    } PacketHeader;
+
+    typedef struct PacketDevice {
+        uint8_t present;
+        uint8_t reserved[3];
+        float score;
+
+        /**
+         * [x, y, z, visibility, presence] in frame's coordinate system
+         */
+        float landmarks[PACKET_MARKS * 5];
+
+        /**
+         * [x, y, z] in world space
+         */
+        float ws_landmarks[PACKET_MARKS * 3];
+    } PacketDevice;
+
+    static_assert(sizeof(PacketHeader) == 32);
+    static_assert(sizeof(PacketDevice) == 8 + PACKET_MARKS * 8 * sizeof(float));
+
+    size_t packet_size(size_t devices);
+
+    /**
+     * Serializes result into (reused) buffer
+     * @return packet size in bytes
+     */
+    size_t encode(const xm::nview::Result &result, std::vector<char> &buffer);
+
+} // xm::sink
+
+#endif //XMOTION_POSE_PACKET_H
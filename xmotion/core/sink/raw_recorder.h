@@ -0,0 +1,186 @@
+//
+// Created by henryco on 21/07/24.
+//
+
+#ifndef XMOTION_RAW_RECORDER_H
+#define XMOTION_RAW_RECORDER_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <opencv2/core/mat.hpp>
+#include <spdlog/logger.h>
+#include <spdlog/sinks/stdout_color_sinks.h>
+
+#include "../ocl/ocl_data.h"
+
+namespace xm::sink {
+
+    /**
+     * Lossless recorder of captured frames (all cameras, full rate) for offline processing.
+     *
+     * Frames are compressed (see frame_codec.h) on a pool of threads and written to per camera
+     * chunked files: <path>/<name>/chunk_<n>.xmr, every record is:
+     *
+     *   [u32 magic "XMR1"][u64 seq][u64 timestamp ns][u32 cols][u32 rows][u8 channels][u8 codec][u16 0][u32 size][data]
+     *
+     * plus <path>/<name>/index.csv (seq,timestamp,chunk,offset,size) for seeking.
+     * Sequence number is shared by the frames of one push(), so cameras are played back in sync.
+     *
+     * Never blocks the capture loop: frames are dropped (and counted) when compression is not keeping up.
+     */
+    class RawRecorder {
+
+        static inline const auto log =
+                spdlog::stdout_color_mt("raw_recorder");
+
+    public:
+        static constexpr uint32_t MAGIC = 0x31524d58; // "XMR1", little endian
+
+        /**
+         * Size of record header (bytes)
+         */
+        static constexpr size_t HEADER_SIZE = 36;
+
+        typedef struct Stats {
+            uint64_t frames = 0;
+            uint64_t dropped = 0;
+            uint64_t bytes_in = 0;
+            uint64_t bytes_out = 0;
+
+            /**
+             * Compression threads busy time (download + encoding + writing)
+             */
+            double cpu_ms = 0;
+        } Stats;
+
+    private:
+        typedef struct Job {
+            int stream;
+            uint64_t order;
+            uint64_t seq;
+            uint64_t timestamp;
+            xm::ocl::Image2D image;
+            cv::Mat frame;
+        } Job;
+
+        typedef struct Encoded {
+            uint64_t seq;
+            uint64_t timestamp;
+            uint32_t cols;
+            uint32_t rows;
+            uint8_t channels;
+            uint8_t codec;
+            std::vector<uint8_t> data;
+            size_t size;
+        } Encoded;
+
+        typedef struct Stream {
+            std::string name;
+            std::filesystem::path dir;
+
+            std::mutex mutex;
+            std::ofstream chunk;
+            std::ofstream index;
+            int chunk_id = -1;
+            int chunk_frames = 0;
+            uint64_t offset = 0;
+
+            /**
+             * Frames are compressed out of order, written in order
+             */
+            std::map<uint64_t, Encoded> pending;
+            uint64_t written = 0;
+
+            /**
+             * Guarded by recorder's mutex (queue)
+             */
+            uint64_t accepted = 0;
+
+            std::atomic<uint64_t> dropped = 0;
+            std::atomic<uint64_t> bytes_in = 0;
+            std::atomic<uint64_t> bytes_out = 0;
+        } Stream;
+
+        std::vector<std::unique_ptr<Stream>> streams;
+        std::vector<std::thread> workers;
+
+        std::mutex mutex;
+        std::condition_variable flag;
+        std::deque<Job> queue;
+
+        std::filesystem::path path;
+        size_t capacity;
+        int threads;
+        int chunk;
+
+        uint64_t seq = 0;
+        std::chrono::steady_clock::time_point started;
+        std::atomic<int64_t> cpu_ns = 0;
+        bool running = false;
+        bool stop = false;
+
+    public:
+        /**
+         * @param path output directory
+         * @param names camera (stream) names, frames of push() are in the same order
+         * @param threads number of compression threads
+         * @param queue max number of frames (per camera) waiting for compression
+         * @param chunk number of frames per chunk file
+         */
+        RawRecorder(std::string path, const std::vector<std::string> &names, int threads, int queue, int chunk);
+
+        ~RawRecorder();
+
+        void open();
+
+        /**
+         * Records frames of all cameras (GPU frames are downloaded by compression threads)
+         */
+        void push(const std::vector<xm::ocl::Image2D> &frames);
+
+        /**
+         * Records frames of all cameras
+         */
+        void push(const std::vector<cv::Mat> &frames);
+
+        /**
+         * Compresses and writes everything queued, then stops compression threads
+         */
+        void close();
+
+        [[nodiscard]] Stats stats() const;
+
+        /**
+         * Logs throughput, compression ratio and dropped frames
+         */
+        void report() const;
+
+    private:
+        template<typename T>
+        void enqueue(const std::vector<T> &frames);
+
+        void worker();
+
+        static void encode(Job &job, Encoded &out, cl_command_queue &queue);
+
+        /**
+         * Writes encoded frame in order of acceptance, frames ahead of the order are kept in pending
+         */
+        void commit(Stream &stream, uint64_t order, const Encoded &encoded);
+
+        void write(Stream &stream, const Encoded &encoded) const;
+    };
+
+} // xm::sink
+
+#endif //XMOTION_RAW_RECORDER_H
@@ -0,0 +1,68 @@
+//
+// Created by henryco on 16/07/24.
+//
+
+#ifndef XMOTION_SHM_RING_H
+#define XMOTION_SHM_RING_H
+
+#include <string>
+#include <cstdint>
+#include "xm_pose_ring.h"
+
+#include <spdlog/logger.h>
+#include <spdlog/sinks/stdout_color_sinks.h>
+
+namespace xm::sink {
+
+    /**
+     * Writer side of shared memory ring (see xm_pose_ring.h for layout and consumer API).
+     * Lock-free, wait-free for the writer, readers are woken up via futex.
+     */
+    class ShmRing {
+
+        static inline const auto log =
+                spdlog::stdout_color_mt("shm_ring");
+
+    private:
+        xm_ring_header *header = nullptr;
+        uint8_t *slots_base = nullptr;
+        size_t length = 0;
+
+        std::string name;
+        uint32_t slots;
+        uint32_t slot_size;
+        uint64_t head = 0;
+
+    public:
+        /**
+         * @param name shm object name, ie: "/xmotion"
+         * @param slots number of slots, readers lagging more than that are losing frames
+         * @param slot_size maximum payload size in bytes
+         */
+        ShmRing(std::string name, uint32_t slots, uint32_t slot_size);
+
+        ShmRing(const ShmRing &src) = delete;
+
+        ~ShmRing();
+
+        void open();
+
+        /**
+         * Copies payload into the next slot and wakes up readers
+         * @return false if payload does not fit into the slot
+         */
+        bool publish(const void *data, uint32_t size);
+
+        /**
+         * Unmaps and unlinks shared memory object
+         */
+        void close();
+
+        [[nodiscard]] uint64_t sequence() const;
+
+        [[nodiscard]] uint32_t capacity() const;
+    };
+
+} // xm::sink
+
+#endif //XMOTION_SHM_RING_H
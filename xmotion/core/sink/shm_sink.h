@@ -0,0 +1,45 @@
+//
+// Created by henryco on 16/07/24.
+//
+
+#ifndef XMOTION_SHM_SINK_H
+#define XMOTION_SHM_SINK_H
+
+#include "i_sink.h"
+#include "shm_ring.h"
+
+#include <spdlog/logger.h>
+#include <spdlog/sinks/stdout_color_sinks.h>
+
+namespace xm::sink {
+
+    /**
+     * Publishes every result (see pose_packet.h) into shared memory ring,
+     * consumers use xm_pose_ring.h (C header)
+     */
+    class ShmSink : public xm::Sink {
+
+        static inline const auto log =
+                spdlog::stdout_color_mt("sink_shm");
+
+    private:
+        std::vector<char> buffer;
+        xm::sink::ShmRing ring;
+        bool oversize = false;
+
+    public:
+        /**
+         * @param devices maximum number of devices per packet, defines slot size
+         */
+        ShmSink(std::string name, uint32_t slots, size_t devices);
+
+        void open() override;
+
+        void publish(const xm::nview::Result &result) override;
+
+        void close() override;
+    };
+
+} // xm::sink
+
+#endif //XMOTION_SHM_SINK_H
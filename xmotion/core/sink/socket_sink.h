@@ -0,0 +1,49 @@
+//
+// Created by henryco on 14/07/24.
+//
+
+#ifndef XMOTION_SOCKET_SINK_H
+#define XMOTION_SOCKET_SINK_H
+
+#include "i_sink.h"
+
+#include <spdlog/logger.h>
+#include <spdlog/sinks/stdout_color_sinks.h>
+
+namespace xm::sink {
+
+    /**
+     * Streams every published result (see pose_packet.h) to the clients
+     * of local UNIX-domain socket (SOCK_SEQPACKET, one packet per message).
+     * Never blocks: frames are dropped for clients which are not keeping up.
+     */
+    class SocketSink : public xm::Sink {
+
+        static inline const auto log =
+                spdlog::stdout_color_mt("sink_socket");
+
+    private:
+        std::vector<char> buffer;
+        std::vector<int> clients;
+        std::string path;
+        size_t max_clients;
+        int server = -1;
+
+    public:
+        SocketSink(std::string path, size_t max_clients);
+
+        ~SocketSink() override;
+
+        void open() override;
+
+        void publish(const xm::nview::Result &result) override;
+
+        void close() override;
+
+    private:
+        void accept_pending();
+    };
+
+} // xm::sink
+
+#endif //XMOTION_SOCKET_SINK_H
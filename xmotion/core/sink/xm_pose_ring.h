@@ -0,0 +1,243 @@
+/*
+ * Created by henryco on 16/07/24.
+ *
+ * Shared memory pose ring, consumer side (C99, C++).
+ * Linux only (POSIX shm + futex), link with -lrt on older glibc.
+ *
+ * Single writer (xmotion), any number of readers. Readers map the ring
+ * read-only and never block the writer: every slot is guarded by
+ * a sequence lock, so reader just retries (or skips) if slot was
+ * overwritten while being copied.
+ *
+ * Slot payload is a pose packet, see pose_packet.h:
+ *   [PacketHeader (32 bytes)] [PacketDevice (1256 bytes) x devices]
+ *
+ * Usage:
+ *   xm_ring ring;
+ *   if (xm_ring_open("/xmotion", &ring) != 0) ...
+ *   uint64_t last = xm_ring_head(&ring), head, n;
+ *   uint32_t size;
+ *   int64_t published;
+ *   for (;;) {
+ *       if (xm_ring_wait(&ring, last, 1000) <= 0) continue;
+ *       head = xm_ring_head(&ring);
+ *       for (n = last + 1; n <= head; n++) {
+ *           if (xm_ring_read(&ring, n, buffer, sizeof(buffer), &size, &published) == 0) ...
+ *           (-1: frame n was overwritten before it was read, reader is too slow)
+ *       }
+ *       last = head;
+ *   }
+ *   xm_ring_close(&ring);
+ */
+
+#ifndef XMOTION_XM_POSE_RING_H
+#define XMOTION_XM_POSE_RING_H
+
+/* syscall(), clock_gettime() with strict -std=c99 */
+#if !defined(_GNU_SOURCE) && !defined(_DEFAULT_SOURCE)
+#define _DEFAULT_SOURCE
+#endif
+
+#include <stdint.h>
+#include <errno.h>
+#include <string.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define XM_RING_MAGIC 0x474E5258u /* "XRNG" */
+#define XM_RING_VERSION 1u
+#define XM_RING_ALIGN 64u
+
+typedef struct xm_ring_header {
+    uint32_t magic;
+    uint32_t version;
+
+    /* number of slots */
+    uint32_t slots;
+
+    /* payload capacity of single slot in bytes */
+    uint32_t slot_size;
+
+    /* distance between slots in bytes (xm_ring_slot + payload, aligned) */
+    uint32_t stride;
+
+    /* futex word, incremented on every publish */
+    uint32_t futex;
+
+    /* sequence number of last published frame (1, 2, 3...), 0 if none */
+    uint64_t head;
+
+    uint8_t reserved[XM_RING_ALIGN - 32];
+} xm_ring_header;
+
+typedef struct xm_ring_slot {
+    /* sequence lock: (2 * n - 1) while frame n is written, (2 * n) when ready */
+    uint64_t lock;
+
+    /* payload size in bytes */
+    uint32_t size;
+    uint32_t reserved;
+
+    /* publish time, CLOCK_MONOTONIC nanoseconds (writer side) */
+    int64_t published;
+
+    uint8_t padding[XM_RING_ALIGN - 24];
+
+    /* followed by slot_size bytes of payload */
+} xm_ring_slot;
+
+typedef struct xm_ring {
+    const xm_ring_header *header;
+    size_t length;
+} xm_ring;
+
+static inline size_t xm_ring_stride(uint32_t slot_size) {
+    return (sizeof(xm_ring_slot) + slot_size + XM_RING_ALIGN - 1) / XM_RING_ALIGN * XM_RING_ALIGN;
+}
+
+static inline size_t xm_ring_length(uint32_t slots, uint32_t slot_size) {
+    return sizeof(xm_ring_header) + (size_t) slots * xm_ring_stride(slot_size);
+}
+
+static inline const xm_ring_slot *xm_ring_slot_at(const xm_ring *ring, uint64_t n) {
+    const uint8_t *base = (const uint8_t *) ring->header + sizeof(xm_ring_header);
+    return (const xm_ring_slot *) (base + (size_t) (n % ring->header->slots) * ring->header->stride);
+}
+
+static inline int64_t xm_ring_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t) ts.tv_sec * 1000000000ll + ts.tv_nsec;
+}
+
+/**
+ * Maps existing ring (read-only)
+ * @param name shm object name, ie: "/xmotion"
+ * @return 0 on success, -1 otherwise
+ */
+static inline int xm_ring_open(const char *name, xm_ring *ring) {
+    struct stat st;
+    void *ptr;
+    const xm_ring_header *header;
+
+    int fd = shm_open(name, O_RDONLY, 0);
+    if (fd < 0)
+        return -1;
+
+    if (fstat(fd, &st) != 0 || (size_t) st.st_size < sizeof(xm_ring_header)) {
+        close(fd);
+        return -1;
+    }
+
+    ptr = mmap(NULL, (size_t) st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (ptr == MAP_FAILED)
+        return -1;
+
+    header = (const xm_ring_header *) ptr;
+    if (header->magic != XM_RING_MAGIC || header->version != XM_RING_VERSION
+        || xm_ring_length(header->slots, header->slot_size) > (size_t) st.st_size) {
+        munmap(ptr, (size_t) st.st_size);
+        return -1;
+    }
+
+    ring->header = header;
+    ring->length = (size_t) st.st_size;
+    return 0;
+}
+
+static inline void xm_ring_close(xm_ring *ring) {
+    if (ring->header != NULL)
+        munmap((void *) ring->header, ring->length);
+    ring->header = NULL;
+    ring->length = 0;
+}
+
+/**
+ * @return sequence number of last published frame, 0 if none
+ */
+static inline uint64_t xm_ring_head(const xm_ring *ring) {
+    return __atomic_load_n(&ring->header->head, __ATOMIC_ACQUIRE);
+}
+
+/**
+ * Copies frame n into dst
+ * @param published optional, publish time (CLOCK_MONOTONIC ns)
+ * @return 0 on success, 1 if frame is not published yet,
+ *         -1 if frame was already overwritten, -2 if dst is too small
+ */
+static inline int xm_ring_read(const xm_ring *ring, uint64_t n, void *dst, uint32_t capacity,
+                               uint32_t *size, int64_t *published) {
+    const xm_ring_slot *slot;
+    uint64_t l1, l2;
+    uint32_t s;
+    int64_t p;
+
+    if (n == 0 || n > xm_ring_head(ring))
+        return 1;
+
+    slot = xm_ring_slot_at(ring, n);
+
+    l1 = __atomic_load_n(&slot->lock, __ATOMIC_ACQUIRE);
+    if (l1 != 2 * n)
+        return l1 < 2 * n ? 1 : -1;
+
+    s = slot->size;
+    p = slot->published;
+    if (s > capacity)
+        return -2;
+
+    memcpy(dst, (const uint8_t *) slot + sizeof(xm_ring_slot), s);
+
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    l2 = __atomic_load_n(&slot->lock, __ATOMIC_RELAXED);
+    if (l1 != l2)
+        return -1;
+
+    if (size != NULL)
+        *size = s;
+    if (published != NULL)
+        *published = p;
+    return 0;
+}
+
+/**
+ * Blocks until frame newer than "after" is published
+ * @param timeout_ms negative means infinite
+ * @return 1 if there is newer frame, 0 on timeout
+ */
+static inline int xm_ring_wait(const xm_ring *ring, uint64_t after, int timeout_ms) {
+    struct timespec ts, *tp = NULL;
+    uint32_t word;
+
+    if (timeout_ms >= 0) {
+        ts.tv_sec = timeout_ms / 1000;
+        ts.tv_nsec = (long) (timeout_ms % 1000) * 1000000l;
+        tp = &ts;
+    }
+
+    for (;;) {
+        word = __atomic_load_n(&ring->header->futex, __ATOMIC_ACQUIRE);
+        if (xm_ring_head(ring) > after)
+            return 1;
+
+        /* shared futex, works on read-only mappings (FUTEX_WAIT only reads the word) */
+        if (syscall(SYS_futex, &ring->header->futex, FUTEX_WAIT, word, tp, NULL, 0) != 0 && errno == ETIMEDOUT)
+            return xm_ring_head(ring) > after ? 1 : 0;
+    }
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* XMOTION_XM_POSE_RING_H */
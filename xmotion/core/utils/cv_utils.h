@@ -111,6 +111,23 @@ namespace xm::ocv {
             bool sb = false,
             int flag = 0);
 
+    /**
+     * Same as find_squares, but pattern is localized on the downscaled image
+     * (longest side <= max_size) and only then refined at full resolution
+     * within pattern's bounding box. If pattern is not found on the downscaled image,
+     * whole image is searched again at full resolution (small patterns).
+     *
+     * @param max_size longest side of the image used for localization,
+     *        non-positive value (or smaller image) falls back to find_squares
+     */
+    Squares find_squares_fast(
+            const cv::UMat &image,
+            uint columns,
+            uint rows,
+            bool sb = false,
+            int max_size = 640,
+            int flag = 0);
+
     /**
      * Function to generate distinct colors for a given integer < N
      */
@@ -6,6 +6,7 @@
 #define XMOTION_EPI_UTIL_H
 
 #include <opencv2/core/mat.hpp>
+#include "geometry.h"
 
 namespace xm::util::epi {
 
@@ -40,6 +41,11 @@ namespace xm::util::epi {
          * l_2 = F * x1
          */
         cv::Mat F;
+
+        /**
+         * Fixed size copies of RT, E and F for per frame use
+         */
+        xm::util::geom::EpiFixed fixed;
     } EpiPair;
 
     typedef struct CalibPair {
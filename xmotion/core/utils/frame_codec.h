@@ -0,0 +1,51 @@
+//
+// Created by henryco on 21/07/24.
+//
+
+#ifndef XMOTION_FRAME_CODEC_H
+#define XMOTION_FRAME_CODEC_H
+
+#include <opencv2/core/mat.hpp>
+#include <cstdint>
+#include <vector>
+
+/**
+ * Fast lossless frame codec (QOI-like: run length, 64 entries pixel cache
+ * and small deltas against previous pixel), single pass, no entropy coding.
+ * Meant for recording at capture rate, not for archiving.
+ */
+namespace xm::util::codec {
+
+    enum Codec : uint8_t {
+        /**
+         * Uncompressed pixels (continuous, row after row)
+         */
+        RAW = 0,
+
+        /**
+         * QOI-like, 8 bit, 1, 3 or 4 channels
+         */
+        QOI = 1
+    };
+
+    /**
+     * Worst case size of encoded frame
+     */
+    size_t bound(int cols, int rows, int channels);
+
+    /**
+     * Encodes 8 bit frame (CV_8UC1, CV_8UC3, CV_8UC4) to the beginning of the output,
+     * output is grown to bound() if needed (never shrunk)
+     * @return size of encoded data
+     */
+    size_t encode(const cv::Mat &frame, std::vector<uint8_t> &out);
+
+    /**
+     * Decodes frame encoded with encode(), output must be allocated (size and type of encoded frame)
+     * @throws std::runtime_error if data is malformed
+     */
+    void decode(const uint8_t *data, size_t size, cv::Mat &out);
+
+} // xm::util::codec
+
+#endif //XMOTION_FRAME_CODEC_H
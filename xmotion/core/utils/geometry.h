@@ -0,0 +1,138 @@
+//
+// Created by henryco on 20/07/24.
+//
+
+#ifndef XMOTION_GEOMETRY_H
+#define XMOTION_GEOMETRY_H
+
+#include <glm/glm.hpp>
+#include <opencv2/core/mat.hpp>
+#include <vector>
+
+/**
+ * Fixed size, allocation free geometry for per frame hot paths.
+ * Matrices are glm (column-major), converted once from cv::Mat (row-major).
+ */
+namespace xm::util::geom {
+
+    using Mat3 = glm::dmat3;
+    using Mat4 = glm::dmat4;
+    using Vec3 = glm::dvec3;
+
+    /**
+     * Image point (x, y)
+     */
+    using Point = glm::vec2;
+
+    /**
+     * Line (a, b, c): ax + by + c = 0, normalized so that a^2 + b^2 = 1
+     */
+    using Line = glm::vec3;
+
+    typedef struct EpiFixed {
+        /**
+         * Rotation-translation matrix: X2 = RT * X1
+         */
+        Mat4 RT;
+
+        /**
+         * Essential matrix
+         */
+        Mat3 E;
+
+        /**
+         * Fundamental matrix: l_2 = F * x1
+         */
+        Mat3 F;
+    } EpiFixed;
+
+    typedef struct Camera {
+        /**
+         * Calibration matrix
+         */
+        Mat3 K;
+
+        /**
+         * Inverse of calibration matrix
+         */
+        Mat3 K_inv;
+
+        /**
+         * Distortion coefficients: k1, k2, p1, p2, k3, k4, k5, k6
+         */
+        double D[8];
+
+        /**
+         * Whether any distortion coefficient is non-zero
+         */
+        bool distorted;
+
+        /**
+         * False for distortion models beyond 8 coefficients (thin prism, tilt),
+         * these have to use opencv instead
+         */
+        bool supported;
+    } Camera;
+
+    /**
+     * Inverse distortion lookup grid: undistorted positions of
+     * (cols x rows) nodes evenly spread over the distorted image
+     */
+    typedef struct Grid {
+        std::vector<Point> nodes;
+        int cols;
+        int rows;
+        float step_x;
+        float step_y;
+    } Grid;
+
+    Mat3 mat3(const cv::Mat &m);
+
+    Mat4 mat4(const cv::Mat &m);
+
+    EpiFixed epi_fixed(const cv::Mat &RT, const cv::Mat &E, const cv::Mat &F);
+
+    Camera camera(const cv::Mat &K, const cv::Mat &D);
+
+    /**
+     * Epipolar lines for batch of points: l_i = F * x_i
+     */
+    void epi_lines(const Mat3 &F, const Point *points, Line *lines, int n);
+
+    /**
+     * Same as cv::undistortPoints(in, out, K, D, cv::noArray(), K) with default criteria,
+     * in place operation (in == out) is allowed
+     *
+     * @param iterations number of fixed point iterations
+     */
+    void undistort(const Camera &camera, const Point *in, Point *out, int n, int iterations = 5);
+
+    /**
+     * Builds inverse distortion lookup grid using undistort(camera, ...) at every node
+     * @param width image width
+     * @param height image height
+     * @param cols number of grid nodes along x axis (>= 2)
+     * @param rows number of grid nodes along y axis (>= 2)
+     */
+    Grid undistort_grid(const Camera &camera, int width, int height, int cols, int rows);
+
+    /**
+     * Bilinear lookup within the grid (extrapolated outside the image),
+     * in place operation (in == out) is allowed
+     */
+    void undistort(const Grid &grid, const Point *in, Point *out, int n);
+
+    /**
+     * Max distance (pixels) between grid lookup and undistort(camera, ...),
+     * measured in the middle of every cell (worst case for bilinear interpolation)
+     */
+    float grid_error(const Grid &grid, const Camera &camera);
+
+    /**
+     * Inverse of undistort: applies lens distortion to ideal (undistorted) pixel points,
+     * in place operation (in == out) is allowed
+     */
+    void distort(const Camera &camera, const Point *in, Point *out, int n);
+}
+
+#endif //XMOTION_GEOMETRY_H
@@ -0,0 +1,86 @@
+//
+// Created by henryco on 21/07/24.
+//
+
+#ifndef XMOTION_MAILBOX_H
+#define XMOTION_MAILBOX_H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <utility>
+
+namespace xm::util {
+
+    /**
+     * Lock-free "latest value wins" mailbox for single producer and single consumer (triple buffer).
+     *
+     * Producer never waits for the consumer: value which is not taken before the next push is overwritten.
+     * Consumer always gets the newest published value. Slots are owned by one side at a time,
+     * they are swapped through the atomic middle index only.
+     */
+    template<typename T>
+    class Mailbox {
+        static constexpr uint8_t INDEX = 0x3;
+
+        /**
+         * Middle slot holds value not taken by the consumer yet
+         */
+        static constexpr uint8_t FRESH = 0x4;
+
+        std::array<T, 3> slots{};
+
+        std::atomic<uint8_t> middle = 1;
+
+        /**
+         * Owned by the producer
+         */
+        uint8_t back = 0;
+
+        /**
+         * Owned by the consumer
+         */
+        uint8_t front = 2;
+
+    public:
+        Mailbox() = default;
+
+        Mailbox(const Mailbox &) = delete;
+
+        Mailbox &operator=(const Mailbox &) = delete;
+
+        /**
+         * Producer side
+         * @return true if previous value was not taken by the consumer (it is dropped)
+         */
+        bool push(T value) {
+            slots[back] = std::move(value);
+            const auto previous = middle.exchange(back | FRESH, std::memory_order_acq_rel);
+            back = previous & INDEX;
+            return (previous & FRESH) != 0;
+        }
+
+        /**
+         * Consumer side, takes the newest value if there is one
+         * @return false if nothing was pushed since the last fetch (latest() is the same value)
+         */
+        bool fetch() {
+            if ((middle.load(std::memory_order_acquire) & FRESH) == 0)
+                return false;
+            // only producer changes middle in the meantime, it is fresh either way
+            front = middle.exchange(front, std::memory_order_acq_rel) & INDEX;
+            return true;
+        }
+
+        /**
+         * Consumer side
+         * @return value taken by the last fetch (default value if none)
+         */
+        const T &latest() const {
+            return slots[front];
+        }
+    };
+
+}
+
+#endif //XMOTION_MAILBOX_H
@@ -0,0 +1,137 @@
+//
+// Created by henryco on 21/07/24.
+//
+
+#ifndef XMOTION_QUALITY_GOVERNOR_H
+#define XMOTION_QUALITY_GOVERNOR_H
+
+#include <vector>
+
+namespace xm::util {
+
+    typedef struct GovernorConf {
+        /**
+         * Target frames per second, frame budget is 1000 / fps (ms)
+         */
+        float fps = 30.f;
+
+        /**
+         * Quality goes down when frame time exceeds budget * (1 + margin_down)
+         */
+        float margin_down = 0.1f;
+
+        /**
+         * Quality goes up when frame time is below budget * (1 - margin_up)
+         */
+        float margin_up = 0.25f;
+
+        /**
+         * Number of consecutive frames over the budget before quality goes down
+         */
+        int window_down = 15;
+
+        /**
+         * Number of consecutive frames under the budget before quality goes up,
+         * longer than window_down, so governor does not oscillate
+         */
+        int window_up = 90;
+
+        /**
+         * Number of frames after any change during which nothing changes
+         */
+        int cooldown = 30;
+
+        /**
+         * Exponential moving average factor for latencies
+         */
+        float alpha = 0.1f;
+    } GovernorConf;
+
+    /**
+     * Frame time governor: keeps quality level per camera (0 is the best one),
+     * steps the slowest camera down when frame budget is exceeded
+     * and the most degraded one up when there is enough headroom.
+     * Only one camera is changed at a time.
+     */
+    class QualityGovernor {
+    private:
+        GovernorConf conf{};
+        std::vector<int> levels{};
+        std::vector<int> max_levels{};
+
+        /**
+         * Per camera runtime limit of the level, never above max_levels
+         */
+        std::vector<int> limits{};
+
+        /**
+         * Per camera stage latency (ms, moving average)
+         */
+        std::vector<float> latencies{};
+
+        /**
+         * Per camera stage latency (ms) of the current frame
+         */
+        std::vector<float> pending{};
+
+        /**
+         * Frame time (ms, moving average)
+         */
+        float frame_ms = 0.f;
+
+        int over = 0;
+        int under = 0;
+        int hold = 0;
+
+    public:
+        /**
+         * @param max_levels number of levels available per camera minus one (0 means no control)
+         */
+        void init(const GovernorConf &conf, const std::vector<int> &max_levels);
+
+        /**
+         * Reports per camera stage latency of the current frame,
+         * stages reported separately are summed up
+         */
+        void report(int index, float ms);
+
+        /**
+         * Ends the frame
+         *
+         * @param ms whole frame processing time
+         * @return index of camera whose quality level has changed, -1 if none
+         */
+        int update(float ms);
+
+        /**
+         * Limits level of the camera at runtime (e.g. some stages are turned off),
+         * current level is lowered at once if it is above the limit
+         *
+         * @param max_level clamped to the max level given in init
+         * @return true if current level has changed
+         */
+        bool limit(int index, int max_level);
+
+        [[nodiscard]] int level(int index) const;
+
+        [[nodiscard]] float latency(int index) const;
+
+        [[nodiscard]] float frame_time() const;
+
+        [[nodiscard]] bool enabled() const;
+
+    protected:
+        /**
+         * @return index of the slowest camera which still can go down, -1 if none
+         */
+        int step_down();
+
+        /**
+         * @return index of the most degraded camera, -1 if none
+         */
+        int step_up();
+    };
+
+} // xm::util
+
+#endif //XMOTION_QUALITY_GOVERNOR_H
@@ -13,6 +13,7 @@
 #include "json_config_common.h"
 #include "json_config_pose.h"
 #include "json_config_gui.h"
+#include "json_config_output.h"
 
 namespace xm::data {
 
@@ -136,6 +137,12 @@ namespace xm::data {
          */
         bool show_epilines;
 
+        /**
+         * Seed ROI of lost views from epipolar geometry
+         * of views which still keep track of the body
+         */
+        bool cross_seed;
+
         /**
          * Perform segmentation.
          * Used in helper background subtraction heuristics
@@ -146,6 +153,11 @@ namespace xm::data {
          * Optional, number of dedicated cpu threads
          */
         int threads;
+
+        /**
+         * Optional, adaptive quality (frame time governor)
+         */
+        PoseGovernor governor;
     } Pose;
 
     typedef struct {
@@ -201,6 +213,11 @@ namespace xm::data {
          * Used when type: "compose"
          */
         Compose compose;
+
+        /**
+         * Results output configuration
+         */
+        Output output;
     } JsonConfig;
 
     JsonConfig config_from_file(const std::string &file);
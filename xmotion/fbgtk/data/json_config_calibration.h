@@ -113,6 +113,12 @@ namespace xm::data {
          * in calibration process
          */
         int delay;
+
+        /**
+         * Longest side of the image used for pattern localization (px),
+         * pattern is refined at full resolution afterwards, non-positive to disable
+         */
+        int detect_size;
     } Calibration;
 
     typedef struct {
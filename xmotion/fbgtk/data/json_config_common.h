@@ -21,10 +21,12 @@ namespace xm::data {
         bool y;
     } Flip;
 
-    typedef struct {
+    typedef struct HSL {
         float h;
         float s;
         float l;
+
+        bool operator==(const HSL &) const = default;
     } HSL;
 
     typedef struct {
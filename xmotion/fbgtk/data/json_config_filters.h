@@ -59,7 +59,7 @@ namespace xm::data {
         };
     }
 
-    typedef struct {
+    typedef struct Chroma {
         std::string key;      // chromakey key color (hex, ie: #ffffff)
         std::string replace;  // chromakey replacement color (hex, ie: #ffffff)
         HSL range;            // HSL range (threshold)
@@ -103,7 +103,16 @@ namespace xm::data {
          */
         bool linear;
 
+        /**
+         * Should be fused with pose preprocessing
+         * (mask is applied only to network input,
+         * keyed image is not produced, POSE only)
+         */
+        bool fused;
+
         bool _present;
+
+        bool operator==(const Chroma &) const = default;
     } Chroma;
 
     typedef struct Difference {
@@ -152,9 +161,11 @@ namespace xm::data {
         fbg::BgKernelType dilate_kernel = fbg::RUBY_12;
 
         bool _present = false;
+
+        bool operator==(const Difference &) const = default;
     } Difference;
 
-    typedef struct {
+    typedef struct Blur {
         /**
          * Property used for calculating kernel size:
          * \code
@@ -164,17 +175,21 @@ namespace xm::data {
         int blur;
 
         bool _present;
+
+        bool operator==(const Blur &) const = default;
     } Blur;
 
     /**
      * This structure in fact results in a combined json object
      * (fields union of all child structures: {type, ...blur, ...chroma, ...difference})
      */
-    typedef struct {
+    typedef struct Filter {
         xm::data::FilterType type;
         Blur blur;
         Chroma chroma;
         Difference difference;
+
+        bool operator==(const Filter &) const = default;
     } Filter;
 }
 
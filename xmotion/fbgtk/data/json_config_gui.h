@@ -5,6 +5,7 @@
 #ifndef XMOTION_JSON_CONFIG_GUI_H
 #define XMOTION_JSON_CONFIG_GUI_H
 
+#include <string>
 #include <vector>
 namespace xm::data {
 
@@ -50,12 +51,47 @@ namespace xm::data {
          */
         bool capture_dummy;
 
+        /**
+         * Use video files as source of frames,
+         * capture id is a file path relative to the project file
+         */
+        bool capture_file;
+
+        /**
+         * Video files are paced by their fps (late frames are dropped),
+         * otherwise every frame is delivered as fast as possible
+         */
+        bool capture_realtime;
+
+        /**
+         * Restart video files from the beginning at the end
+         */
+        bool capture_loop;
+
         /**
          * Use faster method of frames retrieval for camera devices
          * (not recommended)
          */
         bool capture_fast;
 
+        /**
+         * Capture every camera continuously on its own thread, keeping only the newest frame
+         * (lowest latency, frames which are not processed in time are dropped)
+         */
+        bool capture_latest;
+
+        /**
+         * Attach 4 channel OpenCL image objects to captured frames,
+         * resampling filters read them through hardware samplers
+         */
+        bool capture_image;
+
+        /**
+         * Filter frames of every camera with single kernel launches (frames are stacked),
+         * used when every camera has the same filters and frames have the same size
+         */
+        bool batch_filters;
+
         /**
          * Debug mode
          */
@@ -65,6 +101,23 @@ namespace xm::data {
          * Default numbers of cpu cores available
          */
         int cpu;
+
+        /**
+         * Directory for serialized GPU delegate programs,
+         * relative to the project file. Empty disables the cache
+         */
+        std::string dnn_cache;
+
+        /**
+         * Image processing backend: "auto", "opencl" or "cpu"
+         */
+        std::string compute;
+
+        /**
+         * OpenCL work-group size tuning: "auto", "retune" or "off",
+         * winners are persisted in dnn_cache directory
+         */
+        std::string tune;
     } Misc;
 
 }
@@ -0,0 +1,82 @@
+//
+// Created by henryco on 14/07/24.
+//
+
+#ifndef XMOTION_JSON_CONFIG_OUTPUT_H
+#define XMOTION_JSON_CONFIG_OUTPUT_H
+
+#include <string>
+#include <vector>
+
+namespace xm::data {
+
+    typedef std::string SinkType;
+#define XM_SINK_TYPE_FILE "file"
+#define XM_SINK_TYPE_SOCKET "socket"
+#define XM_SINK_TYPE_SHM "shm"
+
+    typedef struct {
+        /**
+         * Sink type: "file" | "socket" | "shm"
+         */
+        xm::data::SinkType type;
+
+        /**
+         * File path (relative to project dir), UNIX-domain socket path
+         * or shared memory object name (ie: "/xmotion")
+         */
+        std::string path;
+
+        /**
+         * Maximum number of connected clients (socket only)
+         */
+        int clients;
+
+        /**
+         * Number of ring slots (shm only)
+         */
+        int slots;
+    } OutputSink;
+
+    typedef struct {
+        /**
+         * Record captured frames (all cameras) for offline processing
+         */
+        bool enabled;
+
+        /**
+         * Output directory (relative to project dir)
+         */
+        std::string path;
+
+        /**
+         * Number of compression threads
+         */
+        int threads;
+
+        /**
+         * Max number of frames per camera waiting for compression, frames above are dropped
+         */
+        int queue;
+
+        /**
+         * Number of frames per chunk file
+         */
+        int chunk;
+    } Record;
+
+    typedef struct {
+        /**
+         * Array of result sinks, used in both gui and headless modes
+         */
+        std::vector<OutputSink> sinks;
+
+        /**
+         * Raw (lossless) recording of captured frames
+         */
+        Record record;
+    } Output;
+
+}
+
+#endif //XMOTION_JSON_CONFIG_OUTPUT_H
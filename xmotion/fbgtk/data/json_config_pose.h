@@ -19,13 +19,18 @@ namespace xm::data {
 
             HEAVY_F16 = 6,
             FULL_F16 = 7,
-            LITE_F16 = 8
+            LITE_F16 = 8,
+
+            HEAVY_I8 = 9,
+            FULL_I8 = 10,
+            LITE_I8 = 11
         };
 
         enum ModeDetector {
             ORIGIN = 0,
             F_32 = 1,
-            F_16 = 2
+            F_16 = 2,
+            I_8 = 3
         };
     }
 
@@ -106,6 +111,13 @@ namespace xm::data {
         * [0.0 ... 1.0]
         */
         float roi;
+
+        /**
+         * Segmentation probability threshold, pixels below are masked out
+         *
+         * [0.0 ... 1.0]
+         */
+        float segmentation;
     } PoseThresholds;
 
     typedef struct {
@@ -126,6 +138,28 @@ namespace xm::data {
         int fps;
     } PoseFilter;
 
+    typedef struct {
+        /**
+         * Max number of people tracked within the view, one (1) means single-person mode
+         */
+        int people;
+
+        /**
+         * Min IoU of detected and tracked ROI to associate them
+         */
+        float iou;
+
+        /**
+         * Number of frames lost track is kept for re-acquisition
+         */
+        int misses;
+
+        /**
+         * Number of frames between detector runs looking for new people
+         */
+        int reacquire;
+    } PoseTracking;
+
     typedef struct {
         /**
          * BlazePose detector model
@@ -144,6 +178,12 @@ namespace xm::data {
          */
         bool source;
 
+        /**
+         * Fold input image undistortion into network input resampling
+         * (whole image is undistorted only for debug output)
+         */
+        bool warp;
+
         /**
          * Undistort position of localized points
          */
@@ -156,6 +196,22 @@ namespace xm::data {
          * 1 - all pixels
          */
         float alpha;
+
+        /**
+         * Inverse distortion lookup grid nodes along x axis,
+         * zero (0) means exact solver for points
+         */
+        int grid_w;
+
+        /**
+         * Inverse distortion lookup grid nodes along y axis
+         */
+        int grid_h;
+
+        /**
+         * Max acceptable lookup grid error (pixels)
+         */
+        float tolerance;
     } PoseUndistort;
 
     typedef struct {
@@ -169,8 +225,43 @@ namespace xm::data {
         PoseFilter filter;
         PoseModel model;
         PoseRoi roi;
+        PoseTracking tracking;
     } PoseDevice;
 
+    typedef struct {
+        /**
+         * Target frames per second
+         */
+        float fps;
+
+        /**
+         * Relative frame budget overrun before quality goes down
+         */
+        float margin_down;
+
+        /**
+         * Relative frame budget headroom before quality goes up
+         */
+        float margin_up;
+
+        /**
+         * Number of frames over the budget before quality goes down
+         */
+        int window_down;
+
+        /**
+         * Number of frames under the budget before quality goes up
+         */
+        int window_up;
+
+        /**
+         * Number of frames after any change during which nothing changes
+         */
+        int cooldown;
+
+        bool _present;
+    } PoseGovernor;
+
 }
 
 #endif //XMOTION_JSON_CONFIG_POSE_H
@@ -15,7 +15,11 @@
 #include "../core/utils/delta_loop.h"
 #include "../core/algo/i_logic.h"
 #include "../core/filter/i_filter.h"
+#include "../core/filter/chroma_key.h"
+#include "../core/sink/i_sink.h"
+#include "../core/sink/raw_recorder.h"
 #include "../core/utils/thread_pool.h"
+#include "../core/utils/quality_governor.h"
 #include "../core/camera/stereo_camera.h"
 
 namespace xm {
@@ -31,13 +35,37 @@ namespace xm {
         // ==== pointers managed externally ====
 
         std::vector<std::vector<std::unique_ptr<xm::Filter>>> filters;
+
+        /**
+         * Single chain for frames of every camera stacked together (see Misc::batch_filters), empty if not used.
+         * Per camera chains are empty while it is used, so background models exist only once
+         */
+        std::vector<std::unique_ptr<xm::Filter>> stacked_filters;
+
+        /**
+         * Frames of every camera stacked together, reused every frame
+         */
+        xm::ocl::Image2D stacked_frame;
+        std::vector<std::unique_ptr<xm::Sink>> sinks;
+        std::unique_ptr<xm::sink::RawRecorder> recorder;
         std::unique_ptr<xm::StereoCamera> camera;
         std::unique_ptr<xm::Logic> logic;
 
         xm::data::JsonConfig config;
         std::string project_file;
 
+        xm::util::QualityGovernor governor;
+
+        /**
+         * Per camera max pose quality level and configured filter resolution
+         */
+        std::vector<int> governor_pose_max;
+        std::vector<int> governor_base;
+
+        uint64_t published = 0;
+
         bool do_filter = false;
+        bool headless = false;
         bool bypass = false;
 
     public:
@@ -46,18 +74,75 @@ namespace xm {
                    const xm::data::JsonConfig &_config,
                    const std::string &_project_file);
 
+        /**
+         * Headless worker: no gui, filters and logic are started right away,
+         * results are available only through configured sinks
+         */
+        FileWorker(const xm::data::JsonConfig &_config,
+                   const std::string &_project_file);
+
+        ~FileWorker() override;
+
         void update(float dt, float latency, float fps) override;
 
+        /**
+         * Offline (batch) processing of recorded inputs, as fast as possible:
+         * decoding (file decoder threads), filtering and inference of consecutive
+         * frame sets are pipelined, every stage keeps frames in order.
+         * Blocks until the end of recordings or until alive is cleared.
+         */
+        void run_offline(const std::atomic<bool> &alive);
+
     private:
         void filter_frames(std::vector<xm::ocl::Image2D> &frames_in_out);
 
+        /**
+         * @return false if frames can't be filtered as a stack, frames are untouched then
+         * (stacked chain is replaced by per camera chains for good)
+         */
+        bool filter_stacked(std::vector<xm::ocl::Image2D> &frames_in_out);
+
         void prepare_gui();
 
         void prepare_cam();
 
         void prepare_logic();
 
-        void prepare_filters();
+        /**
+         * @param stacked single stacked chain for every camera if possible (see Misc::batch_filters)
+         */
+        void prepare_filters(bool stacked = true);
+
+        std::vector<std::unique_ptr<xm::Filter>> create_filters(const std::vector<xm::data::Filter> &chain);
+
+        /**
+         * @return true if filters of every camera can run as single stacked chain
+         */
+        [[nodiscard]] bool stackable() const;
+
+        void prepare_sinks();
+
+        void prepare_recorder();
+
+        void prepare_governor();
+
+        /**
+         * Persists tuned OpenCL work-group sizes in the cache directory (every mode, before any kernel launch)
+         */
+        void prepare_tuner();
+
+        /**
+         * @return misc.dnn_cache relative to the project file, empty if disabled
+         */
+        [[nodiscard]] std::string cache_dir() const;
+
+        void govern(float ms);
+
+        void apply_quality(int index, int level);
+
+        void publish_results(const xm::nview::Result &result);
+
+        static xm::filters::chroma::Conf chroma_conf(const xm::data::Chroma &conf, bool fused);
 
         void load_device_params();
 
@@ -32,6 +32,12 @@ private:
     std::vector<cv::Mat> frames;
     std::vector<bool> initialized;
 
+    /**
+     * Pending read of the next frame into mapped pixel buffer,
+     * displayed on the next render, so GUI thread does not wait for the device
+     */
+    std::vector<cl_event> cl_gl_pending;
+
     GLenum format = GL_RGB;
     int width = 0;
     int height = 0;
@@ -48,6 +54,31 @@ protected:
     cv::Mat fitSize(const cv::Mat &in) const;
     cv::UMat fitSize(const cv::UMat &in) const;
 
+    /**
+     * Renders texture letterboxed within current viewport, scaling is done by GPU
+     */
+    void renderFit(xogl::Texture1 &texture, int img_w, int img_h) const;
+
+    /**
+     * Reads frame directly into mapped pixel buffer (non-blocking),
+     * previous frame is uploaded and displayed once its read is complete
+     * @param buffer OpenCL buffer of the frame, nullptr for host frames
+     * @param offset offset of the frame within the buffer (bytes)
+     * @param size size of the frame (bytes)
+     * @param host host memory of the frame, used only without buffer
+     */
+    void renderStream(size_t num, cl_mem buffer, size_t offset, size_t size, int f_cols, int f_rows, int channels, const void *host);
+
+    /**
+     * Waits for pending write of the area (if any) and uploads its pixel buffer
+     */
+    void finishPending(size_t num);
+
+    /**
+     * Waits for and releases every pending write, pixel buffers are left as they are (textures are dropped)
+     */
+    void releasePending();
+
 public:
     GLImage() = default;
     ~GLImage() override;
@@ -0,0 +1,39 @@
+//
+// Created by henryco on 14/07/24.
+//
+
+#ifndef XMOTION_HEADLESS_BOOT_H
+#define XMOTION_HEADLESS_BOOT_H
+
+#include "data/json_config.h"
+#include "../core/boot/a_updated_boot.h"
+
+#include <spdlog/logger.h>
+#include <spdlog/sinks/stdout_color_sinks.h>
+
+namespace xm {
+
+    /**
+     * Same pipeline as FileBoot, but without any gui (no GTK, no GL context).
+     * Results are delivered through sinks configured in "output" section.
+     * Runs until SIGINT or SIGTERM.
+     */
+    class HeadlessBoot : public xm::UpdatedBoot {
+
+        static inline const auto log =
+                spdlog::stdout_color_mt("headless_boot");
+
+    protected:
+        xm::data::JsonConfig config;
+        std::string project_file;
+    public:
+        int boostrap(int &argc, char **&argv) override;
+
+        eox::util::DeltaWorker *worker() override;
+
+        void open_project(const char *argv) override;
+    };
+
+} // xm
+
+#endif //XMOTION_HEADLESS_BOOT_H
@@ -0,0 +1,37 @@
+//
+// Created by henryco on 21/07/24.
+//
+
+#ifndef XMOTION_OFFLINE_BOOT_H
+#define XMOTION_OFFLINE_BOOT_H
+
+#include "data/json_config.h"
+#include "../core/boot/i_boot.h"
+
+#include <spdlog/logger.h>
+#include <spdlog/sinks/stdout_color_sinks.h>
+
+namespace xm {
+
+    /**
+     * Batch processing of recorded sessions (video files or raw recordings as captures),
+     * no gui and no wall-clock pacing: runs as fast as possible until the end of recordings
+     * (or SIGINT / SIGTERM). Results are written through configured output sinks.
+     */
+    class OfflineBoot : public xm::Boot {
+
+        static inline const auto log =
+                spdlog::stdout_color_mt("offline_boot");
+
+    protected:
+        xm::data::JsonConfig config;
+        std::string project_file;
+    public:
+        void open_project(const char *argv) override;
+
+        int boot(int &argc, char **&argv) override;
+    };
+
+} // xm
+
+#endif //XMOTION_OFFLINE_BOOT_H